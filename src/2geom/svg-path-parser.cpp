@@ -33,6 +33,7 @@
 
 
 #include <cmath>
+#include <string>
 #include <vector>
 #include <glib.h>
 
@@ -44,6 +45,89 @@ namespace Geom {
 
 namespace {
 
+/**
+ * Converts the number in [start, end), which the state machine has already
+ * checked to be a valid SVG number, to a double.
+ *
+ * Numbers whose significand fits in 53 bits and whose decimal exponent is
+ * within the exactly representable powers of ten are converted with a single
+ * correctly rounded multiplication or division, which covers nearly all
+ * numbers found in path data. Anything else goes through g_ascii_strtod().
+ */
+double parse_number(char const *start, char const *end)
+{
+    static double const powers_of_ten[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    static guint64 const max_exact = G_GUINT64_CONSTANT(1) << 53;
+    int const max_digits = 19; // any 19 digit number fits in 64 bits
+
+    char const *p = start;
+    bool negative = false;
+    if (p != end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    guint64 significand = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool overflow = false;
+    for (; p != end && g_ascii_isdigit(*p); ++p) {
+        if (digits < max_digits) {
+            significand = significand * 10 + (*p - '0');
+            if (significand) {
+                ++digits;
+            }
+        } else {
+            overflow = true;
+            ++exponent;
+        }
+    }
+    if (p != end && *p == '.') {
+        for (++p; p != end && g_ascii_isdigit(*p); ++p) {
+            if (digits < max_digits) {
+                significand = significand * 10 + (*p - '0');
+                if (significand) {
+                    ++digits;
+                }
+                --exponent;
+            } else {
+                overflow = true;
+            }
+        }
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negative_exponent = false;
+        if (p != end && (*p == '+' || *p == '-')) {
+            negative_exponent = (*p == '-');
+            ++p;
+        }
+        int written = 0;
+        for (; p != end && g_ascii_isdigit(*p); ++p) {
+            if (written < 10000) {
+                written = written * 10 + (*p - '0');
+            }
+        }
+        exponent += negative_exponent ? -written : written;
+    }
+
+    if (!overflow && significand <= max_exact && exponent >= -22 && exponent <= 22) {
+        double value = static_cast<double>(significand);
+        if (exponent < 0) {
+            value /= powers_of_ten[-exponent];
+        } else {
+            value *= powers_of_ten[exponent];
+        }
+        return negative ? -value : value;
+    }
+
+    std::string buf(start, end);
+    return g_ascii_strtod(buf.c_str(), NULL);
+}
+
 class Parser {
 public:
     Parser(SVGPathSink &sink) : _absolute(false), _sink(sink) {}
@@ -1244,9 +1328,7 @@ _match:
 	case 1:
 #line 160 "/opt/shared/work/programming/eclipse/eclipse_3.4/lib2geom/src/2geom/svg-path-parser.rl"
 	{
-            char const *end=p;
-            std::string buf(start, end);
-            _push(g_ascii_strtod(buf.c_str(), NULL));
+            _push(parse_number(start, p));
             start = NULL;
         }
 	break;
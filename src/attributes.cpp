@@ -522,6 +522,20 @@ sp_attribute_name(unsigned int id)
     return (unsigned char*)props[id].name;
 }
 
+GQuark
+sp_attribute_key(unsigned int id)
+{
+    static GQuark keys[G_N_ELEMENTS(props)] = { 0 };
+
+    if (id >= n_attrs) {
+        return 0;
+    }
+    if (!keys[id]) {
+        keys[id] = g_quark_from_static_string(props[id].name);
+    }
+    return keys[id];
+}
+
 
 /*
   Local Variables:
@@ -17,6 +17,10 @@
 
 unsigned int sp_attribute_lookup(gchar const *key);
 unsigned char const *sp_attribute_name(unsigned int id);
+/**
+ * The GQuark of the name of attribute id, for Node::attributeByKey and friends.
+ */
+GQuark sp_attribute_key(unsigned int id);
 
 /**
  * True iff k is a property in SVG, i.e. something that can be written either in a style attribute
@@ -77,6 +77,18 @@ CompositeUndoStackObserver::notifyUndoCommitEvent(Event* log)
 	this->_unlock();
 }
 
+void
+CompositeUndoStackObserver::notifyUndoExpiredEvent(Event* log)
+{
+	this->_lock();
+	for(UndoObserverRecordList::iterator i = this->_active.begin(); i != _active.end(); ++i) {
+		if (!i->to_remove) {
+			i->issueUndoExpired(log);
+		}
+	}
+	this->_unlock();
+}
+
 void
 CompositeUndoStackObserver::notifyClearUndoEvent()
 {
@@ -83,6 +83,17 @@ public:
 			this->_observer.notifyUndoCommitEvent(log);
 		}
 
+		/**
+		 * Issues an expired event to the UndoStackObserver that is associated with this
+		 * UndoStackObserverRecord.
+		 *
+		 * \param log The event log being dropped from the undo stack.
+		 */
+		void issueUndoExpired(Event* log)
+		{
+			this->_observer.notifyUndoExpiredEvent(log);
+		}
+
 		/**
 		 * Issue a clear undo event to the UndoStackObserver
 		 * that is associated with this
@@ -152,6 +163,13 @@ public:
 	 */
 	void notifyUndoCommitEvent(Event* log);
 
+	/**
+	 * Notify all registered UndoStackObservers of an event log being dropped from the undo stack.
+	 *
+	 * \param log The event log being dropped from the undo stack.
+	 */
+	void notifyUndoExpiredEvent(Event* log);
+
 	virtual void notifyClearUndoEvent();
 	virtual void notifyClearRedoEvent();
 
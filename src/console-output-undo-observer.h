@@ -28,6 +28,7 @@ public:
     void notifyUndoEvent(Event* log);
     void notifyRedoEvent(Event* log);
     void notifyUndoCommitEvent(Event* log);
+    void notifyUndoExpiredEvent(Event* log);
     void notifyClearUndoEvent();
     void notifyClearRedoEvent();
 
@@ -157,6 +157,7 @@ Pixbuf::Pixbuf(cairo_surface_t *s)
         cairo_image_surface_get_stride(s), NULL, NULL))
     , _surface(s)
     , _mod_time(0)
+    , _stamp(0)
     , _pixel_format(PF_CAIRO)
     , _cairo_store(true)
 {}
@@ -168,6 +169,7 @@ Pixbuf::Pixbuf(GdkPixbuf *pb)
     : _pixbuf(pb)
     , _surface(0)
     , _mod_time(0)
+    , _stamp(0)
     , _pixel_format(PF_GDK)
     , _cairo_store(false)
 {
@@ -183,6 +185,7 @@ Pixbuf::Pixbuf(Inkscape::Pixbuf const &other)
         gdk_pixbuf_get_pixels(_pixbuf), CAIRO_FORMAT_ARGB32,
         gdk_pixbuf_get_width(_pixbuf), gdk_pixbuf_get_height(_pixbuf), gdk_pixbuf_get_rowstride(_pixbuf)))
     , _mod_time(other._mod_time)
+    , _stamp(0)
     , _path(other._path)
     , _pixel_format(other._pixel_format)
     , _cairo_store(false)
@@ -426,6 +429,7 @@ guchar *Pixbuf::pixels() {
 }
 void Pixbuf::markDirty() {
     cairo_surface_mark_dirty(_surface);
+    ++_stamp;
 }
 
 void Pixbuf::_forceAlpha()
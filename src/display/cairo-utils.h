@@ -108,6 +108,8 @@ public:
     guchar const *pixels() const;
     guchar *pixels();
     void markDirty();
+    /** Incremented by markDirty(), so that data derived from the pixels can tell it is stale. */
+    unsigned stamp() const { return _stamp; }
 
     bool hasMimeData() const;
     guchar const *getMimeData(gsize &len, std::string &mimetype) const;
@@ -129,6 +131,7 @@ private:
     GdkPixbuf *_pixbuf;
     cairo_surface_t *_surface;
     time_t _mod_time;
+    unsigned _stamp;
     std::string _path;
     PixelFormat _pixel_format;
     bool _cairo_store;
@@ -21,6 +21,7 @@
 #include "sp-defs.h"
 #include "sp-root.h"
 #include "document.h"
+#include "util/unordered-containers.h"
 
 #include "composite-undo-stack-observer.h"
 
@@ -47,6 +48,11 @@ struct SPDocumentPrivate {
 	/** Dictionary of signals for id changes */
 	IDChangedSignalMap id_changed_signals;
 
+	/* Children left unbuilt until looked up, see SPDocument::deferBuild() */
+	INK_UNORDERED_SET<Inkscape::XML::Node *> deferred;
+	/* Ids in the deferred subtrees, to the deferred child holding each; may be stale */
+	INK_UNORDERED_MAP<GQuark, Inkscape::XML::Node *> deferred_ids;
+
 	/* Resources */
 	/* It is GHashTable of GSLists */
 	GHashTable *resources;
@@ -63,6 +69,7 @@ struct SPDocumentPrivate {
 	bool sensitive: true; /* If we save actions to undo stack */
 	Inkscape::XML::Event * partial; /* partial undo log when interrupted */
 	int history_size;
+	std::size_t undo_memory; /* Bytes held by the undo and redo stacks */
 	GSList * undo; /* Undo stack of reprs */
 	GSList * redo; /* Redo stack of reprs */
 
@@ -0,0 +1,116 @@
+#ifndef SEEN_DOCUMENT_SUBSET_TEST_H
+#define SEEN_DOCUMENT_SUBSET_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <cstring>
+#include <vector>
+#include <sigc++/functors/mem_fun.h>
+
+#include "document.h"
+#include "document-subset.h"
+#include "sp-object.h"
+#include "xml/node.h"
+
+class DocumentSubsetTest : public CxxTest::TestSuite
+{
+public:
+    static DocumentSubsetTest *createSuite() { return new DocumentSubsetTest(); }
+    static void destroySuite( DocumentSubsetTest *suite ) { delete suite; }
+
+    void testFollowsAdditionsReordersAndRemovals()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg'>"
+            "<g id='a'><g id='a1'/><g id='a2'/></g>"
+            "<g id='b'/>"
+            "<g id='c'/>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        SPObject *root = doc->getRoot();
+        SPObject *a = doc->getObjectById("a");
+        SPObject *a1 = doc->getObjectById("a1");
+        SPObject *a2 = doc->getObjectById("a2");
+        SPObject *b = doc->getObjectById("b");
+        SPObject *c = doc->getObjectById("c");
+        TS_ASSERT(a && a1 && a2 && b && c);
+        if ( a && a1 && a2 && b && c ) {
+            TestSubset *subset = new TestSubset();
+            subset->connectReordered(sigc::mem_fun(*this, &DocumentSubsetTest::reordered));
+
+            // ancestors added after their descendants take them over
+            subset->add(root);
+            subset->add(c);
+            subset->add(a1);
+            subset->add(a2);
+            subset->add(b);
+            TS_ASSERT_EQUALS(subset->childCount(root), 4u);
+            subset->add(a);
+
+            TS_ASSERT_EQUALS(subset->childCount(NULL), 1u);
+            TS_ASSERT_EQUALS(subset->childCount(root), 3u);
+            TS_ASSERT_EQUALS(subset->nthChildOf(root, 0), a);
+            TS_ASSERT_EQUALS(subset->nthChildOf(root, 1), b);
+            TS_ASSERT_EQUALS(subset->nthChildOf(root, 2), c);
+            TS_ASSERT(!subset->nthChildOf(root, 3));
+            TS_ASSERT_EQUALS(subset->childCount(a), 2u);
+            TS_ASSERT_EQUALS(subset->indexOf(a2), 1u);
+            TS_ASSERT_EQUALS(subset->parentOf(a1), a);
+
+            // moving c to the front of the document moves it in the subset
+            Inkscape::XML::Node *root_repr = root->getRepr();
+            root_repr->changeOrder(c->getRepr(), NULL);
+            TS_ASSERT_EQUALS(_reordered.size(), 1u);
+            if ( !_reordered.empty() ) {
+                TS_ASSERT_EQUALS(_reordered.front(), c);
+            }
+            TS_ASSERT_EQUALS(subset->indexOf(c), 0u);
+            TS_ASSERT_EQUALS(subset->indexOf(a), 1u);
+            TS_ASSERT_EQUALS(subset->indexOf(b), 2u);
+
+            // the children of a removed object take its place
+            subset->remove(a);
+            TS_ASSERT_EQUALS(subset->childCount(root), 4u);
+            TS_ASSERT_EQUALS(subset->parentOf(a1), root);
+            TS_ASSERT_EQUALS(subset->indexOf(a1), 1u);
+            TS_ASSERT_EQUALS(subset->indexOf(a2), 2u);
+            TS_ASSERT_EQUALS(subset->indexOf(b), 3u);
+
+            subset->clear();
+            delete subset;
+        }
+
+        doc->doUnref();
+    }
+
+private:
+    class TestSubset : public Inkscape::DocumentSubset {
+    public:
+        void add(SPObject *obj) { _addOne(obj); }
+        void remove(SPObject *obj) { _removeOne(obj); }
+        void clear() { _clear(); }
+    };
+
+    void reordered(SPObject *obj) { _reordered.push_back(obj); }
+
+    std::vector<SPObject *> _reordered;
+};
+
+#endif // SEEN_DOCUMENT_SUBSET_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
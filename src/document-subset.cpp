@@ -20,6 +20,7 @@
 
 #include "util/list.h"
 #include "util/reverse-list.h"
+#include "util/unordered-containers.h"
 
 #include <vector>
 #include <map>
@@ -34,21 +35,29 @@ struct DocumentSubset::Relations : public GC::Managed<GC::ATOMIC>,
     typedef std::vector<SPObject *> Siblings;
 
     struct Record {
+        typedef INK_UNORDERED_MAP<SPObject *, unsigned> Positions;
+
         SPObject *parent;
         Siblings children;
 
+        /* index of each child, correct for the first indexed children */
+        Positions positions;
+        unsigned indexed;
+
         sigc::connection release_connection;
         sigc::connection position_changed_connection;
 
-        Record() : parent(NULL) {}
+        Record() : parent(NULL), indexed(0) {}
 
         unsigned childIndex(SPObject *obj) {
-            Siblings::iterator found;
-            found = std::find(children.begin(), children.end(), obj);
-            if ( found != children.end() ) {
-                return found - children.begin();
+            for ( ; indexed < children.size() ; ++indexed ) {
+                positions[children[indexed]] = indexed;
+            }
+            Positions::iterator found = positions.find(obj);
+            if ( found != positions.end() ) {
+                return found->second;
             } else {
-                return 0;
+                return children.size();
             }
         }
 
@@ -87,53 +96,57 @@ struct DocumentSubset::Relations : public GC::Managed<GC::ATOMIC>,
             }
         }
 
+        template <typename InputIterator>
+        void insertChildren(unsigned index, InputIterator first, InputIterator last) {
+            children.insert(children.begin()+index, first, last);
+            indexed = std::min(indexed, index);
+        }
+
+        void eraseChildren(unsigned first, unsigned last) {
+            for ( unsigned i = first ; i < last ; ++i ) {
+                positions.erase(children[i]);
+            }
+            children.erase(children.begin()+first, children.begin()+last);
+            indexed = std::min(indexed, first);
+        }
+
         void addChild(SPObject *obj) {
             unsigned index=findInsertIndex(obj);
-            children.insert(children.begin()+index, obj);
+            insertChildren(index, &obj, &obj + 1);
         }
 
+        /* An object sorts after its descendants, so those among the children
+         * are right before the place it would be inserted at. */
         template <typename OutputIterator>
-        void extractDescendants(OutputIterator descendants,
-                                SPObject *obj)
+        unsigned extractDescendants(OutputIterator descendants,
+                                    SPObject *obj)
         {
-            Siblings new_children;
-            bool found_one=false;
-            for ( Siblings::iterator iter=children.begin()
-                ; iter != children.end() ; ++iter )
-            {
-                if (obj->isAncestorOf(*iter)) {
-                    if (!found_one) {
-                        found_one = true;
-                        new_children.insert(new_children.end(),
-                                            children.begin(), iter);
-                    }
-                    *descendants++ = *iter;
-                } else if (found_one) {
-                    new_children.push_back(*iter);
-                }
-            }
-            if (found_one) {
-                children.swap(new_children);
+            unsigned last=findInsertIndex(obj);
+            unsigned first=last;
+            while ( first > 0 && obj->isAncestorOf(children[first-1]) ) {
+                --first;
             }
+            std::copy(children.begin()+first, children.begin()+last, descendants);
+            eraseChildren(first, last);
+            return first;
         }
 
         unsigned removeChild(SPObject *obj) {
-            Siblings::iterator found;
-            found = std::find(children.begin(), children.end(), obj);
-            unsigned index = found - children.begin();
-            if ( found != children.end() ) {
-                children.erase(found);
+            unsigned index = childIndex(obj);
+            if ( index < children.size() ) {
+                eraseChildren(index, index + 1);
             }
             return index;
         }
     };
 
-    typedef std::map<SPObject *, Record> Map;
+    typedef INK_UNORDERED_MAP<SPObject *, Record> Map;
     Map records;
 
     sigc::signal<void> changed_signal;
     sigc::signal<void, SPObject *> added_signal;
     sigc::signal<void, SPObject *> removed_signal;
+    sigc::signal<void, SPObject *> reordered_signal;
 
     Relations() { records[NULL]; }
 
@@ -187,13 +200,7 @@ private:
         Record &record=records[obj];
 
         if ( record.parent == NULL ) {
-            Record &root = records[NULL];
-            for ( Siblings::iterator it = root.children.begin(); it != root.children.end(); ++it ) {
-                if ( *it == obj ) {
-                    root.children.erase( it );
-                    break;
-                }
-            }
+            records[NULL].removeChild(obj);
         }
 
         record.release_connection.disconnect();
@@ -252,7 +259,7 @@ void DocumentSubset::Relations::addOne(SPObject *obj) {
     Siblings &children=record.children;
 
     /* reparent descendants of obj to obj */
-    parent_record->extractDescendants(
+    unsigned index=parent_record->extractDescendants(
         std::back_insert_iterator<Siblings>(children),
         obj
     );
@@ -264,8 +271,8 @@ void DocumentSubset::Relations::addOne(SPObject *obj) {
         child_record->parent = obj;
     }
 
-    /* add obj to the child list */
-    parent_record->addChild(obj);
+    /* add obj to the child list, where its descendants were */
+    parent_record->insertChildren(index, &obj, &obj + 1);
 
     _notifyAdded(obj);
     changed_signal.emit();
@@ -286,10 +293,8 @@ void DocumentSubset::Relations::remove(SPObject *obj, bool subtree) {
         _doRemoveSubtree(obj);
     } else {
         /* reparent obj's orphaned children to their grandparent */
-        Siblings &siblings=parent_record->children;
         Siblings &children=record->children;
-        siblings.insert(siblings.begin()+index,
-                        children.begin(), children.end());
+        parent_record->insertChildren(index, children.begin(), children.end());
 
         for ( Siblings::iterator iter=children.begin()
             ; iter != children.end() ; ++iter)
@@ -329,19 +334,29 @@ void DocumentSubset::Relations::reorder(SPObject *obj) {
         /* move the object if it's in the subset */
         parent_record->removeChild(obj);
         parent_record->addChild(obj);
+        reordered_signal.emit(obj);
         changed_signal.emit();
     } else {
-        /* otherwise, move any top-level descendants */
+        /* otherwise, move any top-level descendants; they are no longer
+         * next to each other, so look through all the children */
         Siblings descendants;
-        parent_record->extractDescendants(
-            std::back_insert_iterator<Siblings>(descendants),
-            obj
-        );
+        Siblings &family=parent_record->children;
+        for ( unsigned i = 0 ; i < family.size() ; ) {
+            if (obj->isAncestorOf(family[i])) {
+                descendants.push_back(family[i]);
+                parent_record->eraseChildren(i, i + 1);
+            } else {
+                ++i;
+            }
+        }
         if (!descendants.empty()) {
             unsigned index=parent_record->findInsertIndex(obj);
-            Siblings &family=parent_record->children;
-            family.insert(family.begin()+index,
-                          descendants.begin(), descendants.end());
+            parent_record->insertChildren(index, descendants.begin(), descendants.end());
+            for ( Siblings::iterator iter=descendants.begin()
+                ; iter != descendants.end() ; ++iter )
+            {
+                reordered_signal.emit(*iter);
+            }
             changed_signal.emit();
         }
     }
@@ -374,14 +389,14 @@ unsigned DocumentSubset::childCount(SPObject *obj) const {
 }
 
 unsigned DocumentSubset::indexOf(SPObject *obj) const {
-    SPObject *parent=parentOf(obj);
-    Relations::Record *record=_relations->get(parent);
-    return ( record ? record->childIndex(obj) : 0 );
+    Relations::Record *record=_relations->get(obj);
+    Relations::Record *parent_record=( record ? _relations->get(record->parent) : NULL );
+    return ( parent_record ? parent_record->childIndex(obj) : 0 );
 }
 
 SPObject *DocumentSubset::nthChildOf(SPObject *obj, unsigned n) const {
     Relations::Record *record=_relations->get(obj);
-    return ( record ? record->children[n] : NULL );
+    return ( record && n < record->children.size() ? record->children[n] : NULL );
 }
 
 sigc::connection DocumentSubset::connectChanged(sigc::slot<void> slot) const {
@@ -398,6 +413,11 @@ DocumentSubset::connectRemoved(sigc::slot<void, SPObject *> slot) const {
     return _relations->removed_signal.connect(slot);
 }
 
+sigc::connection
+DocumentSubset::connectReordered(sigc::slot<void, SPObject *> slot) const {
+    return _relations->reordered_signal.connect(slot);
+}
+
 }
 
 /*
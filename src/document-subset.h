@@ -36,6 +36,8 @@ public:
     sigc::connection connectChanged(sigc::slot<void> slot) const;
     sigc::connection connectAdded(sigc::slot<void, SPObject *> slot) const;
     sigc::connection connectRemoved(sigc::slot<void, SPObject *> slot) const;
+    /// Emitted for each object whose position among its siblings changed
+    sigc::connection connectReordered(sigc::slot<void, SPObject *> slot) const;
 
 protected:
     DocumentSubset();
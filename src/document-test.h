@@ -0,0 +1,198 @@
+#ifndef SEEN_DOCUMENT_TEST_H
+#define SEEN_DOCUMENT_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <cstring>
+
+#include "display/drawing.h"
+#include "document.h"
+#include "sp-item.h"
+#include "sp-object.h"
+#include "sp-root.h"
+#include "xml/node.h"
+
+class DocumentTest : public CxxTest::TestSuite
+{
+public:
+    static DocumentTest *createSuite() { return new DocumentTest(); }
+    static void destroySuite( DocumentTest *suite ) { delete suite; }
+
+    void testDeferredBuild()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg' xmlns:xlink='http://www.w3.org/1999/xlink'"
+            " xmlns:inkscape='http://www.inkscape.org/namespaces/inkscape'>"
+            "<defs id='defs'>"
+            "<symbol id='used'><rect width='5' height='5'/></symbol>"
+            "<symbol id='unused'><rect id='inner' width='5' height='5'/></symbol>"
+            "</defs>"
+            "<use id='u' xlink:href='#used'/>"
+            "<g id='layer' inkscape:groupmode='layer' style='display:none'>"
+            "<rect id='h1' width='10' height='10'/>"
+            "<g id='sublayer' inkscape:groupmode='layer'/>"
+            "<rect id='h2' width='10' height='10'/>"
+            "</g>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        SPObject *defs = doc->getObjectById("defs");
+        SPObject *layer = doc->getObjectById("layer");
+        TS_ASSERT(defs && layer);
+        if ( defs && layer ) {
+            // the referenced symbol and the sublayer are built, the rest waits
+            TS_ASSERT_EQUALS( children(defs), 1u );
+            TS_ASSERT_EQUALS( children(layer), 1u );
+
+            // looking up an id inside a deferred symbol builds the symbol
+            SPObject *inner = doc->getObjectById("inner");
+            TS_ASSERT( inner && inner->parent == doc->getObjectById("unused") );
+            TS_ASSERT_EQUALS( children(defs), 2u );
+
+            SPObject *h2 = doc->getObjectById("h2");
+            TS_ASSERT( h2 && h2->parent == layer );
+            TS_ASSERT_EQUALS( children(layer), 2u );
+            TS_ASSERT_EQUALS( layer->lastChild(), h2 );
+
+            // showing the layer builds everything in it, in document order
+            layer->getRepr()->setAttribute("style", "display:inline");
+            doc->ensureUpToDate();
+            TS_ASSERT_EQUALS( children(layer), 3u );
+            TS_ASSERT_EQUALS( layer->firstChild(), doc->getObjectById("h1") );
+        }
+
+        doc->doUnref();
+    }
+
+    void testVacuumKeepsDefsOfHiddenLayers()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg'"
+            " xmlns:inkscape='http://www.inkscape.org/namespaces/inkscape'>"
+            "<defs id='defs'>"
+            "<linearGradient id='grad'><stop offset='0' style='stop-color:#000'/></linearGradient>"
+            "<linearGradient id='unused-grad'><stop offset='0' style='stop-color:#fff'/></linearGradient>"
+            "</defs>"
+            "<g id='layer' inkscape:groupmode='layer' style='display:none'>"
+            "<rect id='r' width='10' height='10' style='fill:url(#grad)'/>"
+            "</g>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        doc->vacuumDocument();
+        TS_ASSERT( doc->getObjectById("grad") );
+        TS_ASSERT( !doc->getObjectById("unused-grad") );
+
+        doc->doUnref();
+    }
+
+    void testItemQueries()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg' width='100' height='100'"
+            " xmlns:inkscape='http://www.inkscape.org/namespaces/inkscape'"
+            " xmlns:sodipodi='http://sodipodi.sourceforge.net/DTD/sodipodi-0.dtd'>"
+            "<defs><rect id='def' x='0' y='0' width='100' height='100'/></defs>"
+            "<g id='layer' inkscape:groupmode='layer'>"
+            "<rect id='bottom' x='0' y='0' width='20' height='20'/>"
+            "<g id='group'><rect id='inner' x='10' y='10' width='20' height='20'/></g>"
+            "<rect id='top' x='15' y='15' width='20' height='20'/>"
+            "<rect id='hidden' x='50' y='50' width='10' height='10' style='display:none'/>"
+            "<rect id='locked' x='70' y='70' width='10' height='10' sodipodi:insensitive='true'/>"
+            "</g>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        // without a viewBox, drawing and document coordinates are the same
+        Inkscape::Drawing drawing;
+        unsigned const dkey = SPItem::display_key_new(1);
+        drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+        drawing.update();
+
+        SPItem *bottom = item(doc, "bottom");
+        SPItem *group = item(doc, "group");
+        SPItem *inner = item(doc, "inner");
+        SPItem *top = item(doc, "top");
+        TS_ASSERT(bottom && group && inner && top);
+        if ( bottom && group && inner && top ) {
+            // topmost first, below upto, and into groups only when asked to
+            Geom::Point const overlap(17, 17);
+            TS_ASSERT_EQUALS( doc->getItemAtPoint(dkey, overlap, FALSE, NULL), top );
+            TS_ASSERT_EQUALS( doc->getItemAtPoint(dkey, overlap, FALSE, top), group );
+            TS_ASSERT_EQUALS( doc->getItemAtPoint(dkey, overlap, TRUE, top), inner );
+            TS_ASSERT_EQUALS( doc->getItemAtPoint(dkey, overlap, FALSE, group), bottom );
+            TS_ASSERT( !doc->getItemAtPoint(dkey, overlap, FALSE, bottom) );
+            TS_ASSERT_EQUALS( doc->getGroupAtPoint(dkey, Geom::Point(25, 12)), group );
+
+            // hidden and locked items are not picked, nor is anything in defs
+            TS_ASSERT( !doc->getItemAtPoint(dkey, Geom::Point(55, 55), FALSE, NULL) );
+            TS_ASSERT( !doc->getItemAtPoint(dkey, Geom::Point(75, 75), FALSE, NULL) );
+            TS_ASSERT( !doc->getItemAtPoint(dkey, Geom::Point(90, 10), FALSE, NULL) );
+
+            // boxes are in desktop coordinates, with y flipped; results come in z-order
+            Geom::Rect const all(Geom::Point(-1, -1), Geom::Point(101, 101));
+            GSList *items = doc->getItemsInBox(dkey, all);
+            TS_ASSERT_EQUALS( g_slist_length(items), 3u );
+            TS_ASSERT_EQUALS( g_slist_nth_data(items, 0), bottom );
+            TS_ASSERT_EQUALS( g_slist_nth_data(items, 1), group );
+            TS_ASSERT_EQUALS( g_slist_nth_data(items, 2), top );
+            g_slist_free(items);
+
+            Geom::Rect const corner(Geom::Point(0, 95), Geom::Point(5, 100));
+            items = doc->getItemsInBox(dkey, corner);
+            TS_ASSERT( !items );
+            g_slist_free(items);
+            items = doc->getItemsPartiallyInBox(dkey, corner);
+            TS_ASSERT_EQUALS( g_slist_length(items), 1u );
+            TS_ASSERT_EQUALS( g_slist_nth_data(items, 0), bottom );
+            g_slist_free(items);
+        }
+
+        doc->getRoot()->invoke_hide(dkey);
+        doc->doUnref();
+    }
+
+private:
+    static SPItem *item(SPDocument *doc, gchar const *id)
+    {
+        SPObject *object = doc->getObjectById(id);
+        return SP_IS_ITEM(object) ? SP_ITEM(object) : NULL;
+    }
+
+    static unsigned children(SPObject *object)
+    {
+        unsigned count = 0;
+        for (SPObject *child = object->firstChild(); child; child = child->getNext()) {
+            count++;
+        }
+        return count;
+    }
+};
+
+#endif // SEEN_DOCUMENT_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -67,6 +67,7 @@
 #include "debug/simple-event.h"
 #include "debug/timestamp.h"
 #include "event.h"
+#include "preferences.h"
 
 
 /*
@@ -128,6 +129,9 @@ using Inkscape::Verb;
 
 typedef SimpleEvent<Event::INTERACTION> InteractionEvent;
 
+/// Attribute values and contents shorter than this are never packed in the undo stack
+std::size_t const PACK_THRESHOLD = 4096;
+
 class CommitEvent : public InteractionEvent {
 public:
 
@@ -150,6 +154,29 @@ public:
 
 }
 
+/**
+ * Drops the oldest entries of the undo stack while the undo and redo stacks together
+ * hold more than \a limit MiB; 0 means no limit. The latest entry is always kept.
+ */
+static void expire_undo(SPDocument *doc, int limit)
+{
+    if (limit <= 0) {
+        return;
+    }
+    std::size_t const bytes = static_cast<std::size_t>(limit) << 20;
+
+    while (doc->priv->undo_memory > bytes && doc->priv->undo && doc->priv->undo->next) {
+        GSList *oldest = g_slist_last(doc->priv->undo);
+        Inkscape::Event *event = (Inkscape::Event *) oldest->data;
+        doc->priv->undo = g_slist_delete_link(doc->priv->undo, oldest);
+        doc->priv->history_size--;
+        doc->priv->undo_memory -= event->memory_use;
+
+        doc->priv->undoStackObservers.notifyUndoExpiredEvent(event);
+        delete event;
+    }
+}
+
 void Inkscape::DocumentUndo::maybeDone(SPDocument *doc, const gchar *key, const unsigned int event_type,
                                        Glib::ustring const &event_description)
 {
@@ -176,16 +203,28 @@ void Inkscape::DocumentUndo::maybeDone(SPDocument *doc, const gchar *key, const
 		return;
 	}
 
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        if (prefs->getBool("/options/undo/compress", true)) {
+            sp_repr_pack_log(log, PACK_THRESHOLD);
+        }
+
 	if (key && !doc->actionkey.empty() && (doc->actionkey == key) && doc->priv->undo) {
-                ((Inkscape::Event *)doc->priv->undo->data)->event =
-                    sp_repr_coalesce_log (((Inkscape::Event *)doc->priv->undo->data)->event, log);
+                Inkscape::Event *event = (Inkscape::Event *)doc->priv->undo->data;
+                // coalescing may merge a few changes, so this overestimates a little
+                std::size_t const added = sp_repr_log_memory_use(log);
+                event->event = sp_repr_coalesce_log (event->event, log);
+                event->memory_use += added;
+                doc->priv->undo_memory += added;
 	} else {
                 Inkscape::Event *event = new Inkscape::Event(log, event_type, event_description);
                 doc->priv->undo = g_slist_prepend (doc->priv->undo, event);
 		doc->priv->history_size++;
+                doc->priv->undo_memory += event->memory_use;
 		doc->priv->undoStackObservers.notifyUndoCommitEvent(event);
 	}
 
+        expire_undo(doc, prefs->getInt("/options/undo/memorylimit", 256));
+
         if ( key ) {
             doc->actionkey = key;
         } else {
@@ -226,6 +265,7 @@ static void finish_incomplete_transaction(SPDocument &doc) {
 		sp_repr_debug_print_log(priv.partial);
                 Inkscape::Event *event = new Inkscape::Event(priv.partial);
 		priv.undo = g_slist_prepend(priv.undo, event);
+                priv.undo_memory += event->memory_use;
                 priv.undoStackObservers.notifyUndoCommitEvent(event);
 		priv.partial = NULL;
 	}
@@ -332,6 +372,7 @@ void Inkscape::DocumentUndo::clearUndo(SPDocument *doc)
 		current = doc->priv->undo;
 		doc->priv->undo = current->next;
 		doc->priv->history_size--;
+                doc->priv->undo_memory -= ((Inkscape::Event *) current->data)->memory_use;
 
                 delete ((Inkscape::Event *) current->data);
 		g_slist_free_1 (current);
@@ -349,11 +390,21 @@ void Inkscape::DocumentUndo::clearRedo(SPDocument *doc)
 		current = doc->priv->redo;
 		doc->priv->redo = current->next;
 		doc->priv->history_size--;
+                doc->priv->undo_memory -= ((Inkscape::Event *) current->data)->memory_use;
 
                 delete ((Inkscape::Event *) current->data);
 		g_slist_free_1 (current);
 	}
 }
+
+std::size_t Inkscape::DocumentUndo::getMemoryUse(SPDocument const *document)
+{
+    g_assert(document != NULL);
+    g_assert(document->priv != NULL);
+
+    return document->priv->undo_memory;
+}
+
 /*
   Local Variables:
   mode:c++
@@ -1,6 +1,8 @@
 #ifndef SEEN_SP_DOCUMENT_UNDO_H
 #define SEEN_SP_DOCUMENT_UNDO_H
 
+#include <cstddef>
+
 typedef struct _GObject GObject;
 
 class SPDesktop;
@@ -44,6 +46,14 @@ public:
     static gboolean undo(SPDocument *document);
 
     static gboolean redo(SPDocument *document);
+
+    /**
+     * Number of bytes held by the undo and redo stacks of \a document.
+     *
+     * The undo stack is kept under the "/options/undo/memorylimit" preference, in MiB,
+     * by dropping its oldest entries; the latest entry is always kept.
+     */
+    static std::size_t getMemoryUse(SPDocument const *document);
 };
 
 } // namespace Inkscape
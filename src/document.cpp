@@ -39,8 +39,10 @@
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #endif
+#include <algorithm>
 #include <string>
 #include <cstring>
+#include <vector>
 #include <2geom/transforms.h>
 
 #include "widgets/desktop-widget.h"
@@ -52,19 +54,27 @@
 #include "id-clash.h"
 #include "inkscape-private.h"
 #include "inkscape-version.h"
+#include "id-reference-index.h"
+#include "item-bounds-index.h"
 #include "libavoid/router.h"
+#include "object-property-index.h"
 #include "persp3d.h"
 #include "preferences.h"
 #include "profile-manager.h"
 #include "rdf.h"
+#include "sp-defs.h"
 #include "sp-factory.h"
 #include "sp-item-group.h"
 #include "sp-namedview.h"
 #include "sp-symbol.h"
+#include "style.h"
+#include "style-selector-index.h"
 #include "transf_mat_3x4.h"
 #include "util/units.h"
+#include "xml/node-fns.h"
 #include "xml/repr.h"
 #include "xml/rebase-hrefs.h"
+#include "xml/simple-document.h"
 #include "libcroco/cr-cascade.h"
 
 using Inkscape::DocumentUndo;
@@ -96,6 +106,11 @@ SPDocument::SPDocument() :
     rroot(0),
     root(0),
     style_cascade(cr_cascade_new(NULL, NULL, NULL)),
+    style_index(new Inkscape::StyleSelectorIndex()),
+    item_index(new Inkscape::ItemBoundsIndex()),
+    reference_index(new Inkscape::IdReferenceIndex()),
+    property_index(new Inkscape::ObjectPropertyIndex()),
+    update_counters(),
     uri(0),
     base(0),
     name(0),
@@ -126,6 +141,7 @@ SPDocument::SPDocument() :
     p->sensitive = FALSE;
     p->partial = NULL;
     p->history_size = 0;
+    p->undo_memory = 0;
     p->undo = NULL;
     p->redo = NULL;
     p->seeking = false;
@@ -160,6 +176,10 @@ SPDocument::~SPDocument() {
         DocumentUndo::clearRedo(this);
         DocumentUndo::clearUndo(this);
 
+        // nothing is built on demand while tearing down
+        priv->deferred.clear();
+        priv->deferred_ids.clear();
+
         if (root) {
             root->releaseReferences();
             sp_object_unref(root);
@@ -179,6 +199,8 @@ SPDocument::~SPDocument() {
         priv = NULL;
     }
 
+    delete style_index;
+    style_index = NULL;
     cr_cascade_unref(style_cascade);
     style_cascade = NULL;
 
@@ -226,6 +248,13 @@ SPDocument::~SPDocument() {
     // This is at the end of the destructor, because preceding code adds new orphans to the queue
     collectOrphans();
 
+    delete item_index;
+    item_index = NULL;
+    delete reference_index;
+    reference_index = NULL;
+    delete property_index;
+    property_index = NULL;
+
     //delete this->_whiteboard_session_manager;
 }
 
@@ -474,23 +503,32 @@ SPDocument *SPDocument::createDoc(Inkscape::XML::Document *rdoc,
  * appears in document list.
  */
 SPDocument *SPDocument::createNewDoc(gchar const *uri, unsigned int keepalive, bool make_new)
+{
+    Inkscape::XML::Document *rdoc = NULL;
+    if (uri) {
+        /* Try to fetch repr from file */
+        rdoc = sp_repr_read_file(uri, SP_SVG_NS_URI);
+        /* If file cannot be loaded, return NULL without warning */
+        if (rdoc == NULL) return NULL;
+    }
+    return createNewDocFromRepr(rdoc, uri, keepalive, make_new);
+}
+
+SPDocument *SPDocument::createNewDocFromRepr(Inkscape::XML::Document *rdoc, gchar const *uri,
+                                             unsigned int keepalive, bool make_new)
 {
     SPDocument *doc;
-    Inkscape::XML::Document *rdoc;
     gchar *base = NULL;
     gchar *name = NULL;
 
     if (uri) {
-        Inkscape::XML::Node *rroot;
+        g_return_val_if_fail(rdoc != NULL, NULL);
         gchar *s, *p;
-        /* Try to fetch repr from file */
-        rdoc = sp_repr_read_file(uri, SP_SVG_NS_URI);
-        /* If file cannot be loaded, return NULL without warning */
-        if (rdoc == NULL) return NULL;
-        rroot = rdoc->root();
         /* If xml file is not svg, return NULL without warning */
-        /* fixme: destroy document */
-        if (strcmp(rroot->name(), "svg:svg") != 0) return NULL;
+        if (strcmp(rdoc->root()->name(), "svg:svg") != 0) {
+            Inkscape::GC::release(rdoc);
+            return NULL;
+        }
         s = g_strdup(uri);
         p = strrchr(s, '/');
         if (p) {
@@ -546,6 +584,19 @@ SPDocument *SPDocument::createNewDocFromMem(gchar const *buffer, gint length, un
     return doc;
 }
 
+SPDocument *SPDocument::copy() const
+{
+    Inkscape::XML::Document *new_rdoc = new Inkscape::XML::SimpleDocument();
+    for (Inkscape::XML::Node *child = rdoc->firstChild(); child; child = child->next()) {
+        Inkscape::XML::Node *child_copy = child->duplicate(new_rdoc);
+        new_rdoc->appendChild(child_copy);
+        Inkscape::GC::release(child_copy);
+    }
+
+    Glib::ustring name = Glib::ustring::compose( _("Memory document %1"), ++doc_mem_count );
+    return createDoc(new_rdoc, NULL, base, name.c_str(), keepalive);
+}
+
 SPDocument *SPDocument::doRef()
 {
     Inkscape::GC::anchor(this);
@@ -905,6 +956,48 @@ SPDocument::removeUndoObserver(Inkscape::UndoStackObserver& observer)
     this->priv->undoStackObservers.remove(observer);
 }
 
+namespace {
+
+/** Appends the ids in the subtree of \a repr to \a ids. */
+void collect_ids(Inkscape::XML::Node *repr, std::vector<GQuark> &ids)
+{
+    if (repr->type() != Inkscape::XML::ELEMENT_NODE) {
+        return;
+    }
+    gchar const *id = repr->attribute("id");
+    if (id) {
+        ids.push_back(g_quark_from_string(id));
+    }
+    for (Inkscape::XML::Node *child = repr->firstChild(); child; child = child->next()) {
+        collect_ids(child, ids);
+    }
+}
+
+/** Builds the deferred \a child, which follows \a ref, under the object of its parent. */
+void build_deferred(SPDocumentPrivate *priv, Inkscape::XML::Node *child, Inkscape::XML::Node *ref)
+{
+    // forget it first, building may look up other objects
+    if (!priv->deferred.erase(child)) {
+        return;
+    }
+    SPObject *parent = static_cast<SPObject *>(g_hash_table_lookup(priv->reprdef, child->parent()));
+    g_return_if_fail(parent != NULL);
+    parent->buildDeferredChild(child, ref);
+}
+
+void build_deferred_children(SPDocumentPrivate *priv, SPObject *parent)
+{
+    Inkscape::XML::Node *ref = NULL;
+    for (Inkscape::XML::Node *child = parent->getRepr()->firstChild(); child; child = child->next()) {
+        if (priv->deferred.find(child) != priv->deferred.end()) {
+            build_deferred(priv, child, ref);
+        }
+        ref = child;
+    }
+}
+
+}
+
 SPObject *SPDocument::getObjectById(Glib::ustring const &id) const
 {
     return getObjectById( id.c_str() );
@@ -919,6 +1012,17 @@ SPObject *SPDocument::getObjectById(gchar const *id) const
 
     GQuark idq = g_quark_from_string(id);
     gpointer rv = g_hash_table_lookup(priv->iddef, GINT_TO_POINTER(idq));
+    if (rv == NULL && !priv->deferred_ids.empty()) {
+        INK_UNORDERED_MAP<GQuark, Inkscape::XML::Node *>::iterator found = priv->deferred_ids.find(idq);
+        if (found != priv->deferred_ids.end()) {
+            Inkscape::XML::Node *child = found->second;
+            priv->deferred_ids.erase(found);
+            if (priv->deferred.find(child) != priv->deferred.end()) {
+                build_deferred(priv, child, Inkscape::XML::previous_node(child));
+                rv = g_hash_table_lookup(priv->iddef, GINT_TO_POINTER(idq));
+            }
+        }
+    }
     if(rv != NULL)
     {
         return static_cast<SPObject*>(rv);
@@ -949,7 +1053,105 @@ void SPDocument::bindObjectToRepr(Inkscape::XML::Node *repr, SPObject *object)
 SPObject *SPDocument::getObjectByRepr(Inkscape::XML::Node *repr) const
 {
     g_return_val_if_fail(repr != NULL, NULL);
-    return static_cast<SPObject*>(g_hash_table_lookup(priv->reprdef, repr));
+    SPObject *object = static_cast<SPObject*>(g_hash_table_lookup(priv->reprdef, repr));
+    if (!object && !priv->deferred.empty()) {
+        for (Inkscape::XML::Node *ancestor = repr; ancestor; ancestor = ancestor->parent()) {
+            if (priv->deferred.find(ancestor) != priv->deferred.end()) {
+                build_deferred(priv, ancestor, Inkscape::XML::previous_node(ancestor));
+                object = static_cast<SPObject*>(g_hash_table_lookup(priv->reprdef, repr));
+                break;
+            }
+        }
+    }
+    return object;
+}
+
+bool SPDocument::deferBuild(SPObject *parent, Inkscape::XML::Node *child)
+{
+    if (parent->cloned || child->type() != Inkscape::XML::ELEMENT_NODE) {
+        return false;
+    }
+    if (SP_IS_DEFS(parent)) {
+        if (strcmp(child->name(), "svg:symbol")) {
+            return false;
+        }
+    } else if (SP_IS_LAYER(parent)) {
+        if (!parent->style || parent->style->display.computed != SP_CSS_DISPLAY_NONE) {
+            return false;
+        }
+        // the layer hierarchy is always built
+        gchar const *mode = child->attribute("inkscape:groupmode");
+        if (mode && !strcmp(mode, "layer")) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    // an object already waiting for one of its ids is a reference to it
+    std::vector<GQuark> ids;
+    collect_ids(child, ids);
+    for (std::vector<GQuark>::const_iterator i = ids.begin(); i != ids.end(); ++i) {
+        SPDocumentPrivate::IDChangedSignalMap::const_iterator waiting = priv->id_changed_signals.find(*i);
+        if (waiting != priv->id_changed_signals.end() && !waiting->second.empty()) {
+            return false;
+        }
+    }
+
+    priv->deferred.insert(child);
+    for (std::vector<GQuark>::const_iterator i = ids.begin(); i != ids.end(); ++i) {
+        priv->deferred_ids[*i] = child;
+    }
+    return true;
+}
+
+void SPDocument::buildDeferred(SPObject *parent)
+{
+    if (priv->deferred.empty()) {
+        return;
+    }
+    if (parent) {
+        build_deferred_children(priv, parent);
+        return;
+    }
+
+    std::vector<SPObject *> parents;
+    for (INK_UNORDERED_SET<Inkscape::XML::Node *>::const_iterator i = priv->deferred.begin(); i != priv->deferred.end(); ++i) {
+        SPObject *object = static_cast<SPObject *>(g_hash_table_lookup(priv->reprdef, (*i)->parent()));
+        if (object && std::find(parents.begin(), parents.end(), object) == parents.end()) {
+            parents.push_back(object);
+        }
+    }
+    for (std::vector<SPObject *>::const_iterator i = parents.begin(); i != parents.end(); ++i) {
+        build_deferred_children(priv, *i);
+    }
+    priv->deferred_ids.clear();
+}
+
+void SPDocument::forgetDeferred(Inkscape::XML::Node *repr)
+{
+    if (priv->deferred.empty()) {
+        return;
+    }
+    priv->deferred.erase(repr);
+    for (Inkscape::XML::Node *child = repr->firstChild(); child; child = child->next()) {
+        priv->deferred.erase(child);
+    }
+}
+
+void SPDocument::invalidateObjectIndexes(SPObject *object)
+{
+    if (object->cloned) {
+        return;
+    }
+    reference_index->invalidate(object);
+    property_index->invalidate(object);
+}
+
+void SPDocument::removeFromObjectIndexes(SPObject *object)
+{
+    reference_index->remove(object);
+    property_index->remove(object);
 }
 
 Glib::ustring SPDocument::getLanguage() const
@@ -1022,6 +1224,7 @@ SPDocument::_updateDocument()
 {
     /* Process updates */
     if (this->root->uflags || this->root->mflags) {
+        update_counters.updated = update_counters.modified = 0;
         if (this->root->uflags) {
             SPItemCtx ctx;
             setupViewport(&ctx);
@@ -1133,44 +1336,76 @@ static bool overlaps(Geom::Rect const &area, Geom::Rect const &box)
     return area.intersects(box);
 }
 
-static GSList *find_items_in_area(GSList *s, SPGroup *group, unsigned int dkey, Geom::Rect const &area,
-                                  bool (*test)(Geom::Rect const &, Geom::Rect const &), bool take_insensitive = false)
+namespace {
+
+typedef std::pair<std::vector<unsigned>, SPItem *> ZOrdered;
+
+/// Pairs \a item with the positions of it and its ancestors among their siblings, root first.
+ZOrdered z_ordered(SPItem *item)
 {
-    g_return_val_if_fail(SP_IS_GROUP(group), s);
+    ZOrdered ordered(std::vector<unsigned>(), item);
+    for (SPObject const *o = item; o->parent; o = o->parent) {
+        ordered.first.push_back(o->getRepr()->position());
+    }
+    std::reverse(ordered.first.begin(), ordered.first.end());
+    return ordered;
+}
 
-    for ( SPObject *o = group->firstChild() ; o ; o = o->getNext() ) {
-        if ( SP_IS_ITEM(o) ) {
-            if (SP_IS_GROUP(o) && SP_GROUP(o)->effectiveLayerMode(dkey) == SPGroup::LAYER ) {
-                s = find_items_in_area(s, SP_GROUP(o), dkey, area, test);
-            } else {
-                SPItem *child = SP_ITEM(o);
-                Geom::OptRect box = child->desktopVisualBounds();
-                if ( box && test(area, *box) && (take_insensitive || child->isVisibleAndUnlocked(dkey))) {
-                    s = g_slist_append(s, child);
-                }
-            }
+/**
+Returns the item that a search from the root of the document stops at on its way to
+item: layers are entered, other groups only if into_groups. Returns NULL if the search
+never gets to item, because item is entered itself or is not under items all the way up.
+ */
+SPItem *searched_item(SPItem *item, unsigned int dkey, bool into_groups)
+{
+    SPItem *found = NULL;
+    for (SPObject *o = item; o->parent; o = o->parent) {
+        if (!SP_IS_ITEM(o)) {
+            found = NULL;
+        } else if (!SP_IS_GROUP(o) || (!into_groups && SP_GROUP(o)->effectiveLayerMode(dkey) != SPGroup::LAYER)) {
+            found = SP_ITEM(o);
         }
     }
+    return found;
+}
 
-    return s;
 }
 
 /**
-Returns true if an item is among the descendants of group (recursively).
+Returns the items in z-order whose desktop visual bbox passes test against area, taking
+layers as the search from the root does.
  */
-static bool item_is_in_group(SPItem *item, SPGroup *group)
+static GSList *find_items_in_area(SPDocument const *document, unsigned int dkey, Geom::Rect const &area,
+                                  bool (*test)(Geom::Rect const &, Geom::Rect const &), bool take_insensitive = false)
 {
-    bool inGroup = false;
-    for ( SPObject *o = group->firstChild() ; o && !inGroup; o = o->getNext() ) {
-        if ( SP_IS_ITEM(o) ) {
-            if (SP_ITEM(o) == item) {
-                inGroup = true;
-            } else if ( SP_IS_GROUP(o) ) {
-                inGroup = item_is_in_group(item, SP_GROUP(o));
-            }
+    // The index has document coordinates; leave some room for rounding in the flip.
+    /// @fixme hardcoded desktop transform, as in SPItem::desktopVisualBounds()
+    Geom::Affine const dt2doc = Geom::Scale(1, -1) * Geom::Translate(0, document->getHeight().value("px"));
+    Geom::Rect search = area;
+    search *= dt2doc;
+    search.expandBy(1e-3);
+
+    std::vector<SPItem *> candidates;
+    document->item_index->intersecting(search, candidates);
+
+    std::vector<ZOrdered> found;
+    for (std::vector<SPItem *>::const_iterator i = candidates.begin(); i != candidates.end(); ++i) {
+        SPItem *child = *i;
+        if (searched_item(child, dkey, false) != child) {
+            continue;
+        }
+        Geom::OptRect box = child->desktopVisualBounds();
+        if ( box && test(area, *box) && (take_insensitive || child->isVisibleAndUnlocked(dkey))) {
+            found.push_back(z_ordered(child));
         }
     }
-    return inGroup;
+    std::sort(found.begin(), found.end());
+
+    GSList *s = NULL;
+    for (std::vector<ZOrdered>::reverse_iterator i = found.rbegin(); i != found.rend(); ++i) {
+        s = g_slist_prepend(s, i->second);
+    }
+    return s;
 }
 
 SPItem *SPDocument::getItemFromListAtPointBottom(unsigned int dkey, SPGroup *group, GSList const *list,Geom::Point const p, bool take_insensitive)
@@ -1202,85 +1437,61 @@ SPItem *SPDocument::getItemFromListAtPointBottom(unsigned int dkey, SPGroup *gro
 }
 
 /**
-Returns the topmost (in z-order) item from the descendants of group (recursively) which
-is at the point p, or NULL if none. Honors into_groups on whether to recurse into
-non-layer groups or not. Honors take_insensitive on whether to return insensitive
-items. If upto != NULL, then if item upto is encountered (at any level), stops searching
-upwards in z-order and returns what it has found so far (i.e. the found item is
-guaranteed to be lower than upto).
+Returns the topmost (in z-order) item at point p, which is in the coordinates of the
+drawing for dkey, or NULL if none. Honors into_groups on whether to take the items in
+non-layer groups instead of the groups. With groups_only, only returns non-layer groups,
+whether or not they are hidden or locked. If upto != NULL, only items below upto in
+z-order are considered.
  */
-static SPItem *find_item_at_point(unsigned int dkey, SPGroup *group, Geom::Point const p, gboolean into_groups, bool take_insensitive = false, SPItem *upto = NULL)
+static SPItem *find_item_at_point(SPDocument const *document, unsigned int dkey, Geom::Point const p,
+                                  bool into_groups, bool groups_only, SPItem *upto = NULL)
 {
-    SPItem *seen = NULL;
-    SPItem *newseen = NULL;
+    Inkscape::DrawingItem *root_arenaitem = SP_ITEM(document->getRoot())->get_arenaitem(dkey);
+    if (!root_arenaitem || root_arenaitem->ctm().isSingular()) {
+        return NULL;
+    }
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     gdouble delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
 
-    for ( SPObject *o = group->firstChild() ; o ; o = o->getNext() ) {
-        if (!SP_IS_ITEM(o)) {
-            continue;
-        }
-
-        if (upto && SP_ITEM(o) == upto) {
-            break;
-        }
+    // The root's drawing item maps document coordinates to drawing ones. Picking
+    // may reach half a unit outside of the visual bbox for outlines and hairlines.
+    Geom::Rect search(p, p);
+    search.expandBy(delta + 1);
+    search *= root_arenaitem->ctm().inverse();
 
-        if (SP_IS_GROUP(o) && (SP_GROUP(o)->effectiveLayerMode(dkey) == SPGroup::LAYER || into_groups)) {
-            // if nothing found yet, recurse into the group
-            newseen = find_item_at_point(dkey, SP_GROUP(o), p, into_groups, take_insensitive, upto);
-            if (newseen) {
-                seen = newseen;
-                newseen = NULL;
-            }
+    std::vector<SPItem *> candidates;
+    document->item_index->intersecting(search, candidates);
+    document->item_index->unbounded(candidates);
 
-            if (item_is_in_group(upto, SP_GROUP(o))) {
-                break;
-            }
-        } else {
-            SPItem *child = SP_ITEM(o);
-            Inkscape::DrawingItem *arenaitem = child->get_arenaitem(dkey);
+    for (std::vector<SPItem *>::iterator i = candidates.begin(); i != candidates.end(); ++i) {
+        *i = searched_item(*i, dkey, into_groups && !groups_only);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
 
-            // seen remembers the last (topmost) of items pickable at this point
-            if (arenaitem && arenaitem->pick(p, delta, 1) != NULL
-                && (take_insensitive || child->isVisibleAndUnlocked(dkey))) {
-                seen = child;
-            }
+    std::vector<ZOrdered> found;
+    for (std::vector<SPItem *>::const_iterator i = candidates.begin(); i != candidates.end(); ++i) {
+        if (*i && (!groups_only || SP_IS_GROUP(*i))) {
+            found.push_back(z_ordered(*i));
         }
     }
-    return seen;
-}
+    std::sort(found.begin(), found.end());
 
-/**
-Returns the topmost non-layer group from the descendants of group which is at point
-p, or NULL if none. Recurses into layers but not into groups.
- */
-static SPItem *find_group_at_point(unsigned int dkey, SPGroup *group, Geom::Point const p)
-{
-    SPItem *seen = NULL;
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    gdouble delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
-
-    for ( SPObject *o = group->firstChild() ; o ; o = o->getNext() ) {
-        if (!SP_IS_ITEM(o)) {
+    ZOrdered const limit = upto ? z_ordered(upto) : ZOrdered();
+    for (std::vector<ZOrdered>::reverse_iterator i = found.rbegin(); i != found.rend(); ++i) {
+        if (upto && !(i->first < limit.first)) {
             continue;
         }
-        if (SP_IS_GROUP(o) && SP_GROUP(o)->effectiveLayerMode(dkey) == SPGroup::LAYER) {
-            SPItem *newseen = find_group_at_point(dkey, SP_GROUP(o), p);
-            if (newseen) {
-                seen = newseen;
-            }
+        SPItem *child = i->second;
+        if (!groups_only && !child->isVisibleAndUnlocked(dkey)) {
+            continue;
         }
-        if (SP_IS_GROUP(o) && SP_GROUP(o)->effectiveLayerMode(dkey) != SPGroup::LAYER ) {
-            SPItem *child = SP_ITEM(o);
-            Inkscape::DrawingItem *arenaitem = child->get_arenaitem(dkey);
-
-            // seen remembers the last (topmost) of groups pickable at this point
-            if (arenaitem && arenaitem->pick(p, delta, 1) != NULL) {
-                seen = child;
-            }
+        Inkscape::DrawingItem *arenaitem = child->get_arenaitem(dkey);
+        if (arenaitem && arenaitem->pick(p, delta, 1) != NULL) {
+            return child;
         }
     }
-    return seen;
+    return NULL;
 }
 
 /*
@@ -1293,7 +1504,7 @@ GSList *SPDocument::getItemsInBox(unsigned int dkey, Geom::Rect const &box) cons
 {
     g_return_val_if_fail(this->priv != NULL, NULL);
 
-    return find_items_in_area(NULL, SP_GROUP(this->root), dkey, box, is_within);
+    return find_items_in_area(this, dkey, box, is_within);
 }
 
 /*
@@ -1307,7 +1518,7 @@ GSList *SPDocument::getItemsPartiallyInBox(unsigned int dkey, Geom::Rect const &
 {
     g_return_val_if_fail(this->priv != NULL, NULL);
 
-    return find_items_in_area(NULL, SP_GROUP(this->root), dkey, box, overlaps);
+    return find_items_in_area(this, dkey, box, overlaps);
 }
 
 GSList *SPDocument::getItemsAtPoints(unsigned const key, std::vector<Geom::Point> points) const
@@ -1339,14 +1550,14 @@ SPItem *SPDocument::getItemAtPoint( unsigned const key, Geom::Point const p,
 {
     g_return_val_if_fail(this->priv != NULL, NULL);
 
-    return find_item_at_point(key, SP_GROUP(this->root), p, into_groups, false, upto);
+    return find_item_at_point(this, key, p, into_groups, false, upto);
 }
 
 SPItem *SPDocument::getGroupAtPoint(unsigned int key, Geom::Point const p) const
 {
     g_return_val_if_fail(this->priv != NULL, NULL);
 
-    return find_group_at_point(key, SP_GROUP(this->root), p);
+    return find_item_at_point(this, key, p, false, true);
 }
 
 
@@ -1457,6 +1668,9 @@ static void vacuum_document_recursive(SPObject *obj)
 
 unsigned int SPDocument::vacuumDocument()
 {
+    // deferred objects hold hrefs on defs too, and unused symbols are only seen once built
+    buildDeferred();
+
     unsigned int start = objects_in_document(this);
     unsigned int end = start;
     unsigned int newend = start;
@@ -42,6 +42,10 @@ namespace Inkscape {
     class UndoStackObserver;
     class EventLog;
     class ProfileManager;
+    class IdReferenceIndex;
+    class ItemBoundsIndex;
+    class ObjectPropertyIndex;
+    class StyleSelectorIndex;
     namespace XML {
         struct Document;
         class Node;
@@ -94,6 +98,19 @@ private:
     SPRoot *root;             ///< Our SPRoot
 public:
     CRCascade *style_cascade;
+    /// Rulesets of style_cascade by id, class and element name; invalidate when a sheet changes.
+    Inkscape::StyleSelectorIndex *style_index;
+    /// Visual bboxes of the items, for the item-in-box and item-at-point queries.
+    Inkscape::ItemBoundsIndex *item_index;
+    /// Objects referring to each id, for fixing up references when an id changes.
+    Inkscape::IdReferenceIndex *reference_index;
+    /// Objects by paint, font, type, id and class, for "select same" and Find.
+    Inkscape::ObjectPropertyIndex *property_index;
+    /// Objects visited by the last update pass that had anything to do.
+    struct UpdateCounters {
+        unsigned updated;  ///< updateDisplay() calls
+        unsigned modified; ///< emitModified() calls
+    } update_counters;
 
 protected:
     gchar *uri;   ///< A filename (not a URI yet), or NULL
@@ -177,6 +194,25 @@ public:
     void bindObjectToRepr(Inkscape::XML::Node *repr, SPObject *object);
     SPObject *getObjectByRepr(Inkscape::XML::Node *repr) const;
 
+    /**
+     * Whether the object for \a child of \a parent can wait until it is first looked up
+     * by id or by repr, in which case the child is remembered and left unbuilt.
+     *
+     * Symbols in defs and the contents of hidden layers, other than sublayers, are
+     * deferred unless an id in them is already waited for. The XML stays authoritative
+     * for them meanwhile.
+     */
+    bool deferBuild(SPObject *parent, Inkscape::XML::Node *child);
+    /** Builds the deferred children of \a parent, or every deferred object if NULL. */
+    void buildDeferred(SPObject *parent = NULL);
+    /** Forgets \a repr and its children as deferred, as they are removed or released. */
+    void forgetDeferred(Inkscape::XML::Node *repr);
+
+    /** Marks \a object to be scanned again by reference_index and property_index; clones are skipped. */
+    void invalidateObjectIndexes(SPObject *object);
+    /** Takes \a object out of reference_index and property_index, as it is released. */
+    void removeFromObjectIndexes(SPObject *object);
+
     Glib::ustring getLanguage() const;
 
     void queueForOrphanCollection(SPObject *object);
@@ -217,7 +253,12 @@ public:
 
     void fitToRect(Geom::Rect const &rect, bool with_margins = false);
     static SPDocument *createNewDoc(const gchar *uri, unsigned int keepalive, bool make_new = false);
+    /** As createNewDoc(), for a repr document already read from \a uri; takes over \a rdoc. */
+    static SPDocument *createNewDocFromRepr(Inkscape::XML::Document *rdoc, const gchar *uri,
+                                            unsigned int keepalive, bool make_new = false);
     static SPDocument *createNewDocFromMem(const gchar *buffer, gint length, unsigned int keepalive);
+    /** Makes a memory document of a copy of this one's repr tree, without serialising it. */
+    SPDocument *copy() const;
 
     /**
      * Returns the bottommost item from the list which is at the point, or NULL if none.
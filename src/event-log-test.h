@@ -0,0 +1,116 @@
+#ifndef SEEN_EVENT_LOG_TEST_H
+#define SEEN_EVENT_LOG_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <cstring>
+#include <string>
+#include <glibmm/ustring.h>
+#include <gtkmm/main.h>
+
+#include "document.h"
+#include "document-undo.h"
+#include "event-log.h"
+#include "inkscape-private.h"
+#include "preferences.h"
+#include "verbs.h"
+#include "xml/node.h"
+
+class EventLogTest : public CxxTest::TestSuite
+{
+public:
+    EventLogTest()
+    {
+        // the log keeps its rows in a Gtk::TreeStore
+        Gtk::Main::init_gtkmm_internals();
+        if ( !inkscape_get_instance() ) {
+            // undoing signals an external change through the global inkscape object
+            static_cast<void>(g_object_new(inkscape_get_type(), NULL));
+        }
+    }
+
+    static EventLogTest *createSuite() { return new EventLogTest(); }
+    static void destroySuite( EventLogTest *suite ) { delete suite; }
+
+    void testMemoryLimitExpiresOldestEvents()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg'><rect id='r' width='10' height='10'/></svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        prefs->setBool("/options/undo/compress", false);
+        prefs->setInt("/options/undo/memorylimit", 1);
+
+        Inkscape::EventLog *log = new Inkscape::EventLog(doc);
+        doc->addUndoObserver(*log);
+
+        // each step replaces a 200 KiB value with another, so two steps fit in 1 MiB and three don't
+        Inkscape::XML::Node *repr = doc->getObjectById("r")->getRepr();
+        unsigned const steps = 8;
+        for ( unsigned i = 0 ; i < steps ; i++ ) {
+            repr->setAttribute("test-value", value(i).c_str());
+            // alternate the verbs so that the log does not group the steps
+            Inkscape::DocumentUndo::done(doc, (i % 2) ? SP_VERB_OBJECT_FLIP_HORIZONTAL : SP_VERB_OBJECT_FLIP_VERTICAL,
+                                         description(i));
+        }
+
+        TS_ASSERT_LESS_THAN_EQUALS( Inkscape::DocumentUndo::getMemoryUse(doc), 1u << 20 );
+        TS_ASSERT_EQUALS( log->getUndoMemory(), Inkscape::DocumentUndo::getMemoryUse(doc) );
+
+        // the first row stands for the state after the last expired step
+        Gtk::TreeModel::Children rows = log->getEventListStore()->children();
+        TS_ASSERT_EQUALS( rows.size(), 3u );
+        if ( rows.size() == 3 ) {
+            Gtk::TreeModel::iterator row = rows.begin();
+            Inkscape::Event *event = (*row)[log->getColumns().event];
+            TS_ASSERT_EQUALS( Glib::ustring((*row)[log->getColumns().description]), description(steps - 3) );
+            TS_ASSERT( !event );
+            ++row;
+            TS_ASSERT_EQUALS( Glib::ustring((*row)[log->getColumns().description]), description(steps - 2) );
+            ++row;
+            TS_ASSERT_EQUALS( Glib::ustring((*row)[log->getColumns().description]), description(steps - 1) );
+        }
+
+        // undo stops at that state
+        TS_ASSERT( Inkscape::DocumentUndo::undo(doc) );
+        TS_ASSERT( Inkscape::DocumentUndo::undo(doc) );
+        TS_ASSERT( !Inkscape::DocumentUndo::undo(doc) );
+        TS_ASSERT_EQUALS( std::string(repr->attribute("test-value")), value(steps - 3) );
+
+        doc->removeUndoObserver(*log);
+        delete log;
+        prefs->setBool("/options/undo/compress", true);
+        prefs->setInt("/options/undo/memorylimit", 256);
+        doc->doUnref();
+    }
+
+private:
+    static std::string value(unsigned step)
+    {
+        return std::string(200 * 1024, 'a' + step);
+    }
+
+    static Glib::ustring description(unsigned step)
+    {
+        return Glib::ustring::compose("step %1", step);
+    }
+};
+
+#endif // SEEN_EVENT_LOG_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
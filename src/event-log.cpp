@@ -11,6 +11,7 @@
 #include <glibmm/i18n.h>
 
 #include "desktop.h"
+#include "document-undo.h"
 #include "inkscape.h"
 #include "util/ucompose.hpp"
 #include "document.h"
@@ -228,6 +229,46 @@ EventLog::notifyUndoCommitEvent(Event* log)
     updateUndoVerbs();
 }
 
+void
+EventLog::notifyUndoExpiredEvent(Event* log)
+{
+    // The first row stands for the oldest state that can be reached; the state after the
+    // expired event takes its place.
+    iterator first = _event_list_store->children().begin();
+    bool const grouped = !first->children().empty();
+    iterator expired = grouped ? first->children().begin() : first;
+    if (!grouped) {
+        ++expired;
+    }
+    g_return_if_fail( expired != _event_list_store->children().end() && (*expired)[_columns.event] == log );
+
+    if (_connected) {
+        (*_callback_connections)[CALLB_SELECTION_CHANGE].block();
+        (*_callback_connections)[CALLB_EXPAND].block();
+    }
+
+    if (grouped) {
+        (*first)[_columns.description] = Glib::ustring((*expired)[_columns.description]);
+        if (_last_saved == expired) {
+            _last_saved = first;
+        }
+        _event_list_store->erase(expired);
+        (*first)[_columns.child_count] = first->children().size() + 1;
+    } else {
+        (*expired)[_columns.event] = static_cast<Event *>(NULL);
+        if (_last_saved == first) {
+            // the saved state cannot be reached any more
+            _last_saved = _event_list_store->children().end();
+        }
+        _event_list_store->erase(first);
+    }
+
+    if (_connected) {
+        (*_callback_connections)[CALLB_EXPAND].block(false);
+        (*_callback_connections)[CALLB_SELECTION_CHANGE].block(false);
+    }
+}
+
 void
 EventLog::notifyClearUndoEvent()
 {
@@ -370,6 +411,12 @@ EventLog::_clearRedo()
     }
 }
 
+std::size_t
+EventLog::getUndoMemory() const
+{
+    return _document ? DocumentUndo::getMemoryUse(_document) : 0;
+}
+
 /* mark document as untouched if we reach a state where the document was previously saved */
 void
 EventLog::checkForVirginity() {
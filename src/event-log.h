@@ -75,6 +75,7 @@ public:
     void notifyUndoEvent(Event *log);
     void notifyRedoEvent(Event *log);
     void notifyUndoCommitEvent(Event *log);
+    void notifyUndoExpiredEvent(Event *log);
     void notifyClearUndoEvent();
     void notifyClearRedoEvent();
 
@@ -90,6 +91,11 @@ public:
     void blockNotifications(bool status=true)  { _notifications_blocked = status; }
     void rememberFileSave()                    { _last_saved = _curr_event; }
 
+    /**
+     * Number of bytes held by the undo and redo history of the document.
+     */
+    std::size_t getUndoMemory() const;
+
     // Callback types for TreeView changes.
 
     enum CallbackTypes { 
@@ -14,6 +14,7 @@
  */
 
 
+#include <cstddef>
 #include <glibmm/ustring.h>
 
 #include "xml/event-fns.h"
@@ -30,13 +31,15 @@ namespace Inkscape {
 struct Event {
      
     Event(XML::Event *_event, unsigned int _type=SP_VERB_NONE, Glib::ustring _description="")
-        : event (_event), type (_type), description (_description)  { }
+        : event (_event), type (_type), description (_description),
+          memory_use (sp_repr_log_memory_use(_event))  { }
 
     virtual ~Event() { sp_repr_free_log (event); }
 
     XML::Event *event;
     const unsigned int type;
     Glib::ustring description;
+    std::size_t memory_use; ///< bytes held by event, kept up to date by DocumentUndo
 };
 
 } // namespace Inkscape
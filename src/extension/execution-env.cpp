@@ -201,6 +201,7 @@ ExecutionEnv::reselect (void) {
     if (desktop == NULL) { return; }
 
     Inkscape::Selection * selection = sp_desktop_selection(desktop);
+    Inkscape::Selection::ChangeBatch batch(selection);
 
     for (std::list<Glib::ustring>::iterator i = _selected.begin(); i != _selected.end(); ++i) {
         SPObject * obj = doc->getObjectById(i->c_str());
@@ -48,6 +48,7 @@ namespace Extension {
 class Effect;
 class Extension;
 class Input;
+class OpenJob;
 class Output;
 class Print;
 
@@ -115,6 +116,13 @@ public:
     virtual SPDocument *open(Inkscape::Extension::Input * /*module*/,
                              gchar const * /*filename*/) { return NULL; }
 
+    /**
+     * Starts opening a file a piece at a time, for implementations that can.
+     * @return A job the caller runs and deletes, or \c NULL to use open() instead.
+     */
+    virtual OpenJob *open_begin(Inkscape::Extension::Input * /*module*/,
+                                gchar const * /*filename*/) { return NULL; }
+
     // ----- Output functions -----
     /** Find out information about the file. */
     virtual Gtk::Widget *prefs_output(Inkscape::Extension::Output *module);
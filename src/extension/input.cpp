@@ -159,6 +159,27 @@ Input::open (const gchar *uri)
     return doc;
 }
 
+/**
+    \return  A job opening the file, or NULL if this extension can only open it in one go
+    \brief   Starts opening a document a piece at a time
+    \param   uri  The filename to create the document from
+
+    The caller runs the job and deletes it, as Inkscape::Extension::open() does.
+*/
+OpenJob *
+Input::open_begin (const gchar *uri)
+{
+    if (!loaded()) {
+        set_state(Extension::STATE_LOADED);
+    }
+    if (!loaded()) {
+        return NULL;
+    }
+    timer->touch();
+
+    return imp->open_begin(this, uri);
+}
+
 /**
     \return  IETF mime-type for the extension
     \brief   Get the mime-type that describes this extension
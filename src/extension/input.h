@@ -21,6 +21,23 @@
 namespace Inkscape {
 namespace Extension {
 
+/**
+ * An open in progress, as returned by Implementation::open_begin().
+ * step() is called until it returns false, then finish() gives the document.
+ */
+class OpenJob {
+public:
+    virtual ~OpenJob() {}
+
+    /** Does a bit of the work; returns false when there is no more. */
+    virtual bool step() = 0;
+    /** Rough fraction of the work done, from 0 to 1. */
+    virtual double progress() const = 0;
+    virtual void cancel() = 0;
+    /** Completes the open; the caller owns the document, which is NULL on failure or cancel. */
+    virtual SPDocument *finish() = 0;
+};
+
 class Input : public Extension {
     gchar *mimetype;             /**< What is the mime type this inputs? */
     gchar *extension;            /**< The extension of the input files */
@@ -49,6 +66,7 @@ public:
     virtual      ~Input                (void);
     virtual bool  check                (void);
     SPDocument *  open                 (gchar const *uri);
+    OpenJob *     open_begin           (gchar const *uri);
     gchar *       get_mimetype         (void);
     gchar *       get_extension        (void);
     gchar *       get_filetypename     (void);
@@ -129,6 +129,8 @@ CairoRenderContext::CairoRenderContext(CairoRenderer *parent) :
     _omittext_state(EMPTY)
 {
     font_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, font_data_free);
+    image_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                        reinterpret_cast<GDestroyNotify>(cairo_surface_destroy));
 }
 
 CairoRenderContext::~CairoRenderContext(void)
@@ -136,6 +138,9 @@ CairoRenderContext::~CairoRenderContext(void)
     if(font_table != NULL) {
         g_hash_table_remove_all(font_table);
     }
+    if (image_table != NULL) {
+        g_hash_table_unref(image_table);
+    }
 
     if (_cr) cairo_destroy(_cr);
     if (_surface) cairo_surface_destroy(_surface);
@@ -207,6 +212,10 @@ CairoRenderContext::cloneMe(double width, double height) const
     new_context->_height = height;
     new_context->_is_valid = TRUE;
 
+    // patterns, masks etc. end up in the same output, so share the image surfaces
+    g_hash_table_unref(new_context->image_table);
+    new_context->image_table = g_hash_table_ref(image_table);
+
     return new_context;
 }
 
@@ -1436,6 +1445,87 @@ CairoRenderContext::renderPathVector(Geom::PathVector const & pathv, SPStyle con
     return true;
 }
 
+namespace {
+
+/** Content key of an image, kept on its surface until the pixels change. */
+struct ImageKey {
+    gchar *key;
+    unsigned stamp;
+};
+
+cairo_user_data_key_t image_key_key;
+
+void image_key_destroy(void *data)
+{
+    ImageKey *image_key = static_cast<ImageKey *>(data);
+    g_free(image_key->key);
+    delete image_key;
+}
+
+/**
+ * Returns the checksum of the original compressed data of the image if there is any,
+ * or of the pixels. It is computed once per image and change of its pixels, as large
+ * images take about as long to hash as to write.
+ */
+gchar const *image_content_key(Inkscape::Pixbuf *pb, cairo_surface_t *surface)
+{
+    ImageKey *image_key = static_cast<ImageKey *>(cairo_surface_get_user_data(surface, &image_key_key));
+    if (image_key && image_key->stamp == pb->stamp()) {
+        return image_key->key;
+    }
+
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA1);
+    gsize len = 0;
+    std::string mimetype;
+    guchar const *data = pb->getMimeData(len, mimetype);
+    if (data) {
+        g_checksum_update(checksum, reinterpret_cast<guchar const *>(mimetype.c_str()), mimetype.size());
+        g_checksum_update(checksum, data, len);
+    } else {
+        cairo_surface_flush(surface);
+        g_checksum_update(checksum, cairo_image_surface_get_data(surface),
+                          cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface));
+    }
+
+    image_key = new ImageKey();
+    image_key->key = g_strdup_printf("%dx%d:%s", pb->width(), pb->height(), g_checksum_get_string(checksum));
+    image_key->stamp = pb->stamp();
+    g_checksum_free(checksum);
+    // replaces and destroys a stale key
+    cairo_surface_set_user_data(surface, &image_key_key, image_key, image_key_destroy);
+    return image_key->key;
+}
+
+}
+
+/**
+ * Returns the source surface to use for the image.
+ *
+ * Vector backends write every distinct source surface to the output, even if the pixels are
+ * the same, so images with identical content (the same file used by many <image> elements,
+ * or clones of an image) are mapped to the surface of the first such image.
+ */
+cairo_surface_t *CairoRenderContext::_getImageSurface(Inkscape::Pixbuf *pb)
+{
+    cairo_surface_t *surface = pb->getSurfaceRaw();
+    if (!_vector_based_target || cairo_surface_status(surface)) {
+        return surface;
+    }
+
+    gchar const *key = image_content_key(pb, surface);
+    cairo_surface_t *cached = static_cast<cairo_surface_t *>(g_hash_table_lookup(image_table, key));
+    if (cached) {
+        return cached;
+    }
+
+    // The table owns a copy of the key and a reference to the surface. The surface may share
+    // its pixels with the GdkPixbuf, so that is kept alive for as long as the surface.
+    static cairo_user_data_key_t pixbuf_ref_key;
+    cairo_surface_set_user_data(surface, &pixbuf_ref_key, g_object_ref(pb->getPixbufRaw(false)), g_object_unref);
+    g_hash_table_insert(image_table, g_strdup(key), cairo_surface_reference(surface));
+    return surface;
+}
+
 bool CairoRenderContext::renderImage(Inkscape::Pixbuf *pb,
                                      Geom::Affine const &image_transform, SPStyle const * /*style*/)
 {
@@ -1453,7 +1543,7 @@ bool CairoRenderContext::renderImage(Inkscape::Pixbuf *pb,
     // TODO: reenable merge_opacity if useful
     float opacity = _state->opacity;
 
-    cairo_surface_t *image_surface = pb->getSurfaceRaw();
+    cairo_surface_t *image_surface = _getImageSurface(pb);
     if (cairo_surface_status(image_surface)) {
         TRACE(("Image surface creation failed:\n%s\n", cairo_status_to_string(cairo_surface_status(image_surface))));
         return false;
@@ -218,6 +218,11 @@ protected:
     GHashTable *font_table;
     static void font_data_free(gpointer data);
 
+    /** Source surfaces keyed by a checksum of the image content, so that identical
+     *  images are written to the output only once. Shared with cloned contexts. */
+    GHashTable *image_table;
+    cairo_surface_t *_getImageSurface(Inkscape::Pixbuf *pb);
+
     CairoRenderState *_createState(void);
 };
 
@@ -27,6 +27,7 @@
 
 #include <signal.h>
 #include <errno.h>
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 
 #include "libnrtype/Layout-TNG.h"
@@ -39,6 +40,9 @@
 #include "display/curve.h"
 #include "display/canvas-bpath.h"
 #include "display/cairo-utils.h"
+#include "display/drawing.h"
+#include "display/drawing-context.h"
+#include "display/drawing-item.h"
 #include "sp-item.h"
 #include "sp-item-group.h"
 #include "style.h"
@@ -102,10 +106,20 @@ namespace Extension {
 namespace Internal {
 
 CairoRenderer::CairoRenderer(void)
+  : _first_held(0),
+    _next_filtered(0),
+    _held_bytes(0),
+    _filter_drawing(NULL),
+    _filter_dkey(0)
 {}
 
 CairoRenderer::~CairoRenderer(void)
 {
+    for (std::vector<Inkscape::Pixbuf *>::iterator i = _filtered_bitmaps.begin(); i != _filtered_bitmaps.end(); ++i) {
+        delete *i;
+    }
+    _hideFilteredItems();
+
     /* restore default signal handling for SIGPIPE */
 #if !defined(_WIN32) && !defined(__WIN32__)
     (void) signal(SIGPIPE, SIG_DFL);
@@ -428,12 +442,22 @@ static void sp_root_render(SPRoot *root, CairoRenderContext *ctx)
 }
 
 /**
-    This function converts the item to a raster image and includes the image into the cairo renderer.
-    It is only used for filters and then only when rendering filters as bitmaps is requested.
+    Geometry of the bitmap that replaces a filtered item in the output.
 */
-static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
-{
+struct BitmapGeometry {
+    Geom::Rect bbox;          ///< area covered by the bitmap, in desktop coordinates
+    unsigned width;           ///< width of the bitmap in pixels
+    unsigned height;          ///< height of the bitmap in pixels
+    double res;               ///< resolution in dpi
+    Geom::Affine transform;   ///< places the bitmap relative to the item
+};
 
+/**
+    Calculates where and at which size a filtered item is rasterised.
+    @return false if there is nothing to rasterise
+*/
+static bool sp_asbitmap_geometry(SPItem *item, CairoRenderContext *ctx, BitmapGeometry &geom)
+{
     // The code was adapted from sp_selection_create_bitmap_copy in selection-chemistry.cpp
 
     // Calculate resolution
@@ -451,7 +475,7 @@ static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
 
     // no bbox, e.g. empty group
     if (!bbox) {
-        return;
+        return false;
     }
 
     Geom::Rect docrect(Geom::Rect(Geom::Point(0, 0), item->document->getDimensions()));
@@ -459,14 +483,14 @@ static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
 
     // no bbox, e.g. empty group
     if (!bbox) {
-        return;
+        return false;
     }
 
     // The width and height of the bitmap in pixels
     unsigned width =  ceil(bbox->width() * Inkscape::Util::Quantity::convert(res, "px", "in"));
     unsigned height = ceil(bbox->height() * Inkscape::Util::Quantity::convert(res, "px", "in"));
 
-    if (width == 0 || height == 0) return;
+    if (width == 0 || height == 0) return false;
 
     // Scale to exactly fit integer bitmap inside bounding box
     double scale_x = bbox->width() / width;
@@ -491,14 +515,45 @@ static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
 
     // ctx matrix already includes item transformation. We must substract.
     Geom::Affine t_item =  item->i2dt_affine ();
-    Geom::Affine t = t_on_document * t_item.inverse();
+
+    geom.bbox = *bbox;
+    geom.width = width;
+    geom.height = height;
+    geom.res = res;
+    geom.transform = t_on_document * t_item.inverse();
+    return true;
+}
+
+/**
+    This function converts the item to a raster image and includes the image into the cairo renderer.
+    It is only used for filters and then only when rendering filters as bitmaps is requested.
+*/
+static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
+{
+    BitmapGeometry geom;
+    if (!sp_asbitmap_geometry(item, ctx, geom)) {
+        return;
+    }
+
+    // Usually the bitmap was made in advance by CairoRenderer::renderFilteredBitmaps
+    boost::scoped_ptr<Inkscape::Pixbuf> pb(ctx->getRenderer()->takeFilteredBitmap(ctx, item));
+    if (pb) {
+        ctx->renderImage(pb.get(), geom.transform, item->style);
+        return;
+    }
+
+    Geom::OptRect bbox(geom.bbox);
+    unsigned width = geom.width;
+    unsigned height = geom.height;
+    double res = geom.res;
+    Geom::Affine t = geom.transform;
 
     // Do the export
     SPDocument *document = item->document;
     GSList *items = NULL;
     items = g_slist_append(items, item);
 
-    boost::scoped_ptr<Inkscape::Pixbuf> pb(
+    pb.reset(
         sp_generate_internal_bitmap(document, NULL,
             bbox->min()[Geom::X], bbox->min()[Geom::Y], bbox->max()[Geom::X], bbox->max()[Geom::Y], 
             width, height, res, res, (guint32) 0xffffff00, items ));
@@ -596,6 +651,152 @@ void CairoRenderer::renderItem(CairoRenderContext *ctx, SPItem *item)
     ctx->popState();
 }
 
+/**
+ * Collects the items that sp_item_invoke_render will rasterise, in document order.
+ */
+static void collect_filtered_items(SPItem *item, std::vector<SPItem *> &items)
+{
+    if (item->isHidden()) {
+        return;
+    }
+    if (item->style->filter.set != 0) {
+        items.push_back(item);
+        return;
+    }
+    for (SPObject *child = item->firstChild(); child; child = child->getNext()) {
+        if (SP_IS_ITEM(child)) {
+            collect_filtered_items(SP_ITEM(child), items);
+        }
+    }
+}
+
+void
+CairoRenderer::renderFilteredBitmaps(CairoRenderContext *ctx, SPItem *base)
+{
+    if (!ctx->getFilterToBitmap()) {
+        return;
+    }
+
+    collect_filtered_items(base, _filtered_items);
+    if (_filtered_items.empty()) {
+        return;
+    }
+    _filtered_bitmaps.assign(_filtered_items.size(), NULL);
+    for (size_t i = 0; i < _filtered_items.size(); ++i) {
+        _filtered_index[_filtered_items[i]] = i;
+    }
+
+    // One display tree is shared by all the bitmaps, instead of showing the
+    // whole document again for every filtered item.
+    SPDocument *doc = base->document;
+    doc->ensureUpToDate();
+
+    _filter_drawing = new Inkscape::Drawing();
+    _filter_drawing->setExact(true);
+    _filter_dkey = SPItem::display_key_new(1);
+    _filter_drawing->setRoot(doc->getRoot()->invoke_show(*_filter_drawing, _filter_dkey, SP_ITEM_SHOW_DISPLAY));
+
+    _renderNextFilteredBitmaps(ctx);
+}
+
+/**
+ * Rasterises the items from _next_filtered on, until FILTERED_BITMAPS_BUDGET
+ * bytes are held, but at least one item.
+ */
+void
+CairoRenderer::_renderNextFilteredBitmaps(CairoRenderContext *ctx)
+{
+    if (!_filter_drawing) {
+        return;
+    }
+
+    SPDocument *doc = _filtered_items.front()->document;
+    bool rendered = false;
+    while (_next_filtered < _filtered_items.size() && (!rendered || _held_bytes < FILTERED_BITMAPS_BUDGET)) {
+        size_t const index = _next_filtered++;
+        SPItem *item = _filtered_items[index];
+
+        BitmapGeometry geom;
+        Inkscape::DrawingItem *ai = item->get_arenaitem(_filter_dkey);
+        if (!ai || !sp_asbitmap_geometry(item, ctx, geom)) {
+            continue;
+        }
+
+        // Same placement as sp_generate_internal_bitmap
+        Geom::Point origin(geom.bbox.min()[Geom::X], doc->getHeight().value("px") - geom.bbox.max()[Geom::Y]);
+        Geom::Scale scale(Inkscape::Util::Quantity::convert(geom.res, "px", "in"),
+                          Inkscape::Util::Quantity::convert(geom.res, "px", "in"));
+        _filter_drawing->root()->setTransform(scale * Geom::Translate(-origin * scale));
+
+        Geom::IntRect area = Geom::IntRect::from_xywh(0, 0, geom.width, geom.height);
+        _filter_drawing->update(area);
+
+        cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, geom.width, geom.height);
+        if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+            // leave it to sp_asbitmap_render, which reports the error
+            cairo_surface_destroy(surface);
+            continue;
+        }
+
+        Inkscape::DrawingContext ct(surface, Geom::Point(0,0));
+        ai->render(ct, area, Inkscape::DrawingItem::RENDER_BYPASS_CACHE);
+        _filtered_bitmaps[index] = new Inkscape::Pixbuf(surface);
+        _held_bytes += (size_t) geom.width * geom.height * 4;
+        rendered = true;
+    }
+
+    if (_next_filtered == _filtered_items.size()) {
+        // nothing is left to rasterise
+        _hideFilteredItems();
+    }
+}
+
+void
+CairoRenderer::_dropFilteredBitmap(size_t index)
+{
+    Inkscape::Pixbuf *pb = _filtered_bitmaps[index];
+    if (pb) {
+        _held_bytes -= (size_t) pb->width() * pb->height() * 4;
+        _filtered_bitmaps[index] = NULL;
+    }
+}
+
+void
+CairoRenderer::_hideFilteredItems()
+{
+    if (_filter_drawing) {
+        _filtered_items.front()->document->getRoot()->invoke_hide(_filter_dkey);
+        delete _filter_drawing;
+        _filter_drawing = NULL;
+    }
+}
+
+Inkscape::Pixbuf *
+CairoRenderer::takeFilteredBitmap(CairoRenderContext *ctx, SPItem const *item)
+{
+    ItemIndex::iterator found = _filtered_index.find(item);
+    if (found == _filtered_index.end()) {
+        return NULL;
+    }
+    size_t const index = found->second;
+
+    // rendering goes in document order, so the items before are done with
+    for (; _first_held < index; ++_first_held) {
+        Inkscape::Pixbuf *done = _filtered_bitmaps[_first_held];
+        _dropFilteredBitmap(_first_held);
+        delete done;
+    }
+
+    if (index >= _next_filtered) {
+        _next_filtered = index;
+        _renderNextFilteredBitmaps(ctx);
+    }
+
+    Inkscape::Pixbuf *pb = _filtered_bitmaps[index];
+    _dropFilteredBitmap(index);
+    return pb;
+}
+
 bool
 CairoRenderer::setupDocument(CairoRenderContext *ctx, SPDocument *doc, bool pageBoundingBox, float bleedmargin_px, SPItem *base)
 {
@@ -647,6 +848,8 @@ CairoRenderer::setupDocument(CairoRenderContext *ctx, SPDocument *doc, bool page
                                             (d.bottom() - high) * (ctx->_vector_based_target ? Inkscape::Util::Quantity::convert(1, "pt", "px") : 1.0)));
             ctx->transform(tp);
         }
+
+        renderFilteredBitmaps(ctx, base);
     }
 
     return ret;
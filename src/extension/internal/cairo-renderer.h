@@ -19,8 +19,10 @@
 #endif
 
 #include "extension/extension.h"
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 //#include "libnrtype/font-instance.h"
 #include "style.h"
@@ -30,6 +32,11 @@
 class SPClipPath;
 class SPMask;
 
+namespace Inkscape {
+class Drawing;
+class Pixbuf;
+}
+
 namespace Inkscape {
 namespace Extension {
 namespace Internal {
@@ -57,6 +64,34 @@ public:
 
     /** Traverses the object tree and invokes the render methods. */
     void renderItem(CairoRenderContext *ctx, SPItem *item);
+
+    /** Prepares rasterising the filtered items below base, when filters are
+    rendered as bitmaps, by showing the document once for all of them, and
+    rasterises the first ones. Called by setupDocument. */
+    void renderFilteredBitmaps(CairoRenderContext *ctx, SPItem *base);
+
+    /** Returns the bitmap rasterised for item, or NULL. The caller takes
+    ownership. Items are expected in document order: the bitmaps of the items
+    before this one are dropped, and the next ones are rasterised as needed,
+    so that at most FILTERED_BITMAPS_BUDGET bytes of them are held at once. */
+    Inkscape::Pixbuf *takeFilteredBitmap(CairoRenderContext *ctx, SPItem const *item);
+
+private:
+    void _renderNextFilteredBitmaps(CairoRenderContext *ctx);
+    void _dropFilteredBitmap(size_t index);
+    void _hideFilteredItems();
+
+    static size_t const FILTERED_BITMAPS_BUDGET = 64 * 1024 * 1024;
+
+    typedef std::map<SPItem const *, size_t> ItemIndex;
+    std::vector<SPItem *> _filtered_items;      ///< in document order
+    std::vector<Inkscape::Pixbuf *> _filtered_bitmaps; ///< by item, NULL if not rasterised or taken
+    ItemIndex _filtered_index;
+    size_t _first_held;                         ///< no bitmap is held before this item
+    size_t _next_filtered;                      ///< first item not rasterised yet
+    size_t _held_bytes;
+    Inkscape::Drawing *_filter_drawing;         ///< shows the document while items remain
+    unsigned _filter_dkey;
 };
 
 // FIXME: this should be a static method of CairoRenderer
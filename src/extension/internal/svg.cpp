@@ -21,11 +21,14 @@
 #include "svg.h"
 #include "file.h"
 #include "extension/system.h"
+#include "extension/input.h"
 #include "extension/output.h"
+#include <string>
 #include <vector>
 #include "xml/attribute-record.h"
 #include "sp-root.h"
 #include "document.h"
+#include "io/sys.h"
 
 #ifdef WITH_GNOME_VFS
 # include <libgnomevfs/gnome-vfs.h>
@@ -200,6 +203,48 @@ Svg::open (Inkscape::Extension::Input */*mod*/, const gchar *uri)
 #endif
 }
 
+namespace {
+
+/** Reads the file with a ReprFileReader, then makes the document of it. */
+class SvgOpenJob : public Inkscape::Extension::OpenJob {
+public:
+    SvgOpenJob(gchar const *uri) : _uri(uri), _reader(uri, SP_SVG_NS_URI) {}
+
+    virtual bool step() { return _reader.step(); }
+    virtual double progress() const { return _reader.progress(); }
+    virtual void cancel() { _reader.cancel(); }
+    virtual SPDocument *finish() {
+        Inkscape::XML::Document *rdoc = _reader.document();
+        return rdoc ? SPDocument::createNewDocFromRepr(rdoc, _uri.c_str(), TRUE) : NULL;
+    }
+
+private:
+    std::string _uri;
+    Inkscape::XML::ReprFileReader _reader;
+};
+
+}
+
+/**
+    \return    A job reading the document, or NULL when it has to be read with open()
+    \brief     Starts opening a SVG document a piece at a time.
+    \param     mod   Module to use
+    \param     uri   The path to the file (UTF-8)
+*/
+Inkscape::Extension::OpenJob *
+Svg::open_begin (Inkscape::Extension::Input */*mod*/, const gchar *uri)
+{
+#ifdef WITH_GNOME_VFS
+    if (gnome_vfs_initialized() && !gnome_vfs_uri_is_local(gnome_vfs_uri_new(uri))) {
+        return NULL;
+    }
+#endif
+    if ( !uri || !Inkscape::IO::file_test(uri, G_FILE_TEST_EXISTS) ) {
+        return NULL;
+    }
+    return new SvgOpenJob(uri);
+}
+
 /**
     \return    None
     \brief     This is the function that does all of the SVG saves in
@@ -29,6 +29,8 @@ public:
                                gchar const *filename );
     virtual SPDocument *open( Inkscape::Extension::Input *mod,
                                 const gchar *uri );
+    virtual OpenJob    *open_begin( Inkscape::Extension::Input *mod,
+                                    const gchar *uri );
     static void         init( void );
 
 };
@@ -66,9 +66,10 @@ static Extension *build_from_reprdoc(Inkscape::XML::Document *doc, Implementatio
  * preferences.  If there is a function, then it is executed to get the dialog to be displayed.
  * After it is finished the function continues.
  *
- * Lastly, the open function is called in the module itself.
+ * Lastly, the open function is called in the module itself.  When a progress slot is given
+ * and the module can open the file a piece at a time, the slot is called between pieces.
  */
-SPDocument *open(Extension *key, gchar const *filename)
+SPDocument *open(Extension *key, gchar const *filename, OpenProgressSlot const &progress)
 {
     Input *imod = NULL;
 
@@ -114,7 +115,30 @@ SPDocument *open(Extension *key, gchar const *filename)
         return NULL;
     }
 
-    SPDocument *doc = imod->open(filename);
+    SPDocument *doc = NULL;
+    OpenJob *job = progress ? imod->open_begin(filename) : NULL;
+    if (job) {
+        bool cancelled = false;
+        while (job->step()) {
+            if (!progress(job->progress())) {
+                job->cancel();
+                cancelled = true;
+            }
+        }
+        doc = job->finish();
+        delete job;
+        if (cancelled) {
+            if (doc) {
+                doc->doUnref();
+            }
+            if (!show) {
+                imod->set_gui(true);
+            }
+            throw Input::open_cancelled();
+        }
+    } else {
+        doc = imod->open(filename);
+    }
 
     if (!doc) {
         throw Input::open_failed();
@@ -16,6 +16,7 @@
 #define INKSCAPE_EXTENSION_SYSTEM_H__
 
 #include <glibmm/ustring.h>
+#include <sigc++/slot.h>
 
 class SPDocument;
 
@@ -44,7 +45,13 @@ enum FileSaveMethod {
     FILE_SAVE_METHOD_TEMPORARY,
 };
 
-SPDocument *open(Extension *key, gchar const *filename);
+/**
+ * Called with the fraction done while a file is opened; returning false cancels the open.
+ */
+typedef sigc::slot<bool, double> OpenProgressSlot;
+
+SPDocument *open(Extension *key, gchar const *filename,
+                 OpenProgressSlot const &progress = OpenProgressSlot());
 void save(Extension *key, SPDocument *doc, gchar const *filename,
           bool setextension, bool check_overwrite, bool official,
           Inkscape::Extension::FileSaveMethod save_method);
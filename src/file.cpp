@@ -68,11 +68,15 @@
 #include "ui/dialog/font-substitution.h"
 
 #include <gtk/gtk.h>
+#include <gtkmm/dialog.h>
 #include <gtkmm/main.h>
+#include <gtkmm/progressbar.h>
+#include <gtkmm/stock.h>
 
 #include <glibmm/convert.h>
 #include <glibmm/i18n.h>
 #include <glibmm/miscutils.h>
+#include <glibmm/timer.h>
 
 #include <string>
 
@@ -252,6 +256,70 @@ sp_file_exit()
 ## O P E N
 ######################*/
 
+namespace {
+
+/**
+ * Shows how far an open has got in a modal dialog, like the one of Export, and lets
+ * the user cancel it. Nothing is shown for files that open in under half a second.
+ */
+class OpenProgress {
+public:
+    OpenProgress(Glib::ustring const &uri)
+        : _uri(uri),
+          _dialog(NULL),
+          _bar(NULL),
+          _cancelled(false)
+    {
+        _timer.start();
+    }
+    ~OpenProgress() { delete _dialog; }
+
+    bool update(double fraction);
+
+private:
+    void onResponse(int /*response*/) { _cancelled = true; }
+    bool onDelete(GdkEventAny * /*event*/) { _cancelled = true; return true; }
+
+    Glib::ustring _uri;
+    Glib::Timer _timer;
+    Gtk::Dialog *_dialog;
+    Gtk::ProgressBar *_bar;
+    bool _cancelled;
+};
+
+bool OpenProgress::update(double fraction)
+{
+    if (!_dialog) {
+        if (_timer.elapsed() < 0.5) {
+            return true;
+        }
+        _dialog = new Gtk::Dialog(_("Opening document"), true);
+        _bar = Gtk::manage(new Gtk::ProgressBar());
+        _bar->set_text(Glib::path_get_basename(_uri));
+#if GTK_CHECK_VERSION(3,0,0)
+        _bar->set_show_text(true);
+        _dialog->get_content_area()->pack_start(*_bar, FALSE, FALSE, 4);
+#else
+        _dialog->get_vbox()->pack_start(*_bar, FALSE, FALSE, 4);
+#endif
+        _dialog->add_button(Gtk::Stock::CANCEL, Gtk::RESPONSE_CANCEL);
+        _dialog->signal_response().connect(sigc::mem_fun(*this, &OpenProgress::onResponse));
+        _dialog->signal_delete_event().connect(sigc::mem_fun(*this, &OpenProgress::onDelete));
+        _dialog->show_all();
+    }
+
+    _bar->set_fraction(CLAMP(fraction, 0.0, 1.0));
+
+    int evtcount = 0;
+    while ((evtcount < 16) && gdk_events_pending()) {
+        gtk_main_iteration_do(FALSE);
+        evtcount += 1;
+    }
+    return !_cancelled;
+}
+
+}
+
 /**
  *  Open a file, add the document to the desktop
  *
@@ -271,7 +339,13 @@ bool sp_file_open(const Glib::ustring &uri,
     SPDocument *doc = NULL;
     bool cancelled = false;
     try {
-        doc = Inkscape::Extension::open(key, uri.c_str());
+        if ( inkscape_use_gui() ) {
+            OpenProgress progress(uri);
+            doc = Inkscape::Extension::open(key, uri.c_str(),
+                                            sigc::mem_fun(progress, &OpenProgress::update));
+        } else {
+            doc = Inkscape::Extension::open(key, uri.c_str());
+        }
     } catch (Inkscape::Extension::Input::no_extension_found &e) {
         doc = NULL;
     } catch (Inkscape::Extension::Input::open_failed &e) {
@@ -65,6 +65,7 @@ struct Ops {
     void (*enable)();
     void (*disable)();
     void (*free)(void *ptr);
+    void *(*malloc_many)(std::size_t size);
 };
 
 struct Core {
@@ -120,6 +121,10 @@ public:
     static inline void free(void *ptr) {
         return _ops.free(ptr);
     }
+    /// A list of cleared, scanned objects, linked through their first word.
+    static inline void *malloc_many(std::size_t size) {
+        return _ops.malloc_many(size);
+    }
 private:
     static Ops _ops;
 };
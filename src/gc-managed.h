@@ -15,6 +15,7 @@
 #define SEEN_INKSCAPE_GC_MANAGED_H
 
 #include "gc-core.h"
+#include "gc-pool.h"
 
 namespace Inkscape {
 
@@ -43,7 +44,14 @@ public:
         return ::operator new[](size, scan, collect);
     }
 
+    void *operator new(std::size_t size, BatchPool &pool)
+    throw (std::bad_alloc)
+    {
+        return ::operator new(size, pool);
+    }
+
     void operator delete(void *p) { return ::operator delete(p, GC); }
+    void operator delete(void *p, BatchPool &pool) { ::operator delete(p, pool); }
 };
 
 }
@@ -0,0 +1,106 @@
+/** @file
+ * @brief Batch allocation of GC-managed objects
+ */
+/* Copyright (C) 2012 Authors
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifndef SEEN_INKSCAPE_GC_POOL_H
+#define SEEN_INKSCAPE_GC_POOL_H
+
+#include "gc-core.h"
+
+namespace Inkscape {
+
+namespace GC {
+
+/** @brief Hands out scanned, collectable objects, fetched from the collector in batches
+ *
+ * Each batch is a whole list of objects of one size, obtained under a single allocation
+ * lock. The objects are ordinary collectable objects: they are reclaimed one by one once
+ * unreachable, exactly as if they came from Core::malloc. Unused objects of a batch are
+ * reclaimed along with the pool.
+ *
+ * The free lists are only reachable through the pool, so a pool must live in scanned
+ * memory, i.e. inside a GC-managed object.
+ */
+class BatchPool {
+public:
+    BatchPool() : _allocations(0), _batches(0) {
+        for ( unsigned i = 0 ; i < SIZE_CLASSES ; i++ ) {
+            _size[i] = 0;
+            _free[i] = NULL;
+        }
+    }
+
+    void *allocate(std::size_t size) throw(std::bad_alloc) {
+        unsigned i = 0;
+        while ( i < SIZE_CLASSES && _size[i] != size && _size[i] ) {
+            i++;
+        }
+        if ( i == SIZE_CLASSES ) {
+            void *mem = Core::malloc(size);
+            if (!mem) {
+                throw std::bad_alloc();
+            }
+            return mem;
+        }
+        _size[i] = size;
+        if (!_free[i]) {
+            _free[i] = Core::malloc_many(size);
+            if (!_free[i]) {
+                throw std::bad_alloc();
+            }
+            _batches++;
+        }
+        // the list is linked through the first word of each object
+        void **mem = static_cast<void **>(_free[i]);
+        _free[i] = *mem;
+        *mem = NULL;
+        _allocations++;
+        return mem;
+    }
+
+    /// Number of objects handed out so far.
+    unsigned long allocations() const { return _allocations; }
+    /// Number of times the collector was asked for memory.
+    unsigned long batches() const { return _batches; }
+
+private:
+    BatchPool(BatchPool const &); // no copy
+    void operator=(BatchPool const &); // no assign
+
+    static const unsigned SIZE_CLASSES = 8;
+
+    std::size_t _size[SIZE_CLASSES];
+    void *_free[SIZE_CLASSES];
+    unsigned long _allocations;
+    unsigned long _batches;
+};
+
+}
+
+}
+
+inline void *operator new(std::size_t size, Inkscape::GC::BatchPool &pool)
+throw(std::bad_alloc)
+{
+    return pool.allocate(size);
+}
+
+inline void operator delete(void *mem, Inkscape::GC::BatchPool &) {
+    Inkscape::GC::Core::free(mem);
+}
+
+#endif
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
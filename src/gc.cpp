@@ -53,6 +53,11 @@ void *debug_malloc_atomic_uncollectable(std::size_t size) {
     return GC_debug_malloc_uncollectable(size, GC_EXTRAS);
 }
 
+void *debug_malloc_many(std::size_t size) {
+    // a list of one; the debugging headers don't mix with GC_malloc_many
+    return GC_debug_malloc(size, GC_EXTRAS);
+}
+
 std::ptrdiff_t compute_debug_base_fixup() {
     char *base=reinterpret_cast<char *>(GC_debug_malloc(1, GC_EXTRAS));
     char *real_base=reinterpret_cast<char *>(GC_base(base));
@@ -77,6 +82,10 @@ int debug_general_register_disappearing_link(void **p_ptr, void *base) {
 
 void dummy_do_init() {}
 
+void *dummy_malloc_many(std::size_t size) {
+    return std::calloc(1, size);
+}
+
 void *dummy_base(void *) { return NULL; }
 
 void dummy_register_finalizer(void *, CleanupFunc, void *,
@@ -119,7 +128,8 @@ Ops enabled_ops = {
     &GC_gcollect,
     &GC_enable,
     &GC_disable,
-    &GC_free
+    &GC_free,
+    &GC_malloc_many
 };
 
 Ops debug_ops = {
@@ -137,7 +147,8 @@ Ops debug_ops = {
     &GC_gcollect,
     &GC_enable,
     &GC_disable,
-    &GC_debug_free
+    &GC_debug_free,
+    &debug_malloc_many
 };
 
 Ops disabled_ops = {
@@ -155,7 +166,8 @@ Ops disabled_ops = {
     &dummy_gcollect,
     &dummy_enable,
     &dummy_disable,
-    &std::free
+    &std::free,
+    &dummy_malloc_many
 };
 
 class InvalidGCModeError : public std::runtime_error {
@@ -255,7 +267,8 @@ Ops Core::_ops = {
     &stub_gcollect,
     &stub_enable,
     &stub_disable,
-    &stub_free
+    &stub_free,
+    &stub_malloc
 };
 
 void Core::init() {
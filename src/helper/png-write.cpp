@@ -31,10 +31,14 @@
 #include "sp-item.h"
 #include "sp-root.h"
 #include "sp-defs.h"
+#include "sp-item-group.h"
 #include "preferences.h"
 #include "rdf.h"
 #include "display/cairo-utils.h"
 #include "util/units.h"
+#include <glib/gstdio.h>
+#include <cmath>
+#include <vector>
 
 /* This is an example of how to use libpng to read and write PNG files.
  * The file libpng.txt is much more verbose then this.  If you have not
@@ -54,6 +58,8 @@ struct SPEBP {
     unsigned long int width, height, sheight;
     guint32 background;
     Inkscape::Drawing *drawing; // it is assumed that all unneeded items are hidden
+    Geom::IntPoint origin; // pixel of the drawing at the top left corner of the image
+    bool update; // whether to update the drawing for each strip before rendering it
     guchar *px;
     unsigned (*status)(float, void *);
     void *data;
@@ -325,10 +331,13 @@ sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, v
     // bbox is now set to the entire image to prevent discontinuities
     // in the image when blur is used (the borders may still be a bit
     // off, but that's less noticeable).
-    Geom::IntRect bbox = Geom::IntRect::from_xywh(0, row, ebp->width, num_rows);
+    Geom::IntRect bbox = Geom::IntRect::from_xywh(ebp->origin[Geom::X], ebp->origin[Geom::Y] + row,
+                                                  ebp->width, num_rows);
 
     /* Update to renderable state */
-    ebp->drawing->update(bbox);
+    if (ebp->update) {
+        ebp->drawing->update(bbox);
+    }
 
     int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
     unsigned char *px = g_new(guchar, num_rows * stride);
@@ -415,6 +424,83 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 
     doc->ensureUpToDate();
 
+    /* Create new drawing */
+    Inkscape::Drawing drawing;
+    drawing.setExact(true); // export with maximum blur rendering quality
+    unsigned const dkey = SPItem::display_key_new(1);
+
+    // Create ArenaItems
+    drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+
+    // We show all and then hide all items we don't want, instead of showing only requested items,
+    // because that would not work if the shown item references something in defs
+    if (items_only) {
+        hide_other_items_recursively(doc->getRoot(), items_only, dkey);
+    }
+
+    ExportResult result = sp_export_png_file(drawing, doc, filename, area, width, height, xdpi, ydpi,
+                                             bgcolor, status, data, true);
+
+    // Hide items, this releases arenaitem
+    doc->getRoot()->invoke_hide(dkey);
+
+    return result;
+}
+
+/**
+ * Write the pixels \a region of a drawing, whose transform is already set, to a PNG file.
+ * Unless \a update is true, the drawing must have been updated for the whole region.
+ */
+static ExportResult export_png_region(Inkscape::Drawing &drawing, SPDocument *doc, gchar const *filename,
+                                      Geom::IntRect const &region, double xdpi, double ydpi,
+                                      unsigned long bgcolor,
+                                      unsigned (*status)(float, void *), void *data, bool update)
+{
+    unsigned long const width = region.width();
+
+    struct SPEBP ebp;
+    ebp.width  = width;
+    ebp.height = region.height();
+    ebp.background = bgcolor;
+    ebp.drawing = &drawing;
+    ebp.origin = region.min();
+    ebp.update = update;
+    ebp.status = status;
+    ebp.data   = data;
+
+    bool write_status = false;;
+
+    ebp.sheight = 64;
+    ebp.px = g_try_new(guchar, 4 * ebp.sheight * width);
+
+    if (ebp.px) {
+        write_status = sp_png_write_rgba_striped(doc, filename, ebp.width, ebp.height, xdpi, ydpi,
+                                                 sp_export_get_rows, &ebp);
+        g_free(ebp.px);
+    }
+
+    return write_status ? EXPORT_OK : EXPORT_ERROR;
+}
+
+ExportResult sp_export_png_file(Inkscape::Drawing &drawing, SPDocument *doc, gchar const *filename,
+                                Geom::Rect const &area,
+                                unsigned long width, unsigned long height, double xdpi, double ydpi,
+                                unsigned long bgcolor,
+                                unsigned (*status)(float, void *),
+                                void *data, bool force_overwrite)
+{
+    g_return_val_if_fail(doc != NULL, EXPORT_ERROR);
+    g_return_val_if_fail(drawing.root() != NULL, EXPORT_ERROR);
+    g_return_val_if_fail(filename != NULL, EXPORT_ERROR);
+    g_return_val_if_fail(width >= 1, EXPORT_ERROR);
+    g_return_val_if_fail(height >= 1, EXPORT_ERROR);
+    g_return_val_if_fail(!area.hasZeroArea(), EXPORT_ERROR);
+
+    if (!force_overwrite && !sp_ui_overwrite_file(filename)) {
+        // aborted overwrite
+        return EXPORT_ABORTED;
+    }
+
     /* Calculate translation by transforming to document coordinates (flipping Y)*/
     Geom::Point translation = Geom::Point(-area[Geom::X][0], area[Geom::Y][1] - doc->getHeight().value("px"));
 
@@ -440,44 +526,200 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 
     //SP_PRINT_MATRIX("SVG2PNG", &affine);
 
-    struct SPEBP ebp;
-    ebp.width  = width;
-    ebp.height = height;
-    ebp.background = bgcolor;
+    // The drawing may be reused for several exports, so the transform is (re)set every time
+    drawing.root()->setTransform(affine);
 
-    /* Create new drawing */
+    return export_png_region(drawing, doc, filename, Geom::IntRect::from_xywh(0, 0, width, height),
+                             xdpi, ydpi, bgcolor, status, data, true);
+}
+
+/**
+ * Collect the visual bounding boxes of all visible items that intersect the area, looking
+ * into groups unless they are filtered, since a filter may paint outside of the children.
+ */
+static void collect_visible_bounds(SPObject *o, Geom::Rect const &area, std::vector<Geom::Rect> &bounds)
+{
+    for ( SPObject *child = o->firstChild() ; child; child = child->getNext() ) {
+        if (!SP_IS_ITEM(child) || SP_IS_DEFS(child)) {
+            continue;
+        }
+        SPItem *item = SP_ITEM(child);
+        if (item->isHidden()) {
+            continue;
+        }
+        Geom::OptRect bbox = item->desktopVisualBounds();
+        if (!bbox || !bbox->intersects(area)) {
+            continue;
+        }
+        if (SP_IS_GROUP(item) && !item->isFiltered()) {
+            collect_visible_bounds(item, area, bounds);
+        } else {
+            bounds.push_back(*bbox);
+        }
+    }
+}
+
+ExportResult sp_export_png_tiles(SPDocument *doc, gchar const *basename,
+                                 Geom::Rect const &area, double dpi, unsigned tile_size,
+                                 ExportTileLayout layout, unsigned long bgcolor,
+                                 unsigned (*status)(float, void *), void *data)
+{
+    g_return_val_if_fail(doc != NULL, EXPORT_ERROR);
+    g_return_val_if_fail(basename != NULL, EXPORT_ERROR);
+    g_return_val_if_fail(tile_size >= 1, EXPORT_ERROR);
+    g_return_val_if_fail(dpi > 0, EXPORT_ERROR);
+    g_return_val_if_fail(!area.hasZeroArea(), EXPORT_ERROR);
+
+    doc->ensureUpToDate();
+
+    // pixels per user unit at the most detailed level
+    double const scale = dpi / Inkscape::Util::Quantity::convert(1, "in", "px");
+    unsigned long const full_width = (unsigned long) ceil(area.width() * scale);
+    unsigned long const full_height = (unsigned long) ceil(area.height() * scale);
+    unsigned long const full_size = MAX(full_width, full_height);
+
+    int max_level = 0;
+    if (layout == EXPORT_TILES_DZI) {
+        // DZI level 0 is 1x1 pixel
+        while ((1UL << max_level) < full_size) {
+            ++max_level;
+        }
+    } else {
+        // XYZ level 0 is a single tile
+        while (((unsigned long) tile_size << max_level) < full_size) {
+            ++max_level;
+        }
+    }
+
+    // Empty tiles are only skipped when the background is transparent
+    bool const skip_empty = (bgcolor & 0xff) == 0;
+    std::vector<Geom::Rect> bounds;
+    if (skip_empty) {
+        collect_visible_bounds(doc->getRoot(), area, bounds);
+    }
+
+    gchar *tiledir = NULL;
+    if (layout == EXPORT_TILES_DZI) {
+        gchar *dzi = g_strdup_printf("%s.dzi", basename);
+        Inkscape::IO::dump_fopen_call(dzi, "T");
+        FILE *fp = Inkscape::IO::fopen_utf8name(dzi, "w");
+        if (!fp) {
+            g_warning("Could not open %s for writing.", dzi);
+            g_free(dzi);
+            return EXPORT_ERROR;
+        }
+        fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                    "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" TileSize=\"%u\" Overlap=\"0\" Format=\"png\">\n"
+                    "  <Size Width=\"%lu\" Height=\"%lu\"/>\n"
+                    "</Image>\n", tile_size, full_width, full_height);
+        fclose(fp);
+        g_free(dzi);
+        tiledir = g_strdup_printf("%s_files", basename);
+    } else {
+        tiledir = g_strdup(basename);
+    }
+
+    /* Create one drawing for all the levels */
     Inkscape::Drawing drawing;
     drawing.setExact(true); // export with maximum blur rendering quality
     unsigned const dkey = SPItem::display_key_new(1);
-
-    // Create ArenaItems and set transform
     drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
-    drawing.root()->setTransform(affine);
-    ebp.drawing = &drawing;
 
-    // We show all and then hide all items we don't want, instead of showing only requested items,
-    // because that would not work if the shown item references something in defs
-    if (items_only) {
-        hide_other_items_recursively(doc->getRoot(), items_only, dkey);
+    // count tiles for progress reporting
+    unsigned long total_tiles = 0;
+    for (int level = 0; level <= max_level; ++level) {
+        double const f = ldexp(1.0, level - max_level);
+        unsigned long const cols = ((unsigned long) ceil(full_width * f) + tile_size - 1) / tile_size;
+        unsigned long const rows = ((unsigned long) ceil(full_height * f) + tile_size - 1) / tile_size;
+        total_tiles += MAX(cols, 1UL) * MAX(rows, 1UL);
     }
 
-    ebp.status = status;
-    ebp.data   = data;
-
-    bool write_status = false;;
+    ExportResult result = EXPORT_OK;
+    unsigned long tiles_done = 0;
+    for (int level = 0; level <= max_level && result == EXPORT_OK; ++level) {
+        double const f = ldexp(1.0, level - max_level);
+        double const level_scale = scale * f; // pixels per user unit at this level
+        unsigned long const level_width = MAX((unsigned long) ceil(full_width * f), 1UL);
+        unsigned long const level_height = MAX((unsigned long) ceil(full_height * f), 1UL);
+        unsigned long const cols = (level_width + tile_size - 1) / tile_size;
+        unsigned long const rows = (level_height + tile_size - 1) / tile_size;
+
+        // Mark the tiles touched by any visible item
+        std::vector<bool> used(cols * rows, !skip_empty);
+        for (std::vector<Geom::Rect>::const_iterator i = bounds.begin(); i != bounds.end(); ++i) {
+            // tile rows count from the top of the area, i.e. from the maximum Y
+            double const x0 = ((*i)[Geom::X][0] - area[Geom::X][0]) * level_scale / tile_size;
+            double const x1 = ((*i)[Geom::X][1] - area[Geom::X][0]) * level_scale / tile_size;
+            double const y0 = (area[Geom::Y][1] - (*i)[Geom::Y][1]) * level_scale / tile_size;
+            double const y1 = (area[Geom::Y][1] - (*i)[Geom::Y][0]) * level_scale / tile_size;
+            unsigned long const c0 = (unsigned long) MAX(floor(x0), 0.0);
+            unsigned long const c1 = MIN((unsigned long) MAX(floor(x1), 0.0), cols - 1);
+            unsigned long const r0 = (unsigned long) MAX(floor(y0), 0.0);
+            unsigned long const r1 = MIN((unsigned long) MAX(floor(y1), 0.0), rows - 1);
+            for (unsigned long r = r0; r <= r1; ++r) {
+                for (unsigned long c = c0; c <= c1; ++c) {
+                    used[r * cols + c] = true;
+                }
+            }
+        }
 
-    ebp.sheight = 64;
-    ebp.px = g_try_new(guchar, 4 * ebp.sheight * width);
+        // Transform and update the whole level once; each tile then only renders its part
+        Geom::Point const translation(-area[Geom::X][0], area[Geom::Y][1] - doc->getHeight().value("px"));
+        drawing.root()->setTransform(Geom::Translate(translation) * Geom::Scale(level_scale, level_scale));
+        drawing.update(Geom::IntRect::from_xywh(0, 0, cols * tile_size, rows * tile_size));
+
+        double const level_dpi = dpi * f;
+        for (unsigned long c = 0; c < cols && result == EXPORT_OK; ++c) {
+            gchar *dir = (layout == EXPORT_TILES_DZI)
+                ? g_strdup_printf("%s" G_DIR_SEPARATOR_S "%d", tiledir, level)
+                : g_strdup_printf("%s" G_DIR_SEPARATOR_S "%d" G_DIR_SEPARATOR_S "%lu", tiledir, level, c);
+            bool dir_made = false;
+
+            for (unsigned long r = 0; r < rows; ++r, ++tiles_done) {
+                if (status && !status((float) tiles_done / total_tiles, data)) {
+                    result = EXPORT_ABORTED;
+                    break;
+                }
+                if (!used[r * cols + c]) {
+                    continue;
+                }
+                if (!dir_made) {
+                    if (g_mkdir_with_parents(dir, 0755) != 0) {
+                        g_warning("Could not create directory %s.", dir);
+                        result = EXPORT_ERROR;
+                        break;
+                    }
+                    dir_made = true;
+                }
 
-    if (ebp.px) {
-        write_status = sp_png_write_rgba_striped(doc, filename, width, height, xdpi, ydpi, sp_export_get_rows, &ebp);
-        g_free(ebp.px);
+                // XYZ tiles are always full size; DZI tiles are cropped at the image edge
+                unsigned long tw = tile_size;
+                unsigned long th = tile_size;
+                if (layout == EXPORT_TILES_DZI) {
+                    tw = MIN(tw, level_width - c * tile_size);
+                    th = MIN(th, level_height - r * tile_size);
+                }
+                Geom::IntRect const region = Geom::IntRect::from_xywh(c * tile_size, r * tile_size, tw, th);
+
+                gchar *filename = (layout == EXPORT_TILES_DZI)
+                    ? g_strdup_printf("%s" G_DIR_SEPARATOR_S "%lu_%lu.png", dir, c, r)
+                    : g_strdup_printf("%s" G_DIR_SEPARATOR_S "%lu.png", dir, r);
+                result = export_png_region(drawing, doc, filename, region,
+                                           level_dpi, level_dpi, bgcolor, NULL, NULL, false);
+                g_free(filename);
+                if (result != EXPORT_OK) {
+                    break;
+                }
+            }
+            g_free(dir);
+        }
     }
 
     // Hide items, this releases arenaitem
     doc->getRoot()->invoke_hide(dkey);
+    g_free(tiledir);
 
-    return write_status ? EXPORT_OK : EXPORT_ERROR;
+    return result;
 }
 
 
@@ -18,12 +18,24 @@
 #include <2geom/forward.h>
 class SPDocument;
 
+namespace Inkscape {
+class Drawing;
+}
+
 enum ExportResult {
     EXPORT_ERROR = 0,
     EXPORT_OK,
     EXPORT_ABORTED
 };
 
+/**
+ * Directory layout of a tile pyramid.
+ */
+enum ExportTileLayout {
+    EXPORT_TILES_XYZ = 0, ///< BASE/z/x/y.png, full size tiles, level 0 is a single tile
+    EXPORT_TILES_DZI      ///< BASE.dzi and BASE_files/level/x_y.png, level 0 is a single pixel
+};
+
 /**
  * Export the given document as a Portable Network Graphics (PNG) file.
  *
@@ -41,4 +53,31 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 				unsigned long bgcolor,
 				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, GSList *items_only = NULL);
 
+/**
+ * Export an area of a drawing that already shows the document as a PNG file.
+ *
+ * The root transform of the drawing is replaced, so one drawing can be used for
+ * many exports of the same document without showing it again each time.
+ */
+ExportResult sp_export_png_file(Inkscape::Drawing &drawing, SPDocument *doc, gchar const *filename,
+				Geom::Rect const &area,
+				unsigned long int width, unsigned long int height, double xdpi, double ydpi,
+				unsigned long bgcolor,
+				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false);
+
+/**
+ * Export an area of the document as a pyramid of PNG tiles for zoomable viewers.
+ *
+ * The most detailed level is rendered at the given resolution and every level above
+ * it at half the resolution of the one below. All levels are rendered from a single
+ * drawing. Tiles that no visible item touches are not written when the background
+ * is transparent.
+ *
+ * @param basename Output directory (XYZ) or base name of the .dzi descriptor (DZI).
+ */
+ExportResult sp_export_png_tiles(SPDocument *doc, gchar const *basename,
+				 Geom::Rect const &area, double dpi, unsigned tile_size,
+				 ExportTileLayout layout, unsigned long bgcolor,
+				 unsigned int (*status) (float, void *), void *data);
+
 #endif // SEEN_SP_PNG_WRITE_H
@@ -14,193 +14,31 @@
 #include <cstdlib>
 #include <cstring>
 #include <list>
-#include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
-#include "extract-uri.h"
 #include "id-clash.h"
+#include "id-reference-index.h"
 #include "sp-object.h"
 #include "style.h"
-#include "sp-paint-server.h"
 #include "xml/node.h"
 #include "xml/repr.h"
 #include "sp-root.h"
-#include "sp-gradient.h"
 
-typedef enum { REF_HREF, REF_STYLE, REF_URL, REF_CLIPBOARD } ID_REF_TYPE;
+typedef Inkscape::IdReferenceIndex::Reference IdReference;
+typedef std::vector<IdReference> reflist_type;
 
-struct IdReference {
-    ID_REF_TYPE type;
-    SPObject *elem;
-    const char *attr;  // property or href-like attribute
-};
-
-typedef std::map<Glib::ustring, std::list<IdReference> > refmap_type;
-
-typedef std::pair<SPObject*, Glib::ustring> id_changeitem_type;
+typedef std::pair<SPObject*, reflist_type> id_changeitem_type;
 typedef std::list<id_changeitem_type> id_changelist_type;
 
-const char *href_like_attributes[] = {
-    "inkscape:connection-end",
-    "inkscape:connection-start",
-    "inkscape:href",
-    "inkscape:path-effect",
-    "inkscape:perspectiveID",
-    "inkscape:tiled-clone-of",
-    "xlink:href",
-};
-#define NUM_HREF_LIKE_ATTRIBUTES (sizeof(href_like_attributes) / sizeof(*href_like_attributes))
-
-const SPIPaint SPStyle::* SPIPaint_members[] = {
-    &SPStyle::color,
-    &SPStyle::fill,
-    &SPStyle::stroke,
-};
-const char* SPIPaint_properties[] = {
-    "color",
-    "fill",
-    "stroke",
-};
-#define NUM_SPIPAINT_PROPERTIES (sizeof(SPIPaint_properties) / sizeof(*SPIPaint_properties))
-
-const char* other_url_properties[] = {
-    "clip-path",
-    "color-profile",
-    "cursor",
-    "marker-end",
-    "marker-mid",
-    "marker-start",
-    "mask",
-};
-#define NUM_OTHER_URL_PROPERTIES (sizeof(other_url_properties) / sizeof(*other_url_properties))
-
-const char* clipboard_properties[] = {
-    "color",
-    "fill",
-    "filter",
-    "stroke",
-    "marker-end",
-    "marker-mid",
-    "marker-start"
-};
-#define NUM_CLIPBOARD_PROPERTIES (sizeof(clipboard_properties) / sizeof(*clipboard_properties))
-
-/**
- *  Build a table of places where IDs are referenced, for a given element.
- *  FIXME: There are some types of references not yet dealt with here
- *         (e.g., ID selectors in CSS stylesheets, and references in scripts).
- */
-static void
-find_references(SPObject *elem, refmap_type *refmap)
-{
-    if (elem->cloned) return;
-    Inkscape::XML::Node *repr_elem = elem->getRepr();
-    if (!repr_elem) return;
-    if (repr_elem->type() != Inkscape::XML::ELEMENT_NODE) return;
-
-    /* check for references in inkscape:clipboard elements */
-    if (!std::strcmp(repr_elem->name(), "inkscape:clipboard")) {
-        SPCSSAttr *css = sp_repr_css_attr(repr_elem, "style");
-        if (css) {
-            for (unsigned i = 0; i < NUM_CLIPBOARD_PROPERTIES; ++i) {
-                const char *attr = clipboard_properties[i];
-                const gchar *value = sp_repr_css_property(css, attr, NULL);
-                if (value) {
-                    gchar *uri = extract_uri(value);
-                    if (uri && uri[0] == '#') {
-                        IdReference idref = { REF_CLIPBOARD, elem, attr };
-                        (*refmap)[uri+1].push_back(idref);
-                    }
-                    g_free(uri);
-                }
-            }
-
-        }
-        return; // nothing more to do for inkscape:clipboard elements
-    }
-
-    /* check for xlink:href="#..." and similar */
-    for (unsigned i = 0; i < NUM_HREF_LIKE_ATTRIBUTES; ++i) {
-        const char *attr = href_like_attributes[i];
-        const gchar *val = repr_elem->attribute(attr);
-        if (val && val[0] == '#') {
-            std::string id(val+1);
-            IdReference idref = { REF_HREF, elem, attr };
-            (*refmap)[id].push_back(idref);
-        }
-    }
-
-    SPStyle *style = elem->style;
-
-    /* check for url(#...) references in 'fill' or 'stroke' */
-    for (unsigned i = 0; i < NUM_SPIPAINT_PROPERTIES; ++i) {
-        const SPIPaint SPStyle::*prop = SPIPaint_members[i];
-        const SPIPaint *paint = &(style->*prop);
-        if (paint->isPaintserver() && paint->value.href) {
-            const SPObject *obj = paint->value.href->getObject();
-            if (obj) {
-                const gchar *id = obj->getId();
-                IdReference idref = { REF_STYLE, elem, SPIPaint_properties[i] };
-                (*refmap)[id].push_back(idref);
-            }
-        }
-    }
-
-    /* check for url(#...) references in 'filter' */
-    const SPIFilter *filter = &(style->filter);
-    if (filter->href) {
-        const SPObject *obj = filter->href->getObject();
-        if (obj) {
-            const gchar *id = obj->getId();
-            IdReference idref = { REF_STYLE, elem, "filter" };
-            (*refmap)[id].push_back(idref);
-        }
-    }
-
-    /* check for url(#...) references in markers */
-    const gchar *markers[4] = { "", "marker-start", "marker-mid", "marker-end" };
-    for (unsigned i = SP_MARKER_LOC_START; i < SP_MARKER_LOC_QTY; i++) {
-        const gchar *value = style->marker[i].value;
-        if (value) {
-            gchar *uri = extract_uri(value);
-            if (uri && uri[0] == '#') {
-                IdReference idref = { REF_STYLE, elem, markers[i] };
-                (*refmap)[uri+1].push_back(idref);
-            }
-            g_free(uri);
-        }
-    }
-
-    /* check for other url(#...) references */
-    for (unsigned i = 0; i < NUM_OTHER_URL_PROPERTIES; ++i) {
-        const char *attr = other_url_properties[i];
-        const gchar *value = repr_elem->attribute(attr);
-        if (value) {
-            gchar *uri = extract_uri(value);
-            if (uri && uri[0] == '#') {
-                IdReference idref = { REF_URL, elem, attr };
-                (*refmap)[uri+1].push_back(idref);
-            }
-            g_free(uri);
-        }
-    }
-    
-    // recurse
-    for (SPObject *child = elem->firstChild(); child; child = child->getNext() )
-    {
-        find_references(child, refmap);
-    }
-}
-
 /**
  *  Change any IDs that clash with IDs in the current document, and make
  *  a list of those changes that will require fixing up references.
  */
 static void
 change_clashing_ids(SPDocument *imported_doc, SPDocument *current_doc,
-                    SPObject *elem, const refmap_type *refmap,
-                    id_changelist_type *id_changes)
+                    SPObject *elem, id_changelist_type *id_changes)
 {
     const gchar *id = elem->getId();
 
@@ -217,17 +55,19 @@ change_clashing_ids(SPDocument *imported_doc, SPDocument *current_doc,
             if (current_doc->getObjectById(str) == NULL &&
                 imported_doc->getObjectById(str) == NULL) break;
         }
+        // Make a note of this change, if we need to fix up refs to it
+        reflist_type refs;
+        imported_doc->reference_index->referencesTo(old_id.c_str(), refs);
+        if (!refs.empty())
+            id_changes->push_back(id_changeitem_type(elem, refs));
         // Change to the new ID
         elem->getRepr()->setAttribute("id", new_id.c_str());
-        // Make a note of this change, if we need to fix up refs to it
-        if (refmap->find(old_id) != refmap->end())
-            id_changes->push_back(id_changeitem_type(elem, old_id));
     }
 
     // recurse
     for (SPObject *child = elem->firstChild(); child; child = child->getNext() )
     {
-        change_clashing_ids(imported_doc, current_doc, child, refmap, id_changes);
+        change_clashing_ids(imported_doc, current_doc, child, id_changes);
     }
 }
 
@@ -235,27 +75,26 @@ change_clashing_ids(SPDocument *imported_doc, SPDocument *current_doc,
  *  Fix up references to changed IDs.
  */
 static void
-fix_up_refs(const refmap_type *refmap, const id_changelist_type &id_changes)
+fix_up_refs(const id_changelist_type &id_changes)
 {
     id_changelist_type::const_iterator pp;
     const id_changelist_type::const_iterator pp_end = id_changes.end();
     for (pp = id_changes.begin(); pp != pp_end; ++pp) {
         SPObject *obj = pp->first;
-        refmap_type::const_iterator pos = refmap->find(pp->second);
-        std::list<IdReference>::const_iterator it;
-        const std::list<IdReference>::const_iterator it_end = pos->second.end();
-        for (it = pos->second.begin(); it != it_end; ++it) {
-            if (it->type == REF_HREF) {
+        reflist_type::const_iterator it;
+        const reflist_type::const_iterator it_end = pp->second.end();
+        for (it = pp->second.begin(); it != it_end; ++it) {
+            if (it->type == Inkscape::IdReferenceIndex::REF_HREF) {
                 gchar *new_uri = g_strdup_printf("#%s", obj->getId());
                 it->elem->getRepr()->setAttribute(it->attr, new_uri);
                 g_free(new_uri);
-            } else if (it->type == REF_STYLE) {
+            } else if (it->type == Inkscape::IdReferenceIndex::REF_STYLE) {
                 sp_style_set_property_url(it->elem, it->attr, obj, false);
-            } else if (it->type == REF_URL) {
+            } else if (it->type == Inkscape::IdReferenceIndex::REF_URL) {
                 gchar *url = g_strdup_printf("url(#%s)", obj->getId());
                 it->elem->getRepr()->setAttribute(it->attr, url);
                 g_free(url);
-            } else if (it->type == REF_CLIPBOARD) {
+            } else if (it->type == Inkscape::IdReferenceIndex::REF_CLIPBOARD) {
                 SPCSSAttr *style = sp_repr_css_attr(it->elem->getRepr(), "style");
                 gchar *url = g_strdup_printf("url(#%s)", obj->getId());
                 sp_repr_css_set_property(style, it->attr, url);
@@ -279,16 +118,14 @@ fix_up_refs(const refmap_type *refmap, const id_changelist_type &id_changes)
 void
 prevent_id_clashes(SPDocument *imported_doc, SPDocument *current_doc)
 {
-    refmap_type *refmap = new refmap_type;
     id_changelist_type id_changes;
     SPObject *imported_root = imported_doc->getRoot();
-        
-    find_references(imported_root, refmap);
-    change_clashing_ids(imported_doc, current_doc, imported_root, refmap,
-                        &id_changes);
-    fix_up_refs(refmap, id_changes);
 
-    delete refmap;
+    // objects still deferred have ids and references too
+    imported_doc->buildDeferred();
+
+    change_clashing_ids(imported_doc, current_doc, imported_root, &id_changes);
+    fix_up_refs(id_changes);
 }
 
 /*
@@ -297,24 +134,18 @@ prevent_id_clashes(SPDocument *imported_doc, SPDocument *current_doc)
 void
 change_def_references(SPObject *from_obj, SPObject *to_obj)
 {
-    refmap_type *refmap = new refmap_type;
     SPDocument *current_doc = from_obj->document;
-    std::string old_id(from_obj->getId());
-
-    find_references(current_doc->getRoot(), refmap);
-
-    refmap_type::const_iterator pos = refmap->find(old_id);
-    if (pos != refmap->end()) {
-        std::list<IdReference>::const_iterator it;
-        const std::list<IdReference>::const_iterator it_end = pos->second.end();
-        for (it = pos->second.begin(); it != it_end; ++it) {
-            if (it->type == REF_STYLE) {
-                sp_style_set_property_url(it->elem, it->attr, to_obj, false);
-            }
+    reflist_type refs;
+    current_doc->buildDeferred();
+    current_doc->reference_index->referencesTo(from_obj->getId(), refs);
+
+    reflist_type::const_iterator it;
+    const reflist_type::const_iterator it_end = refs.end();
+    for (it = refs.begin(); it != it_end; ++it) {
+        if (it->type == Inkscape::IdReferenceIndex::REF_STYLE) {
+            sp_style_set_property_url(it->elem, it->attr, to_obj, false);
         }
     }
-
-    delete refmap;
 }
 
 /*
@@ -337,11 +168,11 @@ void rename_id(SPObject *elem, Glib::ustring const &new_name)
     }
 
     SPDocument *current_doc = elem->document;
-    refmap_type *refmap = new refmap_type;
     id_changelist_type id_changes;
-    find_references(current_doc->getRoot(), refmap);
+    reflist_type refs;
+    current_doc->buildDeferred();
+    current_doc->reference_index->referencesTo(elem->getId(), refs);
 
-    std::string old_id(elem->getId());
     if (current_doc->getObjectById(id)) {
         // Choose a new ID.
         // To try to preserve any meaningfulness that the original ID
@@ -358,12 +189,11 @@ void rename_id(SPObject *elem, Glib::ustring const &new_name)
     // Change to the new ID
     elem->getRepr()->setAttribute("id", new_name2.c_str());
     // Make a note of this change, if we need to fix up refs to it
-    if (refmap->find(old_id) != refmap->end()) {
-        id_changes.push_back(id_changeitem_type(elem, old_id));
+    if (!refs.empty()) {
+        id_changes.push_back(id_changeitem_type(elem, refs));
     }
 
-    fix_up_refs(refmap, id_changes);
-    delete refmap;
+    fix_up_refs(id_changes);
 }
 
 /*
@@ -0,0 +1,92 @@
+#ifndef SEEN_ID_REFERENCE_INDEX_TEST_H
+#define SEEN_ID_REFERENCE_INDEX_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <cstring>
+#include <vector>
+
+#include "document.h"
+#include "id-reference-index.h"
+#include "sp-object.h"
+#include "xml/node.h"
+
+class IdReferenceIndexTest : public CxxTest::TestSuite
+{
+public:
+    static IdReferenceIndexTest *createSuite() { return new IdReferenceIndexTest(); }
+    static void destroySuite( IdReferenceIndexTest *suite ) { delete suite; }
+
+    void testFollowsChanges()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg' xmlns:xlink='http://www.w3.org/1999/xlink'>"
+            "<defs>"
+            "<linearGradient id='grad'><stop offset='0' style='stop-color:#000'/></linearGradient>"
+            "<clipPath id='clip'><rect width='5' height='5'/></clipPath>"
+            "</defs>"
+            "<rect id='r' width='10' height='10' style='fill:url(#grad)' clip-path='url(#clip)'/>"
+            "<use id='u' xlink:href='#r'/>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        SPObject *r = doc->getObjectById("r");
+        SPObject *u = doc->getObjectById("u");
+        TS_ASSERT(r && u);
+        if ( r && u ) {
+            Inkscape::IdReferenceIndex *index = doc->reference_index;
+
+            TS_ASSERT( refers(index, "grad", r, "fill", Inkscape::IdReferenceIndex::REF_STYLE) );
+            TS_ASSERT( refers(index, "clip", r, "clip-path", Inkscape::IdReferenceIndex::REF_URL) );
+            TS_ASSERT( refers(index, "r", u, "xlink:href", Inkscape::IdReferenceIndex::REF_HREF) );
+            TS_ASSERT( !index->isReferenced("u") );
+            TS_ASSERT( !index->isReferenced("no-such-id") );
+
+            r->getRepr()->setAttribute("style", "fill:none;stroke:url(#grad)");
+            doc->ensureUpToDate();
+            TS_ASSERT( !refers(index, "grad", r, "fill", Inkscape::IdReferenceIndex::REF_STYLE) );
+            TS_ASSERT( refers(index, "grad", r, "stroke", Inkscape::IdReferenceIndex::REF_STYLE) );
+
+            r->getRepr()->setAttribute("clip-path", NULL);
+            TS_ASSERT( !index->isReferenced("clip") );
+
+            Inkscape::XML::Node *repr = u->getRepr();
+            repr->parent()->removeChild(repr);
+            TS_ASSERT( !index->isReferenced("r") );
+        }
+
+        doc->doUnref();
+    }
+
+private:
+    static bool refers(Inkscape::IdReferenceIndex *index, char const *id, SPObject *elem,
+                       char const *attr, Inkscape::IdReferenceIndex::Type type)
+    {
+        std::vector<Inkscape::IdReferenceIndex::Reference> refs;
+        index->referencesTo(id, refs);
+        for (std::vector<Inkscape::IdReferenceIndex::Reference>::const_iterator i = refs.begin(); i != refs.end(); ++i) {
+            if (i->elem == elem && i->type == type && !strcmp(i->attr, attr)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // SEEN_ID_REFERENCE_INDEX_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
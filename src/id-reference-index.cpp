@@ -0,0 +1,248 @@
+/** \file
+ * Reverse index from ids to the objects referring to them.
+ */
+/*
+ * The references recognised are those id-clash.cpp has always fixed up, after
+ * its find_references() by Stephen Silver and Jon A. Cruz.
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <cstring>
+#include <string>
+
+#include "extract-uri.h"
+#include "id-reference-index.h"
+#include "sp-filter-reference.h"
+#include "sp-object.h"
+#include "sp-paint-server-reference.h"
+#include "style.h"
+#include "uri.h"
+#include "xml/node.h"
+#include "xml/repr.h"
+
+namespace {
+
+typedef Inkscape::IdReferenceIndex Index;
+
+char const *href_like_attributes[] = {
+    "inkscape:connection-end",
+    "inkscape:connection-start",
+    "inkscape:href",
+    "inkscape:path-effect",
+    "inkscape:perspectiveID",
+    "inkscape:tiled-clone-of",
+    "xlink:href",
+};
+#define NUM_HREF_LIKE_ATTRIBUTES (sizeof(href_like_attributes) / sizeof(*href_like_attributes))
+
+SPIPaint SPStyle::* const SPIPaint_members[] = {
+    &SPStyle::color,
+    &SPStyle::fill,
+    &SPStyle::stroke,
+};
+char const *SPIPaint_properties[] = {
+    "color",
+    "fill",
+    "stroke",
+};
+#define NUM_SPIPAINT_PROPERTIES (sizeof(SPIPaint_properties) / sizeof(*SPIPaint_properties))
+
+char const *other_url_properties[] = {
+    "clip-path",
+    "color-profile",
+    "cursor",
+    "marker-end",
+    "marker-mid",
+    "marker-start",
+    "mask",
+};
+#define NUM_OTHER_URL_PROPERTIES (sizeof(other_url_properties) / sizeof(*other_url_properties))
+
+char const *clipboard_properties[] = {
+    "color",
+    "fill",
+    "filter",
+    "stroke",
+    "marker-end",
+    "marker-mid",
+    "marker-start"
+};
+#define NUM_CLIPBOARD_PROPERTIES (sizeof(clipboard_properties) / sizeof(*clipboard_properties))
+
+/** The id in a url(#id) value, or 0. */
+GQuark url_id(gchar const *value)
+{
+    GQuark id = 0;
+    if (value) {
+        gchar *uri = extract_uri(value);
+        if (uri && uri[0] == '#') {
+            id = g_quark_from_string(uri + 1);
+        }
+        g_free(uri);
+    }
+    return id;
+}
+
+/** The id \a ref is attached to, in the forms URIReference::attach() accepts, or 0. */
+GQuark reference_id(Inkscape::URIReference const *ref)
+{
+    Inkscape::URI const *uri = ref ? ref->getURI() : NULL;
+    gchar const *fragment = uri ? uri->getFragment() : NULL;
+    if (!fragment) {
+        return 0;
+    }
+    if (!std::strncmp(fragment, "xpointer(id(", 12)) {
+        std::string id(fragment + 12);
+        if (id.size() < 3 || id.compare(id.size() - 2, 2, "))")) {
+            return 0;
+        }
+        id.erase(id.size() - 2);
+        return g_quark_from_string(id.c_str());
+    }
+    return g_quark_from_string(fragment);
+}
+
+template <typename Target>
+void add_target(std::vector<Target> &targets, GQuark id, Index::Type type, char const *attr)
+{
+    if (id) {
+        Target target = { id, type, attr };
+        targets.push_back(target);
+    }
+}
+
+/**
+ * Lists the places where \a elem references ids, not counting its children.
+ * FIXME: There are some types of references not yet dealt with here
+ *        (e.g., ID selectors in CSS stylesheets, and references in scripts).
+ */
+template <typename Target>
+void scan(SPObject *elem, std::vector<Target> &targets)
+{
+    Inkscape::XML::Node *repr_elem = elem->getRepr();
+    if (!repr_elem || repr_elem->type() != Inkscape::XML::ELEMENT_NODE) {
+        return;
+    }
+
+    /* check for references in inkscape:clipboard elements */
+    if (!std::strcmp(repr_elem->name(), "inkscape:clipboard")) {
+        SPCSSAttr *css = sp_repr_css_attr(repr_elem, "style");
+        if (css) {
+            for (unsigned i = 0; i < NUM_CLIPBOARD_PROPERTIES; ++i) {
+                char const *attr = clipboard_properties[i];
+                add_target(targets, url_id(sp_repr_css_property(css, attr, NULL)), Index::REF_CLIPBOARD, attr);
+            }
+            sp_repr_css_attr_unref(css);
+        }
+        return; // nothing more to do for inkscape:clipboard elements
+    }
+
+    /* check for xlink:href="#..." and similar */
+    for (unsigned i = 0; i < NUM_HREF_LIKE_ATTRIBUTES; ++i) {
+        char const *attr = href_like_attributes[i];
+        gchar const *val = repr_elem->attribute(attr);
+        if (val && val[0] == '#') {
+            add_target(targets, g_quark_from_string(val + 1), Index::REF_HREF, attr);
+        }
+    }
+
+    SPStyle *style = elem->style;
+    if (style) {
+        /* check for url(#...) references in 'fill' or 'stroke' */
+        for (unsigned i = 0; i < NUM_SPIPAINT_PROPERTIES; ++i) {
+            SPIPaint const &paint = style->*SPIPaint_members[i];
+            add_target(targets, reference_id(paint.value.href), Index::REF_STYLE, SPIPaint_properties[i]);
+        }
+
+        /* check for url(#...) references in 'filter' */
+        add_target(targets, reference_id(style->filter.href), Index::REF_STYLE, "filter");
+
+        /* check for url(#...) references in markers */
+        char const *markers[4] = { "", "marker-start", "marker-mid", "marker-end" };
+        for (unsigned i = SP_MARKER_LOC_START; i < SP_MARKER_LOC_QTY; i++) {
+            add_target(targets, url_id(style->marker[i].value), Index::REF_STYLE, markers[i]);
+        }
+    }
+
+    /* check for other url(#...) references */
+    for (unsigned i = 0; i < NUM_OTHER_URL_PROPERTIES; ++i) {
+        char const *attr = other_url_properties[i];
+        add_target(targets, url_id(repr_elem->attribute(attr)), Index::REF_URL, attr);
+    }
+}
+
+}
+
+namespace Inkscape {
+
+IdReferenceIndex::IdReferenceIndex()
+{
+}
+
+void IdReferenceIndex::_scan(SPObject *object, std::vector<Target> &targets)
+{
+    scan(object, targets);
+}
+
+void IdReferenceIndex::_link(SPObject *object, Target const &target)
+{
+    _referrers[target.id].insert(object);
+}
+
+void IdReferenceIndex::_unlink(SPObject *object, Target const &target)
+{
+    ReferrerMap::iterator referrers = _referrers.find(target.id);
+    if (referrers != _referrers.end()) {
+        referrers->second.erase(object);
+        if (referrers->second.empty()) {
+            _referrers.erase(referrers);
+        }
+    }
+}
+
+void IdReferenceIndex::referencesTo(char const *id, std::vector<Reference> &refs)
+{
+    GQuark const quark = id ? g_quark_try_string(id) : 0;
+    if (!quark) {
+        return;
+    }
+    _update();
+
+    ReferrerMap::const_iterator referrers = _referrers.find(quark);
+    if (referrers == _referrers.end()) {
+        return;
+    }
+    for (ReferrerSet::const_iterator i = referrers->second.begin(); i != referrers->second.end(); ++i) {
+        std::vector<Target> const *targets = _keys(*i);
+        for (std::vector<Target>::const_iterator j = targets->begin(); j != targets->end(); ++j) {
+            if (j->id == quark) {
+                Reference ref = { j->type, *i, j->attr };
+                refs.push_back(ref);
+            }
+        }
+    }
+}
+
+bool IdReferenceIndex::isReferenced(char const *id)
+{
+    GQuark const quark = id ? g_quark_try_string(id) : 0;
+    if (!quark) {
+        return false;
+    }
+    _update();
+    return _referrers.find(quark) != _referrers.end();
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
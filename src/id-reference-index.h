@@ -0,0 +1,88 @@
+#ifndef SEEN_INKSCAPE_ID_REFERENCE_INDEX_H
+#define SEEN_INKSCAPE_ID_REFERENCE_INDEX_H
+
+/** \file
+ * Reverse index from ids to the objects referring to them.
+ */
+/*
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <vector>
+#include <glib.h>
+#include "object-index.h"
+#include "util/unordered-containers.h"
+
+class SPObject;
+
+namespace Inkscape {
+
+/** Types of IdReferenceIndex, declared ahead of it to name its keys. */
+struct IdReferenceTypes {
+    enum Type {
+        REF_HREF,      ///< attr holds "#id"
+        REF_STYLE,     ///< attr is a style property holding url(#id)
+        REF_URL,       ///< attr holds url(#id)
+        REF_CLIPBOARD  ///< attr is a property of the style of an inkscape:clipboard element
+    };
+
+    /** An id referred to, and where. */
+    struct Target {
+        GQuark id;
+        Type type;
+        char const *attr;
+    };
+};
+
+/**
+ * Maps each id to the objects of a document that refer to it through an
+ * href-like attribute, a url(#...) property or their style, and to the
+ * attribute or property each reference is held in.
+ *
+ * A lookup costs the number of references to the id plus the number of
+ * objects changed since the previous lookup, see ObjectIndex. Clones are not
+ * indexed.
+ *
+ * References are recorded by the id written in the document, whether or not
+ * an object with that id exists.
+ */
+class IdReferenceIndex : public IdReferenceTypes, public ObjectIndex<IdReferenceTypes::Target> {
+public:
+    struct Reference {
+        Type type;
+        SPObject *elem;
+        char const *attr;  ///< property or href-like attribute
+    };
+
+    IdReferenceIndex();
+
+    /** Appends the references to \a id to \a refs. */
+    void referencesTo(char const *id, std::vector<Reference> &refs);
+    bool isReferenced(char const *id);
+
+protected:
+    virtual void _scan(SPObject *object, std::vector<Target> &targets);
+    virtual void _link(SPObject *object, Target const &target);
+    virtual void _unlink(SPObject *object, Target const &target);
+
+private:
+    typedef INK_UNORDERED_SET<SPObject *> ReferrerSet;
+    typedef INK_UNORDERED_MAP<GQuark, ReferrerSet> ReferrerMap;
+
+    ReferrerMap _referrers;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_ID_REFERENCE_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -19,9 +19,12 @@
 #include <errno.h>
 
 #include <map>
+#include <vector>
 
-#if GLIBMM_DISABLE_DEPRECATED && HAVE_GLIBMM_THREADS_H
+#if WITH_GLIBMM_2_32 && HAVE_GLIBMM_THREADS_H
 #include <glibmm/threads.h>
+#else
+#include <glibmm/thread.h>
 #endif
 
 #include <gtkmm/messagedialog.h>
@@ -306,17 +309,231 @@ typedef int uid_t;
 #define getuid() 0
 #endif
 
+namespace {
+
+#if GLIB_CHECK_VERSION(2,32,0)
+typedef Glib::Threads::Mutex AutosaveMutex;
+typedef Glib::Threads::Thread AutosaveThread;
+#else
+typedef Glib::Mutex AutosaveMutex;
+typedef Glib::Thread AutosaveThread;
+#endif
+
+/// Milliseconds between checks for the end of an autosave
+unsigned const AUTOSAVE_POLL_INTERVAL = 200;
+
+/**
+ * One round of autosaving. Snapshots of the modified documents are taken on
+ * the main thread; a worker thread removes old autosaves and writes each
+ * snapshot gzipped to a temporary file, which is then renamed, so that an
+ * autosave file is never left half written. The snapshots are released on
+ * the main thread once the worker is done.
+ */
+class AutosaveRun {
+public:
+    struct Job {
+        Inkscape::XML::ReprSnapshot *snapshot;
+        std::string path;
+        bool ok;
+    };
+
+    AutosaveRun(std::string const &dir, std::string const &prefix, int max)
+        : dir(dir), prefix(prefix), max(max), thread(NULL), done(false)
+    {}
+
+    ~AutosaveRun()
+    {
+        for (std::vector<Job>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+            delete i->snapshot;
+        }
+    }
+
+    void start();
+    void run();
+    bool finished();
+    void wait();
+
+    std::string const dir;
+    std::string const prefix; ///< name start shared by the autosaves of this user
+    int const max;
+    std::vector<Job> jobs;
+
+private:
+    void removeOldest();
+
+    AutosaveThread *thread;
+    AutosaveMutex mutex;
+    bool done;
+};
+
+/// The autosave being written, if any
+AutosaveRun *autosave_run = NULL;
+
+void AutosaveRun::start()
+{
+#if !GLIB_CHECK_VERSION(2,32,0)
+    if(!Glib::thread_supported())
+        Glib::thread_init();
+#endif
+
+    try {
+#if GLIB_CHECK_VERSION(2,32,0)
+        thread = Glib::Threads::Thread::create(sigc::mem_fun(*this, &AutosaveRun::run));
+#else
+        thread = Glib::Thread::create(sigc::mem_fun(*this, &AutosaveRun::run), true);
+#endif
+    } catch (...) {
+        thread = NULL;
+    }
+    if (!thread) {
+        // write on this thread then, as before
+        run();
+    }
+}
+
+/**
+ * Removes the oldest autosave of this user if there are max of them already.
+ */
+void AutosaveRun::removeOldest()
+{
+    GDir *autosave_dir_ptr = g_dir_open(dir.c_str(), 0, NULL);
+    if (!autosave_dir_ptr) {
+        return;
+    }
+
+    gchar *oldest_autosave = 0;
+    const gchar  *filename = 0;
+    struct stat sb;
+    time_t min_time = 0;
+    gint count = 0;
+
+    while( (filename = g_dir_read_name(autosave_dir_ptr)) != NULL ){
+        if ( strncmp(filename, prefix.c_str(), prefix.size()) == 0 ){
+            gchar* full_path = g_build_filename( dir.c_str(), filename, NULL );
+            if (g_file_test (full_path, G_FILE_TEST_EXISTS)){
+                if ( g_stat(full_path, &sb) != -1 ) {
+                    if ( difftime(sb.st_ctime, min_time) < 0 || min_time == 0 ){
+                        min_time = sb.st_ctime;
+                        if ( oldest_autosave ) {
+                            g_free(oldest_autosave);
+                        }
+                        oldest_autosave = g_strdup(full_path);
+                    }
+                    count ++;
+                }
+            }
+            g_free(full_path);
+        }
+    }
+    g_dir_close(autosave_dir_ptr);
+
+    // Have we reached the limit for number of autosaves?
+    if ( count >= max ){
+        // Remove the oldest file
+        if ( oldest_autosave ) {
+            unlink(oldest_autosave);
+        }
+    }
+
+    if ( oldest_autosave ) {
+        g_free(oldest_autosave);
+        oldest_autosave = 0;
+    }
+}
+
+void AutosaveRun::run()
+{
+    for (std::vector<Job>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+        removeOldest();
+
+        // the temporary name does not start with prefix, so it is never taken for an autosave
+        std::string const temp = Glib::build_filename(dir, ".~" + Glib::path_get_basename(i->path));
+        bool ok = i->snapshot->write(temp.c_str(), true);
+        if (ok) {
+            ok = ( g_rename(temp.c_str(), i->path.c_str()) == 0 );
+        }
+        if (!ok) {
+            g_unlink(temp.c_str());
+        }
+
+        AutosaveMutex::Lock lock(mutex);
+        i->ok = ok;
+    }
+
+    AutosaveMutex::Lock lock(mutex);
+    done = true;
+}
+
+bool AutosaveRun::finished()
+{
+    AutosaveMutex::Lock lock(mutex);
+    return done;
+}
+
+void AutosaveRun::wait()
+{
+    if (thread) {
+        thread->join();
+        thread = NULL;
+    }
+}
+
+/**
+ * Callback passed to g_timeout_add() while an autosave is being written.
+ * Reports the outcome once the worker is done.
+ */
+gboolean inkscape_autosave_finish(gpointer)
+{
+    if (!autosave_run) { // already reported on exit
+        return FALSE;
+    }
+    if (!autosave_run->finished()) {
+        return TRUE;
+    }
+    autosave_run->wait();
+
+    SPDesktop *desktop = SP_ACTIVE_DESKTOP;
+    for (std::vector<AutosaveRun::Job>::iterator i = autosave_run->jobs.begin(); i != autosave_run->jobs.end(); ++i) {
+        if (!i->ok) {
+            gchar *safeUri = Inkscape::IO::sanitizeString(i->path.c_str());
+            gchar *errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri);
+            g_free(safeUri);
+            if (desktop) {
+                desktop->messageStack()->flash(Inkscape::ERROR_MESSAGE, errortext);
+            }
+            g_warning("%s", errortext);
+            g_free(errortext);
+        }
+    }
+
+    delete autosave_run;
+    autosave_run = NULL;
+
+    if (desktop) {
+        desktop->messageStack()->flash(Inkscape::NORMAL_MESSAGE, _("Autosave complete."));
+    }
+    return FALSE;
+}
+
+}
+
 /**
  * static gint inkscape_autosave(gpointer);
  *
  * Callback passed to g_timeout_add_seconds()
  * Responsible for autosaving all open documents
+ *
+ * Only snapshots of the documents are taken here; they are written by a
+ * worker thread, and inkscape_autosave_finish() reports the outcome.
  */
 static gint inkscape_autosave(gpointer)
 {
     if (inkscape->document_set.empty()) { // nothing to autosave
         return TRUE;
     }
+    if (autosave_run) { // the previous autosave is still being written
+        return TRUE;
+    }
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
 
     // Use UID for separating autosave-documents between users if directory is multiuser
@@ -353,6 +570,8 @@ static gint inkscape_autosave(gpointer)
             return TRUE;
         }
     }
+    // the worker reads the directory itself
+    g_dir_close(autosave_dir_ptr);
 
     time_t sptime = time(NULL);
     struct tm *sptm = localtime(&sptime);
@@ -361,9 +580,12 @@ static gint inkscape_autosave(gpointer)
 
     gint autosave_max = prefs->getInt("/options/autosave/max", 10);
 
+    gchar* baseName = g_strdup_printf( "inkscape-autosave-%d", uid );
+    AutosaveRun *run = new AutosaveRun(autosave_dir, baseName, autosave_max);
+    g_free(baseName);
+
     gint docnum = 0;
 
-    SP_ACTIVE_DESKTOP->messageStack()->flash(Inkscape::NORMAL_MESSAGE, _("Autosaving documents..."));
     for (std::map<SPDocument*,int>::iterator iter = inkscape->document_set.begin();
           iter != inkscape->document_set.end();
           ++iter) {
@@ -376,92 +598,33 @@ static gint inkscape_autosave(gpointer)
         // g_debug("Document %d: \"%s\" %s", docnum, doc ? doc->getName() : "(null)", doc ? (doc->isModifiedSinceSave() ? "(dirty)" : "(clean)") : "(null)");
 
         if (doc->isModifiedSinceSave()) {
-            gchar *oldest_autosave = 0;
-            const gchar  *filename = 0;
-            struct stat sb;
-            time_t min_time = 0;
-            gint count = 0;
-
-            // Look for previous autosaves
-            gchar* baseName = g_strdup_printf( "inkscape-autosave-%d", uid );
-            g_dir_rewind(autosave_dir_ptr);
-            while( (filename = g_dir_read_name(autosave_dir_ptr)) != NULL ){
-                if ( strncmp(filename, baseName, strlen(baseName)) == 0 ){
-                    gchar* full_path = g_build_filename( autosave_dir.c_str(), filename, NULL );
-                    if (g_file_test (full_path, G_FILE_TEST_EXISTS)){ 
-                        if ( g_stat(full_path, &sb) != -1 ) {
-                            if ( difftime(sb.st_ctime, min_time) < 0 || min_time == 0 ){
-                                min_time = sb.st_ctime;
-                                if ( oldest_autosave ) {
-                                    g_free(oldest_autosave);
-                                }
-                                oldest_autosave = g_strdup(full_path);
-                            }
-                            count ++;
-                        }
-                    }
-                    g_free(full_path);
-                }
-            }
-
-            // g_debug("%d previous autosaves exists. Max = %d", count, autosave_max);
-
-            // Have we reached the limit for number of autosaves?
-            if ( count >= autosave_max ){
-                // Remove the oldest file
-                if ( oldest_autosave ) {
-                    unlink(oldest_autosave);
-                }
-            }
-
-            if ( oldest_autosave ) {
-                g_free(oldest_autosave);
-                oldest_autosave = 0;
-            }
-
-
             // Set the filename we will actually save to
-            g_free(baseName);
-            baseName = g_strdup_printf("inkscape-autosave-%d-%s-%03d.svg", uid, sptstr, docnum);
+            baseName = g_strdup_printf("inkscape-autosave-%d-%s-%03d.svgz", uid, sptstr, docnum);
             gchar* full_path = g_build_filename(autosave_dir.c_str(), baseName, NULL);
             g_free(baseName);
             baseName = 0;
 
             // g_debug("Filename: %s", full_path);
 
-            // Try to save the file
-            FILE *file = Inkscape::IO::fopen_utf8name(full_path, "w");
-            gchar *errortext = 0;
-            if (file) {
-                try{
-                    sp_repr_save_stream(repr->document(), file, SP_SVG_NS_URI);
-                } catch (Inkscape::Extension::Output::no_extension_found &e) {
-                    errortext = g_strdup(_("Autosave failed! Could not find inkscape extension to save document."));
-                } catch (Inkscape::Extension::Output::save_failed &e) {
-                    gchar *safeUri = Inkscape::IO::sanitizeString(full_path);
-                    errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri);
-                    g_free(safeUri);
-                }
-                fclose(file);
-            }
-            else {
-                gchar *safeUri = Inkscape::IO::sanitizeString(full_path);
-                errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri);
-                g_free(safeUri);
-            }
-
-            if (errortext) {
-                SP_ACTIVE_DESKTOP->messageStack()->flash(Inkscape::ERROR_MESSAGE, errortext);
-                g_warning("%s", errortext);
-                g_free(errortext);
-            }
+            AutosaveRun::Job job;
+            job.snapshot = new Inkscape::XML::ReprSnapshot(repr->document(), SP_SVG_NS_URI);
+            job.path = full_path;
+            job.ok = false;
+            run->jobs.push_back(job);
 
             g_free(full_path);
         }
     }
-    g_dir_close(autosave_dir_ptr);
 
-    SP_ACTIVE_DESKTOP->messageStack()->flash(Inkscape::NORMAL_MESSAGE, _("Autosave complete."));
+    if (run->jobs.empty()) {
+        delete run;
+        return TRUE;
+    }
+
+    SP_ACTIVE_DESKTOP->messageStack()->flash(Inkscape::NORMAL_MESSAGE, _("Autosaving documents..."));
+    autosave_run = run;
+    autosave_run->start();
+    g_timeout_add(AUTOSAVE_POLL_INTERVAL, inkscape_autosave_finish, NULL);
 
     return TRUE;
 }
@@ -1408,6 +1571,12 @@ inkscape_exit (Inkscape::Application */*inkscape*/)
     //emit shutdown signal so that dialogs could remember layout
     g_signal_emit (G_OBJECT (INKSCAPE), inkscape_signals[SHUTDOWN_SIGNAL], 0);
 
+    // let an autosave being written finish, so its snapshots can be released
+    if (autosave_run) {
+        autosave_run->wait();
+        inkscape_autosave_finish(NULL);
+    }
+
     Inkscape::Preferences::unload();
     gtk_main_quit ();
 }
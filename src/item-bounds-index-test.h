@@ -0,0 +1,94 @@
+#ifndef SEEN_ITEM_BOUNDS_INDEX_TEST_H
+#define SEEN_ITEM_BOUNDS_INDEX_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <cstring>
+#include <vector>
+
+#include "document.h"
+#include "item-bounds-index.h"
+#include "sp-item.h"
+#include "xml/node.h"
+
+class ItemBoundsIndexTest : public CxxTest::TestSuite
+{
+public:
+    static ItemBoundsIndexTest *createSuite() { return new ItemBoundsIndexTest(); }
+    static void destroySuite( ItemBoundsIndexTest *suite ) { delete suite; }
+
+    void testFollowsChanges()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg' width='100' height='100'>"
+            "<rect id='a' x='0' y='0' width='10' height='10'/>"
+            "<g id='g' transform='translate(50,0)'>"
+            "<rect id='b' x='0' y='0' width='10' height='10'/>"
+            "</g>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        SPObject *a = doc->getObjectById("a");
+        SPObject *b = doc->getObjectById("b");
+        SPObject *g = doc->getObjectById("g");
+        TS_ASSERT(a && b && g);
+        if ( a && b && g ) {
+            Geom::Rect const left(Geom::Point(1, 1), Geom::Point(2, 2));
+            Geom::Rect const right(Geom::Point(51, 1), Geom::Point(52, 2));
+
+            TS_ASSERT( contains(doc, left, a) );
+            TS_ASSERT( !contains(doc, left, b) );
+            TS_ASSERT( contains(doc, right, b) );
+            TS_ASSERT( contains(doc, right, g) );
+
+            // moving the group moves the rect in it
+            g->getRepr()->setAttribute("transform", NULL);
+            doc->ensureUpToDate();
+            TS_ASSERT( contains(doc, left, b) );
+            TS_ASSERT( !contains(doc, right, b) );
+
+            a->getRepr()->setAttribute("x", "50");
+            doc->ensureUpToDate();
+            TS_ASSERT( !contains(doc, left, a) );
+            TS_ASSERT( contains(doc, right, a) );
+
+            unsigned const size = doc->item_index->size();
+            Inkscape::XML::Node *repr = b->getRepr();
+            repr->parent()->removeChild(repr);
+            TS_ASSERT_EQUALS( doc->item_index->size(), size - 1 );
+        }
+
+        doc->doUnref();
+    }
+
+private:
+    static bool contains(SPDocument *doc, Geom::Rect const &area, SPObject *object)
+    {
+        std::vector<SPItem *> items;
+        doc->item_index->intersecting(area, items);
+        for (std::vector<SPItem *>::const_iterator i = items.begin(); i != items.end(); ++i) {
+            if (*i == object) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // SEEN_ITEM_BOUNDS_INDEX_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
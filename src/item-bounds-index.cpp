@@ -0,0 +1,349 @@
+/** \file
+ * Spatial index of the visual bounding boxes of a document's items.
+ */
+/*
+ * The tree is kept balanced with the insertion cost heuristic and the rotations
+ * of the dynamic AABB tree of Box2D (Erin Catto, zlib license).
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <algorithm>
+
+#include "item-bounds-index.h"
+#include "marker.h"
+#include "sp-item.h"
+#include "sp-text.h"
+#include "sp-flowtext.h"
+
+namespace {
+
+double half_perimeter(Geom::Rect const &box)
+{
+    return box.width() + box.height();
+}
+
+Geom::Rect united(Geom::Rect const &a, Geom::Rect const &b)
+{
+    Geom::Rect box(a);
+    box.unionWith(b);
+    return box;
+}
+
+/**
+ * Whether \a item is drawn as part of the canvas, rather than only as a resource under
+ * defs, a clip path, mask, pattern or marker, which no query would return.
+ */
+bool in_canvas(SPItem const *item)
+{
+    for (SPObject const *o = item->parent; o; o = o->parent) {
+        if (!SP_IS_ITEM(o) || SP_IS_MARKER(o)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool picks_beyond_bounds(SPItem const *item)
+{
+    // Text is picked on the advance and ascent of each glyph rather than its outline.
+    return SP_IS_TEXT(item) || SP_IS_FLOWTEXT(item);
+}
+
+}
+
+namespace Inkscape {
+
+ItemBoundsIndex::ItemBoundsIndex()
+    : _root(-1),
+      _free_list(-1)
+{
+}
+
+void ItemBoundsIndex::add(SPItem *item)
+{
+    g_return_if_fail(item != NULL);
+
+    if (!in_canvas(item)) {
+        return;
+    }
+
+    Entry entry = { -1, false };
+    std::pair<EntryMap::iterator, bool> inserted = _entries.insert(std::make_pair(item, entry));
+    if (inserted.second) {
+        if (picks_beyond_bounds(item)) {
+            _unbounded.insert(item);
+        }
+        invalidate(item);
+    }
+}
+
+void ItemBoundsIndex::remove(SPItem *item)
+{
+    EntryMap::iterator found = _entries.find(item);
+    if (found == _entries.end()) {
+        return;
+    }
+    if (found->second.leaf != -1) {
+        _removeLeaf(found->second.leaf);
+        _free(found->second.leaf);
+    }
+    _entries.erase(found);
+    _unbounded.erase(item);
+    // a stale pointer left in _dirty is skipped since it has no entry any more
+}
+
+void ItemBoundsIndex::invalidate(SPItem *item)
+{
+    EntryMap::iterator found = _entries.find(item);
+    if (found != _entries.end() && !found->second.dirty) {
+        found->second.dirty = true;
+        _dirty.push_back(item);
+    }
+}
+
+void ItemBoundsIndex::_update()
+{
+    for (std::vector<SPItem *>::const_iterator i = _dirty.begin(); i != _dirty.end(); ++i) {
+        EntryMap::iterator found = _entries.find(*i);
+        if (found == _entries.end() || !found->second.dirty) {
+            continue;
+        }
+        Entry &entry = found->second;
+        entry.dirty = false;
+
+        Geom::OptRect box = (*i)->documentVisualBounds();
+        if (entry.leaf != -1) {
+            if (box && _nodes[entry.leaf].box == *box) {
+                continue;
+            }
+            _removeLeaf(entry.leaf);
+            if (!box) {
+                _free(entry.leaf);
+                entry.leaf = -1;
+            }
+        } else if (box) {
+            entry.leaf = _allocate();
+            _nodes[entry.leaf].item = *i;
+        }
+        if (box) {
+            _nodes[entry.leaf].box = *box;
+            _insertLeaf(entry.leaf);
+        }
+    }
+    _dirty.clear();
+}
+
+void ItemBoundsIndex::intersecting(Geom::Rect const &area, std::vector<SPItem *> &items)
+{
+    _update();
+    if (_root == -1) {
+        return;
+    }
+
+    _stack.clear();
+    _stack.push_back(_root);
+    while (!_stack.empty()) {
+        Node const &node = _nodes[_stack.back()];
+        _stack.pop_back();
+        if (!node.box.intersects(area)) {
+            continue;
+        }
+        if (node.item) {
+            items.push_back(node.item);
+        } else {
+            _stack.push_back(node.children[0]);
+            _stack.push_back(node.children[1]);
+        }
+    }
+}
+
+void ItemBoundsIndex::unbounded(std::vector<SPItem *> &items) const
+{
+    items.insert(items.end(), _unbounded.begin(), _unbounded.end());
+}
+
+int ItemBoundsIndex::_allocate()
+{
+    int node;
+    if (_free_list != -1) {
+        node = _free_list;
+        _free_list = _nodes[node].parent;
+    } else {
+        node = _nodes.size();
+        _nodes.push_back(Node());
+    }
+    Node &n = _nodes[node];
+    n.item = NULL;
+    n.parent = -1;
+    n.children[0] = n.children[1] = -1;
+    n.height = 0;
+    return node;
+}
+
+void ItemBoundsIndex::_free(int node)
+{
+    _nodes[node].item = NULL;
+    _nodes[node].parent = _free_list;
+    _free_list = node;
+}
+
+void ItemBoundsIndex::_insertLeaf(int leaf)
+{
+    if (_root == -1) {
+        _root = leaf;
+        _nodes[leaf].parent = -1;
+        return;
+    }
+
+    // Go down to the sibling that makes the tree grow the least.
+    Geom::Rect const box = _nodes[leaf].box;
+    int index = _root;
+    while (_nodes[index].height > 0) {
+        Node const &node = _nodes[index];
+        double const area = half_perimeter(node.box);
+        double const combined = half_perimeter(united(node.box, box));
+
+        // cost of making a new parent for this node and the leaf
+        double const cost = 2 * combined;
+        // minimum cost of pushing the leaf further down
+        double const inheritance = 2 * (combined - area);
+
+        double child_cost[2];
+        for (int i = 0; i < 2; i++) {
+            Node const &child = _nodes[node.children[i]];
+            double const grown = half_perimeter(united(child.box, box));
+            child_cost[i] = inheritance + (child.height == 0 ? grown : grown - half_perimeter(child.box));
+        }
+
+        if (cost < child_cost[0] && cost < child_cost[1]) {
+            break;
+        }
+        index = node.children[child_cost[0] < child_cost[1] ? 0 : 1];
+    }
+
+    int const sibling = index;
+    int const old_parent = _nodes[sibling].parent;
+    int const new_parent = _allocate();
+    Node &parent = _nodes[new_parent];
+    parent.parent = old_parent;
+    parent.box = united(_nodes[sibling].box, box);
+    parent.height = _nodes[sibling].height + 1;
+    parent.children[0] = sibling;
+    parent.children[1] = leaf;
+    _nodes[sibling].parent = new_parent;
+    _nodes[leaf].parent = new_parent;
+
+    if (old_parent == -1) {
+        _root = new_parent;
+    } else {
+        Node &old = _nodes[old_parent];
+        old.children[old.children[0] == sibling ? 0 : 1] = new_parent;
+    }
+
+    _refit(_nodes[leaf].parent);
+}
+
+void ItemBoundsIndex::_removeLeaf(int leaf)
+{
+    if (leaf == _root) {
+        _root = -1;
+        return;
+    }
+
+    int const parent = _nodes[leaf].parent;
+    int const grandparent = _nodes[parent].parent;
+    Node const &p = _nodes[parent];
+    int const sibling = p.children[p.children[0] == leaf ? 1 : 0];
+
+    if (grandparent == -1) {
+        _root = sibling;
+        _nodes[sibling].parent = -1;
+        _free(parent);
+    } else {
+        Node &g = _nodes[grandparent];
+        g.children[g.children[0] == parent ? 0 : 1] = sibling;
+        _nodes[sibling].parent = grandparent;
+        _free(parent);
+        _refit(grandparent);
+    }
+    _nodes[leaf].parent = -1;
+}
+
+/** Rebalances and recomputes the boxes and heights from \a node up to the root. */
+void ItemBoundsIndex::_refit(int node)
+{
+    while (node != -1) {
+        node = _balance(node);
+        Node &n = _nodes[node];
+        Node const &a = _nodes[n.children[0]];
+        Node const &b = _nodes[n.children[1]];
+        n.height = 1 + std::max(a.height, b.height);
+        n.box = united(a.box, b.box);
+        node = n.parent;
+    }
+}
+
+/**
+ * Rotates the taller grandchild of \a a up if its children differ in height
+ * by more than one. Returns the node now in the place of \a a.
+ */
+int ItemBoundsIndex::_balance(int a)
+{
+    Node &na = _nodes[a];
+    if (na.height < 2) {
+        return a;
+    }
+
+    int const ib = na.children[0];
+    int const ic = na.children[1];
+    int const balance = _nodes[ic].height - _nodes[ib].height;
+    if (balance >= -1 && balance <= 1) {
+        return a;
+    }
+
+    // Lift the taller child up; 'up' takes the place of a, and a becomes its child.
+    int const up = (balance > 1) ? ic : ib;
+    int const other = (balance > 1) ? ib : ic;
+    Node &nu = _nodes[up];
+    int const f = nu.children[0];
+    int const g = nu.children[1];
+
+    nu.children[0] = a;
+    nu.parent = na.parent;
+    na.parent = up;
+    if (nu.parent == -1) {
+        _root = up;
+    } else {
+        Node &pp = _nodes[nu.parent];
+        pp.children[pp.children[0] == a ? 0 : 1] = up;
+    }
+
+    // The taller grandchild stays under 'up', the other one moves under a.
+    int const keep = (_nodes[f].height > _nodes[g].height) ? f : g;
+    int const move = (keep == f) ? g : f;
+    nu.children[1] = keep;
+    na.children[0] = other;
+    na.children[1] = move;
+    _nodes[move].parent = a;
+
+    na.box = united(_nodes[other].box, _nodes[move].box);
+    na.height = 1 + std::max(_nodes[other].height, _nodes[move].height);
+    nu.box = united(na.box, _nodes[keep].box);
+    nu.height = 1 + std::max(na.height, _nodes[keep].height);
+
+    return up;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
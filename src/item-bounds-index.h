@@ -0,0 +1,104 @@
+#ifndef SEEN_INKSCAPE_ITEM_BOUNDS_INDEX_H
+#define SEEN_INKSCAPE_ITEM_BOUNDS_INDEX_H
+
+/** \file
+ * Spatial index of the visual bounding boxes of a document's items.
+ */
+/*
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <vector>
+#include <2geom/rect.h>
+#include "util/unordered-containers.h"
+
+class SPItem;
+
+namespace Inkscape {
+
+/**
+ * Bounding volume tree (a binary R-tree) over the document visual bounding
+ * boxes of the items of a document.
+ *
+ * Items are added when they are built and removed when they are released.
+ * Whenever an item's cached bbox is invalidated it is marked dirty here, and
+ * dirty items are put back into the tree at their new place before the next
+ * query. Clones are not indexed; the SPUse itself is. Neither are items in
+ * defs, clip paths, masks, patterns or markers, as they are only drawn through
+ * their users.
+ *
+ * The boxes are the same for every display key, so a single index serves all
+ * views; layer modes, visibility and locking are up to the caller.
+ */
+class ItemBoundsIndex {
+public:
+    ItemBoundsIndex();
+
+    void add(SPItem *item);
+    void remove(SPItem *item);
+    /** Notes that the document visual bbox of \a item may have changed. */
+    void invalidate(SPItem *item);
+
+    /**
+     * Appends the items whose bbox intersects \a area, which is in document
+     * coordinates, to \a items, in no particular order.
+     */
+    void intersecting(Geom::Rect const &area, std::vector<SPItem *> &items);
+
+    /**
+     * Appends the items which can be picked outside of their visual bbox to
+     * \a items; text picks on whole character cells, for instance.
+     */
+    void unbounded(std::vector<SPItem *> &items) const;
+
+    /** Number of items in the index, with or without a bbox. */
+    unsigned size() const { return _entries.size(); }
+
+private:
+    struct Node {
+        Geom::Rect box;
+        SPItem *item;  ///< NULL for inner nodes
+        int parent;    ///< next free node for nodes on the free list
+        int children[2];
+        int height;    ///< 0 for leaves
+    };
+    struct Entry {
+        int leaf;      ///< -1 when the item has no bbox
+        bool dirty;
+    };
+    typedef INK_UNORDERED_MAP<SPItem *, Entry> EntryMap;
+
+    ItemBoundsIndex(ItemBoundsIndex const &); // no copy
+    void operator=(ItemBoundsIndex const &); // no assign
+
+    void _update();
+    int _allocate();
+    void _free(int node);
+    void _insertLeaf(int leaf);
+    void _removeLeaf(int leaf);
+    void _refit(int node);
+    int _balance(int node);
+
+    std::vector<Node> _nodes;
+    int _root;
+    int _free_list;
+    EntryMap _entries;
+    std::vector<SPItem *> _dirty;
+    INK_UNORDERED_SET<SPItem *> _unbounded;
+    std::vector<int> _stack;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_ITEM_BOUNDS_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
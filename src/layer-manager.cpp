@@ -25,6 +25,7 @@
 #include "xml/node.h"
 #include "xml/node-observer.h"
 #include "util/format.h"
+#include "util/unordered-containers.h"
 // #include "debug/event-tracker.h"
 // #include "debug/simple-event.h"
 
@@ -242,100 +243,127 @@ void LayerManager::_objectModified( SPObject* obj, guint /*flags*/ )
     _details_changed_signal.emit( obj );
 }
 
+void LayerManager::_removeWatcher(LayerWatcher *one) {
+    if ( one->_obj ) {
+        Node* node = one->_obj->getRepr();
+        if ( node ) {
+            node->removeObserver(*one);
+        }
+        one->_connection.disconnect();
+    }
+    delete one;
+}
+
 void LayerManager::_rebuild() {
 //     Debug::EventTracker<DebugLayerRebuild> tracker1();
 
-    while ( !_watchers.empty() ) {
-        LayerWatcher* one = _watchers.back();
-        _watchers.pop_back();
-        if ( one->_obj ) {
-            Node* node = one->_obj->getRepr();
-            if ( node ) {
-                node->removeObserver(*one);
-            }
-            one->_connection.disconnect();
+    SPObject *root = _document ? _desktop->currentRoot() : NULL;
+
+    // Only a new root starts the subset over: otherwise the layers which came or
+    // went are added or removed one by one, so that views of it can follow along.
+    if ( !root || !includes(root) || parentOf(root) ) {
+        while ( !_watchers.empty() ) {
+            _removeWatcher(_watchers.back());
+            _watchers.pop_back();
         }
-    }
 
-    _clear();
+        _clear();
 
-    if (!_document) // http://sourceforge.net/mailarchive/forum.php?thread_name=5747bce9a7ed077c1b4fc9f0f4f8a5e0%40localhost&forum_name=inkscape-devel
-        return;
+        if (!root) // http://sourceforge.net/mailarchive/forum.php?thread_name=5747bce9a7ed077c1b4fc9f0f4f8a5e0%40localhost&forum_name=inkscape-devel
+            return;
 
-    GSList const *layers = _document->getResourceList("layer");
-    SPObject *root=_desktop->currentRoot();
-    if ( root ) {
         _addOne(root);
+    }
 
-        std::set<SPGroup*> layersToAdd;
-
-        for ( GSList const *iter = layers; iter; iter = iter->next ) {
-            SPObject *layer = static_cast<SPObject *>(iter->data);
-//             Debug::EventTracker<DebugLayerNote> tracker(Util::format("Examining %s", layer->label()));
-            bool needsAdd = false;
-            std::set<SPGroup*> additional;
-
-            if ( root->isAncestorOf(layer) ) {
-                needsAdd = true;
-                for ( SPObject* curr = layer; curr && (curr != root) && needsAdd; curr = curr->parent ) {
-                    if ( SP_IS_GROUP(curr) ) {
-                        SPGroup* group = SP_GROUP(curr);
-                        if ( group->layerMode() == SPGroup::LAYER ) {
-                            // If we have a layer-group as the one or a parent, ensure it is listed as a valid layer.
-                            needsAdd &= ( g_slist_find(const_cast<GSList *>(layers), curr) != NULL );
-							// XML Tree being used here directly while it shouldn't be...
-                            if ( (!(group->getRepr())) || (!(group->getRepr()->parent())) ) {
-                                needsAdd = false;
-                            }
+    GSList const *layers = _document->getResourceList("layer");
+    INK_UNORDERED_SET<SPObject *> listed;
+    for ( GSList const *iter = layers; iter; iter = iter->next ) {
+        listed.insert(static_cast<SPObject *>(iter->data));
+    }
+
+    std::set<SPObject*> layersToAdd;
+
+    for ( GSList const *iter = layers; iter; iter = iter->next ) {
+        SPObject *layer = static_cast<SPObject *>(iter->data);
+//         Debug::EventTracker<DebugLayerNote> tracker(Util::format("Examining %s", layer->label()));
+        bool needsAdd = false;
+        std::set<SPGroup*> additional;
+
+        if ( root->isAncestorOf(layer) ) {
+            needsAdd = true;
+            for ( SPObject* curr = layer; curr && (curr != root) && needsAdd; curr = curr->parent ) {
+                if ( SP_IS_GROUP(curr) ) {
+                    SPGroup* group = SP_GROUP(curr);
+                    if ( group->layerMode() == SPGroup::LAYER ) {
+                        // If we have a layer-group as the one or a parent, ensure it is listed as a valid layer.
+                        needsAdd &= ( listed.find(curr) != listed.end() );
+                        // XML Tree being used here directly while it shouldn't be...
+                        if ( (!(group->getRepr())) || (!(group->getRepr()->parent())) ) {
+                            needsAdd = false;
+                        }
+                    } else {
+                        // If a non-layer group is a parent of layer groups, then show it also as a layer.
+                        // TODO add the magic Inkscape group mode?
+                        // XML Tree being used directly while it shouldn't be...
+                        if ( group->getRepr() && group->getRepr()->parent() ) {
+                            additional.insert(group);
                         } else {
-                            // If a non-layer group is a parent of layer groups, then show it also as a layer.
-                            // TODO add the magic Inkscape group mode?
-							// XML Tree being used directly while it shouldn't be...
-                            if ( group->getRepr() && group->getRepr()->parent() ) {
-                                additional.insert(group);
-                            } else {
-                                needsAdd = false;
-                            }
+                            needsAdd = false;
                         }
                     }
                 }
             }
-            if ( needsAdd ) {
-                if ( !includes(layer) ) {
-                    layersToAdd.insert(SP_GROUP(layer));
-                }
-                for ( std::set<SPGroup*>::iterator it = additional.begin(); it != additional.end(); ++it ) {
-                    if ( !includes(*it) ) {
-                        layersToAdd.insert(*it);
-                    }
-                }
-            }
         }
+        if ( needsAdd ) {
+            layersToAdd.insert(layer);
+            layersToAdd.insert(additional.begin(), additional.end());
+        }
+    }
 
-        for ( std::set<SPGroup*>::iterator it = layersToAdd.begin(); it != layersToAdd.end(); ++it ) {
-            SPGroup* layer = *it;
-            // Filter out objects in the middle of being deleted
+    // Filter out objects in the middle of being deleted
 
-            // Such may have been the cause of bug 1339397.
-            // See http://sourceforge.net/tracker/index.php?func=detail&aid=1339397&group_id=93438&atid=604306
+    // Such may have been the cause of bug 1339397.
+    // See http://sourceforge.net/tracker/index.php?func=detail&aid=1339397&group_id=93438&atid=604306
+    for ( std::set<SPObject*>::iterator it = layersToAdd.begin(); it != layersToAdd.end(); ) {
+        SPObject const *higher = *it;
+        while ( higher && (higher->parent != root) ) {
+            higher = higher->parent;
+        }
+        Node const* node = higher ? higher->getRepr() : NULL;
+        if ( node && node->parent() ) {
+            ++it;
+        } else {
+            layersToAdd.erase(it++);
+        }
+    }
 
-            SPObject const *higher = layer;
-            while ( higher && (higher->parent != root) ) {
-                higher = higher->parent;
+    // Drop the layers which are no longer listed, keeping the others as they are
+    std::vector<LayerWatcher*> kept;
+    for ( std::vector<LayerWatcher*>::iterator it = _watchers.begin(); it != _watchers.end(); ++it ) {
+        LayerWatcher* one = *it;
+        SPObject *layer = one->_obj;
+        if ( layersToAdd.erase(layer) ) {
+            kept.push_back(one);
+        } else {
+            _removeWatcher(one);
+            if ( includes(layer) ) {
+                _removeOne(layer);
             }
-            Node const* node = higher ? higher->getRepr() : NULL;
-            if ( node && node->parent() ) {
-//                 Debug::EventTracker<DebugAddLayer> tracker(*layer);
+        }
+    }
+    _watchers.swap(kept);
 
-                sigc::connection connection = layer->connectModified(sigc::mem_fun(*this, &LayerManager::_objectModified));
+    for ( std::set<SPObject*>::iterator it = layersToAdd.begin(); it != layersToAdd.end(); ++it ) {
+        SPObject* layer = *it;
+//         Debug::EventTracker<DebugAddLayer> tracker(*layer);
 
-                LayerWatcher *eye = new LayerWatcher(this, layer, connection);
-                _watchers.push_back( eye );
-                layer->getRepr()->addObserver(*eye);
+        sigc::connection connection = layer->connectModified(sigc::mem_fun(*this, &LayerManager::_objectModified));
 
-                _addOne(layer);
-            }
-        }
+        LayerWatcher *eye = new LayerWatcher(this, layer, connection);
+        _watchers.push_back( eye );
+        layer->getRepr()->addObserver(*eye);
+
+        _addOne(layer);
     }
 }
 
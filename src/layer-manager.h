@@ -47,6 +47,7 @@ private:
     void _objectModified( SPObject* obj, guint flags );
     void _setDocument(SPDocument *document);
     void _rebuild();
+    void _removeWatcher(LayerWatcher *one);
     void _selectedLayerChanged(SPObject *layer);
 
     sigc::connection _layer_connection;
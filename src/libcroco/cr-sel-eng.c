@@ -253,6 +253,9 @@ class_add_sel_matches_node (CRAdditionalSel * a_add_sel,
                                 if ((cur && !*cur)
                                     || cr_utils_is_white_space (*cur) == TRUE)
                                         result = TRUE;
+                                else    /* only a prefix of this class matched, skip the rest of it */
+                                        while (cur && *cur && !(cr_utils_is_white_space(*cur) == TRUE))
+                                                cur++;
                         } else {  /* if it doesn't match,  */
                                 /*   then skip to next whitespace character to try again */
                                 while (cur && *cur && !(cr_utils_is_white_space(*cur) == TRUE)) 
@@ -1395,6 +1398,54 @@ cr_sel_eng_get_matched_rulesets (CRSelEng * a_this,
         return status;
 }
 
+/**
+ * cr_sel_eng_merge_matched_rulesets:
+ *@a_rulesets: the ruleset statements that matched a node, in cascade
+ *order, each with its specificity field set for that node.
+ *@a_len: the number of entries in a_rulesets.
+ *@a_props: in/out parameter. The property list to merge the
+ *declarations of the rulesets into.
+ *
+ *Applies the cascading rules to the declarations of the given rulesets.
+ *This is the last step of cr_sel_eng_get_matched_properties_from_cascade(),
+ *for callers that find the matching rulesets themselves.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_merge_matched_rulesets (CRStatement ** a_rulesets,
+                                   gulong a_len,
+                                   CRPropList ** a_props)
+{
+        gulong i = 0;
+
+        g_return_val_if_fail (a_props && (a_rulesets || !a_len),
+                              CR_BAD_PARAM_ERROR);
+
+        /*
+         *TODO, walk down the stmts_tab and build the
+         *property_name/declaration hashtable.
+         *Make sure one can walk from the declaration to
+         *the stylesheet.
+         */
+        for (i = 0; i < a_len; i++) {
+                CRStatement *stmt = a_rulesets[i];
+
+                if (!stmt)
+                        continue;
+                switch (stmt->type) {
+                case RULESET_STMT:
+                        if (!stmt->parent_sheet)
+                                continue;
+                        put_css_properties_in_props_list (a_props, stmt);
+                        break;
+                default:
+                        break;
+                }
+
+        }
+        return CR_OK;
+}
 
 enum CRStatus
 cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
@@ -1406,7 +1457,6 @@ cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
         enum CRStatus status = CR_OK;
         gulong tab_size = 0,
                 tab_len = 0,
-                i = 0,
                 index = 0;
         enum CRStyleOrigin origin;
         gushort stmts_chunck_size = 8;
@@ -1464,30 +1514,7 @@ cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
                 tab_len = tab_size - index;
         }
 
-        /*
-         *TODO, walk down the stmts_tab and build the
-         *property_name/declaration hashtable.
-         *Make sure one can walk from the declaration to
-         *the stylesheet.
-         */
-        for (i = 0; i < index; i++) {
-                CRStatement *stmt = stmts_tab[i];
-
-                if (!stmt)
-                        continue;
-                switch (stmt->type) {
-                case RULESET_STMT:
-                        if (!stmt->parent_sheet)
-                                continue;
-                        status = put_css_properties_in_props_list
-                                (a_props, stmt);
-                        break;
-                default:
-                        break;
-                }
-
-        }
-        status = CR_OK ;
+        status = cr_sel_eng_merge_matched_rulesets (stmts_tab, index, a_props);
  cleanup:
         if (stmts_tab) {
                 g_free (stmts_tab);
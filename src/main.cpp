@@ -88,6 +88,7 @@
 
 #include "helper/action-context.h"
 #include "helper/png-write.h"
+#include "display/drawing.h"
 #include "helper/geom.h"
 
 #include <extension/extension.h>
@@ -148,6 +149,10 @@ enum {
     SP_ARG_EXPORT_HEIGHT,
     SP_ARG_EXPORT_ID,
     SP_ARG_EXPORT_ID_ONLY,
+    SP_ARG_EXPORT_BATCH,
+    SP_ARG_EXPORT_TILES,
+    SP_ARG_EXPORT_TILE_SIZE,
+    SP_ARG_EXPORT_TILE_LAYOUT,
     SP_ARG_EXPORT_USE_HINTS,
     SP_ARG_EXPORT_BACKGROUND,
     SP_ARG_EXPORT_BACKGROUND_OPACITY,
@@ -185,6 +190,9 @@ enum {
 int sp_main_gui(int argc, char const **argv);
 int sp_main_console(int argc, char const **argv);
 static int sp_do_export_png(SPDocument *doc);
+static int sp_do_export_batch(SPDocument *doc);
+static int sp_do_export_tiles(SPDocument *doc);
+static guint32 sp_export_get_background(SPDocument *doc);
 static int do_export_ps_pdf(SPDocument* doc, gchar const* uri, char const *mime);
 static int do_export_emf(SPDocument* doc, gchar const* uri, char const *mime);
 static int do_export_wmf(SPDocument* doc, gchar const* uri, char const *mime);
@@ -209,6 +217,10 @@ static gchar *sp_export_background_opacity = NULL;
 static gboolean sp_export_area_snap = FALSE;
 static gboolean sp_export_use_hints = FALSE;
 static gboolean sp_export_id_only = FALSE;
+static gchar *sp_export_batch = NULL;
+static gchar *sp_export_tiles = NULL;
+static gint sp_export_tile_size = 256;
+static gchar *sp_export_tile_layout = NULL;
 static gchar *sp_export_svg = NULL;
 static gchar *sp_export_ps = NULL;
 static gchar *sp_export_eps = NULL;
@@ -257,6 +269,10 @@ static void resetCommandlineGlobals() {
         sp_export_area_snap = FALSE;
         sp_export_use_hints = FALSE;
         sp_export_id_only = FALSE;
+        sp_export_batch = NULL;
+        sp_export_tiles = NULL;
+        sp_export_tile_size = 256;
+        sp_export_tile_layout = NULL;
         sp_export_svg = NULL;
         sp_export_ps = NULL;
         sp_export_eps = NULL;
@@ -372,6 +388,28 @@ struct poptOption options[] = {
      N_("Export just the object with export-id, hide all others (only with export-id)"),
      NULL},
 
+    {"export-batch", 0,
+     POPT_ARG_STRING, &sp_export_batch, SP_ARG_EXPORT_BATCH,
+     // TRANSLATORS: "jobs" are lines of the form "ID-or-x0:y0:x1:y1 DPI FILENAME".
+     //  See "man inkscape" for details.
+     N_("Export to PNG all the jobs listed in FILENAME, loading the document only once"),
+     N_("FILENAME")},
+
+    {"export-tiles", 0,
+     POPT_ARG_STRING, &sp_export_tiles, SP_ARG_EXPORT_TILES,
+     N_("Export the area as a pyramid of PNG tiles for zoomable viewers"),
+     N_("BASENAME")},
+
+    {"export-tile-size", 0,
+     POPT_ARG_INT, &sp_export_tile_size, SP_ARG_EXPORT_TILE_SIZE,
+     N_("Size of the exported tiles in pixels (only with export-tiles; default 256)"),
+     N_("SIZE")},
+
+    {"export-tile-layout", 0,
+     POPT_ARG_STRING, &sp_export_tile_layout, SP_ARG_EXPORT_TILE_LAYOUT,
+     N_("Tile layout: xyz or dzi (only with export-tiles; default xyz)"),
+     N_("LAYOUT")},
+
     {"export-use-hints", 't',
      POPT_ARG_NONE, &sp_export_use_hints, SP_ARG_EXPORT_USE_HINTS,
      N_("Use stored filename and DPI hints when exporting (only with export-id)"),
@@ -736,6 +774,8 @@ main(int argc, char **argv)
             || !strncmp(argv[i], "--export-area-page", 18)
             || !strcmp(argv[i], "-C")
             || !strncmp(argv[i], "--export-id", 11)
+            || !strncmp(argv[i], "--export-batch", 14)
+            || !strncmp(argv[i], "--export-tiles", 14)
             || !strcmp(argv[i], "-P")
             || !strncmp(argv[i], "--export-ps", 11)
             || !strcmp(argv[i], "-E")
@@ -1150,6 +1190,12 @@ static int sp_process_file_list(GSList *fl)
             if (sp_export_png || (sp_export_id && sp_export_use_hints)) {
                 retVal |= sp_do_export_png(doc);
             }
+            if (sp_export_batch) {
+                retVal |= sp_do_export_batch(doc);
+            }
+            if (sp_export_tiles) {
+                retVal |= sp_do_export_tiles(doc);
+            }
             if (sp_export_svg) {
                 if (sp_export_text_to_path) {
                     GSList *items = NULL;
@@ -1568,6 +1614,54 @@ static int sp_do_export_png(SPDocument *doc)
         height = (unsigned long int) (Inkscape::Util::Quantity::convert(area.height(), "px", "in") * dpi + 0.5);
     }
 
+    guint32 bgcolor = sp_export_get_background(doc);
+
+    Glib::ustring path;
+    if (filename_from_hint) {
+        //Make relative paths go from the document location, if possible:
+        if (!Glib::path_is_absolute(filename) && doc->getURI()) {
+            Glib::ustring dirname = Glib::path_get_dirname(doc->getURI());
+            if (!dirname.empty()) {
+                path = Glib::build_filename(dirname, filename);
+            }
+        }
+        if (path.empty()) {
+            path = filename;
+        }
+    } else {
+        path = filename;
+    }
+
+    int retcode = 0;
+    //check if specified directory exists
+
+    if (!Inkscape::IO::file_directory_exists(filename.c_str())) {
+        g_warning("File path \"%s\" includes directory that doesn't exist.\n", filename.c_str());
+        retcode = 1;
+    } else {
+        g_print("Background RRGGBBAA: %08x\n", bgcolor);
+
+        g_print("Area %g:%g:%g:%g exported to %lu x %lu pixels (%g dpi)\n", area[Geom::X][0], area[Geom::Y][0], area[Geom::X][1], area[Geom::Y][1], width, height, dpi);
+
+        g_print("Bitmap saved as: %s\n", filename.c_str());
+
+        if ((width >= 1) && (height >= 1) && (width <= PNG_UINT_31_MAX) && (height <= PNG_UINT_31_MAX)) {
+            sp_export_png_file(doc, path.c_str(), area, width, height, dpi, dpi, bgcolor, NULL, NULL, true, sp_export_id_only ? items : NULL);
+        } else {
+            g_warning("Calculated bitmap dimensions %lu %lu are out of range (1 - %lu). Nothing exported.", width, height, (unsigned long int)PNG_UINT_31_MAX);
+        }
+    }
+
+    g_slist_free (items);
+    return retcode;
+}
+
+
+/**
+ *  Get the background color for bitmap export, from the command line or the namedview.
+ */
+static guint32 sp_export_get_background(SPDocument *doc)
+{
     guint32 bgcolor = 0x00000000;
     if (sp_export_background) {
         // override the page color
@@ -1602,46 +1696,213 @@ static int sp_do_export_png(SPDocument *doc)
         }
     }
 
-    Glib::ustring path;
-    if (filename_from_hint) {
-        //Make relative paths go from the document location, if possible:
-        if (!Glib::path_is_absolute(filename) && doc->getURI()) {
-            Glib::ustring dirname = Glib::path_get_dirname(doc->getURI());
-            if (!dirname.empty()) {
-                path = Glib::build_filename(dirname, filename);
-            }
-        }
-        if (path.empty()) {
-            path = filename;
+    return bgcolor;
+}
+
+/**
+ *  Splits off the next whitespace-separated field of a batch line.
+ *
+ *  \param p Position in the line; advanced past the field and the whitespace after it.
+ *  \return The field, or NULL if none is left.
+ */
+static gchar *sp_export_batch_field(gchar *&p)
+{
+    while (g_ascii_isspace(*p)) {
+        p++;
+    }
+    if (!*p) {
+        return NULL;
+    }
+    gchar *field = p;
+    while (*p && !g_ascii_isspace(*p)) {
+        p++;
+    }
+    if (*p) {
+        *p++ = '\0';
+        while (g_ascii_isspace(*p)) {
+            p++;
         }
-    } else {
-        path = filename;
     }
+    return field;
+}
+
+/**
+ *  Export a list of PNG jobs from one loaded document.
+ *
+ *  Each non-empty line of the batch file that does not start with '#' has the form
+ *  "TARGET DPI FILENAME", where TARGET is either an object id or an area "x0:y0:x1:y1"
+ *  in SVG pixels. Fields are separated by runs of blanks, and FILENAME is the rest of
+ *  the line, so it may hold blanks itself. Only PNG is written. The document is shown only once and every job renders from the
+ *  same drawing, so fonts, display items and their caches are shared between jobs.
+ *
+ *  \param doc Document to export.
+ */
+static int sp_do_export_batch(SPDocument *doc)
+{
+    gchar *contents = NULL;
+    GError *error = NULL;
+    if (!g_file_get_contents(sp_export_batch, &contents, NULL, &error)) {
+        g_warning("Cannot read batch file \"%s\": %s. Nothing exported.", sp_export_batch, error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    doc->ensureUpToDate();
+
+    guint32 bgcolor = sp_export_get_background(doc);
+
+    Inkscape::Drawing drawing;
+    drawing.setExact(true); // export with maximum blur rendering quality
+    unsigned const dkey = SPItem::display_key_new(1);
+    drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
 
     int retcode = 0;
-    //check if specified directory exists
+    gchar **lines = g_strsplit(contents, "\n", -1);
+    for (int n = 0; lines[n]; n++) {
+        gchar *line = g_strstrip(lines[n]);
+        if (!*line || *line == '#') {
+            continue;
+        }
 
-    if (!Inkscape::IO::file_directory_exists(filename.c_str())) {
-        g_warning("File path \"%s\" includes directory that doesn't exist.\n", filename.c_str());
-        retcode = 1;
-    } else {
-        g_print("Background RRGGBBAA: %08x\n", bgcolor);
+        gchar *p = line;
+        gchar const *target = sp_export_batch_field(p);
+        gchar const *dpi_field = sp_export_batch_field(p);
+        gchar const *filename = p; // the rest of the line, stripped at both ends
+        if (!target || !dpi_field || !*filename) {
+            g_warning("Batch line %d: expected \"ID-or-x0:y0:x1:y1 DPI FILENAME\". Skipped.", n + 1);
+            retcode = 1;
+            continue;
+        }
 
-        g_print("Area %g:%g:%g:%g exported to %lu x %lu pixels (%g dpi)\n", area[Geom::X][0], area[Geom::Y][0], area[Geom::X][1], area[Geom::Y][1], width, height, dpi);
+        Geom::Rect area;
+        gdouble x0,y0,x1,y1;
+        if (sscanf(target, "%lg:%lg:%lg:%lg", &x0, &y0, &x1, &y1) == 4) {
+            area = Geom::Rect(Geom::Interval(x0,x1), Geom::Interval(y0,y1));
+        } else {
+            SPObject *o = doc->getObjectById(target);
+            Geom::OptRect areaMaybe;
+            if (o && SP_IS_ITEM(o)) {
+                areaMaybe = SP_ITEM(o)->desktopVisualBounds();
+            }
+            if (!areaMaybe) {
+                g_warning("Batch line %d: object with id=\"%s\" was not found or is not a visible item. Skipped.", n + 1, target);
+                retcode = 1;
+                continue;
+            }
+            area = *areaMaybe;
+        }
 
-        g_print("Bitmap saved as: %s\n", filename.c_str());
+        if (sp_export_area_snap) {
+            round_rectangle_outwards(area);
+        }
 
-        if ((width >= 1) && (height >= 1) && (width <= PNG_UINT_31_MAX) && (height <= PNG_UINT_31_MAX)) {
-            sp_export_png_file(doc, path.c_str(), area, width, height, dpi, dpi, bgcolor, NULL, NULL, true, sp_export_id_only ? items : NULL);
+        gdouble dpi = atof(dpi_field);
+        if ((dpi < 0.1) || (dpi > 10000.0)) {
+            g_warning("Batch line %d: DPI value %s out of range [0.1 - 10000.0]. Skipped.", n + 1, dpi_field);
+            retcode = 1;
+            continue;
+        }
+
+        unsigned long int width = (unsigned long int) (Inkscape::Util::Quantity::convert(area.width(), "px", "in") * dpi + 0.5);
+        unsigned long int height = (unsigned long int) (Inkscape::Util::Quantity::convert(area.height(), "px", "in") * dpi + 0.5);
+
+        if (!Inkscape::IO::file_directory_exists(filename)) {
+            g_warning("Batch line %d: file path \"%s\" includes directory that doesn't exist.", n + 1, filename);
+            retcode = 1;
+        } else if ((width >= 1) && (height >= 1) && (width <= PNG_UINT_31_MAX) && (height <= PNG_UINT_31_MAX)) {
+            g_print("Area %g:%g:%g:%g exported to %lu x %lu pixels (%g dpi)\n", area[Geom::X][0], area[Geom::Y][0], area[Geom::X][1], area[Geom::Y][1], width, height, dpi);
+            if (sp_export_png_file(drawing, doc, filename, area, width, height, dpi, dpi, bgcolor, NULL, NULL, true) == EXPORT_OK) {
+                g_print("Bitmap saved as: %s\n", filename);
+            } else {
+                retcode = 1;
+            }
         } else {
-            g_warning("Calculated bitmap dimensions %lu %lu are out of range (1 - %lu). Nothing exported.", width, height, (unsigned long int)PNG_UINT_31_MAX);
+            g_warning("Batch line %d: calculated bitmap dimensions %lu %lu are out of range (1 - %lu). Skipped.", n + 1, width, height, (unsigned long int)PNG_UINT_31_MAX);
+            retcode = 1;
         }
     }
+    g_strfreev(lines);
+    g_free(contents);
+
+    // Hide items, this releases arenaitem
+    doc->getRoot()->invoke_hide(dkey);
 
-    g_slist_free (items);
     return retcode;
 }
 
+/**
+ *  Export the export area as a pyramid of PNG tiles.
+ *
+ *  The area is taken from --export-area, --export-area-drawing or the page, and
+ *  --export-dpi gives the resolution of the most detailed level.
+ *
+ *  \param doc Document to export.
+ */
+static int sp_do_export_tiles(SPDocument *doc)
+{
+    ExportTileLayout layout = EXPORT_TILES_XYZ;
+    if (sp_export_tile_layout) {
+        if (!strcmp(sp_export_tile_layout, "dzi")) {
+            layout = EXPORT_TILES_DZI;
+        } else if (strcmp(sp_export_tile_layout, "xyz")) {
+            g_warning("Unknown tile layout '%s'; use 'xyz' or 'dzi'. Nothing exported.", sp_export_tile_layout);
+            return 1;
+        }
+    }
+
+    if ((sp_export_tile_size < 16) || (sp_export_tile_size > 4096)) {
+        g_warning("Tile size %d out of range [16 - 4096]. Nothing exported.", sp_export_tile_size);
+        return 1;
+    }
+
+    doc->ensureUpToDate();
+
+    Geom::Rect area;
+    if (sp_export_area) {
+        /* Try to parse area (given in SVG pixels) */
+        gdouble x0,y0,x1,y1;
+        if (sscanf(sp_export_area, "%lg:%lg:%lg:%lg", &x0, &y0, &x1, &y1) != 4) {
+            g_warning("Cannot parse export area '%s'; use 'x0:y0:x1:y1'. Nothing exported.", sp_export_area);
+            return 1;
+        }
+        area = Geom::Rect(Geom::Interval(x0,x1), Geom::Interval(y0,y1));
+    } else if (sp_export_area_drawing) {
+        Geom::OptRect areaMaybe = doc->getRoot()->desktopVisualBounds();
+        if (!areaMaybe) {
+            g_warning("Unable to determine a valid bounding box. Nothing exported.");
+            return 1;
+        }
+        area = *areaMaybe;
+    } else {
+        Geom::Point origin(doc->getRoot()->x.computed, doc->getRoot()->y.computed);
+        area = Geom::Rect(origin, origin + doc->getDimensions());
+    }
+
+    if (sp_export_area_snap) {
+        round_rectangle_outwards(area);
+    }
+
+    gdouble dpi = Inkscape::Util::Quantity::convert(1, "in", "px");
+    if (sp_export_dpi) {
+        dpi = atof(sp_export_dpi);
+        if ((dpi < 0.1) || (dpi > 10000.0)) {
+            g_warning("DPI value %s out of range [0.1 - 10000.0]. Nothing exported.", sp_export_dpi);
+            return 1;
+        }
+    }
+
+    guint32 bgcolor = sp_export_get_background(doc);
+
+    g_print("Area %g:%g:%g:%g exported as %dpx tiles (%g dpi)\n", area[Geom::X][0], area[Geom::Y][0], area[Geom::X][1], area[Geom::Y][1], sp_export_tile_size, dpi);
+
+    if (sp_export_png_tiles(doc, sp_export_tiles, area, dpi, sp_export_tile_size, layout, bgcolor, NULL, NULL) != EXPORT_OK) {
+        g_warning("Tile export to %s failed.", sp_export_tiles);
+        return 1;
+    }
+
+    g_print("Tiles saved to: %s\n", sp_export_tiles);
+    return 0;
+}
 
 /**
  *  Perform a PDF/PS/EPS export
@@ -0,0 +1,133 @@
+#ifndef SEEN_INKSCAPE_OBJECT_INDEX_H
+#define SEEN_INKSCAPE_OBJECT_INDEX_H
+
+/** \file
+ * Base of the indexes filing a document's objects under keys found in them.
+ */
+/*
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <vector>
+#include <glib.h>
+#include "util/unordered-containers.h"
+
+class SPObject;
+
+namespace Inkscape {
+
+/**
+ * Files the objects of a document under the keys _scan() finds in them.
+ *
+ * Objects are added when they are built and removed when they are released.
+ * Any change of their attributes or of their computed style marks them dirty
+ * (SPDocument::invalidateObjectIndexes() does this for every index), and
+ * subclasses call _update() before each query to scan the dirty objects
+ * again, so a lookup costs the objects changed since the previous one on top
+ * of its results.
+ */
+template <typename Key>
+class ObjectIndex {
+public:
+    virtual ~ObjectIndex() {}
+
+    /** Notes that the keys of \a object may have changed, adding it if it is new. */
+    void invalidate(SPObject *object)
+    {
+        g_return_if_fail(object != NULL);
+
+        Entry &entry = _entries[object];
+        if (!entry.dirty) {
+            entry.dirty = true;
+            _dirty.push_back(object);
+        }
+    }
+
+    void remove(SPObject *object)
+    {
+        typename EntryMap::iterator found = _entries.find(object);
+        if (found == _entries.end()) {
+            return;
+        }
+        _unlinkAll(object, found->second);
+        _entries.erase(found);
+        // a stale pointer left in _dirty is skipped since it has no entry any more
+    }
+
+    /** Number of objects in the index, with or without keys. */
+    unsigned size() const { return _entries.size(); }
+
+protected:
+    ObjectIndex() {}
+
+    /** Appends the keys to file \a object under to \a keys. */
+    virtual void _scan(SPObject *object, std::vector<Key> &keys) = 0;
+    /** Files \a object under \a key. */
+    virtual void _link(SPObject *object, Key const &key) = 0;
+    /** Takes \a object from under \a key. */
+    virtual void _unlink(SPObject *object, Key const &key) = 0;
+
+    /** Files the dirty objects again. */
+    void _update()
+    {
+        for (std::vector<SPObject *>::const_iterator i = _dirty.begin(); i != _dirty.end(); ++i) {
+            typename EntryMap::iterator found = _entries.find(*i);
+            if (found == _entries.end() || !found->second.dirty) {
+                continue;
+            }
+            Entry &entry = found->second;
+            entry.dirty = false;
+
+            _unlinkAll(*i, entry);
+            entry.keys.clear();
+            _scan(*i, entry.keys);
+            for (typename std::vector<Key>::const_iterator j = entry.keys.begin(); j != entry.keys.end(); ++j) {
+                _link(*i, *j);
+            }
+        }
+        _dirty.clear();
+    }
+
+    /** The keys \a object is filed under, or NULL if it is not in the index. */
+    std::vector<Key> const *_keys(SPObject *object) const
+    {
+        typename EntryMap::const_iterator found = _entries.find(object);
+        return found != _entries.end() ? &found->second.keys : NULL;
+    }
+
+private:
+    struct Entry {
+        Entry() : dirty(false) {}
+        std::vector<Key> keys;
+        bool dirty;
+    };
+    typedef INK_UNORDERED_MAP<SPObject *, Entry> EntryMap;
+
+    ObjectIndex(ObjectIndex const &); // no copy
+    void operator=(ObjectIndex const &); // no assign
+
+    void _unlinkAll(SPObject *object, Entry const &entry)
+    {
+        for (typename std::vector<Key>::const_iterator i = entry.keys.begin(); i != entry.keys.end(); ++i) {
+            _unlink(object, *i);
+        }
+    }
+
+    EntryMap _entries;
+    std::vector<SPObject *> _dirty;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_OBJECT_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
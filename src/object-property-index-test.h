@@ -0,0 +1,103 @@
+#ifndef SEEN_OBJECT_PROPERTY_INDEX_TEST_H
+#define SEEN_OBJECT_PROPERTY_INDEX_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "document.h"
+#include "object-property-index.h"
+#include "sp-object.h"
+#include "xml/node.h"
+
+class ObjectPropertyIndexTest : public CxxTest::TestSuite
+{
+public:
+    static ObjectPropertyIndexTest *createSuite() { return new ObjectPropertyIndexTest(); }
+    static void destroySuite( ObjectPropertyIndexTest *suite ) { delete suite; }
+
+    void testFollowsChanges()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg' xmlns:sodipodi='http://sodipodi.sourceforge.net/DTD/sodipodi-0.dtd'>"
+            "<defs><linearGradient id='grad'><stop offset='0' style='stop-color:#000'/></linearGradient></defs>"
+            "<rect id='a' class='big red' width='10' height='10' style='fill:#ff0000;stroke:none'/>"
+            "<g id='g' style='fill:url(#grad)'>"
+            "<path id='b' sodipodi:type='spiral' d='M 0,0 L 1,1' style='font-family:Sans'/>"
+            "</g>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        SPObject *a = doc->getObjectById("a");
+        SPObject *b = doc->getObjectById("b");
+        TS_ASSERT(a && b);
+        if ( a && b ) {
+            typedef Inkscape::ObjectPropertyIndex Index;
+            Index *index = doc->property_index;
+
+            TS_ASSERT( has(index, Index::FILL, "#ff0000ff", a) );
+            TS_ASSERT( has(index, Index::STROKE, "none", a) );
+            TS_ASSERT( has(index, Index::CLASS, "big", a) );
+            TS_ASSERT( has(index, Index::CLASS, "red", a) );
+            TS_ASSERT( has(index, Index::ID, "a", a) );
+            TS_ASSERT( has(index, Index::TYPE, "svg:rect", a) );
+            TS_ASSERT( has(index, Index::TYPE, "spiral", b) );
+            TS_ASSERT( has(index, Index::FONT_FAMILY, "Sans", b) );
+            // inherited paint
+            TS_ASSERT( has(index, Index::FILL, "url", b) );
+
+            a->getRepr()->setAttribute("class", "small");
+            a->getRepr()->setAttribute("style", "fill:#00ff00");
+            doc->ensureUpToDate();
+            TS_ASSERT( !has(index, Index::CLASS, "big", a) );
+            TS_ASSERT( has(index, Index::CLASS, "small", a) );
+            TS_ASSERT( !has(index, Index::FILL, "#ff0000ff", a) );
+            TS_ASSERT( has(index, Index::FILL, "#00ff00ff", a) );
+
+            doc->getObjectById("g")->getRepr()->setAttribute("style", "fill:none");
+            doc->ensureUpToDate();
+            TS_ASSERT( has(index, Index::FILL, "none", b) );
+
+            unsigned const size = index->size();
+            Inkscape::XML::Node *repr = a->getRepr();
+            repr->parent()->removeChild(repr);
+            TS_ASSERT_EQUALS( index->size(), size - 1 );
+            TS_ASSERT( !has(index, Index::CLASS, "small", NULL) );
+        }
+
+        doc->doUnref();
+    }
+
+private:
+    /** Whether \a object has \a value, or any object does if \a object is NULL. */
+    static bool has(Inkscape::ObjectPropertyIndex *index, Inkscape::ObjectPropertyIndex::Property property,
+                    char const *value, SPObject *object)
+    {
+        std::vector<SPObject *> objects;
+        index->objectsWith(property, value, objects);
+        if (!object) {
+            return !objects.empty();
+        }
+        return std::find(objects.begin(), objects.end(), object) != objects.end();
+    }
+};
+
+#endif // SEEN_OBJECT_PROPERTY_INDEX_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,174 @@
+/** \file
+ * Index of a document's objects by paint, font, type, id and class.
+ */
+/*
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <cstring>
+
+#include "factory.h"
+#include "object-property-index.h"
+#include "sp-object.h"
+#include "sp-paint-server-reference.h"
+#include "style.h"
+#include "xml/node.h"
+
+namespace {
+
+typedef Inkscape::ObjectPropertyIndex Index;
+
+char const *font_properties[] = {
+    "font-family:",
+    "-inkscape-font-specification:",
+};
+#define NUM_FONT_PROPERTIES (sizeof(font_properties) / sizeof(*font_properties))
+
+template <typename Key>
+void add_key(std::vector<Key> &keys, Index::Property property, char const *value)
+{
+    if (value && *value) {
+        keys.push_back(Key(property, g_quark_from_string(value)));
+    }
+}
+
+/**
+ * Adds the value following each of font_properties in \a style, the way
+ * Find looks for fonts in the style attribute, in any case.
+ */
+template <typename Key>
+void add_fonts(std::vector<Key> &keys, char const *style)
+{
+    gchar **tokens = g_strsplit(style, ";", 0);
+    for (gchar **token = tokens; *token; ++token) {
+        gchar *lower = g_ascii_strdown(*token, -1);
+        for (unsigned i = 0; i < NUM_FONT_PROPERTIES; ++i) {
+            char const *found = std::strstr(lower, font_properties[i]);
+            if (found) {
+                add_key(keys, Index::FONT_FAMILY, *token + (found - lower) + std::strlen(font_properties[i]));
+            }
+        }
+        g_free(lower);
+    }
+    g_strfreev(tokens);
+}
+
+/** Lists the property values of \a object. */
+template <typename Key>
+void scan(SPObject *object, std::vector<Key> &keys)
+{
+    Inkscape::XML::Node *repr = object->getRepr();
+    if (!repr || repr->type() != Inkscape::XML::ELEMENT_NODE) {
+        return;
+    }
+
+    add_key(keys, Index::TYPE, NodeTraits::get_type_string(*repr).c_str());
+    add_key(keys, Index::ID, repr->attribute("id"));
+
+    gchar const *classes = repr->attribute("class");
+    if (classes) {
+        gchar **words = g_strsplit_set(classes, " \t\r\n", 0);
+        for (gchar **word = words; *word; ++word) {
+            add_key(keys, Index::CLASS, *word);
+        }
+        g_strfreev(words);
+    }
+
+    gchar const *style_attr = repr->attribute("style");
+    if (style_attr) {
+        add_fonts(keys, style_attr);
+    }
+
+    SPStyle *style = object->style;
+    if (style) {
+        add_key(keys, Index::FILL, Index::paintValue(style->fill).c_str());
+        add_key(keys, Index::STROKE, Index::paintValue(style->stroke).c_str());
+    }
+}
+
+}
+
+namespace Inkscape {
+
+ObjectPropertyIndex::ObjectPropertyIndex()
+{
+}
+
+std::string ObjectPropertyIndex::paintValue(SPIPaint const &paint)
+{
+    if (paint.value.href && paint.value.href->getURI()) {
+        return "url";
+    }
+    if (paint.colorSet) {
+        return colorValue(paint.value.color);
+    }
+    if (paint.noneSet) {
+        return "none";
+    }
+    return "unset";
+}
+
+std::string ObjectPropertyIndex::colorValue(SPColor const &color)
+{
+    gchar value[16];
+    g_snprintf(value, sizeof(value), "#%08x", color.toRGBA32(1.0));
+    return value;
+}
+
+void ObjectPropertyIndex::_scan(SPObject *object, std::vector<Key> &keys)
+{
+    scan(object, keys);
+}
+
+void ObjectPropertyIndex::_link(SPObject *object, Key const &key)
+{
+    _values[key.first][key.second].insert(object);
+}
+
+void ObjectPropertyIndex::_unlink(SPObject *object, Key const &key)
+{
+    ValueMap &values = _values[key.first];
+    ValueMap::iterator objects = values.find(key.second);
+    if (objects != values.end()) {
+        objects->second.erase(object);
+        if (objects->second.empty()) {
+            values.erase(objects);
+        }
+    }
+}
+
+void ObjectPropertyIndex::objectsWith(Property property, char const *value, std::vector<SPObject *> &objects)
+{
+    GQuark const quark = value ? g_quark_try_string(value) : 0;
+    if (!quark) {
+        return;
+    }
+    _update();
+
+    ValueMap::const_iterator found = _values[property].find(quark);
+    if (found != _values[property].end()) {
+        objects.insert(objects.end(), found->second.begin(), found->second.end());
+    }
+}
+
+void ObjectPropertyIndex::values(Property property, std::vector<char const *> &values)
+{
+    _update();
+
+    for (ValueMap::const_iterator i = _values[property].begin(); i != _values[property].end(); ++i) {
+        values.push_back(g_quark_to_string(i->first));
+    }
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
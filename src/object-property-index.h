@@ -0,0 +1,94 @@
+#ifndef SEEN_INKSCAPE_OBJECT_PROPERTY_INDEX_H
+#define SEEN_INKSCAPE_OBJECT_PROPERTY_INDEX_H
+
+/** \file
+ * Index of a document's objects by paint, font, type, id and class.
+ */
+/*
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <glib.h>
+#include "object-index.h"
+#include "util/unordered-containers.h"
+
+class SPObject;
+struct SPColor;
+struct SPIPaint;
+
+namespace Inkscape {
+
+/** Types of ObjectPropertyIndex, declared ahead of it to name its keys. */
+struct ObjectPropertyTypes {
+    enum Property {
+        FILL,         ///< paintValue() of the computed fill
+        STROKE,       ///< paintValue() of the computed stroke
+        FONT_FAMILY,  ///< what follows "font-family:" or "-inkscape-font-specification:" in the style attribute
+        TYPE,         ///< type of the object, as the object factory names it
+        ID,
+        CLASS,        ///< each word of the class attribute
+        NUM_PROPERTIES
+    };
+
+    /** A property and the value an object has for it. */
+    typedef std::pair<Property, GQuark> Key;
+};
+
+/**
+ * Maps the values of a few properties to the objects of a document having
+ * them, for "select same" and Find to look up candidates instead of testing
+ * every object.
+ *
+ * Objects are kept up to date as ObjectIndex describes. Clones are not
+ * indexed.
+ *
+ * The values are coarser than the comparisons of their users, so a lookup
+ * gives candidates which still have to be checked.
+ */
+class ObjectPropertyIndex : public ObjectPropertyTypes, public ObjectIndex<ObjectPropertyTypes::Key> {
+public:
+    ObjectPropertyIndex();
+
+    /** Appends the objects whose \a property has \a value to \a objects. */
+    void objectsWith(Property property, char const *value, std::vector<SPObject *> &objects);
+    /** Appends each value that \a property has in some object to \a values, once. */
+    void values(Property property, std::vector<char const *> &values);
+
+    /**
+     * The value a paint is filed under: "url" when it names a paint server,
+     * whether or not that resolves, "#rrggbbaa" for a color, "none" for an
+     * explicit none and "unset" otherwise.
+     */
+    static std::string paintValue(SPIPaint const &paint);
+    /** The value a paint of \a color is filed under. */
+    static std::string colorValue(SPColor const &color);
+
+protected:
+    virtual void _scan(SPObject *object, std::vector<Key> &keys);
+    virtual void _link(SPObject *object, Key const &key);
+    virtual void _unlink(SPObject *object, Key const &key);
+
+private:
+    typedef INK_UNORDERED_SET<SPObject *> ObjectSet;
+    typedef INK_UNORDERED_MAP<GQuark, ObjectSet> ValueMap;
+
+    ValueMap _values[NUM_PROPERTIES];
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_OBJECT_PROPERTY_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
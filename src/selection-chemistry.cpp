@@ -83,14 +83,20 @@ SPCycleType SP_CYCLING = SP_CYCLE_FOCUS;
 #include "helper/png-write.h"
 #include "layer-fns.h"
 #include "context-fns.h"
+#include <algorithm>
 #include <map>
 #include <cstring>
 #include <string>
+#include <vector>
 #include "sp-item.h"
 #include "box3d.h"
 #include "persp3d.h"
 #include "util/units.h"
+#include "util/unordered-containers.h"
+#include "object-property-index.h"
+#include "factory.h"
 #include "xml/simple-document.h"
+#include "xml/repr-sorting.h"
 #include "sp-filter-reference.h"
 #include "gradient-drag.h"
 #include "uri-references.h"
@@ -323,11 +329,17 @@ static void sp_selection_copy_one(Inkscape::XML::Node *repr, Geom::Affine full_t
     *clip = g_slist_prepend(*clip, copy);
 }
 
+/** For sp_repr_sort_by_position() on lists of objects. */
+static Inkscape::XML::Node const *object_repr(gconstpointer object)
+{
+    return static_cast<SPObject const *>(object)->getRepr();
+}
+
 static void sp_selection_copy_impl(GSList const *items, GSList **clip, Inkscape::XML::Document* xml_doc)
 {
     // Sort items:
     GSList *sorted_items = g_slist_copy(const_cast<GSList *>(items));
-    sorted_items = g_slist_sort(static_cast<GSList *>(sorted_items), (GCompareFunc) sp_object_compare_position);
+    sorted_items = sp_repr_sort_by_position(sorted_items, object_repr);
 
     // Copy item reprs:
     for (GSList *i = (GSList *) sorted_items; i != NULL; i = i->next) {
@@ -342,6 +354,10 @@ static GSList *sp_selection_paste_impl(SPDocument *doc, SPObject *parent, GSList
 {
     Inkscape::XML::Document *xml_doc = doc->getReprDoc();
 
+    // the accumulated parent transform in the paste layer, the same for all objects
+    Geom::Affine const local(SP_ITEM(parent)->i2doc_affine());
+    Geom::Affine const local_inverse(local.isIdentity() ? local : local.inverse());
+
     GSList *copied = NULL;
     // add objects to document
     for (GSList *l = *clip; l != NULL; l = l->next) {
@@ -349,13 +365,12 @@ static GSList *sp_selection_paste_impl(SPDocument *doc, SPObject *parent, GSList
         Inkscape::XML::Node *copy = repr->duplicate(xml_doc);
 
         // premultiply the item transform by the accumulated parent transform in the paste layer
-        Geom::Affine local(SP_ITEM(parent)->i2doc_affine());
         if (!local.isIdentity()) {
             gchar const *t_str = copy->attribute("transform");
             Geom::Affine item_t(Geom::identity());
             if (t_str)
                 sp_svg_transform_read(t_str, &item_t);
-            item_t *= local.inverse();
+            item_t *= local_inverse;
             // (we're dealing with unattached repr, so we write to its attr instead of using sp_item_set_transform)
             gchar *affinestr=sp_svg_transform_write(item_t);
             copy->setAttribute("transform", affinestr);
@@ -456,7 +471,7 @@ void sp_selection_duplicate(SPDesktop *desktop, bool suppressDone)
 
     // sorting items from different parents sorts each parent's subset without possibly mixing
     // them, just what we need
-    reprs = g_slist_sort(reprs, (GCompareFunc) sp_repr_compare_position);
+    reprs = sp_repr_sort_by_position(reprs);
 
     GSList *newsel = NULL;
 
@@ -496,34 +511,43 @@ void sp_selection_duplicate(SPDesktop *desktop, bool suppressDone)
 
         g_assert(old_ids.size() == new_ids.size());
 
+        // where each duplicated id is in old_ids, rather than searching it for every clone
+        INK_UNORDERED_MAP<GQuark, unsigned> old_index;
+        for (unsigned int j = 0; j < old_ids.size(); j++) {
+            if (old_ids[j]) {
+                old_index.insert(std::make_pair(g_quark_from_string(old_ids[j]), j));
+            }
+        }
+
         for (unsigned int i = 0; i < old_ids.size(); i++) {
             const gchar *id = old_ids[i];
-            SPObject *old_clone = doc->getObjectById(id);
+            SPObject *old_clone = id ? doc->getObjectById(id) : NULL;
+            gchar const *orig_id = NULL;
             if (SP_IS_USE(old_clone)) {
                 SPItem *orig = SP_USE(old_clone)->get_original();
                 if (!orig) // orphaned
                     continue;
-                for (unsigned int j = 0; j < old_ids.size(); j++) {
-                    if (!strcmp(orig->getId(), old_ids[j])) {
-                        // we have both orig and clone in selection, relink
-                        // std::cout << id  << " old, its ori: " << orig->getId() << "; will relink:" << new_ids[i] << " to " << new_ids[j] << "\n";
-                        gchar *newref = g_strdup_printf("#%s", new_ids[j]);
-                        SPObject *new_clone = doc->getObjectById(new_ids[i]);
-                        new_clone->getRepr()->setAttribute("xlink:href", newref);
-                        new_clone->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG);
-                        g_free(newref);
-                    }
-                }
+                orig_id = orig->getId();
             } else if (SP_IS_OFFSET(old_clone)) {
-                for (guint j = 0; j < old_ids.size(); j++) {
                 gchar *source_href = SP_OFFSET(old_clone)->sourceHref;
-                    if (source_href && source_href[0]=='#' && !strcmp(source_href+1, old_ids[j])) {
-                        gchar *newref = g_strdup_printf("#%s", new_ids[j]);
-                        doc->getObjectById(new_ids[i])->getRepr()->setAttribute("xlink:href", newref);
-                        g_free(newref);
-                    }
+                if (source_href && source_href[0]=='#') {
+                    orig_id = source_href + 1;
                 }
             }
+            GQuark const orig_quark = orig_id ? g_quark_try_string(orig_id) : 0;
+            INK_UNORDERED_MAP<GQuark, unsigned>::const_iterator found = old_index.find(orig_quark);
+            if (!orig_quark || found == old_index.end()) {
+                continue;
+            }
+
+            // we have both orig and clone in selection, relink
+            gchar *newref = g_strdup_printf("#%s", new_ids[found->second]);
+            SPObject *new_clone = doc->getObjectById(new_ids[i]);
+            new_clone->getRepr()->setAttribute("xlink:href", newref);
+            if (SP_IS_USE(old_clone)) {
+                new_clone->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG);
+            }
+            g_free(newref);
         }
     }
 
@@ -570,6 +594,11 @@ void sp_edit_clear_all(Inkscape::Selection *selection)
  */
 GSList *get_all_items(GSList *list, SPObject *from, SPDesktop *desktop, bool onlyvisible, bool onlysensitive, bool ingroups, GSList const *exclude)
 {
+    if (!onlyvisible) {
+        // a hidden layer may not have built what it holds yet
+        from->document->buildDeferred(from);
+    }
+
     for ( SPObject *child = from->firstChild() ; child; child = child->getNext() ) {
         if (SP_IS_ITEM(child) &&
             !desktop->isLayer(SP_ITEM(child)) &&
@@ -619,6 +648,9 @@ static void sp_edit_select_all_full(SPDesktop *dt, bool force_all_layers, bool i
              (onlyvisible && dt->itemIsHidden(SP_ITEM(dt->currentLayer()))) )
         return;
 
+        if (!onlyvisible) {
+            dt->getDocument()->buildDeferred(dt->currentLayer());
+        }
         GSList *all_items = sp_item_group_item_list(SP_GROUP(dt->currentLayer()));
 
         for (GSList *i = all_items; i; i = i->next) {
@@ -677,7 +709,7 @@ void sp_edit_invert_in_all_layers(SPDesktop *desktop)
 
 static void sp_selection_group_impl(GSList *p, Inkscape::XML::Node *group, Inkscape::XML::Document *xml_doc, SPDocument *doc) {
 
-    p = g_slist_sort(p, (GCompareFunc) sp_repr_compare_position);
+    p = sp_repr_sort_by_position(p);
 
     // Remember the position and parent of the topmost object.
     gint topmost = (static_cast<Inkscape::XML::Node *>(g_slist_last(p)->data))->position();
@@ -913,7 +945,7 @@ sp_selection_raise(Inkscape::Selection *selection, SPDesktop *desktop)
 
     /* Construct reverse-ordered list of selected children. */
     GSList *rev = g_slist_copy(const_cast<GSList *>(items));
-    rev = g_slist_sort(rev, (GCompareFunc) sp_item_repr_compare_position);
+    rev = sp_repr_sort_by_position(rev, object_repr);
 
     // Determine the common bbox of the selected items.
     Geom::OptRect selected = enclose_items(items);
@@ -929,7 +961,7 @@ sp_selection_raise(Inkscape::Selection *selection, SPDesktop *desktop)
                     Geom::OptRect newref_bbox = SP_ITEM(newref)->desktopVisualBounds();
                     if ( newref_bbox && selected->intersects(*newref_bbox) ) {
                         // AND if it's not one of our selected objects,
-                        if (!g_slist_find(const_cast<GSList *>(items), newref)) {
+                        if (!selection->includes(newref)) {
                             // move the selected object after that sibling
                             grepr->changeOrder(child->getRepr(), newref->getRepr());
                         }
@@ -966,7 +998,7 @@ void sp_selection_raise_to_top(Inkscape::Selection *selection, SPDesktop *deskto
     }
 
     GSList *rl = g_slist_copy(const_cast<GSList *>(selection->reprList()));
-    rl = g_slist_sort(rl, (GCompareFunc) sp_repr_compare_position);
+    rl = sp_repr_sort_by_position(rl);
 
     for (GSList *l = rl; l != NULL; l = l->next) {
         Inkscape::XML::Node *repr = static_cast<Inkscape::XML::Node *>(l->data);
@@ -1000,7 +1032,7 @@ void sp_selection_lower(Inkscape::Selection *selection, SPDesktop *desktop)
 
     /* Construct direct-ordered list of selected children. */
     GSList *rev = g_slist_copy(const_cast<GSList *>(items));
-    rev = g_slist_sort(rev, (GCompareFunc) sp_item_repr_compare_position);
+    rev = sp_repr_sort_by_position(rev, object_repr);
     rev = g_slist_reverse(rev);
 
     // Iterate over all objects in the selection (starting from top).
@@ -1014,7 +1046,7 @@ void sp_selection_lower(Inkscape::Selection *selection, SPDesktop *desktop)
                     Geom::OptRect ref_bbox = SP_ITEM(newref)->desktopVisualBounds();
                     if ( ref_bbox && selected->intersects(*ref_bbox) ) {
                         // AND if it's not one of our selected objects,
-                        if (!g_slist_find(const_cast<GSList *>(items), newref)) {
+                        if (!selection->includes(newref)) {
                             // move the selected object before that sibling
                             SPObject *put_after = prev_sibling(newref);
                             if (put_after)
@@ -1056,7 +1088,7 @@ void sp_selection_lower_to_bottom(Inkscape::Selection *selection, SPDesktop *des
 
     GSList *rl;
     rl = g_slist_copy(const_cast<GSList *>(selection->reprList()));
-    rl = g_slist_sort(rl, (GCompareFunc) sp_repr_compare_position);
+    rl = sp_repr_sort_by_position(rl);
     rl = g_slist_reverse(rl);
 
     for (GSList *l = rl; l != NULL; l = l->next) {
@@ -1271,6 +1303,7 @@ void sp_selection_to_next_layer(SPDesktop *dt, bool suppressDone)
     if (next) {
         GSList *temp_clip = NULL;
         sp_selection_copy_impl(items, &temp_clip, dt->doc()->getReprDoc());
+        selection->clear();
         sp_selection_delete_impl(items, false, false);
         next=Inkscape::next_layer(dt->currentRoot(), dt->currentLayer()); // Fixes bug 1482973: crash while moving layers
         GSList *copied;
@@ -1316,6 +1349,7 @@ void sp_selection_to_prev_layer(SPDesktop *dt, bool suppressDone)
     if (next) {
         GSList *temp_clip = NULL;
         sp_selection_copy_impl(items, &temp_clip, dt->doc()->getReprDoc()); // we're in the same doc, so no need to copy defs
+        selection->clear();
         sp_selection_delete_impl(items, false, false);
         next=Inkscape::previous_layer(dt->currentRoot(), dt->currentLayer()); // Fixes bug 1482973: crash while moving layers
         GSList *copied;
@@ -1359,6 +1393,8 @@ void sp_selection_to_layer(SPDesktop *dt, SPObject *moveto, bool suppressDone)
     if (moveto) {
         GSList *temp_clip = NULL;
         sp_selection_copy_impl(items, &temp_clip, dt->doc()->getReprDoc()); // we're in the same doc, so no need to copy defs
+        // deselect first, rather than announce each deletion as a selection change
+        selection->clear();
         sp_selection_delete_impl(items, false, false);
         GSList *copied = sp_selection_paste_impl(sp_desktop_document(dt), moveto, &temp_clip);
         selection->setReprList((GSList const *) copied);
@@ -1718,6 +1754,101 @@ sp_selection_rotate(Inkscape::Selection *selection, gdouble const angle_degrees)
                             _("Rotate"));
 }
 
+/*
+ * The items among candidates that get_all_items() would list from the current root
+ * with ingroups set, in no particular order; clones are not indexed and never listed.
+ * Unless only visible items are wanted, the candidates must be looked up after
+ * build_hidden_items().
+ */
+static GSList *get_candidate_items(std::vector<SPObject *> &candidates, SPDesktop *desktop, bool onlyvisible, bool onlysensitive)
+{
+    SPObject *root = desktop->currentRoot();
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    GSList *list = NULL;
+    for (std::vector<SPObject *>::const_iterator i = candidates.begin(); i != candidates.end(); ++i) {
+        SPItem *item = dynamic_cast<SPItem *>(*i);
+        if (item &&
+            !desktop->isLayer(item) &&
+            (!onlysensitive || !item->isLocked()) &&
+            (!onlyvisible || !desktop->itemIsHidden(item)) &&
+            root->isAncestorOf(item))
+        {
+            list = g_slist_prepend(list, item);
+        }
+    }
+    return list;
+}
+
+/*
+ * Builds what hidden layers hold, so that it is indexed.
+ */
+static void build_hidden_items(SPDesktop *desktop)
+{
+    SPObject *root = desktop->currentRoot();
+    root->document->buildDeferred(root);
+}
+
+/*
+ * Appends the objects whose paint can match paint in sp_get_same_fill_or_stroke_color() to candidates.
+ */
+static void same_paint_candidates(SPDesktop *desktop, Inkscape::ObjectPropertyIndex::Property property, SPIPaint const &paint, std::vector<SPObject *> &candidates)
+{
+    Inkscape::ObjectPropertyIndex *index = sp_desktop_document(desktop)->property_index;
+
+    // a paint server that does not resolve leaves its fallback color or none
+    index->objectsWith(property, "url", candidates);
+    if (paint.isColor()) {
+        index->objectsWith(property, Inkscape::ObjectPropertyIndex::colorValue(paint.value.color).c_str(), candidates);
+    } else if (paint.isNone()) {
+        index->objectsWith(property, "none", candidates);
+        index->objectsWith(property, "unset", candidates);
+    }
+}
+
+/*
+ * Object types, as the object factory names them, that item_type_match() puts together.
+ * item_type_match() checks classes, so each group lists the types of the subclasses too.
+ */
+static char const *const same_type_groups[][4] = {
+    { "svg:rect", NULL },
+    { "svg:circle", "svg:ellipse", "arc", NULL },
+    { "star", "svg:polygon", "inkscape:box3dside", NULL },
+    { "spiral", NULL },
+    { "svg:path", "svg:line", "svg:polyline", NULL },
+    { "svg:text", "svg:flowRoot", "svg:tspan", "svg:tref" },
+    { "svg:use", NULL },
+    { "svg:image", NULL },
+    { "inkscape:offset", NULL },
+};
+
+/*
+ * Appends the objects whose type can match the type of sel in item_type_match() to candidates.
+ * Returns false if the type of sel is not in same_type_groups, so that all items have to be
+ * compared.
+ */
+static bool same_type_candidates(SPDesktop *desktop, SPItem *sel, std::vector<SPObject *> &candidates)
+{
+    Inkscape::ObjectPropertyIndex *index = sp_desktop_document(desktop)->property_index;
+    std::string const type = NodeTraits::get_type_string(*sel->getRepr());
+
+    for (unsigned i = 0; i < G_N_ELEMENTS(same_type_groups); ++i) {
+        char const *const *group = same_type_groups[i];
+        char const *const *end = group + G_N_ELEMENTS(same_type_groups[i]);
+        for (char const *const *t = group; t != end && *t; ++t) {
+            if (type == *t) {
+                for (t = group; t != end && *t; ++t) {
+                    index->objectsWith(Inkscape::ObjectPropertyIndex::TYPE, *t, candidates);
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 /*
  * Selects all the visible items with the same fill and/or stroke color/style as the items in the current selection
  *
@@ -1741,11 +1872,29 @@ void sp_select_same_fill_stroke_style(SPDesktop *desktop, gboolean fill, gboolea
     bool onlysensitive = prefs->getBool("/options/kbselection/onlysensitive", true);
     bool ingroups = TRUE;
 
-    GSList *all_list = get_all_items(NULL, desktop->currentRoot(), desktop, onlyvisible, onlysensitive, ingroups, NULL);
-    GSList *all_matches = NULL;
-
     Inkscape::Selection *selection = sp_desktop_selection (desktop);
 
+    GSList *all_list = NULL;
+    if (fill || stroke) {
+        if (!onlyvisible) {
+            build_hidden_items(desktop);
+        }
+        // only the items with a paint that can match need comparing
+        std::vector<SPObject *> candidates;
+        for (GSList const* sel_iter = selection->itemList(); sel_iter; sel_iter = sel_iter->next) {
+            SPItem *sel = SP_ITEM(sel_iter->data);
+            if (fill) {
+                same_paint_candidates(desktop, Inkscape::ObjectPropertyIndex::FILL, sel->style->fill, candidates);
+            } else {
+                same_paint_candidates(desktop, Inkscape::ObjectPropertyIndex::STROKE, sel->style->stroke, candidates);
+            }
+        }
+        all_list = get_candidate_items(candidates, desktop, onlyvisible, onlysensitive);
+    } else {
+        all_list = get_all_items(NULL, desktop->currentRoot(), desktop, onlyvisible, onlysensitive, ingroups, NULL);
+    }
+    GSList *all_matches = NULL;
+
     for (GSList const* sel_iter = selection->itemList(); sel_iter; sel_iter = sel_iter->next) {
         SPItem *sel = SP_ITEM(sel_iter->data);
         GSList *matches = all_list;
@@ -1792,13 +1941,27 @@ void sp_select_same_object_type(SPDesktop *desktop)
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     bool onlyvisible = prefs->getBool("/options/kbselection/onlyvisible", true);
     bool onlysensitive = prefs->getBool("/options/kbselection/onlysensitive", true);
-    bool ingroups = TRUE;
-
-    GSList *all_list = get_all_items(NULL, desktop->currentRoot(), desktop, onlyvisible, onlysensitive, ingroups, NULL);
-    GSList *matches = all_list;
 
     Inkscape::Selection *selection = sp_desktop_selection (desktop);
 
+    if (!onlyvisible) {
+        build_hidden_items(desktop);
+    }
+    // only the items of the types that can match need comparing
+    std::vector<SPObject *> candidates;
+    bool known_types = true;
+    for (GSList const* sel_iter = selection->itemList(); sel_iter && known_types; sel_iter = sel_iter->next) {
+        known_types = same_type_candidates(desktop, SP_ITEM(sel_iter->data), candidates);
+    }
+
+    GSList *all_list = NULL;
+    if (known_types) {
+        all_list = get_candidate_items(candidates, desktop, onlyvisible, onlysensitive);
+    } else {
+        all_list = get_all_items(NULL, desktop->currentRoot(), desktop, onlyvisible, onlysensitive, TRUE, NULL);
+    }
+    GSList *matches = all_list;
+
     for (GSList const* sel_iter = selection->itemList(); sel_iter; sel_iter = sel_iter->next) {
         SPItem *sel = SP_ITEM(sel_iter->data);
         matches = sp_get_same_object_type(sel, matches);
@@ -43,13 +43,17 @@ namespace Inkscape {
 
 Selection::Selection(LayerModel *layers, SPDesktop *desktop) :
     _objs(NULL),
+    _stale_objs(0),
     _reprs(NULL),
     _items(NULL),
     _layers(layers),
     _desktop(desktop),
     _selection_context(NULL),
     _flags(0),
-    _idle(0)
+    _idle(0),
+    _change_freeze(0),
+    _change_pending(false),
+    _change_persist(false)
 {
 }
 
@@ -94,6 +98,12 @@ void Selection::_emitModified(guint flags) {
 }
 
 void Selection::_emitChanged(bool persist_selection_context/* = false */) {
+    if (_change_freeze) {
+        _change_pending = true;
+        _change_persist = persist_selection_context;
+        return;
+    }
+
     if (persist_selection_context) {
         if (NULL == _selection_context) {
             _selection_context = _layers->currentLayer();
@@ -108,6 +118,18 @@ void Selection::_emitChanged(bool persist_selection_context/* = false */) {
     _changed_signal.emit(this);
 }
 
+void Selection::_freezeChanged() {
+    _change_freeze++;
+}
+
+void Selection::_thawChanged() {
+    g_return_if_fail(_change_freeze > 0);
+    if (--_change_freeze == 0 && _change_pending) {
+        _change_pending = false;
+        _emitChanged(_change_persist);
+    }
+}
+
 void
 Selection::_releaseContext(SPObject *obj)
 {
@@ -130,10 +152,34 @@ void Selection::_invalidateCachedLists() {
 
 void Selection::_clear() {
     _invalidateCachedLists();
-    while (_objs) {
-        SPObject *obj=reinterpret_cast<SPObject *>(_objs->data);
-        _remove(obj);
+    for ( GSList const *iter = _objs ; iter != NULL ; iter = iter->next ) {
+        SPObject *obj=reinterpret_cast<SPObject *>(iter->data);
+        if (_objs_set.find(obj) != _objs_set.end()) {
+            _remove(obj);
+        }
+    }
+    g_slist_free(_objs);
+    _objs = NULL;
+    _stale_objs = 0;
+}
+
+void Selection::_compactList() {
+    if (!_stale_objs) {
+        return;
     }
+
+    // an object removed and added again also has a stale entry, after its live one
+    INK_UNORDERED_SET<SPObject *> seen;
+    GSList *kept = NULL;
+    for ( GSList const *iter = _objs ; iter != NULL ; iter = iter->next ) {
+        SPObject *obj=reinterpret_cast<SPObject *>(iter->data);
+        if (_objs_set.find(obj) != _objs_set.end() && seen.insert(obj).second) {
+            kept = g_slist_prepend(kept, obj);
+        }
+    }
+    g_slist_free(_objs);
+    _objs = g_slist_reverse(kept);
+    _stale_objs = 0;
 }
 
 SPObject *Selection::activeContext() {
@@ -148,7 +194,7 @@ bool Selection::includes(SPObject *obj) const {
 
     g_return_val_if_fail(SP_IS_OBJECT(obj), FALSE);
 
-    return ( g_slist_find(_objs, obj) != NULL );
+    return ( _objs_set.find(obj) != _objs_set.end() );
 }
 
 void Selection::add(SPObject *obj, bool persist_selection_context/* = false */) {
@@ -179,7 +225,15 @@ void Selection::_add(SPObject *obj) {
     _removeObjectDescendants(obj);
     _removeObjectAncestors(obj);
 
+    // keep the stale entries fewer than the live ones
+    if ( _stale_objs > _objs_set.size() ) {
+        _compactList();
+    }
     _objs = g_slist_prepend(_objs, obj);
+    _objs_set.insert(obj);
+    for ( SPObject *parent = obj->parent ; parent ; parent = parent->parent ) {
+        _selected_descendants[parent]++;
+    }
 
     add_3D_boxes_recursively(obj);
 
@@ -233,7 +287,14 @@ void Selection::_remove(SPObject *obj) {
 
     remove_3D_boxes_recursively(obj);
 
-    _objs = g_slist_remove(_objs, obj);
+    _objs_set.erase(obj);
+    _stale_objs++;
+    for ( SPObject *parent = obj->parent ; parent ; parent = parent->parent ) {
+        INK_UNORDERED_MAP<SPObject *, unsigned>::iterator found = _selected_descendants.find(parent);
+        if (found != _selected_descendants.end() && --found->second == 0) {
+            _selected_descendants.erase(found);
+        }
+    }
 }
 
 void Selection::setList(GSList const *list) {
@@ -265,7 +326,7 @@ void Selection::setReprList(GSList const *list) {
 
     for ( GSList const *iter = list ; iter != NULL ; iter = iter->next ) {
         SPObject *obj=_objectForXMLNode(reinterpret_cast<Inkscape::XML::Node *>(iter->data));
-        if (obj) {
+        if (obj && !includes(obj)) {
             _add(obj);
         }
     }
@@ -279,6 +340,7 @@ void Selection::clear() {
 }
 
 GSList const *Selection::list() {
+    _compactList();
     return _objs;
 }
 
@@ -287,6 +349,7 @@ GSList const *Selection::itemList() {
         return _items;
     }
 
+    _compactList();
     for ( GSList const *iter=_objs ; iter != NULL ; iter = iter->next ) {
         SPObject *obj=reinterpret_cast<SPObject *>(iter->data);
         if (SP_IS_ITEM(obj)) {
@@ -336,8 +399,8 @@ std::list<SPBox3D *> const Selection::box3DList(Persp3D *persp) {
 }
 
 SPObject *Selection::single() {
-    if ( _objs != NULL && _objs->next == NULL ) {
-        return reinterpret_cast<SPObject *>(_objs->data);
+    if ( _objs_set.size() == 1 ) {
+        return *_objs_set.begin();
     } else {
         return NULL;
     }
@@ -476,10 +539,16 @@ std::vector<Inkscape::SnapCandidatePoint> Selection::getSnapPoints(SnapPreferenc
 }
 
 void Selection::_removeObjectDescendants(SPObject *obj) {
-    GSList *iter, *next;
-    for ( iter = _objs ; iter ; iter = next ) {
-        next = iter->next;
+    if (_selected_descendants.find(obj) == _selected_descendants.end()) {
+        return;
+    }
+
+    // _remove() leaves the list alone, so it can be walked meanwhile
+    for ( GSList const *iter = _objs ; iter ; iter = iter->next ) {
         SPObject *sel_obj=reinterpret_cast<SPObject *>(iter->data);
+        if (_objs_set.find(sel_obj) == _objs_set.end()) {
+            continue;
+        }
         SPObject *parent = sel_obj->parent;
         while (parent) {
             if ( parent == obj ) {
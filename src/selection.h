@@ -24,6 +24,7 @@
 #include "gc-anchored.h"
 #include "gc-soft-ptr.h"
 #include "util/list.h"
+#include "util/unordered-containers.h"
 #include "sp-item.h"
 #include "snapped-point.h"
 
@@ -171,6 +172,25 @@ public:
      */
     void setReprList(GSList const *reprs);
 
+    /**
+     * Holds back the changed signal while in scope, so that a series of
+     * changes made one object at a time is announced once, when the
+     * outermost batch ends.
+     */
+    class ChangeBatch {
+    public:
+        ChangeBatch(Selection *selection) : _selection(selection) {
+            _selection->_freezeChanged();
+        }
+        ~ChangeBatch() { _selection->_thawChanged(); }
+
+    private:
+        ChangeBatch(ChangeBatch const &); // no copy
+        void operator=(ChangeBatch const &); // no assign
+
+        Selection *_selection;
+    };
+
     /**  Add items from an STL iterator range to the selection.
      *  \param  from the begin iterator
      *  \param  to   the end iterator
@@ -179,7 +199,9 @@ public:
     void add(InputIterator from, InputIterator to) {
         _invalidateCachedLists();
         while ( from != to ) {
-            _add(*from);
+            if (!includes(*from)) {
+                _add(*from);
+            }
             ++from;
         }
         _emitChanged();
@@ -193,7 +215,7 @@ public:
     /**
      * Returns true if no items are selected.
      */
-    bool isEmpty() const { return _objs == NULL; }
+    bool isEmpty() const { return _objs_set.empty(); }
 
     /**
      * Returns true if the given object is selected.
@@ -335,6 +357,8 @@ private:
     void _emitModified(guint flags);
     /** Issues changed selection signal. */
     void _emitChanged(bool persist_selection_context = false);
+    void _freezeChanged();
+    void _thawChanged();
 
     void _invalidateCachedLists();
 
@@ -348,12 +372,22 @@ private:
     void _add(SPObject *obj);
     /** removes an object (without issuing a notification). */
     void _remove(SPObject *obj);
+    /** drops the entries of removed objects from _objs. */
+    void _compactList();
     /** returns the SPObject corresponding to an xml node (if any). */
     SPObject *_objectForXMLNode(XML::Node *repr) const;
     /** Releases an active layer object that is being removed. */
     void _releaseContext(SPObject *obj);
 
+    /**
+     * The selected objects, most recently added first. Removing an object only
+     * takes it out of _objs_set; its entry here is dropped by _compactList().
+     */
     mutable GSList *_objs;
+    unsigned _stale_objs;
+    INK_UNORDERED_SET<SPObject *> _objs_set;
+    /** For each ancestor of a selected object, how many selected objects it has below it. */
+    INK_UNORDERED_MAP<SPObject *, unsigned> _selected_descendants;
     mutable GSList *_reprs;
     mutable GSList *_items;
 
@@ -370,9 +404,12 @@ private:
     SPObject* _selection_context;
     guint _flags;
     guint _idle;
+    unsigned _change_freeze;
+    bool _change_pending;
+    bool _change_persist;
 
-    std::map<SPObject *, sigc::connection> _modified_connections;
-    std::map<SPObject *, sigc::connection> _release_connections;
+    INK_UNORDERED_MAP<SPObject *, sigc::connection> _modified_connections;
+    INK_UNORDERED_MAP<SPObject *, sigc::connection> _release_connections;
     sigc::connection _context_release_connection;
 
     sigc::signal<void, Selection *> _changed_signal;
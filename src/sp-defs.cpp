@@ -47,7 +47,7 @@ void SPDefs::update(SPCtx *ctx, guint flags) {
 
     flags &= SP_OBJECT_MODIFIED_CASCADE;
 
-    GSList *l = g_slist_reverse(this->childList(true));
+    GSList *l = flags ? g_slist_reverse(this->childList(true)) : this->updatedChildList();
     while (l) {
         SPObject *child = SP_OBJECT(l->data);
         l = g_slist_remove(l, child);
@@ -65,13 +65,7 @@ void SPDefs::modified(unsigned int flags) {
 
     flags &= SP_OBJECT_MODIFIED_CASCADE;
 
-    GSList *l = NULL;
-    for ( SPObject *child = this->firstChild() ; child; child = child->getNext() ) {
-        sp_object_ref(child);
-        l = g_slist_prepend(l, child);
-    }
-
-    l = g_slist_reverse(l);
+    GSList *l = flags ? g_slist_reverse(this->childList(true)) : this->modifiedChildList();
 
     while (l) {
         SPObject *child = SP_OBJECT(l->data);
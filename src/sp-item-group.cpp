@@ -173,7 +173,10 @@ void SPGroup::update(SPCtx *ctx, unsigned int flags) {
     }
     childflags &= SP_OBJECT_MODIFIED_CASCADE;
 
-    GSList *l = g_slist_reverse(this->childList(true, SPObject::ActionUpdate));
+    // Unless something cascades down from the group, only the children that asked
+    // for an update need one.
+    GSList *l = childflags ? g_slist_reverse(this->childList(true, SPObject::ActionUpdate))
+                           : this->updatedChildList();
     while (l) {
         SPObject *child = SP_OBJECT (l->data);
         l = g_slist_remove (l, child);
@@ -209,6 +212,11 @@ void SPGroup::update(SPCtx *ctx, unsigned int flags) {
 void SPGroup::modified(guint flags) {
     SPLPEItem::modified(flags);
 
+    // what a hidden layer holds is built once it is shown
+    if ((flags & SP_OBJECT_STYLE_MODIFIED_FLAG) && !this->cloned && !this->isHidden()) {
+        this->document->buildDeferred(this);
+    }
+
     SPObject *child;
 
     if (flags & SP_OBJECT_MODIFIED_FLAG) {
@@ -217,7 +225,7 @@ void SPGroup::modified(guint flags) {
 
     flags &= SP_OBJECT_MODIFIED_CASCADE;
 
-    GSList *l = g_slist_reverse(this->childList(true));
+    GSList *l = flags ? g_slist_reverse(this->childList(true)) : this->modifiedChildList();
 
     while (l) {
         child = SP_OBJECT (l->data);
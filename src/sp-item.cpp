@@ -31,6 +31,7 @@
 #include "display/drawing-item.h"
 #include "attributes.h"
 #include "document.h"
+#include "item-bounds-index.h"
 #include "uri.h"
 #include "inkscape.h"
 #include "desktop.h"
@@ -398,11 +399,19 @@ void SPItem::build(SPDocument *document, Inkscape::XML::Node *repr) {
     object->readAttr( "inkscape:connection-points" );
 
     SPObject::build(document, repr);
+
+    if (!cloned) {
+        document->item_index->add(this);
+    }
 }
 
 void SPItem::release() {
 	SPItem* item = this;
 
+    if (document && !cloned) {
+        document->item_index->remove(this);
+    }
+
     // Note: do this here before the clip_ref is deleted, since calling
     // ensureUpToDate() for triggered routing may reference
     // the deleted clip_ref.
@@ -514,7 +523,7 @@ void SPItem::set(unsigned int key, gchar const* value) {
 
 void SPItem::clip_ref_changed(SPObject *old_clip, SPObject *clip, SPItem *item)
 {
-    item->bbox_valid = FALSE; // force a re-evaluation
+    item->invalidateBBox(); // force a re-evaluation
     if (old_clip) {
         SPItemView *v;
         /* Hide clippath */
@@ -570,7 +579,7 @@ void SPItem::update(SPCtx* /*ctx*/, guint flags) {
 
     // any of the modifications defined in sp-object.h might change bbox,
     // so we invalidate it unconditionally
-    item->bbox_valid = FALSE;
+    item->invalidateBBox();
 
     if (flags & (SP_OBJECT_CHILD_MODIFIED_FLAG | SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG)) {
         if (flags & SP_OBJECT_MODIFIED_FLAG) {
@@ -805,6 +814,14 @@ Geom::OptRect SPItem::documentVisualBounds() const
     }
     return doc_bbox;
 }
+void SPItem::invalidateBBox()
+{
+    bbox_valid = FALSE;
+    if (document && !cloned) {
+        document->item_index->invalidate(this);
+    }
+}
+
 Geom::OptRect SPItem::documentBounds(BBoxType type) const
 {
     if (type == GEOMETRIC_BBOX) {
@@ -182,6 +182,8 @@ public:
     Geom::OptRect documentGeometricBounds() const;
     Geom::OptRect documentVisualBounds() const;
     Geom::OptRect documentBounds(BBoxType type) const;
+    /// Forgets the cached document bbox, here and in the document's item index.
+    void invalidateBBox();
     Geom::OptRect desktopGeometricBounds() const;
     Geom::OptRect desktopVisualBounds() const;
     Geom::OptRect desktopPreferredBounds() const;
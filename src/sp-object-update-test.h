@@ -0,0 +1,127 @@
+#ifndef SEEN_SP_OBJECT_UPDATE_TEST_H
+#define SEEN_SP_OBJECT_UPDATE_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <cstring>
+#include <string>
+#include <sigc++/functors/mem_fun.h>
+
+#include "document.h"
+#include "sp-item.h"
+#include "xml/node.h"
+
+class SPObjectUpdateTest : public CxxTest::TestSuite
+{
+public:
+    static SPObjectUpdateTest *createSuite() { return new SPObjectUpdateTest(); }
+    static void destroySuite( SPObjectUpdateTest *suite ) { delete suite; }
+
+    void testUpdatesOnlyChangedBranch()
+    {
+        std::string svg("<svg xmlns='http://www.w3.org/2000/svg' width='100' height='100'><g id='g'>");
+        for (int i = 0; i < 100; i++) {
+            svg += "<rect x='0' y='0' width='10' height='10'/>";
+        }
+        svg += "<rect id='a' x='0' y='0' width='10' height='10'/></g></svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        SPItem *a = SP_ITEM(doc->getObjectById("a"));
+        TS_ASSERT(a);
+        if ( a ) {
+            a->getRepr()->setAttribute("x", "50");
+            doc->ensureUpToDate();
+
+            // the root, the group and the rect, not the other hundred rects
+            TS_ASSERT_LESS_THAN( doc->update_counters.updated, 10u );
+            TS_ASSERT_LESS_THAN( doc->update_counters.modified, 10u );
+
+            Geom::OptRect bbox = a->documentVisualBounds();
+            TS_ASSERT( bbox && bbox->min()[Geom::X] >= 49 );
+
+            // a change cascading from the group still reaches every rect
+            doc->getObjectById("g")->getRepr()->setAttribute("transform", "translate(1,0)");
+            doc->ensureUpToDate();
+            TS_ASSERT_LESS_THAN( 100u, doc->update_counters.updated );
+        }
+
+        doc->doUnref();
+    }
+
+    void testUpdateRequestedDuringModifiedPass()
+    {
+        // s is notified before g, whose child a gets an update request meanwhile
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg' width='100' height='100'>"
+            "<rect id='s' width='10' height='10'/>"
+            "<g id='g'><rect id='a' width='10' height='10'/><rect id='b' width='10' height='10'/></g>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+        doc->ensureUpToDate();
+
+        SPObject *s = doc->getObjectById("s");
+        SPObject *b = doc->getObjectById("b");
+        _a = doc->getObjectById("a");
+        TS_ASSERT(s && b && _a);
+        if ( s && b && _a ) {
+            sigc::connection request = s->connectModified(sigc::mem_fun(*this, &SPObjectUpdateTest::requestUpdateOfA));
+            sigc::connection count = _a->connectModified(sigc::mem_fun(*this, &SPObjectUpdateTest::countModifiedOfA));
+            _a_modified = 0;
+
+            s->getRepr()->setAttribute("x", "5");
+            b->getRepr()->setAttribute("x", "5");
+            doc->ensureUpToDate();
+            request.disconnect();
+
+            // a got its notification in the pass after its update
+            TS_ASSERT_EQUALS(_a_modified, 1u);
+            TS_ASSERT_EQUALS(static_cast<unsigned>(_a->mflags), 0u);
+            TS_ASSERT_EQUALS(static_cast<unsigned>(_a->uflags), 0u);
+
+            // and later requests still reach it
+            _a->getRepr()->setAttribute("x", "5");
+            doc->ensureUpToDate();
+            TS_ASSERT_EQUALS(_a_modified, 2u);
+
+            count.disconnect();
+        }
+
+        doc->doUnref();
+    }
+
+private:
+    void requestUpdateOfA(SPObject * /*object*/, unsigned /*flags*/)
+    {
+        _a->requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG);
+    }
+
+    void countModifiedOfA(SPObject * /*object*/, unsigned /*flags*/)
+    {
+        _a_modified++;
+    }
+
+    SPObject *_a;
+    unsigned _a_modified;
+};
+
+#endif // SEEN_SP_OBJECT_UPDATE_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
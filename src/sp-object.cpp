@@ -14,8 +14,10 @@
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
 
+#include <algorithm>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "helper/sp-marshal.h"
 #include "xml/node-event-vector.h"
@@ -112,12 +114,58 @@ public:
 static gchar *sp_object_get_unique_id(SPObject    *object,
                                       gchar const *defid);
 
+namespace {
+
+/** Unreferences the objects queued in \a queue and frees it. */
+GSList *free_queue(GSList *queue)
+{
+    for (GSList *i = queue; i; i = i->next) {
+        sp_object_unref(static_cast<SPObject *>(i->data));
+    }
+    g_slist_free(queue);
+    return NULL;
+}
+
+bool precedes_sibling(SPObject const *a, SPObject const *b)
+{
+    return a->getRepr()->position() < b->getRepr()->position();
+}
+
+/**
+ * The objects in \a queue still attached to \a parent, in document order and without
+ * duplicates, referenced like SPObject::childList(true).
+ */
+GSList *queued_child_list(SPObject *parent, GSList *queue)
+{
+    std::vector<SPObject *> children;
+    for (GSList *i = queue; i; i = i->next) {
+        SPObject *child = static_cast<SPObject *>(i->data);
+        if (child->parent == parent && child->getRepr()) {
+            children.push_back(child);
+        }
+    }
+    if (children.size() > 1) {
+        std::sort(children.begin(), children.end());
+        children.erase(std::unique(children.begin(), children.end()), children.end());
+        std::sort(children.begin(), children.end(), precedes_sibling);
+    }
+
+    GSList *l = NULL;
+    for (std::vector<SPObject *>::reverse_iterator i = children.rbegin(); i != children.rend(); ++i) {
+        l = g_slist_prepend(l, sp_object_ref(*i));
+    }
+    return l;
+}
+
+}
+
 SPObject::SPObject()
     : cloned(0), uflags(0), mflags(0), hrefcount(0), _total_hrefcount(0),
       document(NULL), parent(NULL), children(NULL), _last_child(NULL),
-      next(NULL), id(NULL), repr(NULL), refCount(1),
+      next(NULL), _prev(NULL), id(NULL), repr(NULL), refCount(1),
       _successor(NULL), _collection_policy(SPObject::COLLECT_WITH_PARENT),
-      _label(NULL), _default_label(NULL)
+      _label(NULL), _default_label(NULL),
+      _update_queue(NULL), _update_pass(NULL), _modified_queue(NULL), _modified_pass(NULL)
 {
     debug("id=%x, typename=%s",this, g_type_name_from_instance((GTypeInstance*)object));
 
@@ -134,6 +182,9 @@ SPObject::SPObject()
 }
 
 SPObject::~SPObject() {
+    free_queue(this->_update_queue);
+    free_queue(this->_modified_queue);
+
     g_free(this->_label);
     g_free(this->_default_label);
 
@@ -483,11 +534,22 @@ void SPObject::attach(SPObject *object, SPObject *prev)
         this->children = object;
     }
     object->next = next;
+    object->_prev = prev;
     if (!next) {
         this->_last_child = object;
+    } else {
+        next->_prev = object;
     }
     if (!object->xml_space.set)
         object->xml_space.value = this->xml_space.value;
+
+    // requests made before the object had a parent
+    if (object->uflags) {
+        this->_update_queue = g_slist_prepend(this->_update_queue, sp_object_ref(object));
+    }
+    if (object->uflags || object->mflags) {
+        this->_modified_queue = g_slist_prepend(this->_modified_queue, sp_object_ref(object));
+    }
 }
 
 void SPObject::reorder(SPObject *prev)
@@ -500,13 +562,7 @@ void SPObject::reorder(SPObject *prev)
     g_return_if_fail(!prev || prev->parent == this->parent);
 
     SPObject *const parent=this->parent;
-
-    SPObject *old_prev=NULL;
-    for ( SPObject *child = parent->children ; child && child != this ;
-          child = child->next )
-    {
-        old_prev = child;
-    }
+    SPObject *const old_prev=this->_prev;
 
     SPObject *next=this->next;
     if (old_prev) {
@@ -516,6 +572,8 @@ void SPObject::reorder(SPObject *prev)
     }
     if (!next) {
         parent->_last_child = old_prev;
+    } else {
+        next->_prev = old_prev;
     }
     if (prev) {
         next = prev->next;
@@ -525,8 +583,11 @@ void SPObject::reorder(SPObject *prev)
         parent->children = this;
     }
     this->next = next;
+    this->_prev = prev;
     if (!next) {
         parent->_last_child = this;
+    } else {
+        next->_prev = this;
     }
 }
 
@@ -540,12 +601,7 @@ void SPObject::detach(SPObject *object)
 
     object->releaseReferences();
 
-    SPObject *prev=NULL;
-    for ( SPObject *child = this->children ; child && child != object ;
-          child = child->next )
-    {
-        prev = child;
-    }
+    SPObject *prev=object->_prev;
 
     SPObject *next=object->next;
     if (prev) {
@@ -555,15 +611,41 @@ void SPObject::detach(SPObject *object)
     }
     if (!next) {
         this->_last_child = prev;
+    } else {
+        next->_prev = prev;
     }
 
     object->next = NULL;
+    object->_prev = NULL;
     object->parent = NULL;
 
     this->_updateTotalHRefCount(-object->_total_hrefcount);
     sp_object_unref(object, this);
 }
 
+/**
+ * The child of \a parent for \a ref or, when \a ref has none because it is deferred or
+ * of an unknown type, for the closest sibling before it that has one, not counting
+ * \a moving.
+ */
+static SPObject *child_at_or_before(SPObject *parent, Inkscape::XML::Node *ref, SPObject *moving = NULL)
+{
+    SPObject *result = parent->get_child_by_repr(ref);
+    if (!result) {
+        unsigned const position = ref->position();
+        for (SPObject *child = parent->firstChild(); child; child = child->getNext()) {
+            if (child == moving) {
+                continue;
+            }
+            if (child->getRepr()->position() > position) {
+                break;
+            }
+            result = child;
+        }
+    }
+    return result;
+}
+
 SPObject *SPObject::get_child_by_repr(Inkscape::XML::Node *repr)
 {
     g_return_val_if_fail(repr != NULL, NULL);
@@ -590,7 +672,7 @@ void SPObject::child_added(Inkscape::XML::Node *child, Inkscape::XML::Node *ref)
 
         SPObject* ochild = SPFactory::instance().createObject(typeString);
 
-        SPObject *prev = ref ? object->get_child_by_repr(ref) : NULL;
+        SPObject *prev = ref ? child_at_or_before(object, ref) : NULL;
         object->attach(ochild, prev);
         sp_object_unref(ochild, NULL);
 
@@ -604,6 +686,13 @@ void SPObject::child_added(Inkscape::XML::Node *child, Inkscape::XML::Node *ref)
     }
 }
 
+void SPObject::buildDeferredChild(Inkscape::XML::Node *child, Inkscape::XML::Node *ref)
+{
+    g_return_if_fail(child->parent() == this->repr);
+
+    this->child_added(child, ref);
+}
+
 void SPObject::release() {
     SPObject* object = this;
 
@@ -621,6 +710,8 @@ void SPObject::remove_child(Inkscape::XML::Node* child) {
     // If the xml node has got a corresponding child in the object tree
     if (ochild) {
         this->detach(ochild);
+    } else if (!this->cloned) {
+        this->document->forgetDeferred(child);
     }
 }
 
@@ -628,8 +719,11 @@ void SPObject::order_changed(Inkscape::XML::Node *child, Inkscape::XML::Node * /
     SPObject* object = this;
 
     SPObject *ochild = object->get_child_by_repr(child);
-    g_return_if_fail(ochild != NULL);
-    SPObject *prev = new_ref ? object->get_child_by_repr(new_ref) : NULL;
+    if (!ochild) {
+        // deferred or of an unknown type, only its node moves
+        return;
+    }
+    SPObject *prev = new_ref ? child_at_or_before(object, new_ref, ochild) : NULL;
     ochild->reorder(prev);
     ochild->_position_changed_signal.emit(ochild);
 }
@@ -645,6 +739,9 @@ void SPObject::build(SPDocument *document, Inkscape::XML::Node *repr) {
     object->readAttr("inkscape:collect");
 
     for (Inkscape::XML::Node *rchild = repr->firstChild() ; rchild != NULL; rchild = rchild->next()) {
+        if (document->deferBuild(object, rchild)) {
+            continue;
+        }
         try {
             const std::string typeString = NodeTraits::get_type_string(*rchild);
 
@@ -721,6 +818,8 @@ void SPObject::invoke_build(SPDocument *document, Inkscape::XML::Node *repr, uns
     /* Invoke derived methods, if any */
     this->build(document, repr);
 
+    document->invalidateObjectIndexes(this);
+
     /* Signalling (should be connected AFTER processing derived methods */
     sp_repr_add_listener(repr, &object_event_vector, this);
 }
@@ -774,6 +873,8 @@ void SPObject::releaseReferences() {
         this->_default_label = NULL;
 
         this->document->bindObjectToRepr(this->repr, NULL);
+        this->document->removeFromObjectIndexes(this);
+        this->document->forgetDeferred(this->repr);
 
         Inkscape::GC::release(this->repr);
     } else {
@@ -784,6 +885,9 @@ void SPObject::releaseReferences() {
         this->style = sp_style_unref(this->style);
     }
 
+    this->_update_queue = free_queue(this->_update_queue);
+    this->_modified_queue = free_queue(this->_modified_queue);
+
     this->document = NULL;
     this->repr = NULL;
 }
@@ -791,13 +895,7 @@ void SPObject::releaseReferences() {
 
 SPObject *SPObject::getPrev()
 {
-    SPObject *prev = 0;
-    for ( SPObject *obj = parent->firstChild(); obj && !prev; obj = obj->getNext() ) {
-        if (obj->getNext() == this) {
-            prev = obj;
-        }
-    }
-    return prev;
+    return _prev;
 }
 
 void SPObject::repr_child_added(Inkscape::XML::Node * /*repr*/, Inkscape::XML::Node *child, Inkscape::XML::Node *ref, gpointer data)
@@ -927,7 +1025,7 @@ void SPObject::readAttr(gchar const *key)
     unsigned int keyid = sp_attribute_lookup(key);
     if (keyid != SP_ATTR_INVALID) {
         /* Retrieve the 'key' attribute from the object's XML representation */
-        gchar const *value = getRepr()->attribute(key);
+        gchar const *value = getRepr()->attributeByKey(sp_attribute_key(keyid));
 
         setKeyValue(keyid, value);
     }
@@ -939,6 +1037,8 @@ void SPObject::repr_attr_changed(Inkscape::XML::Node * /*repr*/, gchar const *ke
 
     object->readAttr(key);
 
+    object->document->invalidateObjectIndexes(object);
+
     // manual changes to extension attributes require the normal
     // attributes, which depend on them, to be updated immediately
     if (is_interactive) {
@@ -1103,6 +1203,8 @@ void SPObject::requestDisplayUpdate(unsigned int flags)
      */
     if (already_propagated) {
         if (parent) {
+            // queued for the modified pass by updateDisplay
+            parent->_update_queue = g_slist_prepend(parent->_update_queue, sp_object_ref(this));
             parent->requestDisplayUpdate(SP_OBJECT_CHILD_MODIFIED_FLAG);
         } else {
             document->requestModified();
@@ -1115,6 +1217,9 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
     g_return_if_fail(!(flags & ~SP_OBJECT_MODIFIED_CASCADE));
 
     update_in_progress ++;
+    if (this->document) {
+        this->document->update_counters.updated++;
+    }
 
 #ifdef SP_OBJECT_DEBUG_CASCADE
     g_print("Update %s:%s %x %x %x\n", g_type_name_from_instance((GTypeInstance *) this), getId(), flags, this->uflags, this->mflags);
@@ -1123,7 +1228,15 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
     /* Get this flags */
     flags |= this->uflags;
     /* Copy flags to modified cascade for later processing */
+    bool const modified_queued = this->mflags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG);
     this->mflags |= this->uflags;
+    /* The parent is told only now, not when the update was requested: a request made during
+     * the modified pass would otherwise be taken, and skipped, by a parent notified later in
+     * that pass, and the notification would never be sent. */
+    if ( !modified_queued && this->parent
+         && ( this->mflags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG) ) ) {
+        this->parent->_modified_queue = g_slist_prepend(this->parent->_modified_queue, sp_object_ref(this));
+    }
     /* We have to clear flags here to allow rescheduling update */
     this->uflags = 0;
 
@@ -1136,9 +1249,16 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
     if ((flags & SP_OBJECT_STYLE_MODIFIED_FLAG) && (flags & SP_OBJECT_PARENT_MODIFIED_FLAG)) {
         if (this->style && this->parent) {
             sp_style_merge_from_parent(this->style, this->parent->style);
+            // inherited paint servers, filters and markers count as references,
+            // and inherited paint is indexed
+            this->document->invalidateObjectIndexes(this);
         }
     }
 
+    /* Children requesting an update from here on are left for the next pass */
+    this->_update_pass = this->_update_queue;
+    this->_update_queue = NULL;
+
     try
     {
         this->update(ctx, flags);
@@ -1153,6 +1273,8 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
         g_warning("SPObject::updateDisplay(SPCtx *ctx, unsigned int flags) : throw in ((SPObjectClass *) G_OBJECT_GET_CLASS(this))->update(this, ctx, flags);");
     }
 
+    this->_update_pass = free_queue(this->_update_pass);
+
     update_in_progress --;
 }
 
@@ -1175,6 +1297,7 @@ void SPObject::requestModified(unsigned int flags)
      */
     if (already_propagated) {
         if (parent) {
+            parent->_modified_queue = g_slist_prepend(parent->_modified_queue, sp_object_ref(this));
             parent->requestModified(SP_OBJECT_CHILD_MODIFIED_FLAG);
         } else {
             document->requestModified();
@@ -1196,15 +1319,31 @@ void SPObject::emitModified(unsigned int flags)
      * make changes and therefore queue new modification notifications
      * themselves. */
     this->mflags = 0;
+    this->_modified_pass = this->_modified_queue;
+    this->_modified_queue = NULL;
+    if (this->document) {
+        this->document->update_counters.modified++;
+    }
 
     sp_object_ref(this);
 
     this->modified(flags);
+    this->_modified_pass = free_queue(this->_modified_pass);
 
     _modified_signal.emit(this, flags);
     sp_object_unref(this);
 }
 
+GSList *SPObject::updatedChildList()
+{
+    return queued_child_list(this, this->_update_pass);
+}
+
+GSList *SPObject::modifiedChildList()
+{
+    return queued_child_list(this, this->_modified_pass);
+}
+
 gchar const *SPObject::getTagName(SPException *ex) const
 {
     g_assert(repr != NULL);
@@ -204,6 +204,7 @@ public:
     SPObject *children; /* Our children */
     SPObject *_last_child; /* Remembered last child */
     SPObject *next; /* Next object in linked list */
+    SPObject *_prev; /* Previous object in linked list */
 
 private:
     SPObject(const SPObject&);
@@ -614,6 +615,21 @@ public:
      */
     void emitModified(unsigned int flags);
 
+    /**
+     * Returns the children that requested a display update since this object's last
+     * update, in document order and referenced like childList(true).
+     *
+     * Only valid from within update(). Containers use it to visit just those children
+     * when no flags cascade down from themselves.
+     */
+    GSList *updatedChildList();
+
+    /**
+     * Returns the children with a modification notification pending, in document order
+     * and referenced like childList(true). Only valid from within modified().
+     */
+    GSList *modifiedChildList();
+
     /**
      * Connects to the modification notification signal
      *
@@ -653,6 +669,14 @@ public:
     gchar *_label;
     mutable gchar *_default_label;
 
+    /* Children that requested an update or a modified notification since the last pass,
+     * and the lists being handled by the pass in progress. Each entry holds a reference
+     * (sp_object_ref) taken when it is queued and dropped by free_queue. */
+    GSList *_update_queue;
+    GSList *_update_pass;
+    GSList *_modified_queue;
+    GSList *_modified_pass;
+
     // WARNING:
     // Methods below should not be used outside of the SP tree,
     // as they operate directly on the XML representation.
@@ -679,6 +703,12 @@ public:
      */
     SPObject *get_child_by_repr(Inkscape::XML::Node *repr);
 
+    /**
+     * Builds the object for \a child, one of our node's children the document deferred,
+     * as if it had just been added after \a ref.
+     */
+    void buildDeferredChild(Inkscape::XML::Node *child, Inkscape::XML::Node *ref);
+
     void invoke_build(SPDocument *document, Inkscape::XML::Node *repr, unsigned int cloned);
 
     int getIntAttribute(char const *key, int def);
@@ -161,7 +161,7 @@ void SPPath::set(unsigned int key, const gchar* value) {
     switch (key) {
         case SP_ATTR_INKSCAPE_ORIGINAL_D:
 			if (value) {
-				Geom::PathVector pv = sp_svg_read_pathv(value);
+				Geom::PathVector pv = sp_svg_read_pathv_cached(value);
 				SPCurve *curve = new SPCurve(pv);
 
 				if (curve) {
@@ -177,7 +177,7 @@ void SPPath::set(unsigned int key, const gchar* value) {
 
        case SP_ATTR_D:
 			if (value) {
-				Geom::PathVector pv = sp_svg_read_pathv(value);
+				Geom::PathVector pv = sp_svg_read_pathv_cached(value);
 				SPCurve *curve = new SPCurve(pv);
 
 				if (curve) {
@@ -325,7 +325,7 @@ g_message("sp_path_update_patheffect writes 'd' attribute");
         } else if (!success) {
             // LPE was unsuccesfull. Read the old 'd'-attribute.
             if (gchar const * value = repr->attribute("d")) {
-                Geom::PathVector pv = sp_svg_read_pathv(value);
+                Geom::PathVector pv = sp_svg_read_pathv_cached(value);
                 SPCurve *oldcurve = new SPCurve(pv);
 
                 if (oldcurve) {
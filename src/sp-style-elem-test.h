@@ -6,6 +6,8 @@
 #include "test-helpers.h"
 
 #include "sp-style-elem.h"
+#include "style-selector-index.h"
+#include "xml/croco-node-iface.h"
 #include "xml/repr.h"
 
 class SPStyleElemTest : public CxxTest::TestSuite
@@ -149,6 +151,47 @@ public:
         Inkscape::GC::release(repr);
     }
 
+    void testSelectorIndex()
+    {
+        TS_ASSERT( _doc );
+        TS_ASSERT( _doc->getReprDoc() );
+        if ( !_doc->getReprDoc() ) {
+            return; // evil early return
+        }
+
+        SPStyleElem *style_elem = new SPStyleElem();
+        Inkscape::XML::Node *const repr = _doc->getReprDoc()->createElement("svg:style");
+        repr->setAttribute("type", "text/css");
+        Inkscape::XML::Node *const content_repr = _doc->getReprDoc()->createTextNode(
+            ".a { fill: red } rect { stroke: blue } * > #b { opacity: 0.5 } [fill] { display: none }");
+        repr->addChild(content_repr, NULL);
+        style_elem->invoke_build(_doc, repr, false);
+
+        CRSelEng *sel_eng = cr_sel_eng_new();
+        cr_sel_eng_set_node_iface(sel_eng, &Inkscape::XML::croco_node_iface);
+        Inkscape::XML::Node *const rect = _doc->getReprDoc()->createElement("svg:rect");
+        rect->setAttribute("class", "ab a");
+
+        CRPropList *props = NULL;
+        TS_ASSERT_EQUALS( _doc->style_index->matchedProperties(sel_eng, _doc->style_cascade, rect, &props), CR_OK );
+        TS_ASSERT_EQUALS( _doc->style_index->selectorCount(), 4u );
+        TS_ASSERT_EQUALS( _doc->style_index->fallbackCount(), 1u );
+
+        unsigned count = 0;
+        for (CRPropList *cur = props; cur; cur = cr_prop_list_get_next(cur)) {
+            count++;
+        }
+        TS_ASSERT_EQUALS( count, 2u ); // fill from .a, stroke from rect
+        if (props) {
+            cr_prop_list_destroy(props);
+        }
+
+        cr_sel_eng_destroy(sel_eng);
+        Inkscape::GC::release(rect);
+        delete style_elem;
+        Inkscape::GC::release(repr);
+    }
+
 };
 
 
@@ -5,6 +5,7 @@
 #include "sp-style-elem.h"
 #include "attributes.h"
 #include "style.h"
+#include "style-selector-index.h"
 using Inkscape::XML::TEXT_NODE;
 
 #include "sp-factory.h"
@@ -313,6 +314,7 @@ void SPStyleElem::read_content() {
     g_assert(sac_handler->app_data == &parse_tmp);
     if (parse_status == CR_OK) {
         cr_cascade_set_sheet(style_elem.document->style_cascade, stylesheet, ORIGIN_AUTHOR);
+        style_elem.document->style_index->invalidate();
     } else {
         if (parse_status != CR_PARSING_ERROR) {
             g_printerr("parsing error code=%u\n", unsigned(parse_status));
@@ -0,0 +1,225 @@
+/** \file
+ * Candidate lookup for the selectors of a document's style cascade.
+ */
+/*
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "style-selector-index.h"
+#include "xml/node.h"
+
+namespace {
+
+char const *string_of(CRString const *s)
+{
+    return ( s && s->stryng ) ? s->stryng->str : NULL;
+}
+
+bool is_class_space(char c)
+{
+    // the white-space production of CSS 2, as used by libcroco's class matching
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f';
+}
+
+char const *local_part(char const *qname)
+{
+    char const *colon = std::strrchr(qname, ':');
+    return colon ? colon + 1 : qname;
+}
+
+}
+
+namespace Inkscape {
+
+StyleSelectorIndex::StyleSelectorIndex()
+    : _valid(false)
+{
+    std::fill(_sheets, _sheets + NB_ORIGINS, static_cast<CRStyleSheet *>(NULL));
+}
+
+void StyleSelectorIndex::invalidate()
+{
+    _valid = false;
+}
+
+bool StyleSelectorIndex::_isCurrent(CRCascade *cascade) const
+{
+    if (!_valid) {
+        return false;
+    }
+    for (int origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
+        if (cr_cascade_get_sheet(cascade, CRStyleOrigin(origin)) != _sheets[origin]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void StyleSelectorIndex::_build(CRCascade *cascade)
+{
+    _rules.clear();
+    _by_id.clear();
+    _by_class.clear();
+    _by_name.clear();
+    _fallback.clear();
+
+    // Rules are numbered in the order libcroco visits them: by origin, then by
+    // statement, then by selector within the statement's comma separated list.
+    for (int origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
+        CRStyleSheet *sheet = cr_cascade_get_sheet(cascade, CRStyleOrigin(origin));
+        _sheets[origin] = sheet;
+        if (!sheet) {
+            continue;
+        }
+        for (CRStatement *stmt = sheet->statements; stmt; stmt = stmt->next) {
+            // @media rulesets are matched by libcroco but then never merged, so leave them out.
+            if (stmt->type != RULESET_STMT || !stmt->kind.ruleset || !stmt->parent_sheet) {
+                continue;
+            }
+            for (CRSelector *sel = stmt->kind.ruleset->sel_list; sel; sel = sel->next) {
+                if (sel->simple_sel) {
+                    _addRule(stmt, sel->simple_sel);
+                }
+            }
+        }
+    }
+    _valid = true;
+}
+
+void StyleSelectorIndex::_addRule(CRStatement *stmt, CRSimpleSel *sel)
+{
+    cr_simple_sel_compute_specificity(sel);
+    Rule const rule = { stmt, sel, sel->specificity };
+    unsigned const index = _rules.size();
+    _rules.push_back(rule);
+
+    CRSimpleSel *last = sel;
+    while (last->next) {
+        last = last->next;
+    }
+
+    // libcroco checks additional selectors from the last one backwards and accepts the
+    // compound as soon as a pseudo-class matches, so only those after the last
+    // pseudo-class are certain to be required.
+    CRAdditionalSel *tail = last->add_sel;
+    while (tail && tail->next) {
+        tail = tail->next;
+    }
+    char const *id = NULL;
+    char const *klass = NULL;
+    for (CRAdditionalSel *add = tail; add && add->type != PSEUDO_CLASS_ADD_SELECTOR; add = add->prev) {
+        if (add->type == ID_ADD_SELECTOR && !id) {
+            id = string_of(add->content.id_name);
+        } else if (add->type == CLASS_ADD_SELECTOR && !klass) {
+            klass = string_of(add->content.class_name);
+        }
+    }
+
+    char const *name = NULL;
+    if ((last->type_mask & TYPE_SELECTOR) && !(last->type_mask & UNIVERSAL_SELECTOR)) {
+        name = string_of(last->name);
+    }
+
+    if (id) {
+        _by_id[g_quark_from_string(id)].push_back(index);
+    } else if (klass) {
+        _by_class[g_quark_from_string(klass)].push_back(index);
+    } else if (name) {
+        _by_name[g_quark_from_string(name)].push_back(index);
+    } else {
+        _fallback.push_back(index);
+    }
+}
+
+void StyleSelectorIndex::_addCandidates(Buckets const &buckets, GQuark key, RuleList &candidates)
+{
+    if (!key) {
+        return;
+    }
+    Buckets::const_iterator found = buckets.find(key);
+    if (found != buckets.end()) {
+        candidates.insert(candidates.end(), found->second.begin(), found->second.end());
+    }
+}
+
+CRStatus StyleSelectorIndex::matchedProperties(CRSelEng *sel_eng, CRCascade *cascade,
+                                               XML::Node const *node, CRPropList **props)
+{
+    g_return_val_if_fail(sel_eng && cascade && node && props, CR_BAD_PARAM_ERROR);
+
+    if (!_isCurrent(cascade)) {
+        _build(cascade);
+    }
+    if (_rules.empty() || node->type() != XML::ELEMENT_NODE) {
+        return CR_OK;
+    }
+
+    _candidates.assign(_fallback.begin(), _fallback.end());
+    if (!_by_id.empty()) {
+        if (char const *id = node->attribute("id")) {
+            _addCandidates(_by_id, g_quark_try_string(id), _candidates);
+        }
+    }
+    if (!_by_class.empty()) {
+        if (char const *classes = node->attribute("class")) {
+            std::string klass;
+            for (char const *p = classes; *p; ) {
+                while (*p && is_class_space(*p)) {
+                    p++;
+                }
+                char const *start = p;
+                while (*p && !is_class_space(*p)) {
+                    p++;
+                }
+                if (p != start) {
+                    klass.assign(start, p);
+                    _addCandidates(_by_class, g_quark_try_string(klass.c_str()), _candidates);
+                }
+            }
+        }
+    }
+    if (!_by_name.empty()) {
+        _addCandidates(_by_name, g_quark_try_string(local_part(node->name())), _candidates);
+    }
+    if (_candidates.empty()) {
+        return CR_OK;
+    }
+
+    // A class listed twice brings its rules in twice; libcroco tries each selector once.
+    std::sort(_candidates.begin(), _candidates.end());
+    _candidates.erase(std::unique(_candidates.begin(), _candidates.end()), _candidates.end());
+
+    _matched.clear();
+    for (RuleList::const_iterator i = _candidates.begin(); i != _candidates.end(); ++i) {
+        Rule const &rule = _rules[*i];
+        gboolean matches = FALSE;
+        CRStatus status = cr_sel_eng_matches_node(sel_eng, rule.sel, node, &matches);
+        if (status == CR_OK && matches) {
+            // As libcroco does, the statement carries the specificity of the last of
+            // its selectors that matched.
+            rule.stmt->specificity = rule.specificity;
+            _matched.push_back(rule.stmt);
+        }
+    }
+    if (_matched.empty()) {
+        return CR_OK;
+    }
+    return cr_sel_eng_merge_matched_rulesets(&_matched[0], _matched.size(), props);
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
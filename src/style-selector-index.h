@@ -0,0 +1,94 @@
+#ifndef SEEN_INKSCAPE_STYLE_SELECTOR_INDEX_H
+#define SEEN_INKSCAPE_STYLE_SELECTOR_INDEX_H
+
+/** \file
+ * Candidate lookup for the selectors of a document's style cascade.
+ */
+/*
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <vector>
+#include <glib.h>
+#include "libcroco/cr-cascade.h"
+#include "libcroco/cr-sel-eng.h"
+#include "util/unordered-containers.h"
+
+namespace Inkscape {
+
+namespace XML {
+class Node;
+}
+
+/**
+ * Index of the rulesets in a CRCascade, keyed by what their selectors require.
+ *
+ * Each selector is filed under the id, class or element name that its rightmost
+ * compound needs; the rest go on a fallback list which is tried for every node.
+ * Only the candidates for a node are run through the libcroco selector engine, in
+ * cascade order, so the result is the same as walking every ruleset of the cascade.
+ *
+ * The index is built on first use and must be invalidated whenever one of the
+ * cascade's stylesheets is replaced.
+ */
+class StyleSelectorIndex {
+public:
+    StyleSelectorIndex();
+
+    /** Drops the index; it is rebuilt from the cascade on the next lookup. */
+    void invalidate();
+
+    /**
+     * Merges the declarations of the rulesets matching \a node into \a props,
+     * like cr_sel_eng_get_matched_properties_from_cascade() does.
+     */
+    CRStatus matchedProperties(CRSelEng *sel_eng, CRCascade *cascade,
+                               XML::Node const *node, CRPropList **props);
+
+    /** Number of selectors in the index, including the fallback ones. */
+    unsigned selectorCount() const { return _rules.size(); }
+    /** Number of selectors that have to be tried on every node. */
+    unsigned fallbackCount() const { return _fallback.size(); }
+
+private:
+    struct Rule {
+        CRStatement *stmt;
+        CRSimpleSel *sel;
+        gulong specificity;
+    };
+    typedef std::vector<unsigned> RuleList;
+    typedef INK_UNORDERED_MAP<GQuark, RuleList> Buckets;
+
+    StyleSelectorIndex(StyleSelectorIndex const &); // no copy
+    void operator=(StyleSelectorIndex const &); // no assign
+
+    bool _isCurrent(CRCascade *cascade) const;
+    void _build(CRCascade *cascade);
+    void _addRule(CRStatement *stmt, CRSimpleSel *sel);
+    static void _addCandidates(Buckets const &buckets, GQuark key, RuleList &candidates);
+
+    bool _valid;
+    CRStyleSheet *_sheets[NB_ORIGINS];
+    std::vector<Rule> _rules;
+    Buckets _by_id;
+    Buckets _by_class;
+    Buckets _by_name;
+    RuleList _fallback;
+    RuleList _candidates;
+    std::vector<CRStatement *> _matched;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_STYLE_SELECTOR_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -5,6 +5,9 @@
 
 #include "test-helpers.h"
 
+#include <cstring>
+#include <string>
+
 #include "style.h"
 
 class StyleTest : public CxxTest::TestSuite
@@ -118,6 +121,55 @@ public:
         }
     }
 
+    void testSharedTextStyles()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg'>"
+            "<rect id='a' style='font-family:Serif'/>"
+            "<rect id='b' font-family='Serif'/>"
+            "<rect id='c'/>"
+            "</svg>";
+        SPDocument *doc = SPDocument::createNewDocFromMem(svg, strlen(svg), false);
+        TS_ASSERT(doc);
+        if ( !doc ) {
+            return;
+        }
+
+        SPObject *a = doc->getObjectById("a");
+        SPObject *b = doc->getObjectById("b");
+        SPObject *c = doc->getObjectById("c");
+        TS_ASSERT(a && b && c);
+        if ( a && b && c ) {
+            TS_ASSERT_EQUALS( a->style->text, b->style->text );
+            TS_ASSERT_DIFFERS( a->style->text, c->style->text );
+            TS_ASSERT_EQUALS( std::string(c->style->text->font_family.value), std::string("sans-serif") );
+
+            SPStyleMemoryStats const stats = sp_style_memory_stats();
+            TS_ASSERT( stats.unshared_bytes > stats.bytes );
+        }
+
+        doc->doUnref();
+    }
+
+    void testMemoryStatsCountPrivateTextStyles()
+    {
+        SPStyleMemoryStats const before = sp_style_memory_stats();
+
+        // a free-standing style keeps a text style of its own
+        std::string const family(1000, 'x');
+        SPStyle *style = sp_style_new(NULL);
+        sp_style_merge_from_style_string(style, ("font-family:" + family).c_str());
+
+        SPStyleMemoryStats const after = sp_style_memory_stats();
+        TS_ASSERT_EQUALS( after.styles, before.styles + 1 );
+        TS_ASSERT_EQUALS( after.text_styles, before.text_styles + 1 );
+        TS_ASSERT_EQUALS( after.shared_text_styles, before.shared_text_styles );
+        TS_ASSERT_LESS_THAN_EQUALS( before.bytes + family.size(), after.bytes );
+
+        sp_style_unref(style);
+        TS_ASSERT_EQUALS( sp_style_memory_stats().bytes, before.bytes );
+    }
+
 };
 
 
@@ -42,10 +42,12 @@
 #include "streq.h"
 #include "strneq.h"
 #include "style.h"
+#include "style-selector-index.h"
 #include "svg/css-ostringstream.h"
 #include "xml/repr.h"
 #include "xml/simple-document.h"
 #include "util/units.h"
+#include "util/unordered-containers.h"
 #include "macros.h"
 #include "preferences.h"
 
@@ -79,9 +81,10 @@ static void sp_style_read_dash(SPStyle *style, gchar const *str);
 static SPTextStyle *sp_text_style_new(void);
 static void sp_text_style_clear(SPTextStyle *ts);
 static SPTextStyle *sp_text_style_unref(SPTextStyle *st);
-static SPTextStyle *sp_text_style_duplicate_unset(SPTextStyle *st);
+static SPTextStyle *sp_text_style_duplicate(SPTextStyle const *st);
 static guint sp_text_style_write(gchar *p, guint len, SPTextStyle const *st, guint flags = SP_STYLE_FLAG_IFSET);
 static void sp_style_privatize_text(SPStyle *style);
+static void sp_style_share_text(SPStyle *style);
 
 static void sp_style_read_ifloat(SPIFloat *val, gchar const *str);
 static void sp_style_read_iscale24(SPIScale24 *val, gchar const *str);
@@ -489,6 +492,67 @@ sp_style_stroke_paint_server_ref_changed(SPObject *old_ref, SPObject *ref, SPSty
     sp_style_paint_server_ref_modified(ref, 0, style);
 }
 
+namespace {
+
+/// Number of live SPStyle objects, for sp_style_memory_stats().
+std::size_t live_styles = 0;
+
+bool istring_equal(SPIString const &a, SPIString const &b)
+{
+    return a.set == b.set && a.inherit == b.inherit && !g_strcmp0(a.value, b.value);
+}
+
+guint istring_hash(SPIString const &s)
+{
+    return ( s.value ? g_str_hash(s.value) : 0 ) * 4 + s.set * 2 + s.inherit;
+}
+
+struct TextStyleHash {
+    std::size_t operator()(SPTextStyle const *ts) const {
+        return ( istring_hash(ts->font_family) * 31 + istring_hash(ts->font_specification) ) * 31
+            + istring_hash(ts->font);
+    }
+};
+
+struct TextStyleEqual {
+    bool operator()(SPTextStyle const *a, SPTextStyle const *b) const {
+        return istring_equal(a->font_family, b->font_family)
+            && istring_equal(a->font_specification, b->font_specification)
+            && istring_equal(a->font, b->font);
+    }
+};
+
+typedef INK_UNORDERED_SET<SPTextStyle *, TextStyleHash, TextStyleEqual> TextStyleTable;
+
+/// Text styles shared by value among object styles; they are never modified.
+TextStyleTable &shared_text_styles()
+{
+    static TextStyleTable table;
+    return table;
+}
+
+typedef INK_UNORDERED_SET<SPTextStyle *> TextStyleSet;
+
+/// Live text styles that belong to a single style, for sp_style_memory_stats().
+TextStyleSet &private_text_styles()
+{
+    static TextStyleSet styles;
+    return styles;
+}
+
+std::size_t istring_bytes(SPIString const &s)
+{
+    return s.value ? strlen(s.value) + 1 : 0;
+}
+
+std::size_t text_style_bytes(SPTextStyle const *ts)
+{
+    return sizeof(SPTextStyle) + istring_bytes(ts->font_family) + istring_bytes(ts->font_specification)
+        + istring_bytes(ts->font);
+}
+
+}
+
 /**
  * Returns a new SPStyle object with settings as per sp_style_clear().
  */
@@ -496,6 +560,7 @@ SPStyle *
 sp_style_new(SPDocument *document)
 {
     SPStyle *const style = g_new0(SPStyle, 1);
+    live_styles++;
 
     style->refcount = 1;
     style->object = NULL;
@@ -602,11 +667,39 @@ sp_style_unref(SPStyle *style)
         }
 
         g_free(style);
+        live_styles--;
         return NULL;
     }
     return style;
 }
 
+/**
+ * Memory used by all live styles, and what their text styles would take if none were shared.
+ */
+SPStyleMemoryStats
+sp_style_memory_stats()
+{
+    SPStyleMemoryStats stats;
+    stats.styles = live_styles;
+    stats.text_styles = private_text_styles().size() + shared_text_styles().size();
+    stats.shared_text_styles = shared_text_styles().size();
+    stats.bytes = live_styles * sizeof(SPStyle);
+
+    TextStyleSet const &own = private_text_styles();
+    for (TextStyleSet::const_iterator i = own.begin(); i != own.end(); ++i) {
+        stats.bytes += text_style_bytes(*i);
+    }
+    stats.unshared_bytes = stats.bytes;
+
+    TextStyleTable const &table = shared_text_styles();
+    for (TextStyleTable::const_iterator i = table.begin(); i != table.end(); ++i) {
+        std::size_t const size = text_style_bytes(*i);
+        stats.bytes += size;
+        stats.unshared_bytes += (*i)->refcount * size;
+    }
+    return stats;
+}
+
 /**
  *  Reads the various style parameters for an object from repr.
  */
@@ -788,7 +881,7 @@ sp_style_read(SPStyle *style, SPObject *object, Inkscape::XML::Node *repr)
     }
 
     /* -inkscape-font-specification */
-    if (!style->text_private || !style->text->font_specification.set) {
+    if (!style->text->font_specification.set) {
         val = repr->attribute("-inkscape-font-specification");
         if (val) {
             if (!style->text_private) sp_style_privatize_text(style);
@@ -799,7 +892,7 @@ sp_style_read(SPStyle *style, SPObject *object, Inkscape::XML::Node *repr)
     }
 
     /* font-family */
-    if (!style->text_private || !style->text->font_family.set) {
+    if (!style->text->font_family.set) {
         val = repr->attribute("font-family");
         if (val) {
             if (!style->text_private) sp_style_privatize_text(style);
@@ -863,6 +956,7 @@ sp_style_read_from_object(SPStyle *style, SPObject *object)
     g_return_if_fail(repr != NULL);
 
     sp_style_read(style, object, repr);
+    sp_style_share_text(style);
 }
 
 
@@ -899,17 +993,45 @@ sp_style_read_from_prefs(SPStyle *style, Glib::ustring const &path)
 
 
 /**
- *
+ * Gives style its own copy of its text style, so that it can be modified.
  */
 static void
 sp_style_privatize_text(SPStyle *style)
 {
     SPTextStyle *text = style->text;
-    style->text = sp_text_style_duplicate_unset(style->text);
+    style->text = sp_text_style_duplicate(style->text);
     sp_text_style_unref(text);
     style->text_private = TRUE;
 }
 
+/**
+ * Replaces the text style of an object's style by the shared one with the same values.
+ *
+ * Most objects end up with the same font family and specification, inherited from
+ * the root, so this keeps one copy of them instead of one per object.  A shared text
+ * style is never written to; sp_style_privatize_text() has to be called first.
+ */
+static void
+sp_style_share_text(SPStyle *style)
+{
+    if (!style->text || !style->text_private) {
+        return;
+    }
+
+    TextStyleTable &table = shared_text_styles();
+    TextStyleTable::iterator found = table.find(style->text);
+    if (found == table.end()) {
+        private_text_styles().erase(style->text);
+        style->text->shared = TRUE;
+        table.insert(style->text);
+    } else {
+        (*found)->refcount += 1;
+        sp_text_style_unref(style->text);
+        style->text = *found;
+    }
+    style->text_private = FALSE;
+}
+
 
 /**
  * Merge property into style.
@@ -1492,10 +1614,10 @@ sp_style_merge_from_object_stylesheet(SPStyle *const style, SPObject const *cons
     CRPropList *props = NULL;
 
     //XML Tree being directly used here while it shouldn't be.
-    CRStatus status = cr_sel_eng_get_matched_properties_from_cascade(sel_eng,
-                                                                     object->document->style_cascade,
-                                                                     object->getRepr(),
-                                                                     &props);
+    CRStatus status = object->document->style_index->matchedProperties(sel_eng,
+                                                                       object->document->style_cascade,
+                                                                       object->getRepr(),
+                                                                       &props);
     g_return_if_fail(status == CR_OK);
     /// \todo Check what errors can occur, and handle them properly.
     if (props) {
@@ -1851,14 +1973,20 @@ sp_style_merge_from_parent(SPStyle *const style, SPStyle const *const parent)
     }
 
     if (style->text && parent->text) {
-        if (!style->text->font_family.set || style->text->font_family.inherit) {
+        if ((!style->text->font_family.set || style->text->font_family.inherit)
+            && g_strcmp0(style->text->font_family.value, parent->text->font_family.value))
+        {
+            if (!style->text_private) sp_style_privatize_text(style);
             g_free(style->text->font_family.value);
             style->text->font_family.value = g_strdup(parent->text->font_family.value);
         }
     }
 
     if (style->text && parent->text) {
-        if (!style->text->font_specification.set || style->text->font_specification.inherit) {
+        if ((!style->text->font_specification.set || style->text->font_specification.inherit)
+            && g_strcmp0(style->text->font_specification.value, parent->text->font_specification.value))
+        {
+            if (!style->text_private) sp_style_privatize_text(style);
             g_free(style->text->font_specification.value);
             style->text->font_specification.value = g_strdup(parent->text->font_specification.value);
         }
@@ -1891,6 +2019,11 @@ sp_style_merge_from_parent(SPStyle *const style, SPStyle const *const parent)
         style->color_rendering.computed = parent->color_rendering.computed;
     }
 
+    // Free-standing styles (queries, preferences) keep their own text style, since
+    // their users write to it directly.
+    if (style->object) {
+        sp_style_share_text(style);
+    }
 }
 
 template <typename T>
@@ -2289,6 +2422,7 @@ sp_style_merge_from_dying_parent(SPStyle *const style, SPStyle const *const pare
     /* Font */
 
     if (style->text && parent->text) {
+        if (!style->text_private) sp_style_privatize_text(style);
         sp_style_merge_string_prop_from_dying_parent(style->text->font_specification,
                                                      parent->text->font_specification);
 
@@ -3047,6 +3181,7 @@ sp_style_clear(SPStyle *style)
     style->text = text;
     style->text_private = text_private;
 
+    if (!style->text_private) sp_style_privatize_text(style);
     style->text->font_specification.set = FALSE;
     style->text->font.set = FALSE;
     style->text->font_family.set = FALSE;
@@ -3320,6 +3455,7 @@ sp_text_style_new()
 {
     SPTextStyle *ts = g_new0(SPTextStyle, 1);
     ts->refcount = 1;
+    private_text_styles().insert(ts);
     sp_text_style_clear(ts);
 
     ts->font_specification.value = g_strdup("sans-serif");
@@ -3352,6 +3488,11 @@ sp_text_style_unref(SPTextStyle *st)
     st->refcount -= 1;
 
     if (st->refcount < 1) {
+        if (st->shared) {
+            shared_text_styles().erase(st);
+        } else {
+            private_text_styles().erase(st);
+        }
         g_free(st->font_specification.value);
         g_free(st->font.value);
         g_free(st->font_family.value);
@@ -3364,16 +3505,20 @@ sp_text_style_unref(SPTextStyle *st)
 
 
 /**
- * Return duplicate of text style.
+ * Return unshared duplicate of text style.
  */
 static SPTextStyle *
-sp_text_style_duplicate_unset(SPTextStyle *st)
+sp_text_style_duplicate(SPTextStyle const *st)
 {
     SPTextStyle *nt = g_new0(SPTextStyle, 1);
     nt->refcount = 1;
+    private_text_styles().insert(nt);
 
+    nt->font_specification = st->font_specification;
     nt->font_specification.value = g_strdup(st->font_specification.value);
+    nt->font = st->font;
     nt->font.value = g_strdup(st->font.value);
+    nt->font_family = st->font_family;
     nt->font_family.value = g_strdup(st->font_family.value);
 
     return nt;
@@ -4791,10 +4936,10 @@ sp_style_unset_property_attrs(SPObject *o)
     if (style->stroke_dashoffset_set) {
         repr->setAttribute("stroke-dashoffset", NULL);
     }
-    if (style->text_private && style->text->font_specification.set) {
+    if (style->text->font_specification.set) {
         repr->setAttribute("-inkscape-font-specification", NULL);
     }
-    if (style->text_private && style->text->font_family.set) {
+    if (style->text->font_family.set) {
         repr->setAttribute("font-family", NULL);
     }
     if (style->text_anchor.set) {
@@ -24,6 +24,7 @@
 #include "sp-paint-server-reference.h"
 
 #include <stddef.h>
+#include <cstddef>
 #include <sigc++/connection.h>
 
 namespace Inkscape {
@@ -286,6 +287,7 @@ struct SPStyle {
 
     /** Our text style component */
     SPTextStyle *text;
+    /** Whether text belongs to this style alone; if not, it has to be privatized before writing */
     unsigned text_private : 1;
 
     /* CSS2 */
@@ -450,6 +452,22 @@ SPStyle *sp_style_ref(SPStyle *style);
 
 SPStyle *sp_style_unref(SPStyle *style);
 
+/**
+ * Memory taken by live SPStyle objects and their text styles, with the strings of both
+ * private and shared text styles. Only text styles are shared; the rest of an SPStyle,
+ * and the marker, dash and reference data it owns, belongs to its object and is not
+ * counted beyond sizeof(SPStyle).
+ */
+struct SPStyleMemoryStats {
+    std::size_t styles;
+    std::size_t text_styles;
+    std::size_t shared_text_styles;
+    std::size_t bytes;
+    std::size_t unshared_bytes; ///< bytes if every style had its own text style
+};
+
+SPStyleMemoryStats sp_style_memory_stats();
+
 void sp_style_read_from_object(SPStyle *style, SPObject *object);
 
 void sp_style_read_from_prefs(SPStyle *style, Glib::ustring const &path);
@@ -649,6 +667,8 @@ enum SPTextRendering {
 /// An SPTextStyle has a refcount, a font family, and a font name.
 struct SPTextStyle {
     int refcount;
+    /** Shared by value among styles; must not be modified (see text_private) */
+    unsigned shared : 1;
 
     /* CSS font properties */
     SPIString font_family;
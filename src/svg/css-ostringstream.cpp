@@ -1,5 +1,5 @@
 #include "svg/css-ostringstream.h"
-#include "svg/strip-trailing-zeros.h"
+#include "svg/svg.h"
 #include "preferences.h"
 #include <glib.h>
 
@@ -20,21 +20,9 @@ Inkscape::CSSOStringStream::CSSOStringStream()
 static void
 write_num(Inkscape::CSSOStringStream &os, unsigned const prec, double const d)
 {
-    char buf[32];  // haven't thought about how much is really required.
-    switch (prec) {
-        case 9: g_ascii_formatd(buf, sizeof(buf), "%.9f", d); break;
-        case 8: g_ascii_formatd(buf, sizeof(buf), "%.8f", d); break;
-        case 7: g_ascii_formatd(buf, sizeof(buf), "%.7f", d); break;
-        case 6: g_ascii_formatd(buf, sizeof(buf), "%.6f", d); break;
-        case 5: g_ascii_formatd(buf, sizeof(buf), "%.5f", d); break;
-        case 4: g_ascii_formatd(buf, sizeof(buf), "%.4f", d); break;
-        case 3: g_ascii_formatd(buf, sizeof(buf), "%.3f", d); break;
-        case 2: g_ascii_formatd(buf, sizeof(buf), "%.2f", d); break;
-        case 1: g_ascii_formatd(buf, sizeof(buf), "%.1f", d); break;
-        case 0: g_ascii_formatd(buf, sizeof(buf), "%.0f", d); break;
-        case 10: default: g_ascii_formatd(buf, sizeof(buf), "%.10f", d); break;
-    }
-    os << strip_trailing_zeros(buf);
+    char buf[32];
+    sp_svg_number_write_f(buf, sizeof(buf), d, prec > 10 ? 10 : prec);
+    os << buf;
 }
 
 Inkscape::CSSOStringStream &
@@ -156,10 +156,12 @@ void Inkscape::SVG::PathString::State::appendNumber(double v, int precision, int
 }
 
 void Inkscape::SVG::PathString::State::appendNumber(double v, double &rv, int precision, int minexp) {
+    size_t const reserve = precision+1+1+1+1+3;
     size_t const oldsize = str.size();
-    appendNumber(v, precision, minexp);
-    char* begin_of_num = const_cast<char*>(str.data()+oldsize); // Slightly evil, I know (but std::string should be storing its data in one big block of memory, so...)
-    sp_svg_number_read_d(begin_of_num, &rv);
+    str.append(reserve, (char)0);
+    char* begin_of_num = const_cast<char*>(str.data()+oldsize);
+    size_t added = sp_svg_number_write_de(begin_of_num, reserve, v, precision, minexp, &rv); // rv is the value as written, no need to parse it back
+    str.resize(oldsize+added);
 }
 
 /*
@@ -1,5 +1,5 @@
 #include "svg/stringstream.h"
-#include "svg/strip-trailing-zeros.h"
+#include "svg/svg.h"
 #include "preferences.h"
 #include <2geom/point.h>
 
@@ -29,12 +29,9 @@ operator<<(Inkscape::SVGOStringStream &os, float d)
         }
     }
 
-    std::ostringstream s;
-    s.imbue(std::locale::classic());
-    s.flags(os.setf(std::ios::showpoint));
-    s.precision(os.precision());
-    s << d;
-    os << strip_trailing_zeros(s.str());
+    char buf[32];
+    sp_svg_number_write_g(buf, sizeof(buf), d, os.precision());
+    os << buf;
     return os;
 }
 
@@ -50,12 +47,9 @@ operator<<(Inkscape::SVGOStringStream &os, double d)
         }
     }
 
-    std::ostringstream s;
-    s.imbue(std::locale::classic());
-    s.flags(os.setf(std::ios::showpoint));
-    s.precision(os.precision());
-    s << d;
-    os << strip_trailing_zeros(s.str());
+    char buf[32];
+    sp_svg_number_write_g(buf, sizeof(buf), d, os.precision());
+    os << buf;
     return os;
 }
 
@@ -1,8 +1,10 @@
 #include <cxxtest/TestSuite.h>
 
 #include "svg/svg-length.h"
+#include "svg/svg.h"
 #include <glib.h>
 #include <utility>
+#include <vector>
 
 // function internal to svg-length.cpp:
 gchar const *sp_svg_length_get_css_units(SVGLength::Unit unit);
@@ -155,6 +157,148 @@ public:
         }
     }
 
+    void testPlacesValue()
+    {
+        testd_t const precTests[] = {
+            {"760", 761.92918978947023, 2, -8},
+            {"761.9", 761.92918978947023, 4, -8},
+            {"-0.00123", -0.00123456, 5, -8},
+            {"1.2346e-6", 1.23456e-6, 5, -8},
+            {"0", 1.23456e-9, 5, -8},
+            {"1e23", 9.99999999999999e22, 8, -8},
+        };
+
+        for ( size_t i = 0; i < G_N_ELEMENTS(precTests); i++ ) {
+            char buf[256] = {0};
+            double rval = -1;
+            unsigned int retval = sp_svg_number_write_de( buf, sizeof(buf), precTests[i].val, precTests[i].prec, precTests[i].minexp, &rval );
+            TSM_ASSERT_EQUALS("Numeric string written", std::string(buf, retval), std::string(precTests[i].str));
+            TSM_ASSERT_EQUALS(std::string("Value written ") + precTests[i].str, rval, g_ascii_strtod(precTests[i].str, NULL));
+        }
+    }
+
+    void testLargeExponents()
+    {
+        testd_t const expTests[] = {
+            {"-1.2345678e300", -1.2345678e300, 8, -8},
+            {"-9.8765432e-200", -9.87654321e-200, 8, -300},
+            {"1e100", 1e100, 8, -8},
+            {"1.5e-150", 1.5e-150, 6, -300},
+        };
+
+        for ( size_t i = 0; i < G_N_ELEMENTS(expTests); i++ ) {
+            // as much room as PathString gives, with nothing spare for a terminator
+            size_t const reserve = expTests[i].prec + 7;
+            char buf[64];
+            memset(buf, 0xCC, sizeof(buf));
+            double rval = -1;
+            unsigned int retval = sp_svg_number_write_de( buf, reserve, expTests[i].val, expTests[i].prec, expTests[i].minexp, &rval );
+            TSM_ASSERT_EQUALS("Numeric string written", std::string(buf, retval), std::string(expTests[i].str));
+            TSM_ASSERT_EQUALS(std::string("Value written ") + expTests[i].str, rval, g_ascii_strtod(expTests[i].str, NULL));
+            TSM_ASSERT_EQUALS(std::string("Buffer overrun ") + expTests[i].str, '\xCC', buf[reserve]);
+        }
+    }
+
+    void testHalfWayRounding()
+    {
+        // exact half-way values round away from zero in SVG output, as they always have
+        testd_t const deTests[] = {
+            {"3", 2.5, 1, -8},
+            {"-3", -2.5, 1, -8},
+            {"0.13", 0.125, 2, -8},
+            {"3e10", 2.5e10, 1, -8},
+        };
+        for ( size_t i = 0; i < G_N_ELEMENTS(deTests); i++ ) {
+            char buf[32];
+            unsigned int retval = sp_svg_number_write_de( buf, sizeof(buf), deTests[i].val, deTests[i].prec, deTests[i].minexp );
+            TSM_ASSERT_EQUALS(deTests[i].str, std::string(buf, retval), std::string(deTests[i].str));
+        }
+
+        // ...while the printf replacements go to the even neighbour like printf
+        char buf[32];
+        TS_ASSERT_EQUALS(std::string(buf, sp_svg_number_write_g( buf, sizeof(buf), 2.5, 1 )), "2");
+        TS_ASSERT_EQUALS(std::string(buf, sp_svg_number_write_f( buf, sizeof(buf), 0.125, 2 )), "0.12");
+    }
+
+    void testWriteSpeed()
+    {
+        unsigned const count = 200000;
+        std::vector<double> values(count);
+        GRand *rand = g_rand_new_with_seed(1);
+        for ( unsigned i = 0; i < count; i++ ) {
+            values[i] = g_rand_double_range(rand, -1000, 1000);
+        }
+        g_rand_free(rand);
+
+        // what PathString did before: write the number, then read it back
+        GTimer *timer = g_timer_new();
+        double sum_old = 0;
+        for ( unsigned i = 0; i < count; i++ ) {
+            char buf[32];
+            double rval;
+            sp_svg_number_write_de( buf, sizeof(buf), values[i], 8, -8 );
+            sp_svg_number_read_d( buf, &rval );
+            sum_old += rval;
+        }
+        double const old_time = g_timer_elapsed(timer, NULL);
+
+        g_timer_start(timer);
+        double sum_new = 0;
+        for ( unsigned i = 0; i < count; i++ ) {
+            char buf[32];
+            double rval;
+            sp_svg_number_write_de( buf, sizeof(buf), values[i], 8, -8, &rval );
+            sum_new += rval;
+        }
+        double const new_time = g_timer_elapsed(timer, NULL);
+
+        g_timer_start(timer);
+        for ( unsigned i = 0; i < count; i++ ) {
+            char buf[32];
+            g_ascii_formatd( buf, sizeof(buf), "%.8g", values[i] );
+        }
+        double const printf_time = g_timer_elapsed(timer, NULL);
+        g_timer_destroy(timer);
+
+        // the value handed back is the one the number reads back as
+        TS_ASSERT_EQUALS(sum_new, sum_old);
+
+        gchar *report = g_strdup_printf("%u numbers: write and read back %.1fms, write with value %.1fms, g_ascii_formatd %.1fms",
+                                        count, old_time * 1000, new_time * 1000, printf_time * 1000);
+        TS_TRACE(report);
+        g_free(report);
+    }
+
+    void testPrintfFormats()
+    {
+        testd_t const gTests[] = {
+            {"3e+09", 3e9, 8, 0},
+            {"3.2768e+13", 3.2768e13, 8, 0},
+            {"0.33333333", 1./3, 8, 0},
+            {"-1.5e-05", -1.5e-5, 8, 0},
+            {"1e+03", 999.96, 3, 0},
+            {"0.12345679", 0.123456789, 8, 0},
+        };
+        for ( size_t i = 0; i < G_N_ELEMENTS(gTests); i++ ) {
+            char buf[32];
+            unsigned int retval = sp_svg_number_write_g( buf, sizeof(buf), gTests[i].val, gTests[i].prec );
+            TSM_ASSERT_EQUALS(gTests[i].str, std::string(buf, retval), std::string(gTests[i].str));
+        }
+
+        testd_t const fTests[] = {
+            {"0.0000003", 3e-7, 8, 0},
+            {"0", 3e-9, 8, 0},
+            {"-2.5", -2.5, 8, 0},
+            {"1234.57", 1234.5678, 2, 0},
+            {"0.1", 0.1, 10, 0},
+        };
+        for ( size_t i = 0; i < G_N_ELEMENTS(fTests); i++ ) {
+            char buf[32];
+            unsigned int retval = sp_svg_number_write_f( buf, sizeof(buf), fTests[i].val, fTests[i].prec );
+            TSM_ASSERT_EQUALS(fTests[i].str, std::string(buf, retval), std::string(fTests[i].str));
+        }
+    }
+
     // TODO: More tests
 };
 
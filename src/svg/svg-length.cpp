@@ -99,63 +99,173 @@ static unsigned int sp_svg_number_write_i(gchar *buf, int bufLen, int val)
     return p;
 }
 
-// TODO unsafe code ingnoring bufLen
-// rewrite using std::string?
-static unsigned sp_svg_number_write_d(gchar *buf, int bufLen, double val, unsigned int tprec, unsigned int fprec)
+/*
+ * Locale independent number formatting.
+ *
+ * A value is first rounded to an integer mantissa of decimal digits, which is then written
+ * out directly. This avoids the locale machinery of printf and iostreams, and the repeated
+ * floating point operations of extracting one digit at a time. As long as the scale factor
+ * is an exactly representable power of ten (up to 10^22) and the mantissa stays below 2^52,
+ * both the digits and the value read back from them are correctly rounded. Other values
+ * are left to g_ascii_formatd.
+ */
+
+static double const sp_svg_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static int const SP_SVG_POW10_MAX = 22;
+static double const SP_SVG_EXACT_SCALED_MAX = 4503599627370496.0; // 2^52, so that x.5 is representable
+
+/**
+ * Rounds val * 10^shift (val >= 0) to the nearest integer. Half-way cases go to the even
+ * neighbour like printf does if ties_to_even, and up otherwise, like the SVG writer always did.
+ * @return false if the result cannot be rounded exactly
+ */
+static bool sp_svg_number_scale(double val, int shift, bool ties_to_even, double &mantissa, double *scaled_out = NULL)
 {
-    /* Process sign */
-    int i = 0;
-    if (val < 0.0) {
-        buf[i++] = '-';
-        val = fabs(val);
-    }
-
-    /* Determine number of integral digits */
-    int idigits = 0;
-    if (val >= 1.0) {
-        idigits = (int) floor(log10(val)) + 1;
-    }
-
-    /* Determine the actual number of fractional digits */
-    fprec = MAX(static_cast<int>(fprec), static_cast<int>(tprec) - idigits);
-    /* Round value */
-    val += 0.5 / pow(10.0, fprec);
-    /* Extract integral and fractional parts */
-    double dival = floor(val);
-    double fval = val - dival;
-    /* Write integra */
-    if (idigits > (int)tprec) {
-        i += sp_svg_number_write_ui(buf + i, (unsigned int)floor(dival/pow(10.0, idigits-tprec) + .5));
-        for(unsigned int j=0; j<(unsigned int)idigits-tprec; j++) {
-            buf[i+j] = '0';
+    if (shift > SP_SVG_POW10_MAX || shift < -SP_SVG_POW10_MAX) {
+        return false;
+    }
+    double const p = sp_svg_pow10[shift >= 0 ? shift : -shift];
+    double const scaled = shift >= 0 ? val * p : val / p;
+    if (scaled >= SP_SVG_EXACT_SCALED_MAX) {
+        return false;
+    }
+    if (scaled_out) {
+        *scaled_out = scaled;
+    }
+
+    mantissa = floor(scaled);
+    double const frac = scaled - mantissa;
+    if (frac > 0.5) {
+        mantissa += 1.0;
+    } else if (frac == 0.5) {
+        // The scaled value may have been rounded onto the half-way point; the exact
+        // rounding error of the multiplication or division tells which side it was on.
+        double const err = shift >= 0 ? fma(val, p, -scaled) : fma(-scaled, p, val);
+        if (err > 0.0 || (err == 0.0 && (!ties_to_even || fmod(mantissa, 2.0) != 0.0))) {
+            mantissa += 1.0;
         }
-        i += idigits-tprec;
+    }
+    return true;
+}
+
+/**
+ * Rounds |val| (non-zero) to prec significant digits.
+ * On success |val| is approximately mantissa * 10^(exp10 - prec + 1), where
+ * 10^(prec-1) <= mantissa < 10^prec.
+ */
+static bool sp_svg_number_significant(double val, unsigned int prec, bool ties_to_even, double &mantissa, int &exp10)
+{
+    if (prec < 1 || prec > 16) {
+        return false;
+    }
+    val = fabs(val);
+    exp10 = (int) floor(log10(val));
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        double scaled;
+        if (!sp_svg_number_scale(val, (int) prec - 1 - exp10, ties_to_even, mantissa, &scaled)) {
+            return false;
+        }
+        if (mantissa >= sp_svg_pow10[prec]) {
+            // log10 was rounded down, or rounding carried into a new digit
+            ++exp10;
+        } else if (scaled < sp_svg_pow10[prec - 1]) {
+            // log10 was rounded up
+            --exp10;
+        } else {
+            return true;
+        }
+    }
+    // 9.99..95 style carries end up here with mantissa == 10^prec
+    if (mantissa == sp_svg_pow10[prec]) {
+        mantissa = sp_svg_pow10[prec - 1];
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Writes the integer mantissa as a decimal number with the given number of fractional
+ * digits (negative values append zeros), dropping trailing fractional zeros.
+ */
+static unsigned int sp_svg_number_write_mantissa(gchar *buf, double mantissa, int decimals)
+{
+    char digits[24];
+    int n = 0;
+    guint64 m = (guint64) mantissa;
+    do {
+        digits[n++] = '0' + (char) (m % 10);
+        m /= 10;
+    } while (m > 0);
+    // digits[] now holds the digits in reverse order
+
+    unsigned int p = 0;
+    int const intdigits = n - MAX(decimals, 0);
+    if (intdigits <= 0 || mantissa == 0.0) {
+        buf[p++] = '0';
     } else {
-        i += sp_svg_number_write_ui(buf + i, (unsigned int)dival);
-    }
-    int end_i = i;
-    if (fprec > 0 && fval > 0.0) {
-        buf[i++] = '.';
-        do {
-            fval *= 10.0;
-            dival = floor(fval);
-            fval -= dival;
-            int const int_dival = (int) dival;
-            buf[i++] = '0' + int_dival;
-            if (int_dival != 0) {
-                end_i = i;
-            }
-            fprec -= 1;
-        } while(fprec > 0 && fval > 0.0);
+        for (int i = 0; i < intdigits; ++i) {
+            buf[p++] = digits[n - 1 - i];
+        }
+        for (int i = 0; i < -decimals; ++i) {
+            buf[p++] = '0';
+        }
+    }
+
+    // skip trailing zeros of the fractional part
+    int last = 0;
+    while (last < decimals && (last >= n || digits[last] == '0')) {
+        ++last;
+    }
+    if (last < decimals) {
+        buf[p++] = '.';
+        for (int i = decimals - 1; i >= last; --i) {
+            buf[p++] = i < n ? digits[i] : '0';
+        }
     }
-    buf[end_i] = 0;
-    return end_i;
+    buf[p] = 0;
+    return p;
 }
 
-unsigned int sp_svg_number_write_de(gchar *buf, int bufLen, double val, unsigned int tprec, int min_exp)
+/**
+ * Removes trailing fractional zeros (and a trailing period) from the first len characters.
+ */
+static unsigned int sp_svg_number_strip_zeros(gchar *buf, unsigned int len)
+{
+    if (memchr(buf, '.', len)) {
+        while (buf[len - 1] == '0') {
+            --len;
+        }
+        if (buf[len - 1] == '.') {
+            --len;
+        }
+    }
+    buf[len] = 0;
+    return len;
+}
+
+/**
+ * Reads back the value of mantissa * 10^-decimals, which is exact under the same
+ * conditions as the rounding.
+ */
+static bool sp_svg_number_value(double mantissa, int decimals, double &val)
+{
+    if (decimals > SP_SVG_POW10_MAX || decimals < -SP_SVG_POW10_MAX) {
+        return false;
+    }
+    val = decimals >= 0 ? mantissa / sp_svg_pow10[decimals] : mantissa * sp_svg_pow10[-decimals];
+    return true;
+}
+
+unsigned int sp_svg_number_write_de(gchar *buf, int bufLen, double val, unsigned int tprec, int min_exp, double *rval)
 {
     int eval = (int)floor(log10(fabs(val)));
     if (val == 0.0 || eval < min_exp) {
+        if (rval) {
+            *rval = 0.0;
+        }
         return sp_svg_number_write_ui(buf, 0);
     }
     unsigned int maxnumdigitsWithoutExp = // This doesn't include the sign because it is included in either representation
@@ -163,15 +273,138 @@ unsigned int sp_svg_number_write_de(gchar *buf, int bufLen, double val, unsigned
         eval+1<(int)tprec?tprec+1:
         (unsigned int)eval+1;
     unsigned int maxnumdigitsWithExp = tprec + ( eval<0 ? 4 : 3 ); // It's not necessary to take larger exponents into account, because then maxnumdigitsWithoutExp is DEFINITELY larger
+
+    unsigned int p = 0;
+    if (val < 0.0) {
+        buf[p++] = '-';
+    }
+
+    double mantissa;
     if (maxnumdigitsWithoutExp <= maxnumdigitsWithExp) {
-        return sp_svg_number_write_d(buf, bufLen, val, tprec, 0);
+        // tprec significant digits for numbers >= 1, tprec fractional digits otherwise
+        int const idigits = eval >= 0 ? eval + 1 : 0;
+        int const decimals = (int) tprec - idigits;
+        if (sp_svg_number_scale(fabs(val), decimals, false, mantissa)) {
+            p += sp_svg_number_write_mantissa(buf + p, mantissa, decimals);
+            if (rval) {
+                if (sp_svg_number_value(mantissa, decimals, *rval)) {
+                    if (val < 0.0) {
+                        *rval = -*rval;
+                    }
+                } else {
+                    sp_svg_number_read_d(buf, rval);
+                }
+            }
+            return p;
+        }
     } else {
-        val = eval < 0 ? val * pow(10.0, -eval) : val / pow(10.0, eval);
-        int p = sp_svg_number_write_d(buf, bufLen, val, tprec, 0);
+        int exp10;
+        if (sp_svg_number_significant(val, tprec, false, mantissa, exp10)) {
+            p += sp_svg_number_write_mantissa(buf + p, mantissa, (int) tprec - 1);
+            buf[p++] = 'e';
+            p += sp_svg_number_write_i(buf + p, bufLen - p, exp10);
+            if (rval) {
+                sp_svg_number_read_d(buf, rval);
+            }
+            return p;
+        }
+    }
+
+    // Out of the exactly handled range, let g_ascii_formatd make the digits. It needs room for
+    // a long exponent and a terminator, which buf may not have, so it writes to digits.
+    gchar digits[64];
+    gchar format[16];
+    unsigned int len;
+    if (maxnumdigitsWithoutExp <= maxnumdigitsWithExp) {
+        int const decimals = (int) tprec - (eval >= 0 ? eval + 1 : 0);
+        g_snprintf(format, sizeof(format), "%%.%df", MAX(decimals, 0));
+        g_ascii_formatd(digits, sizeof(digits), format, val);
+        len = sp_svg_number_strip_zeros(digits, strlen(digits));
+    } else {
+        g_snprintf(format, sizeof(format), "%%.%de", MAX((int) tprec - 1, 0));
+        g_ascii_formatd(digits, sizeof(digits), format, val);
+        gchar *e = strchr(digits, 'e');
+        if (e) {
+            int const exp10 = atoi(e + 1);
+            len = sp_svg_number_strip_zeros(digits, e - digits);
+            digits[len++] = 'e';
+            len += sp_svg_number_write_i(digits + len, sizeof(digits) - len, exp10);
+        } else {
+            len = strlen(digits);
+        }
+    }
+    if (rval) {
+        sp_svg_number_read_d(digits, rval);
+    }
+
+    p = MIN(len, (unsigned int) bufLen);
+    memcpy(buf, digits, p);
+    if (p < (unsigned int) bufLen) {
+        buf[p] = 0;
+    }
+    return p;
+}
+
+unsigned int sp_svg_number_write_g(gchar *buf, int bufLen, double val, unsigned int prec)
+{
+    prec = MAX(prec, 1u);
+    double mantissa;
+    int exp10;
+    if (val == 0.0) {
+        return sp_svg_number_write_ui(buf, 0);
+    }
+    if (!sp_svg_number_significant(val, prec, true, mantissa, exp10)) {
+        gchar format[16];
+        g_snprintf(format, sizeof(format), "%%#.%ug", prec);
+        g_ascii_formatd(buf, bufLen, format, val);
+        gchar *e = strchr(buf, 'e');
+        if (!e) {
+            return sp_svg_number_strip_zeros(buf, strlen(buf));
+        }
+        // keep the exponent
+        gchar exponent[8];
+        g_strlcpy(exponent, e, sizeof(exponent));
+        unsigned int p = sp_svg_number_strip_zeros(buf, e - buf);
+        g_strlcpy(buf + p, exponent, bufLen - p);
+        return p + strlen(exponent);
+    }
+
+    unsigned int p = 0;
+    if (val < 0.0) {
+        buf[p++] = '-';
+    }
+    if (exp10 < -4 || exp10 >= (int) prec) {
+        // Same exponent format as printf: sign and at least two digits
+        p += sp_svg_number_write_mantissa(buf + p, mantissa, (int) prec - 1);
         buf[p++] = 'e';
-        p += sp_svg_number_write_i(buf + p, bufLen - p, eval);
-        return p;
+        buf[p++] = exp10 < 0 ? '-' : '+';
+        unsigned int const e = (unsigned int) abs(exp10);
+        if (e < 10) {
+            buf[p++] = '0';
+        }
+        p += sp_svg_number_write_ui(buf + p, e);
+    } else {
+        p += sp_svg_number_write_mantissa(buf + p, mantissa, (int) prec - 1 - exp10);
     }
+    return p;
+}
+
+unsigned int sp_svg_number_write_f(gchar *buf, int bufLen, double val, unsigned int fprec)
+{
+    double mantissa;
+    if (!sp_svg_number_scale(fabs(val), (int) fprec, true, mantissa)) {
+        gchar format[16];
+        g_snprintf(format, sizeof(format), "%%.%uf", fprec);
+        g_ascii_formatd(buf, bufLen, format, val);
+        return sp_svg_number_strip_zeros(buf, strlen(buf));
+    }
+
+    unsigned int p = 0;
+    if (val < 0.0) {
+        buf[p++] = '-';
+    }
+    p += sp_svg_number_write_mantissa(buf + p, mantissa, (int) fprec);
+    return p;
 }
 
 SVGLength::SVGLength()
@@ -403,6 +403,29 @@ public:
         g_free(path_str);
     }
 
+    void testReadExactNumbers() {
+        // Every coordinate has to come out as the closest double, like strtod gives.
+        char const * path_str = "M 0.1,-2.675 L 1234567.891,0.3e-5 L 9007199254740993,123456789012345678901e-30 L 1e23,.000000000000000000000000123";
+        Geom::PathVector pv = sp_svg_read_pathv(path_str);
+        TS_ASSERT_EQUALS(pv.size(), 1u);
+        Geom::Path const &p = pv.front();
+        TS_ASSERT_EQUALS(p.initialPoint(), Geom::Point(0.1, -2.675));
+        TS_ASSERT_EQUALS(p[0].finalPoint(), Geom::Point(1234567.891, 0.3e-5));
+        TS_ASSERT_EQUALS(p[1].finalPoint(), Geom::Point(9007199254740993., 123456789012345678901e-30));
+        TS_ASSERT_EQUALS(p[2].finalPoint(), Geom::Point(1e23, .000000000000000000000000123));
+    }
+
+    void testReadCached() {
+        char const * path_str = "M 1,2 L 4,2 L 4,8 L 1,8 z";
+        Geom::PathVector pv = sp_svg_read_pathv_cached(path_str);
+        TS_ASSERT(bpathEqual(pv, rectanglepvclosed));
+        // Changing the returned path must not change what the next reader gets.
+        pv *= Geom::Translate(10, 10);
+        Geom::PathVector again = sp_svg_read_pathv_cached(path_str);
+        TS_ASSERT(bpathEqual(again, rectanglepvclosed));
+        TS_ASSERT(bpathEqual(sp_svg_read_pathv_cached(NULL), Geom::PathVector()));
+    }
+
 private:
     bool bpathEqual(Geom::PathVector const &a, Geom::PathVector const &b, double eps = 1e-16) {
         if (a.size() != b.size()) {
@@ -29,12 +29,14 @@
 */
 
 #include <cstring>
+#include <list>
 #include <string>
 #include <cassert>
 #include <glib.h> // g_assert()
 
 #include "svg/svg.h"
 #include "svg/path-string.h"
+#include "util/unordered-containers.h"
 
 #include <2geom/pathvector.h>
 #include <2geom/path.h>
@@ -73,6 +75,104 @@ Geom::PathVector sp_svg_read_pathv(char const * str)
     return pathv;
 }
 
+namespace {
+
+/**
+ * Least recently used cache of parsed path data, keyed by a hash of the string.
+ * It is bounded both in the number of entries and in the total length of their strings.
+ */
+class PathDataCache {
+public:
+    PathDataCache() : _count(0), _bytes(0) {}
+
+    bool lookup(char const *str, guint hash, Geom::PathVector &pathv);
+    void insert(char const *str, guint hash, Geom::PathVector const &pathv);
+
+private:
+    struct Entry {
+        guint hash;
+        std::string data;
+        Geom::PathVector pathv;
+    };
+    typedef std::list<Entry> EntryList;
+    typedef INK_UNORDERED_MAP<guint, EntryList::iterator> Index;
+
+    static size_t const MAX_ENTRIES = 2048;
+    static size_t const MAX_BYTES = 4 * 1024 * 1024;
+
+    void _erase(EntryList::iterator entry);
+
+    EntryList _entries; ///< most recently used first
+    Index _index;
+    size_t _count;
+    size_t _bytes;
+};
+
+bool PathDataCache::lookup(char const *str, guint hash, Geom::PathVector &pathv)
+{
+    Index::iterator found = _index.find(hash);
+    if (found == _index.end() || found->second->data != str) {
+        return false;
+    }
+    _entries.splice(_entries.begin(), _entries, found->second);
+    pathv = found->second->pathv;
+    return true;
+}
+
+void PathDataCache::insert(char const *str, guint hash, Geom::PathVector const &pathv)
+{
+    size_t const length = std::strlen(str);
+    if (length > MAX_BYTES / 8) {
+        // a few huge paths would push out everything else
+        return;
+    }
+
+    Index::iterator found = _index.find(hash);
+    if (found != _index.end()) {
+        // a different string with the same hash; the newer one wins
+        _erase(found->second);
+    }
+
+    _entries.push_front(Entry());
+    Entry &entry = _entries.front();
+    entry.hash = hash;
+    entry.data.assign(str, length);
+    entry.pathv = pathv;
+    _index[hash] = _entries.begin();
+    _count++;
+    _bytes += length;
+
+    while (_count > MAX_ENTRIES || _bytes > MAX_BYTES) {
+        _erase(--_entries.end());
+    }
+}
+
+void PathDataCache::_erase(EntryList::iterator entry)
+{
+    _index.erase(entry->hash);
+    _count--;
+    _bytes -= entry->data.size();
+    _entries.erase(entry);
+}
+
+} // namespace
+
+Geom::PathVector sp_svg_read_pathv_cached(char const * str)
+{
+    if (!str) {
+        return Geom::PathVector();
+    }
+
+    static PathDataCache cache;
+    guint const hash = g_str_hash(str);
+    Geom::PathVector pathv;
+    if (!cache.lookup(str, hash, pathv)) {
+        pathv = sp_svg_read_pathv(str);
+        cache.insert(str, hash, pathv);
+    }
+    return pathv;
+}
+
 static void sp_svg_write_curve(Inkscape::SVG::PathString & str, Geom::Curve const * c) {
     if(Geom::LineSegment const *line_segment = dynamic_cast<Geom::LineSegment const  *>(c)) {
         // don't serialize stitch segments
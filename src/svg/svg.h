@@ -33,8 +33,27 @@ unsigned int sp_svg_number_read_d( const gchar *str, double *val );
 
 /*
  * No buffer overflow checking is done, so better wrap them if needed
+ *
+ * None of these depend on the locale. The buffer should hold at least 32 characters.
+ */
+
+/*
+ * Writes val with tprec significant digits, using an exponent if that is shorter.
+ * Values smaller than 10^min_exp are written as 0. Exact half-way values are rounded away
+ * from zero. If rval is given, it receives the value of the written number, as if it was
+ * read back with sp_svg_number_read_d.
+ */
+unsigned int sp_svg_number_write_de( gchar *buf, int bufLen, double val, unsigned int tprec, int min_exp, double *rval = NULL );
+
+/*
+ * Same as printf "%.<prec>g" in the C locale, without trailing zeros.
+ */
+unsigned int sp_svg_number_write_g( gchar *buf, int bufLen, double val, unsigned int prec );
+
+/*
+ * Same as printf "%.<fprec>f" in the C locale, without trailing zeros.
  */
-unsigned int sp_svg_number_write_de( gchar *buf, int bufLen, double val, unsigned int tprec, int min_exp );
+unsigned int sp_svg_number_write_f( gchar *buf, int bufLen, double val, unsigned int fprec );
 
 /* Length */
 
@@ -63,6 +82,13 @@ double sp_svg_read_percentage( const char * str, double def );
 /* NB! As paths can be long, we use here dynamic string */
 
 Geom::PathVector sp_svg_read_pathv( char const * str );
+
+/**
+ * Like sp_svg_read_pathv(), but keeps recently read path data in a bounded cache so
+ * that setting the same string again (undo, paste, repeated icons) does not parse it
+ * again. The returned PathVector shares its curves copy-on-write with the cached one.
+ */
+Geom::PathVector sp_svg_read_pathv_cached( char const * str );
 gchar * sp_svg_write_path( Geom::PathVector const &p );
 gchar * sp_svg_write_path( Geom::Path const &p );
 
@@ -0,0 +1,149 @@
+#ifndef SEEN_SVG_PREVIEW_CACHE_TEST_H
+#define SEEN_SVG_PREVIEW_CACHE_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <utime.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "ui/cache/svg_preview_cache.h"
+
+using Inkscape::UI::Cache::SvgPreviewDiskCache;
+
+class SvgPreviewCacheTest : public CxxTest::TestSuite
+{
+public:
+    SvgPreviewCacheTest()
+    {
+        gchar *dir = g_build_filename(g_get_tmp_dir(), "svg-preview-cache-test", NULL);
+        _dir = dir;
+        g_free(dir);
+    }
+
+    static SvgPreviewCacheTest *createSuite() { return new SvgPreviewCacheTest(); }
+    static void destroySuite( SvgPreviewCacheTest *suite ) { delete suite; }
+
+    void setUp()
+    {
+        clearDir();
+        g_mkdir_with_parents(_dir.c_str(), 0700);
+    }
+
+    void tearDown()
+    {
+        clearDir();
+    }
+
+    void testStoredKeyIsFoundAndOtherIsMissed()
+    {
+        GdkPixbuf *px = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, 4, 3);
+        gdk_pixbuf_fill(px, 0xff0000ff);
+
+        std::vector<SvgPreviewDiskCache::Loaded> loaded;
+        {
+            SvgPreviewDiskCache cache(_dir);
+            // the worker does its jobs in order, so the file is there for the lookup
+            cache.store("stored", px);
+            cache.request("stored");
+            cache.request("missing");
+            waitFor(cache, loaded, 2);
+        }
+        g_object_unref(px);
+
+        TS_ASSERT_EQUALS(loaded.size(), 2u);
+        for (std::vector<SvgPreviewDiskCache::Loaded>::iterator i = loaded.begin(); i != loaded.end(); ++i) {
+            if (i->key == "stored") {
+                TS_ASSERT(i->pixbuf);
+                if (i->pixbuf) {
+                    TS_ASSERT_EQUALS(gdk_pixbuf_get_width(i->pixbuf), 4);
+                    TS_ASSERT_EQUALS(gdk_pixbuf_get_height(i->pixbuf), 3);
+                }
+            } else {
+                TS_ASSERT_EQUALS(i->key, std::string("missing"));
+                TS_ASSERT(!i->pixbuf);
+            }
+            if (i->pixbuf) {
+                g_object_unref(i->pixbuf);
+            }
+        }
+    }
+
+    void testLeastRecentlyUsedArePruned()
+    {
+        std::string const oldest = writeFile("oldest", 300);
+        std::string const older = writeFile("older", 200);
+        std::string const recent = writeFile("recent", 100);
+
+        std::vector<SvgPreviewDiskCache::Loaded> loaded;
+        {
+            // pruning is done when the worker starts, before the lookup
+            SvgPreviewDiskCache cache(_dir, 2500);
+            cache.request("missing");
+            waitFor(cache, loaded, 1);
+        }
+        TS_ASSERT_EQUALS(loaded.size(), 1u);
+
+        TS_ASSERT(!g_file_test(oldest.c_str(), G_FILE_TEST_EXISTS));
+        TS_ASSERT(g_file_test(older.c_str(), G_FILE_TEST_EXISTS));
+        TS_ASSERT(g_file_test(recent.c_str(), G_FILE_TEST_EXISTS));
+    }
+
+private:
+    /** Writes a 1000 byte preview file for key, last used age seconds ago. */
+    std::string writeFile(gchar const *key, int age)
+    {
+        std::string name = std::string(key) + ".png";
+        gchar *path = g_build_filename(_dir.c_str(), name.c_str(), NULL);
+        std::string result(path);
+        g_free(path);
+
+        std::string content(1000, 'x');
+        g_file_set_contents(result.c_str(), content.data(), content.size(), NULL);
+        struct utimbuf times;
+        times.actime = times.modtime = time(NULL) - age;
+        g_utime(result.c_str(), &times);
+        return result;
+    }
+
+    void waitFor(SvgPreviewDiskCache &cache, std::vector<SvgPreviewDiskCache::Loaded> &loaded, size_t count)
+    {
+        for (int tries = 0; loaded.size() < count && tries < 500; ++tries) {
+            g_usleep(10000);
+            cache.take_loaded(loaded);
+        }
+    }
+
+    void clearDir()
+    {
+        GDir *d = g_dir_open(_dir.c_str(), 0, NULL);
+        if (d) {
+            while (gchar const *name = g_dir_read_name(d)) {
+                gchar *path = g_build_filename(_dir.c_str(), name, NULL);
+                g_unlink(path);
+                g_free(path);
+            }
+            g_dir_close(d);
+            g_rmdir(_dir.c_str());
+        }
+    }
+
+    std::string _dir;
+};
+
+#endif // SEEN_SVG_PREVIEW_CACHE_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
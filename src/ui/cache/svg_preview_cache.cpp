@@ -19,7 +19,11 @@
 # include "config.h"
 #endif
 
+#include <algorithm>
+#include <deque>
+#include <ctime>
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
 #include <2geom/transforms.h>
 #include "sp-namedview.h"
 #include "selection.h"
@@ -33,6 +37,12 @@
 
 #include "ui/cache/svg_preview_cache.h"
 
+#if WITH_GLIBMM_2_32 && HAVE_GLIBMM_THREADS_H
+# include <glibmm/threads.h>
+#else
+# include <glibmm/thread.h>
+#endif
+
 GdkPixbuf* render_pixbuf(Inkscape::Drawing &drawing, double scale_factor, Geom::Rect const &dbox, unsigned psize)
 {
     Geom::Affine t(Geom::Scale(scale_factor, scale_factor));
@@ -130,6 +140,362 @@ void SvgPreview::remove_preview_from_cache(const Glib::ustring& key) {
     }
 }
 
+namespace {
+
+#if GLIB_CHECK_VERSION(2,32,0)
+typedef Glib::Threads::Mutex CacheMutex;
+typedef Glib::Threads::Cond CacheCond;
+typedef Glib::Threads::Thread CacheThread;
+#else
+typedef Glib::Mutex CacheMutex;
+typedef Glib::Cond CacheCond;
+typedef Glib::Thread CacheThread;
+#endif
+
+}
+
+/**
+ * The thread reading and writing preview files, with its queue of jobs.
+ * Everything but dir and thread is guarded by mutex.
+ */
+class SvgPreviewDiskCache::Worker
+{
+public:
+    struct Job {
+        std::string key;
+        GdkPixbuf *pixbuf; ///< pixbuf to write, or NULL for a lookup
+    };
+
+    Worker(std::string const &dir, guint64 max_size)
+        : dir(dir),
+          max_size(max_size),
+          thread(NULL),
+          running(0),
+          quit(false)
+    {
+        if (this->dir.empty()) {
+            gchar *path = g_build_filename(g_get_user_cache_dir(), "inkscape", "previews", NULL);
+            this->dir = path;
+            g_free(path);
+        }
+    }
+
+    bool start();
+    void run();
+    void prune();
+    GdkPixbuf *read(std::string const &key);
+    void write(std::string const &key, GdkPixbuf *px);
+    std::string path(std::string const &key) const;
+
+    std::string dir;
+    guint64 max_size;
+    CacheThread *thread;
+
+    CacheMutex mutex;
+    CacheCond cond;
+    std::deque<Job> jobs;
+    std::vector<Loaded> loaded;
+    unsigned running; ///< lookups being read
+    bool quit;
+};
+
+bool SvgPreviewDiskCache::Worker::start()
+{
+    if (thread) {
+        return true;
+    }
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+    if(!Glib::thread_supported())
+        Glib::thread_init();
+#endif
+
+    try {
+#if GLIB_CHECK_VERSION(2,32,0)
+        thread = Glib::Threads::Thread::create(sigc::mem_fun(*this, &Worker::run));
+#else
+        thread = Glib::Thread::create(sigc::mem_fun(*this, &Worker::run), true);
+#endif
+    } catch (...) {
+        thread = NULL;
+    }
+    return thread != NULL;
+}
+
+void SvgPreviewDiskCache::Worker::run()
+{
+    prune();
+
+    while (true) {
+        Job job;
+        {
+            CacheMutex::Lock lock(mutex);
+            while ( jobs.empty() && !quit ) {
+                cond.wait(mutex);
+            }
+            if (jobs.empty()) {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+            if (!job.pixbuf) {
+                if (quit) {
+                    continue;
+                }
+                ++running;
+            }
+        }
+
+        if (job.pixbuf) {
+            // pending writes are finished even when quitting
+            write(job.key, job.pixbuf);
+            g_object_unref(job.pixbuf);
+        } else {
+            Loaded result;
+            result.key = job.key;
+            result.pixbuf = read(job.key);
+
+            CacheMutex::Lock lock(mutex);
+            --running;
+            loaded.push_back(result);
+        }
+    }
+}
+
+namespace {
+
+struct CacheFile {
+    std::string path;
+    time_t mtime;
+    guint64 size;
+
+    bool operator<(CacheFile const &other) const { return mtime < other.mtime; }
+};
+
+// temporary files of writes that did not finish, e.g. on a crash
+time_t const STALE_TEMP_AGE = 24 * 60 * 60;
+
+}
+
+/**
+ * Deletes the least recently used previews until at most max_size bytes are
+ * left. read() touches the files it finds, so their mtime is their last use.
+ */
+void SvgPreviewDiskCache::Worker::prune()
+{
+    GDir *d = g_dir_open(dir.c_str(), 0, NULL);
+    if (!d) {
+        return;
+    }
+
+    std::vector<CacheFile> files;
+    guint64 total = 0;
+    time_t const now = time(NULL);
+    while (gchar const *name = g_dir_read_name(d)) {
+        gchar *path = g_build_filename(dir.c_str(), name, NULL);
+        struct stat st;
+        if ( g_file_test(path, G_FILE_TEST_IS_REGULAR) && g_stat(path, &st) == 0 ) {
+            if (g_str_has_suffix(name, ".png")) {
+                CacheFile file;
+                file.path = path;
+                file.mtime = st.st_mtime;
+                file.size = st.st_size;
+                files.push_back(file);
+                total += file.size;
+            } else if ( g_str_has_suffix(name, ".tmp") && now - st.st_mtime > STALE_TEMP_AGE ) {
+                g_unlink(path);
+            }
+        }
+        g_free(path);
+    }
+    g_dir_close(d);
+
+    std::sort(files.begin(), files.end());
+    for (std::vector<CacheFile>::iterator i = files.begin(); i != files.end() && total > max_size; ++i) {
+        if ( g_unlink(i->path.c_str()) == 0 ) {
+            total -= i->size;
+        }
+    }
+}
+
+std::string SvgPreviewDiskCache::Worker::path(std::string const &key) const
+{
+    std::string name = key + ".png";
+    gchar *path = g_build_filename(dir.c_str(), name.c_str(), NULL);
+    std::string result(path);
+    g_free(path);
+    return result;
+}
+
+GdkPixbuf *SvgPreviewDiskCache::Worker::read(std::string const &key)
+{
+    std::string const file = path(key);
+    if (!g_file_test(file.c_str(), G_FILE_TEST_IS_REGULAR)) {
+        return NULL;
+    }
+    // a damaged file is a miss, and is written again after rendering
+    GdkPixbuf *px = gdk_pixbuf_new_from_file(file.c_str(), NULL);
+    if (px) {
+        // keeps it from being pruned
+        g_utime(file.c_str(), NULL);
+    }
+    return px;
+}
+
+void SvgPreviewDiskCache::Worker::write(std::string const &key, GdkPixbuf *px)
+{
+    if ( g_mkdir_with_parents(dir.c_str(), 0700) != 0 ) {
+        return;
+    }
+
+    // write under a name of our own and rename, so that other instances
+    // never read a partial file
+    std::string const file = path(key);
+    gchar *suffix = g_strdup_printf(".%08x.tmp", g_random_int());
+    std::string const temp = file + suffix;
+    g_free(suffix);
+
+    if (gdk_pixbuf_save(px, temp.c_str(), "png", NULL, NULL)) {
+        if ( g_rename(temp.c_str(), file.c_str()) != 0 ) {
+            // Windows does not rename over an existing file
+            g_unlink(file.c_str());
+            if ( g_rename(temp.c_str(), file.c_str()) != 0 ) {
+                g_unlink(temp.c_str());
+            }
+        }
+    } else {
+        g_unlink(temp.c_str());
+    }
+}
+
+SvgPreviewDiskCache::SvgPreviewDiskCache(std::string const &dir, guint64 max_size)
+    : _worker(new Worker(dir, max_size))
+{
+}
+
+SvgPreviewDiskCache::~SvgPreviewDiskCache()
+{
+    if (_worker->thread) {
+        {
+            CacheMutex::Lock lock(_worker->mutex);
+            _worker->quit = true;
+            _worker->cond.signal();
+        }
+        _worker->thread->join();
+    }
+    for (std::deque<Worker::Job>::iterator i = _worker->jobs.begin(); i != _worker->jobs.end(); ++i) {
+        if (i->pixbuf) {
+            g_object_unref(i->pixbuf);
+        }
+    }
+    for (std::vector<Loaded>::iterator i = _worker->loaded.begin(); i != _worker->loaded.end(); ++i) {
+        if (i->pixbuf) {
+            g_object_unref(i->pixbuf);
+        }
+    }
+    delete _worker;
+}
+
+std::string SvgPreviewDiskCache::file_hash(gchar const *filename)
+{
+    std::string hash;
+    gchar *contents = NULL;
+    gsize length = 0;
+    if (g_file_get_contents(filename, &contents, &length, NULL)) {
+        gchar *sum = g_compute_checksum_for_data(G_CHECKSUM_SHA1, reinterpret_cast<guchar const *>(contents), length);
+        hash = sum;
+        g_free(sum);
+        g_free(contents);
+    }
+    return hash;
+}
+
+std::string SvgPreviewDiskCache::cache_key(std::string const &hash, gchar const *name, unsigned psize, bool fit)
+{
+    // hashed again, as names may hold anything
+    gchar *text = g_strdup_printf("%s:%s:%u:%d", hash.c_str(), name ? name : "", psize, fit ? 1 : 0);
+    gchar *sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, text, -1);
+    std::string key(sum);
+    g_free(sum);
+    g_free(text);
+    return key;
+}
+
+void SvgPreviewDiskCache::request(std::string const &key)
+{
+    Worker::Job job;
+    job.key = key;
+    job.pixbuf = NULL;
+
+    CacheMutex::Lock lock(_worker->mutex);
+    if (!_worker->start()) {
+        // no thread to read it, so it is a miss
+        Loaded result;
+        result.key = key;
+        result.pixbuf = NULL;
+        _worker->loaded.push_back(result);
+        return;
+    }
+    _worker->jobs.push_back(job);
+    _worker->cond.signal();
+}
+
+void SvgPreviewDiskCache::store(std::string const &key, GdkPixbuf *px)
+{
+    g_return_if_fail(px != NULL);
+
+    Worker::Job job;
+    job.key = key;
+    job.pixbuf = px;
+
+    CacheMutex::Lock lock(_worker->mutex);
+    if (!_worker->start()) {
+        return;
+    }
+    g_object_ref(px);
+    _worker->jobs.push_back(job);
+    _worker->cond.signal();
+}
+
+void SvgPreviewDiskCache::take_loaded(std::vector<Loaded> &loaded)
+{
+    CacheMutex::Lock lock(_worker->mutex);
+    loaded.insert(loaded.end(), _worker->loaded.begin(), _worker->loaded.end());
+    _worker->loaded.clear();
+}
+
+void SvgPreviewDiskCache::cancel_requests()
+{
+    CacheMutex::Lock lock(_worker->mutex);
+    std::deque<Worker::Job> stores;
+    for (std::deque<Worker::Job>::iterator i = _worker->jobs.begin(); i != _worker->jobs.end(); ++i) {
+        if (i->pixbuf) {
+            stores.push_back(*i);
+        }
+    }
+    _worker->jobs.swap(stores);
+    for (std::vector<Loaded>::iterator i = _worker->loaded.begin(); i != _worker->loaded.end(); ++i) {
+        if (i->pixbuf) {
+            g_object_unref(i->pixbuf);
+        }
+    }
+    _worker->loaded.clear();
+}
+
+bool SvgPreviewDiskCache::busy()
+{
+    CacheMutex::Lock lock(_worker->mutex);
+    if ( _worker->running || !_worker->loaded.empty() ) {
+        return true;
+    }
+    for (std::deque<Worker::Job>::iterator i = _worker->jobs.begin(); i != _worker->jobs.end(); ++i) {
+        if (!i->pixbuf) {
+            return true;
+        }
+    }
+    return false;
+}
+
 
 }
 }
@@ -10,6 +10,8 @@
 #define SEEN_INKSCAPE_UI_SVG_PREVIEW_CACHE_H
 
 #include <map>
+#include <string>
+#include <vector>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glibmm/ustring.h>
 #include <2geom/rect.h>
@@ -43,6 +45,62 @@ class SvgPreview {
     void          remove_preview_from_cache(const Glib::ustring& key);
 };
 
+/**
+ * Previews kept as PNG files in the user's cache directory, so that they
+ * survive restarts. The files are read and written by a worker thread and
+ * lookups are answered through take_loaded(), so the caller never waits for
+ * the disk.
+ *
+ * Keys are derived from a hash of the content of the file a preview was
+ * made from, so an edited file gets new previews. Old ones are pruned when
+ * the worker starts: the least recently used files are deleted until the
+ * directory holds at most max_size bytes of previews.
+ */
+class SvgPreviewDiskCache {
+public:
+    struct Loaded {
+        std::string key;
+        GdkPixbuf *pixbuf; ///< NULL if the preview was not on disk
+    };
+
+    static guint64 const DEFAULT_MAX_SIZE = 50 * 1024 * 1024;
+
+    /**
+     * @param dir directory of the preview files; the default is
+     * "inkscape/previews" in the user's cache directory
+     * @param max_size bytes of previews kept in dir
+     */
+    SvgPreviewDiskCache(std::string const &dir = std::string(), guint64 max_size = DEFAULT_MAX_SIZE);
+    ~SvgPreviewDiskCache();
+
+    /** SHA-1 of the content of \a filename, or an empty string if it can't be read. */
+    static std::string file_hash(gchar const *filename);
+    /** Key of the preview of \a name, \a psize pixels wide, from a file with content \a hash. */
+    static std::string cache_key(std::string const &hash, gchar const *name, unsigned psize, bool fit);
+
+    /** Queues a lookup of \a key, answered by a later take_loaded(). */
+    void request(std::string const &key);
+    /** Queues writing \a px to the file of \a key. */
+    void store(std::string const &key, GdkPixbuf *px);
+    /** Moves the finished lookups to \a loaded; the caller owns their pixbufs. */
+    void take_loaded(std::vector<Loaded> &loaded);
+    /**
+     * Drops the lookups not started yet and the results not taken yet. A lookup
+     * being read meanwhile is still answered.
+     */
+    void cancel_requests();
+    /** Whether lookups are queued, running or waiting to be taken. */
+    bool busy();
+
+private:
+    class Worker;
+
+    SvgPreviewDiskCache(SvgPreviewDiskCache const &); // no copy
+    SvgPreviewDiskCache &operator=(SvgPreviewDiskCache const &); // no assign
+
+    Worker *_worker;
+};
+
 }; // namespace Cache
 }; // namespace UI
 }; // namespace Inkscape
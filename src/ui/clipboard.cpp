@@ -149,6 +149,7 @@ private:
 
     // private properites
     SPDocument *_clipboardSPDoc; ///< Document that stores the clipboard until someone requests it
+    bool _owns_clipboard; ///< Whether the system clipboard still holds _clipboardSPDoc
     Inkscape::XML::Node *_defs; ///< Reference to the clipboard document's defs node
     Inkscape::XML::Node *_root; ///< Reference to the clipboard's root node
     Inkscape::XML::Node *_clipnode; ///< The node that holds extra information
@@ -165,6 +166,7 @@ private:
 
 ClipboardManagerImpl::ClipboardManagerImpl()
     : _clipboardSPDoc(NULL),
+      _owns_clipboard(false),
       _defs(NULL),
       _root(NULL),
       _clipnode(NULL),
@@ -353,19 +355,23 @@ bool ClipboardManagerImpl::paste(SPDesktop *desktop, bool in_place)
         return false;
     }
 
-    Glib::ustring target = _getBestTarget();
+    // when we copied the contents ourselves, there is no need to ask the system clipboard
+    Glib::ustring target = "image/x-inkscape-svg";
+    if ( !_owns_clipboard ) {
+        target = _getBestTarget();
 
-    // Special cases of clipboard content handling go here
-    // Note that target priority is determined in _getBestTarget.
-    // TODO: Handle x-special/gnome-copied-files and text/uri-list to support pasting files
+        // Special cases of clipboard content handling go here
+        // Note that target priority is determined in _getBestTarget.
+        // TODO: Handle x-special/gnome-copied-files and text/uri-list to support pasting files
 
-    // if there is an image on the clipboard, paste it
-    if ( target == CLIPBOARD_GDK_PIXBUF_TARGET ) {
-        return _pasteImage(desktop->doc());
-    }
-    // if there's only text, paste it into a selected text object or create a new one
-    if ( target == CLIPBOARD_TEXT_TARGET ) {
-        return _pasteText(desktop);
+        // if there is an image on the clipboard, paste it
+        if ( target == CLIPBOARD_GDK_PIXBUF_TARGET ) {
+            return _pasteImage(desktop->doc());
+        }
+        // if there's only text, paste it into a selected text object or create a new one
+        if ( target == CLIPBOARD_TEXT_TARGET ) {
+            return _pasteText(desktop);
+        }
     }
 
     // otherwise, use the import extensions
@@ -957,10 +963,19 @@ void ClipboardManagerImpl::_applyPathEffect(SPItem *item, gchar const *effectsta
 
 /**
  * Retrieve the clipboard contents as a document.
+ *
+ * While the system clipboard still holds what was copied in this instance, the contents
+ * are a copy of the internal clipboard document and nothing is serialised.
+ *
  * @return Clipboard contents converted to SPDocument, or NULL if no suitable content was present
  */
 SPDocument *ClipboardManagerImpl::_retrieveClipboard(Glib::ustring required_target)
 {
+    if ( _owns_clipboard && _clipboardSPDoc != NULL
+         && ( required_target == "" || required_target == "image/x-inkscape-svg" ) ) {
+        return _clipboardSPDoc->copy();
+    }
+
     Glib::ustring best_target;
     if ( required_target == "" ) {
         best_target = _getBestTarget();
@@ -1009,6 +1024,15 @@ SPDocument *ClipboardManagerImpl::_retrieveClipboard(Glib::ustring required_targ
         Gtk::SelectionData sel = _clipboard->wait_for_contents(best_target);
         target = sel.get_target();  // this can crash if the result was invalid of last function. No way to check for this :(
 
+        // SVG is read straight from memory
+        if ( target == "image/x-inkscape-svg" || target == "image/svg+xml" ) {
+            g_free(filename);
+            if ( sel.get_length() <= 0 ) {
+                return NULL;
+            }
+            return SPDocument::createNewDocFromMem((const gchar *) sel.get_data(), sel.get_length(), TRUE);
+        }
+
         // FIXME: Temporary hack until we add memory input.
         // Save the clipboard contents to some file, then read it
         g_file_set_contents(filename, (const gchar *) sel.get_data(), sel.get_length(), NULL);
@@ -1073,10 +1097,17 @@ void ClipboardManagerImpl::_onGet(Gtk::SelectionData &sel, guint /*info*/)
         return; // this also shouldn't happen
     }
 
+    // Inkscape SVG is the internal clipboard document itself, so write it straight to memory
+    if (target == "image/x-inkscape-svg") {
+        Glib::ustring data = sp_repr_save_buf(_doc, SP_SVG_NS_URI);
+        sel.set(8, (guint8 const *) data.data(), data.bytes());
+        return;
+    }
+
     // FIXME: Temporary hack until we add support for memory output.
     // Save to a temporary file, read it back and then set the clipboard contents
     gchar *filename = g_build_filename( g_get_tmp_dir(), "inkscape-clipboard-export", NULL );
-    gsize len; gchar *data;
+    gsize len; gchar *data = NULL;
 
     try {
         if (out == outlist.end() && target == "image/png")
@@ -1114,6 +1145,7 @@ void ClipboardManagerImpl::_onGet(Gtk::SelectionData &sel, guint /*info*/)
         g_file_get_contents(filename, &data, &len, NULL);
 
         sel.set(8, (guint8 const *) data, len);
+        g_free(data);
     } catch (...) {
     }
 
@@ -1132,6 +1164,7 @@ void ClipboardManagerImpl::_onClear()
 {
     // why is this called before _onGet???
     //_discardInternalClipboard();
+    _owns_clipboard = false;
 }
 
 
@@ -1299,6 +1332,8 @@ void ClipboardManagerImpl::_setClipboardTargets()
     _clipboard->set(target_list,
         sigc::mem_fun(*this, &ClipboardManagerImpl::_onGet),
         sigc::mem_fun(*this, &ClipboardManagerImpl::_onClear));
+    // set() clears our previous contents first, so this must come after it
+    _owns_clipboard = true;
 
 #ifdef WIN32
     // If the "image/x-emf" target handled by the emf extension would be
@@ -1266,7 +1266,7 @@ void FilterEffectsDialog::FilterModifier::update_selection(Selection *sel)
         }
 
         if (style->filter.set && style->getFilter()) {
-            SP_ITEM(obj)->bbox_valid = FALSE;
+            SP_ITEM(obj)->invalidateBBox();
             used.insert(style->getFilter());
         } else {
             used.insert(0);
@@ -54,12 +54,16 @@
 #include "sp-image.h"
 #include "sp-offset.h"
 #include "sp-root.h"
+#include "object-property-index.h"
+#include "util/unordered-containers.h"
 #include "xml/repr.h"
 #include "xml/node-iterators.h"
 #include "xml/attribute-record.h"
 
 #include <glibmm/i18n.h>
 #include <glibmm/regex.h>
+#include <algorithm>
+#include <vector>
 
 namespace Inkscape {
 namespace UI {
@@ -558,11 +562,12 @@ GSList *Find::filter_fields (GSList *l, bool exact, bool casematch)
 
     GSList *in = l;
     GSList *out = NULL;
+    INK_UNORDERED_SET<gpointer> found; // the items in out
 
     if (check_searchin_text.get_active()) {
         for (GSList *i = in; i != NULL; i = i->next) {
             if (item_text_match (SP_ITEM(i->data), text, exact, casematch)) {
-                if (!g_slist_find(out, i->data)) {
+                if (found.insert(i->data).second) {
                     out = g_slist_prepend (out, i->data);
                     if (_action_replace) {
                         item_text_match (SP_ITEM(i->data), text, exact, casematch, _action_replace);
@@ -582,7 +587,7 @@ GSList *Find::filter_fields (GSList *l, bool exact, bool casematch)
         if (ids) {
             for (GSList *i = in; i != NULL; i = i->next) {
                 if (item_id_match (SP_ITEM(i->data), text, exact, casematch)) {
-                    if (!g_slist_find(out, i->data)) {
+                    if (found.insert(i->data).second) {
                         out = g_slist_prepend (out, i->data);
                         if (_action_replace) {
                             item_id_match (SP_ITEM(i->data), text, exact, casematch, _action_replace);
@@ -596,13 +601,12 @@ GSList *Find::filter_fields (GSList *l, bool exact, bool casematch)
         if (style) {
             for (GSList *i = in; i != NULL; i = i->next) {
                 if (item_style_match (SP_ITEM(i->data), text, exact, casematch)) {
-                    if (!g_slist_find(out, i->data))
-                        if (!g_slist_find(out, i->data)) {
-                            out = g_slist_prepend (out, i->data);
-                            if (_action_replace) {
-                                item_style_match (SP_ITEM(i->data), text, exact, casematch, _action_replace);
-                            }
+                    if (found.insert(i->data).second) {
+                        out = g_slist_prepend (out, i->data);
+                        if (_action_replace) {
+                            item_style_match (SP_ITEM(i->data), text, exact, casematch, _action_replace);
                         }
+                    }
                 }
             }
         }
@@ -611,7 +615,7 @@ GSList *Find::filter_fields (GSList *l, bool exact, bool casematch)
         if (attrname) {
             for (GSList *i = in; i != NULL; i = i->next) {
                 if (item_attr_match (SP_ITEM(i->data), text, exact, casematch)) {
-                    if (!g_slist_find(out, i->data)) {
+                    if (found.insert(i->data).second) {
                         out = g_slist_prepend (out, i->data);
                         if (_action_replace) {
                             item_attr_match (SP_ITEM(i->data), text, exact, casematch, _action_replace);
@@ -625,7 +629,7 @@ GSList *Find::filter_fields (GSList *l, bool exact, bool casematch)
         if (attrvalue) {
             for (GSList *i = in; i != NULL; i = i->next) {
                 if (item_attrvalue_match (SP_ITEM(i->data), text, exact, casematch)) {
-                    if (!g_slist_find(out, i->data)) {
+                    if (found.insert(i->data).second) {
                         out = g_slist_prepend (out, i->data);
                         if (_action_replace) {
                             item_attrvalue_match (SP_ITEM(i->data), text, exact, casematch, _action_replace);
@@ -639,7 +643,7 @@ GSList *Find::filter_fields (GSList *l, bool exact, bool casematch)
         if (font) {
             for (GSList *i = in; i != NULL; i = i->next) {
                 if (item_font_match (SP_ITEM(i->data), text, exact, casematch)) {
-                    if (!g_slist_find(out, i->data)) {
+                    if (found.insert(i->data).second) {
                         out = g_slist_prepend (out, i->data);
                         if (_action_replace) {
                             item_font_match (SP_ITEM(i->data), text, exact, casematch, _action_replace);
@@ -736,6 +740,72 @@ GSList *Find::all_items (SPObject *r, GSList *l, bool hidden, bool locked)
     return l;
 }
 
+bool Find::indexed_items (SPObject *r, GSList **l, bool hidden, bool locked, bool exact, bool casematch)
+{
+    if (!check_searchin_property.get_active() ||
+        check_style.get_active() || check_attributename.get_active() || check_attributevalue.get_active()) {
+        return false;
+    }
+    bool ids = check_ids.get_active();
+    bool font = check_font.get_active();
+    Glib::ustring text = entry_find.getEntry()->get_text();
+    if ((!ids && !font) || text.empty()) {
+        return false;
+    }
+
+    Inkscape::ObjectPropertyIndex *index = r->document->property_index;
+    std::vector<SPObject *> candidates;
+    std::vector<char const *> values;
+
+    if (ids) {
+        if (exact && casematch) {
+            index->objectsWith(Inkscape::ObjectPropertyIndex::ID, text.c_str(), candidates);
+        } else {
+            index->values(Inkscape::ObjectPropertyIndex::ID, values);
+            for (std::vector<char const *>::const_iterator i = values.begin(); i != values.end(); ++i) {
+                if (find_strcmp(*i, text.c_str(), exact, casematch)) {
+                    index->objectsWith(Inkscape::ObjectPropertyIndex::ID, *i, candidates);
+                }
+            }
+        }
+    }
+    if (font) {
+        // item_font_match() matches the whole style token, so look for the text anywhere in the value
+        values.clear();
+        index->values(Inkscape::ObjectPropertyIndex::FONT_FAMILY, values);
+        for (std::vector<char const *>::const_iterator i = values.begin(); i != values.end(); ++i) {
+            if (find_strcmp(*i, text.c_str(), false, casematch)) {
+                index->objectsWith(Inkscape::ObjectPropertyIndex::FONT_FAMILY, *i, candidates);
+            }
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (std::vector<SPObject *>::const_iterator i = candidates.begin(); i != candidates.end(); ++i) {
+        SPItem *item = dynamic_cast<SPItem *>(*i);
+        if (!item || item->cloned || desktop->isLayer(item) || !r->isAncestorOf(item)) {
+            continue;
+        }
+        if ((!hidden && desktop->itemIsHidden(item)) || (!locked && item->isLocked())) {
+            continue;
+        }
+        // all_items() does not look into defs and metadata
+        bool skip = false;
+        for (SPObject *parent = item->parent; parent && parent != r; parent = parent->parent) {
+            if (SP_IS_DEFS(parent) || !strcmp(parent->getRepr()->name(), "svg:metadata")) {
+                skip = true;
+                break;
+            }
+        }
+        if (!skip) {
+            *l = g_slist_prepend (*l, item);
+        }
+    }
+    return true;
+}
+
 GSList *Find::all_selection_items (Inkscape::Selection *s, GSList *l, SPObject *ancestor, bool hidden, bool locked)
 {
     for (GSList *i = (GSList *) s->itemList(); i != NULL; i = i->next) {
@@ -791,7 +861,13 @@ void Find::onAction()
     bool casematch = check_case_sensitive.get_active();
     blocked = true;
 
+    if (hidden) {
+        // the contents of hidden layers may not have been built yet
+        sp_desktop_document(desktop)->buildDeferred();
+    }
+
     GSList *l = NULL;
+    bool indexed = false;
     if (check_scope_selection.get_active()) {
         if (check_scope_layer.get_active()) {
             l = all_selection_items (desktop->selection, l, desktop->currentLayer(), hidden, locked);
@@ -799,10 +875,11 @@ void Find::onAction()
             l = all_selection_items (desktop->selection, l, NULL, hidden, locked);
         }
     } else {
-        if (check_scope_layer.get_active()) {
-            l = all_items (desktop->currentLayer(), l, hidden, locked);
-        } else {
-            l = all_items(sp_desktop_document(desktop)->getRoot(), l, hidden, locked);
+        SPObject *r = check_scope_layer.get_active() ? desktop->currentLayer() : sp_desktop_document(desktop)->getRoot();
+        // ids and fonts are looked up instead of testing every item
+        indexed = indexed_items (r, &l, hidden, locked, exact, casematch);
+        if (!indexed) {
+            l = all_items (r, l, hidden, locked);
         }
     }
     guint all = g_slist_length (l);
@@ -811,12 +888,22 @@ void Find::onAction()
 
     if (n != NULL) {
         int count = g_slist_length (n);
-        desktop->messageStack()->flashF(Inkscape::NORMAL_MESSAGE,
-                                        // TRANSLATORS: "%s" is replaced with "exact" or "partial" when this string is displayed
-                                        ngettext("<b>%d</b> object found (out of <b>%d</b>), %s match.",
-                                                 "<b>%d</b> objects found (out of <b>%d</b>), %s match.",
-                                                 count),
-                                        count, all, exact? _("exact") : _("partial"));
+        if (indexed) {
+            // only the candidates were listed, so the total is unknown
+            desktop->messageStack()->flashF(Inkscape::NORMAL_MESSAGE,
+                                            // TRANSLATORS: "%s" is replaced with "exact" or "partial" when this string is displayed
+                                            ngettext("<b>%d</b> object found, %s match.",
+                                                     "<b>%d</b> objects found, %s match.",
+                                                     count),
+                                            count, exact? _("exact") : _("partial"));
+        } else {
+            desktop->messageStack()->flashF(Inkscape::NORMAL_MESSAGE,
+                                            // TRANSLATORS: "%s" is replaced with "exact" or "partial" when this string is displayed
+                                            ngettext("<b>%d</b> object found (out of <b>%d</b>), %s match.",
+                                                     "<b>%d</b> objects found (out of <b>%d</b>), %s match.",
+                                                     count),
+                                            count, all, exact? _("exact") : _("partial"));
+        }
         if (_action_replace){
             // TRANSLATORS: "%1" is replaced with the number of matches
             status.set_text(Glib::ustring::compose(ngettext("%1 match replaced","%1 matches replaced",count), count));
@@ -178,6 +178,12 @@ protected:
      *
      */
     GSList *    all_selection_items (Inkscape::Selection *s, GSList *l, SPObject *ancestor, bool hidden, bool locked);
+    /**
+     * to return a list of the items under r which the search fields can match, as found in
+     * the document's property index; returns false when the fields searched are not indexed
+     *
+     */
+    bool        indexed_items (SPObject *r, GSList **l, bool hidden, bool locked, bool exact, bool casematch);
 
     /**
      * Shrink the dialog size when the expander widget is closed
@@ -1893,6 +1893,14 @@ void InkscapePreferences::initPageSystem()
     _page_system.add_line( false, "", _misc_namedicon_delay, "",
                            _("When on, named icons will be rendered before displaying the ui. This is for working around bugs in GTK+ named icon notification"), true);
 
+    _misc_undo_memory.init("/options/undo/memorylimit", 0.0, 65536.0, 1.0, 16.0, 256.0, true, false);
+    _page_system.add_line( false, _("Undo history _memory limit:"), _misc_undo_memory, _("MiB"),
+                           _("The oldest changes are forgotten when the undo history of a document takes more memory than this; 0 means no limit"), false);
+
+    _misc_undo_compress.init( _("Compress long values in the undo history"), "/options/undo/compress", true);
+    _page_system.add_line( false, "", _misc_undo_compress, "",
+                           _("Keep long attribute values, such as the data of large paths, compressed until they are needed for undo or redo"), true);
+
 
     {
         // TRANSLATORS: following strings are paths in Inkscape preferences - Misc - System info
@@ -335,6 +335,8 @@ protected:
 
     // System page
     UI::Widget::PrefSpinButton  _misc_latency_skew;
+    UI::Widget::PrefSpinButton  _misc_undo_memory;
+    UI::Widget::PrefCheckButton _misc_undo_compress;
     UI::Widget::PrefSpinButton  _misc_simpl;
     Gtk::Entry                  _sys_user_prefs;
     Gtk::Entry                  _sys_tmp_files;
@@ -318,15 +318,10 @@ public:
 };
 
 void LayersPanel::_updateLayer( SPObject *layer ) {
-    _store->foreach( sigc::bind<SPObject*>(sigc::mem_fun(*this, &LayersPanel::_checkForUpdated), layer) );
-}
-
-bool LayersPanel::_checkForUpdated(const Gtk::TreePath &/*path*/, const Gtk::TreeIter& iter, SPObject* layer)
-{
-    bool stopGoing = false;
-    Gtk::TreeModel::Row row = *iter;
-    if ( layer == row[_model->_colObject] )
+    RowMap::iterator found = _rows.find(layer);
+    if ( found != _rows.end() )
     {
+        Gtk::TreeModel::Row row = *found->second;
         /*
          * We get notified of layer update here (from layer->setLabel()) before layer->label() is set
          * with the correct value (sp-object bug?). So use the inkscape:label attribute instead which
@@ -337,11 +332,7 @@ bool LayersPanel::_checkForUpdated(const Gtk::TreePath &/*path*/, const Gtk::Tre
         row[_model->_colLabel] = label ? label : layer->getId();
         row[_model->_colVisible] = SP_IS_ITEM(layer) ? !SP_ITEM(layer)->isHidden() : false;
         row[_model->_colLocked] = SP_IS_ITEM(layer) ? SP_ITEM(layer)->isLocked() : false;
-
-        stopGoing = true;
     }
-
-    return stopGoing;
 }
 
 void LayersPanel::_selectLayer( SPObject *layer ) {
@@ -350,31 +341,24 @@ void LayersPanel::_selectLayer( SPObject *layer ) {
             _tree.get_selection()->unselect_all();
         }
     } else {
-        _store->foreach( sigc::bind<SPObject*>(sigc::mem_fun(*this, &LayersPanel::_checkForSelected), layer) );
-    }
-
-    _checkTreeSelection();
-}
+        RowMap::iterator found = _rows.find(layer);
+        if ( found != _rows.end() )
+        {
+            _tree.expand_to_path( _store->get_path(found->second) );
 
-bool LayersPanel::_checkForSelected(const Gtk::TreePath &path, const Gtk::TreeIter& iter, SPObject* layer)
-{
-    bool stopGoing = false;
-
-    Gtk::TreeModel::Row row = *iter;
-    if ( layer == row[_model->_colObject] )
-    {
-        _tree.expand_to_path( path );
-
-        Glib::RefPtr<Gtk::TreeSelection> select = _tree.get_selection();
+            Glib::RefPtr<Gtk::TreeSelection> select = _tree.get_selection();
 
-        select->select(iter);
-
-        stopGoing = true;
+            select->select(found->second);
+        }
     }
 
-    return stopGoing;
+    _checkTreeSelection();
 }
 
+/*
+ * Rebuild the whole tree, on a desktop change; later changes of the layer manager
+ * are applied row by row by _layerAdded(), _layerRemoved() and _layerReordered()
+ */
 void LayersPanel::_layersChanged()
 {
 //    g_message("_layersChanged()");
@@ -385,6 +369,7 @@ void LayersPanel::_layersChanged()
             _selectedConnection.block();
             if ( _desktop->layer_manager && _desktop->layer_manager->includes( root ) ) {
                 SPObject* target = _desktop->currentLayer();
+                _rows.clear();
                 _store->clear();
 
     #if DUMP_LAYERS
@@ -410,10 +395,7 @@ void LayersPanel::_addLayer( SPDocument* doc, SPObject* layer, Gtk::TreeModel::R
 
                 Gtk::TreeModel::iterator iter = parentRow ? _store->prepend(parentRow->children()) : _store->prepend();
                 Gtk::TreeModel::Row row = *iter;
-                row[_model->_colObject] = child;
-                row[_model->_colLabel] = child->defaultLabel();
-                row[_model->_colVisible] = SP_IS_ITEM(child) ? !SP_ITEM(child)->isHidden() : false;
-                row[_model->_colLocked] = SP_IS_ITEM(child) ? SP_ITEM(child)->isLocked() : false;
+                _setRow( iter, child );
 
                 if ( target && child == target ) {
                     _tree.expand_to_path( _store->get_path(iter) );
@@ -430,6 +412,153 @@ void LayersPanel::_addLayer( SPDocument* doc, SPObject* layer, Gtk::TreeModel::R
     }
 }
 
+void LayersPanel::_setRow( Gtk::TreeModel::iterator const &iter, SPObject* layer )
+{
+    Gtk::TreeModel::Row row = *iter;
+    row[_model->_colObject] = layer;
+    row[_model->_colLabel] = layer->defaultLabel();
+    row[_model->_colVisible] = SP_IS_ITEM(layer) ? !SP_ITEM(layer)->isHidden() : false;
+    row[_model->_colLocked] = SP_IS_ITEM(layer) ? SP_ITEM(layer)->isLocked() : false;
+
+    _rows[layer] = iter;
+}
+
+void LayersPanel::_layerAdded( SPObject *layer )
+{
+    if ( _desktop && _desktop->layer_manager ) {
+        LayerManager *mgr = _desktop->layer_manager;
+
+        _selectedConnection.block();
+
+        // Sublayers shown under the parent so far move under the new layer
+        unsigned int counter = mgr->childCount(layer);
+        for ( unsigned int i = 0; i < counter; i++ ) {
+            _removeRow( mgr->nthChildOf(layer, i) );
+        }
+        _insertLayer( layer );
+
+        _followCurrentLayer();
+        _selectedConnection.unblock();
+    }
+}
+
+void LayersPanel::_layerRemoved( SPObject *layer )
+{
+    RowMap::iterator found = _rows.find(layer);
+    if ( found != _rows.end() && _desktop && _desktop->layer_manager ) {
+        _selectedConnection.block();
+
+        // Sublayers left in the layer manager now belong to the parent of layer.
+        // Rows are shown last child first: add them back from the bottom up, so
+        // that the row each one goes above is already there.
+        std::vector<SPObject *> sublayers;
+        Gtk::TreeModel::Children children = found->second->children();
+        for ( Gtk::TreeModel::Children::iterator iter = children.begin(); iter != children.end(); ++iter ) {
+            SPObject *child = (*iter)[_model->_colObject];
+            sublayers.push_back( child );
+        }
+
+        _removeRow( layer );
+
+        for ( std::vector<SPObject *>::reverse_iterator it = sublayers.rbegin(); it != sublayers.rend(); ++it ) {
+            if ( _desktop->layer_manager->includes(*it) ) {
+                _insertLayer( *it );
+            }
+        }
+
+        _followCurrentLayer();
+        _selectedConnection.unblock();
+    }
+}
+
+void LayersPanel::_layerReordered( SPObject *layer )
+{
+    RowMap::iterator found = _rows.find(layer);
+    if ( found != _rows.end() && _desktop && _desktop->layer_manager ) {
+        LayerManager *mgr = _desktop->layer_manager;
+
+        // Move the row above the one of the sibling before it in the document
+        unsigned int index = mgr->indexOf(layer);
+        RowMap::iterator below = index > 0 ? _rows.find( mgr->nthChildOf(mgr->parentOf(layer), index - 1) ) : _rows.end();
+        if ( below != _rows.end() ) {
+            _store->move( found->second, below->second );
+        } else {
+            Gtk::TreeModel::iterator parent = found->second->parent();
+            _store->move( found->second, parent ? parent->children().end() : _store->children().end() );
+        }
+    }
+}
+
+/*
+ * Add the rows of layer and of its sublayers in place among the rows of its siblings
+ */
+void LayersPanel::_insertLayer( SPObject *layer )
+{
+    LayerManager *mgr = _desktop->layer_manager;
+    SPObject *parent = mgr->parentOf(layer);
+    if ( !parent ) {
+        return; // the root has no row
+    }
+
+    RowMap::iterator parentRow = _rows.find(parent);
+    int level = 0;
+    if ( parentRow != _rows.end() ) {
+        level = _store->get_path(parentRow->second).size();
+    } else if ( mgr->parentOf(parent) ) {
+        return; // the parent is nested too deep to be shown
+    }
+    if ( level >= _maxNestDepth ) {
+        return;
+    }
+
+    unsigned int index = mgr->indexOf(layer);
+    RowMap::iterator below = index > 0 ? _rows.find( mgr->nthChildOf(parent, index - 1) ) : _rows.end();
+
+    Gtk::TreeModel::iterator iter;
+    if ( below != _rows.end() ) {
+        iter = _store->insert( below->second );
+    } else if ( parentRow != _rows.end() ) {
+        iter = _store->append( parentRow->second->children() );
+    } else {
+        iter = _store->append();
+    }
+    _setRow( iter, layer );
+
+    Gtk::TreeModel::Row row = *iter;
+    _addLayer( _desktop->doc(), layer, &row, 0, level + 1 );
+}
+
+void LayersPanel::_removeRow( SPObject *layer )
+{
+    RowMap::iterator found = _rows.find(layer);
+    if ( found != _rows.end() ) {
+        Gtk::TreeModel::iterator iter = found->second;
+        _forgetRows( *iter );
+        _store->erase( iter );
+    }
+}
+
+void LayersPanel::_forgetRows( Gtk::TreeModel::Row row )
+{
+    Gtk::TreeModel::Children children = row.children();
+    for ( Gtk::TreeModel::Children::iterator iter = children.begin(); iter != children.end(); ++iter ) {
+        _forgetRows( *iter );
+    }
+    SPObject *layer = row[_model->_colObject];
+    _rows.erase( layer );
+}
+
+/*
+ * Keep the selection on the current layer as rows come and go
+ */
+void LayersPanel::_followCurrentLayer()
+{
+    SPObject *current = _desktop ? _desktop->currentLayer() : 0;
+    if ( _selectedLayer() != current ) {
+        _selectLayer( current );
+    }
+}
+
 SPObject* LayersPanel::_selectedLayer()
 {
     SPObject* obj = 0;
@@ -713,6 +842,9 @@ bool LayersPanel::_handleDragDrop(const Glib::RefPtr<Gdk::DragContext>& /*contex
  */
 void LayersPanel::_doTreeMove( )
 {
+    // The drop has moved rows of the store by itself, leaving _rows behind
+    _layersChanged();
+
     if (_dnd_source ) {
         _dnd_source->moveTo(_dnd_target, _dnd_into);
         _selectLayer(_dnd_source);
@@ -1009,7 +1141,9 @@ void LayersPanel::setDesktop( SPDesktop* desktop )
     if ( desktop != _desktop ) {
         _layerChangedConnection.disconnect();
         _layerUpdatedConnection.disconnect();
-        _changedConnection.disconnect();
+        _addedConnection.disconnect();
+        _removedConnection.disconnect();
+        _reorderedConnection.disconnect();
         if ( _desktop ) {
             _desktop = 0;
         }
@@ -1022,7 +1156,9 @@ void LayersPanel::setDesktop( SPDesktop* desktop )
             if ( mgr ) {
                 _layerChangedConnection = mgr->connectCurrentLayerChanged( sigc::mem_fun(*this, &LayersPanel::_selectLayer) );
                 _layerUpdatedConnection = mgr->connectLayerDetailsChanged( sigc::mem_fun(*this, &LayersPanel::_updateLayer) );
-                _changedConnection = mgr->connectChanged( sigc::mem_fun(*this, &LayersPanel::_layersChanged) );
+                _addedConnection = mgr->connectAdded( sigc::mem_fun(*this, &LayersPanel::_layerAdded) );
+                _removedConnection = mgr->connectRemoved( sigc::mem_fun(*this, &LayersPanel::_layerRemoved) );
+                _reorderedConnection = mgr->connectReordered( sigc::mem_fun(*this, &LayersPanel::_layerReordered) );
             }
 
             _layersChanged();
@@ -28,6 +28,7 @@
 #include "ui/widget/panel.h"
 #include "ui/widget/object-composite-settings.h"
 #include "desktop-tracker.h"
+#include "util/unordered-containers.h"
 #include "ui/widget/style-subject.h"
 
 class SPObject;
@@ -61,6 +62,7 @@ protected:
 private:
     class ModelColumns;
     class InternalUIBounce;
+    typedef INK_UNORDERED_MAP<SPObject *, Gtk::TreeModel::iterator> RowMap;
 
     LayersPanel(LayersPanel const &); // no copy
     LayersPanel &operator=(LayersPanel const &); // no assign
@@ -90,22 +92,29 @@ private:
     bool _rowSelectFunction( Glib::RefPtr<Gtk::TreeModel> const & model, Gtk::TreeModel::Path const & path, bool b );
 
     void _updateLayer(SPObject *layer);
-    bool _checkForUpdated(const Gtk::TreePath &path, const Gtk::TreeIter& iter, SPObject* layer);
 
     void _selectLayer(SPObject *layer);
-    bool _checkForSelected(const Gtk::TreePath& path, const Gtk::TreeIter& iter, SPObject* layer);
 
     void _layersChanged();
     void _addLayer( SPDocument* doc, SPObject* layer, Gtk::TreeModel::Row* parentRow, SPObject* target, int level );
+    void _setRow( Gtk::TreeModel::iterator const &iter, SPObject* layer );
+
+    void _layerAdded(SPObject *layer);
+    void _layerRemoved(SPObject *layer);
+    void _layerReordered(SPObject *layer);
+    void _insertLayer(SPObject *layer);
+    void _removeRow(SPObject *layer);
+    void _forgetRows(Gtk::TreeModel::Row row);
+    void _followCurrentLayer();
 
     SPObject* _selectedLayer();
 
     // Hooked to the layer manager:
     sigc::connection _layerChangedConnection;
     sigc::connection _layerUpdatedConnection;
-    sigc::connection _changedConnection;
     sigc::connection _addedConnection;
     sigc::connection _removedConnection;
+    sigc::connection _reorderedConnection;
 
     // Internal
     sigc::connection _selectedConnection;
@@ -121,6 +130,8 @@ private:
     GdkEvent* _toggleEvent;
 
     Glib::RefPtr<Gtk::TreeStore> _store;
+    /// The row of each layer shown; rows of a TreeStore stay valid until removed
+    RowMap _rows;
     std::vector<Gtk::Widget*> _watching;
     std::vector<Gtk::Widget*> _watchingNonTop;
     std::vector<Gtk::Widget*> _watchingNonBottom;
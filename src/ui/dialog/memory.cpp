@@ -17,11 +17,16 @@
 #include "ui/dialog/memory.h"
 #include <glibmm/main.h>
 #include <glibmm/i18n.h>
+#include <gtkmm/label.h>
 #include <gtkmm/liststore.h>
 #include <gtkmm/treeview.h>
 
 #include "gc-core.h"
 #include "debug/heap.h"
+#include "desktop.h"
+#include "event-log.h"
+#include "inkscape.h"
+#include "style.h"
 #include "verbs.h"
 
 namespace Inkscape {
@@ -109,6 +114,8 @@ struct Memory::Private {
     ModelColumns columns;
     Glib::RefPtr<Gtk::ListStore> model;
     Gtk::TreeView view;
+    Gtk::Label styles;
+    Gtk::Label undo;
 
     sigc::connection update_task;
 };
@@ -191,6 +198,22 @@ void Memory::Private::update() {
     while ( row != model->children().end() ) {
         row = model->erase(row);
     }
+
+    SPStyleMemoryStats const style_stats = sp_style_memory_stats();
+    styles.set_text(Glib::ustring::compose(_("Styles: %1 bytes in %2 styles and their text styles, %3 bytes without sharing text styles (%4 of %5 text styles shared)"),
+                                           format_size(style_stats.bytes),
+                                           format_size(style_stats.styles),
+                                           format_size(style_stats.unshared_bytes),
+                                           format_size(style_stats.shared_text_styles),
+                                           format_size(style_stats.text_styles)));
+
+    SPDesktop *desktop = SP_ACTIVE_DESKTOP;
+    if (desktop && desktop->event_log) {
+        undo.set_text(Glib::ustring::compose(_("Undo history: %1 bytes"),
+                                             format_size(desktop->event_log->getUndoMemory())));
+    } else {
+        undo.set_text(Glib::ustring());
+    }
 }
 
 void Memory::Private::start_update_task() {
@@ -210,6 +233,10 @@ Memory::Memory()
       _private(*(new Memory::Private())) 
 {
     _getContents()->add(_private.view);
+    _private.styles.set_alignment(0.0, 0.5);
+    _getContents()->pack_start(_private.styles, false, false);
+    _private.undo.set_alignment(0.0, 0.5);
+    _getContents()->pack_start(_private.undo, false, false);
 
     _private.update();
 
@@ -77,6 +77,11 @@ static Cache::SvgPreview svg_preview_cache;
 
 namespace Dialog {
 
+/// Seconds spent rendering previews per call of fillIcons()
+static double const ICON_RENDER_BUDGET = 0.02;
+/// Milliseconds between calls of fillIcons()
+static unsigned const ICON_FILL_INTERVAL = 10;
+
   // See: http://developer.gnome.org/gtkmm/stable/classGtk_1_1TreeModelColumnRecord.html
 class SymbolColumns : public Gtk::TreeModel::ColumnRecord
 {
@@ -110,6 +115,7 @@ SymbolsDialog::SymbolsDialog( gchar const* prefsPath ) :
   deskTrack(),
   currentDocument(0),
   previewDocument(0),
+  iconDocument(0),
   instanceConns()
 {
 
@@ -283,6 +289,7 @@ SymbolsDialog::SymbolsDialog( gchar const* prefsPath ) :
 
 SymbolsDialog::~SymbolsDialog()
 {
+  cancelIcons();
   for (std::vector<sigc::connection>::iterator it =  instanceConns.begin(); it != instanceConns.end(); ++it) {
       it->disconnect();
   }
@@ -311,6 +318,7 @@ void SymbolsDialog::zoomout() {
 
 void SymbolsDialog::rebuild() {
 
+  cancelIcons();
   store->clear();
   Glib::ustring symbolSetString = symbolSet->get_active_text();
 
@@ -544,6 +552,7 @@ void SymbolsDialog::get_symbols() {
         symbol_doc = read_vss( fullname, filename );
         if( symbol_doc ) {
     symbolSets[Glib::ustring(filename)]= symbol_doc;
+    symbolHashes[symbol_doc] = Cache::SvgPreviewDiskCache::file_hash(fullname);
     symbolSet->append(filename);
         }
       }
@@ -558,6 +567,7 @@ void SymbolsDialog::get_symbols() {
                   title = _("Unnamed Symbols");
               }
           symbolSets[Glib::ustring(title)] = symbol_doc;
+          symbolHashes[symbol_doc] = Cache::SvgPreviewDiskCache::file_hash(fullname);
           symbolSet->append(title);
         }
       }
@@ -592,6 +602,9 @@ GSList* SymbolsDialog::symbols_in_doc_recursive (SPObject *r, GSList *l)
 
 GSList* SymbolsDialog::symbols_in_doc( SPDocument* symbolDocument ) {
 
+  // symbols are built as they are looked up, but all of them are listed here
+  symbolDocument->buildDeferred();
+
   GSList *l = NULL;
   l = symbols_in_doc_recursive (symbolDocument->getRoot(), l );
   return l;
@@ -644,15 +657,32 @@ gchar const* SymbolsDialog::style_from_use( gchar const* id, SPDocument* documen
 
 void SymbolsDialog::draw_symbols( SPDocument* symbolDocument ) {
 
+  cancelIcons();
+  iconDocument = symbolDocument;
+
+  unsigned psize = SYMBOL_ICON_SIZES[in_sizes];
+  blankIcon = Gdk::Pixbuf::create(Gdk::COLORSPACE_RGB, true, 8, psize, psize);
+  blankIcon->fill(0);
+
   GSList* l = symbols_in_doc( symbolDocument );
   for( ; l != NULL; l = l->next ) {
     SPObject* symbol = SP_OBJECT(l->data);
-    if (SP_IS_SYMBOL(symbol)) {
+    // symbols without a visual bounding box have no preview, so are not listed
+    if (SP_IS_SYMBOL(symbol) && symbol_has_visual_bounds( symbol )) {
       draw_symbol( symbol );
     }
   }
+
+  if( !iconsToRender.empty() || !iconsToLoad.empty() ) {
+    fillIconsConn = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &SymbolsDialog::fillIcons), ICON_FILL_INTERVAL, Glib::PRIORITY_LOW);
+  }
 }
 
+/*
+ * Lists a symbol with a blank image, and shows its preview if it is in
+ * memory or queues it for fillIcons().
+ */
 void SymbolsDialog::draw_symbol( SPObject* symbol ) {
 
   SymbolColumns* columns = getColumns();
@@ -663,16 +693,138 @@ void SymbolsDialog::draw_symbol( SPObject* symbol ) {
     title = id;
   }
 
-  Glib::RefPtr<Gdk::Pixbuf> pixbuf = create_symbol_image(id, symbol );
+  Gtk::ListStore::iterator row = store->append();
+  (*row)[columns->symbol_id]    = Glib::ustring( id );
+  (*row)[columns->symbol_title] = Glib::ustring( title );
+  (*row)[columns->symbol_image] = blankIcon;
+
+  unsigned psize = SYMBOL_ICON_SIZES[in_sizes];
+  bool fit = fitSymbol->get_active();
+
+  PendingIcon icon;
+  icon.id = id;
+  icon.row = row;
+
+  // Previews of symbol files are kept on disk by the content of the file;
+  // those of the current document can change with it, so only last the session
+  std::map<SPDocument*, std::string>::const_iterator hash = symbolHashes.find(symbol->document);
+  if( hash != symbolHashes.end() && !hash->second.empty() ) {
+    icon.disk_key = Cache::SvgPreviewDiskCache::cache_key(hash->second, id, psize, fit);
+    icon.memory_key = icon.disk_key;
+  } else {
+    icon.memory_key = svg_preview_cache.cache_key(symbol->document->getURI(), id, psize);
+    icon.memory_key += fit ? ":fit" : ":nofit";
+  }
+
+  GdkPixbuf *pixbuf_gobj = svg_preview_cache.get_preview_from_cache(icon.memory_key);
+  if( pixbuf_gobj ) {
+    g_object_ref(pixbuf_gobj); // the reference in svg_preview_cache will get destroyed when it's freed
+    (*row)[columns->symbol_image] = Glib::wrap(pixbuf_gobj);
+  } else if( !icon.disk_key.empty() ) {
+    std::vector<PendingIcon> &pending = iconsToLoad[icon.disk_key];
+    if( pending.empty() ) {
+      previewDiskCache.request(icon.disk_key);
+    }
+    pending.push_back(icon);
+  } else {
+    iconsToRender.push_back(icon);
+  }
+
+  delete columns;
+}
+
+/*
+ * Shows the previews found on disk and renders the missing ones until the
+ * time budget is spent. Returns whether previews are still pending.
+ */
+bool SymbolsDialog::fillIcons() {
+
+  std::vector<Cache::SvgPreviewDiskCache::Loaded> loaded;
+  previewDiskCache.take_loaded(loaded);
+  for( std::vector<Cache::SvgPreviewDiskCache::Loaded>::iterator it = loaded.begin(); it != loaded.end(); ++it ) {
+    std::map<std::string, std::vector<PendingIcon> >::iterator found = iconsToLoad.find(it->key);
+    if( found == iconsToLoad.end() ) {
+      // asked for before the last rebuild
+      if( it->pixbuf ) {
+        g_object_unref(it->pixbuf);
+      }
+      continue;
+    }
+    std::vector<PendingIcon> const &pending = found->second;
+    if( it->pixbuf ) {
+      Glib::RefPtr<Gdk::Pixbuf> pixbuf = Glib::wrap(it->pixbuf);
+      for( std::vector<PendingIcon>::const_iterator icon = pending.begin(); icon != pending.end(); ++icon ) {
+        setIcon(*icon, pixbuf);
+      }
+    } else {
+      iconsToRender.insert(iconsToRender.end(), pending.begin(), pending.end());
+    }
+    iconsToLoad.erase(found);
+  }
+
+  GTimer *timer = g_timer_new();
+  while( !iconsToRender.empty() && g_timer_elapsed(timer, NULL) < ICON_RENDER_BUDGET ) {
+    PendingIcon icon = iconsToRender.front();
+    iconsToRender.pop_front();
+    renderIcon(icon);
+  }
+  g_timer_destroy(timer);
+
+  return !iconsToRender.empty() || !iconsToLoad.empty();
+}
+
+void SymbolsDialog::cancelIcons() {
+
+  fillIconsConn.disconnect();
+  iconsToRender.clear();
+  iconsToLoad.clear();
+  previewDiskCache.cancel_requests();
+}
+
+void SymbolsDialog::renderIcon(PendingIcon const &icon) {
 
-  if( pixbuf ) {
-    Gtk::ListStore::iterator row = store->append();
-    (*row)[columns->symbol_id]    = Glib::ustring( id );
-    (*row)[columns->symbol_title] = Glib::ustring( title );
-    (*row)[columns->symbol_image] = pixbuf;
+  SPObject* symbol = iconDocument->getObjectById(icon.id);
+  Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+  if( symbol && SP_IS_SYMBOL(symbol) ) {
+    pixbuf = create_symbol_image(icon.id.c_str(), symbol);
   }
 
+  if( !pixbuf ) {
+    // draw_symbols() left out the symbols without a visual bounding box,
+    // so this one changed since; keep its blank image rather than its row
+    return;
+  }
+
+  setIcon(icon, pixbuf);
+  if( !icon.disk_key.empty() ) {
+    previewDiskCache.store(icon.disk_key, pixbuf->gobj());
+  }
+}
+
+void SymbolsDialog::setIcon(PendingIcon const &icon, Glib::RefPtr<Gdk::Pixbuf> const &pixbuf) {
+
+  SymbolColumns* columns = getColumns();
+  (*icon.row)[columns->symbol_image] = pixbuf;
   delete columns;
+  svg_preview_cache.set_preview_in_cache(icon.memory_key, pixbuf->gobj());
+}
+
+/*
+ * Returns whether any item in the symbol has a visual bounding box.
+ *
+ * Symbols only have bounds when cloned, so this asks their children.
+ */
+bool SymbolsDialog::symbol_has_visual_bounds( SPObject* symbol )
+{
+  for( SPObject *child = symbol->firstChild(); child; child = child->getNext() ) {
+    if( SP_IS_ITEM(child) ) {
+      SPItem *item = SP_ITEM(child);
+      if( !item->isHidden() && item->visualBounds(item->transform) ) {
+        return true;
+      }
+    }
+  }
+  return false;
 }
 
 /*
@@ -683,6 +835,9 @@ void SymbolsDialog::draw_symbol( SPObject* symbol ) {
  * <symbol> element and a <use> element that references the symbol
  * element. Each real symbol is swapped in for the dummy symbol and
  * the temporary document is rendered.
+ *
+ * Returns an empty pointer if the symbol has no visual bounding box.
+ * Previews are cached by the callers.
  */
 Glib::RefPtr<Gdk::Pixbuf>
 SymbolsDialog::create_symbol_image(gchar const *symbol_id, SPObject *symbol)
@@ -746,16 +901,7 @@ SymbolsDialog::create_symbol_image(gchar const *symbol_id, SPObject *symbol)
 
   unsigned psize = SYMBOL_ICON_SIZES[in_sizes];
 
-  /* Update to renderable state */
-  Glib::ustring key = svg_preview_cache.cache_key(previewDocument->getURI(), symbol_id, psize);
-  //std::cout << "  Key: " << key << std::endl;
-
   Glib::RefPtr<Gdk::Pixbuf> pixbuf(NULL);
-  GdkPixbuf *pixbuf_gobj = svg_preview_cache.get_preview_from_cache(key);
-  if (pixbuf_gobj) {
-    g_object_ref(pixbuf_gobj); // the reference in svg_preview_cache will get destroyed when it's freed
-    pixbuf = Glib::wrap(pixbuf_gobj);
-  }
 
   // Find object's bbox in document.
   // Note symbols can have own viewport... ignore for now.
@@ -766,28 +912,24 @@ SymbolsDialog::create_symbol_image(gchar const *symbol_id, SPObject *symbol)
     return pixbuf;
   }
 
-  if (!pixbuf) {
-
-    /* Scale symbols to fit */
-    double scale = 1.0;
-    double width  = dbox->width();
-    double height = dbox->height();
-    if( width == 0.0 ) {
-      width = 1.0;
-    }
-    if( height == 0.0 ) {
-      height = 1.0;
-    }
-
-    if( fitSymbol->get_active() ) {
-    /* Fit */
-    scale = psize/std::max(width,height);
-    }
+  /* Scale symbols to fit */
+  double scale = 1.0;
+  double width  = dbox->width();
+  double height = dbox->height();
+  if( width == 0.0 ) {
+    width = 1.0;
+  }
+  if( height == 0.0 ) {
+    height = 1.0;
+  }
 
-    pixbuf = Glib::wrap(render_pixbuf(renderDrawing, scale, *dbox, psize));
-    svg_preview_cache.set_preview_in_cache(key, pixbuf->gobj());
+  if( fitSymbol->get_active() ) {
+  /* Fit */
+  scale = psize/std::max(width,height);
   }
 
+  pixbuf = Glib::wrap(render_pixbuf(renderDrawing, scale, *dbox, psize));
+
   return pixbuf;
 }
 
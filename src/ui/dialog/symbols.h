@@ -15,10 +15,14 @@
 
 #include "display/drawing.h"
 
+#include "ui/cache/svg_preview_cache.h"
 #include "ui/dialog/desktop-tracker.h"
 
 #include "ui/widget/panel.h"
 
+#include <deque>
+#include <map>
+#include <string>
 #include <vector>
 
 class SPObject;
@@ -43,6 +47,11 @@ class SymbolColumns; // For Gtk::ListStore
  * the symbol from the symbol document, into the current document and places a
  * new <use element at the correct location on the canvas.
  *
+ * Previews are filled in progressively: rows are listed at once with a blank
+ * image, previews of symbol files are looked up in the disk cache by a worker
+ * thread, and the others are rendered a few at a time from a low priority
+ * timeout, as the preview document can only be used from the main thread.
+ *
  * Selected groups on the canvas can be added to the current document's symbols
  * table, and symbols can be removed from the current document. This allows
  * new symbols documents to be constructed and if saved in the prefs folder will
@@ -88,11 +97,34 @@ private:
     GSList* use_in_doc( SPDocument* document );
     gchar const* style_from_use( gchar const* id, SPDocument* document);
 
+    bool symbol_has_visual_bounds( SPObject* symbol );
     Glib::RefPtr<Gdk::Pixbuf>
     create_symbol_image(gchar const *symbol_name, SPObject *symbol);
 
+    /// A row whose preview is not filled in yet
+    struct PendingIcon {
+        Glib::ustring id;
+        Gtk::TreeModel::iterator row;
+        Glib::ustring memory_key; ///< key in the in-memory preview cache
+        std::string disk_key;     ///< key in previewDiskCache, empty if not kept on disk
+    };
+
+    bool fillIcons();
+    void cancelIcons();
+    void renderIcon(PendingIcon const &icon);
+    void setIcon(PendingIcon const &icon, Glib::RefPtr<Gdk::Pixbuf> const &pixbuf);
+
     /* Keep track of all symbol template documents */
     std::map<Glib::ustring, SPDocument*> symbolSets;
+    /* Content hash of the file of each symbol set */
+    std::map<SPDocument*, std::string> symbolHashes;
+
+    SPDocument* iconDocument; /* Document the pending icons are from */
+    Glib::RefPtr<Gdk::Pixbuf> blankIcon;
+    std::deque<PendingIcon> iconsToRender;
+    std::map<std::string, std::vector<PendingIcon> > iconsToLoad; /* by disk key, rows may share one */
+    Cache::SvgPreviewDiskCache previewDiskCache;
+    sigc::connection fillIconsConn;
 
     // Index into sizes which is selected
     int in_sizes;
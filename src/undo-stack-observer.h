@@ -25,6 +25,7 @@ struct Event;
  * 	<li>A change is committed to the undo stack.</li>
  * 	<li>An undo action is made.</li>
  * 	<li>A redo action is made.</li>
+ * 	<li>The oldest change is dropped from the undo stack.</li>
  * </ul>
  *
  * UndoStackObservers should not be used on their own.  Instead, they should be registered
@@ -56,6 +57,14 @@ public:
 	 */
 	virtual void notifyUndoCommitEvent(Event* log) = 0;
 
+	/**
+	 * Triggered when the oldest event of the undo log is dropped to keep the undo
+	 * history within its memory limit.  The event is deleted after the notification.
+	 *
+	 * \param log Pointer to the Event being dropped.
+	 */
+	virtual void notifyUndoExpiredEvent(Event* log) = 0;
+
 	/**
 	 * Triggered when the undo log is cleared.
 	 */
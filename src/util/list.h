@@ -63,6 +63,9 @@ public:
     List() : _cell(NULL) {}
     explicit List(const_reference value, List const &next=List())
     : _cell(new ListCell<T>(value, next._cell)) {}
+    /// Same, with the cell taken from a batch pool.
+    List(const_reference value, List const &next, GC::BatchPool &pool)
+    : _cell(new (pool) ListCell<T>(value, next._cell)) {}
 
     operator bool() const { return this->_cell; }
 
@@ -127,6 +130,8 @@ public:
     List() : List<T const>() {}
     explicit List(const_reference value, List const &next=List())
     : List<T const>(value, next) {}
+    List(const_reference value, List const &next, GC::BatchPool &pool)
+    : List<T const>(value, next, pool) {}
 
     reference operator*() const { return this->_cell->value; }
     pointer operator->() const { return &this->_cell->value; }
@@ -209,6 +214,9 @@ public:
     explicit MutableList(typename List<T>::const_reference value,
                          MutableList const &next=MutableList())
     : List<T>(value, next) {}
+    MutableList(typename List<T>::const_reference value,
+                MutableList const &next, GC::BatchPool &pool)
+    : List<T>(value, next, pool) {}
 
     MutableList &operator++() {
         this->_cell = this->_cell->next;
@@ -13,17 +13,33 @@
 
 #include <cstring>
 #include <string>
+#include <vector>
 
+#include "../util/unordered-containers.h"
 #include "../xml/node-event-vector.h"
 #include "sp-xmlview-tree.h"
 
 struct NodeData {
 	SPXMLViewTree * tree;
-	GtkTreeRowReference  *rowref;
+	GtkTreeIter iter;             /* a GtkTreeStore keeps its iters valid as long as the row exists */
 	Inkscape::XML::Node * repr;
+	bool populated;               /* the children have rows, rather than a placeholder */
 };
 
-enum { STORE_TEXT_COL = 0, STORE_DATA_COL, STORE_REPR_COL, STORE_N_COLS };
+struct SPXMLViewTreePrivate {
+    typedef INK_UNORDERED_MAP<Inkscape::XML::Node *, NodeData *> NodeMap;
+    typedef INK_UNORDERED_SET<Inkscape::XML::Node *> ReprSet;
+
+    SPXMLViewTreePrivate() : idle_id(0) {}
+
+    NodeMap nodes;        /* the reprs which have a row */
+    ReprSet relabel;      /* reprs whose label changed since the last idle */
+    ReprSet resync;       /* reprs whose children changed since the last idle */
+    ReprSet rebuild;      /* reprs whose row was moved by drag and drop */
+    guint idle_id;
+};
+
+enum { STORE_TEXT_COL = 0, STORE_REPR_COL, STORE_N_COLS };
 
 static void sp_xmlview_tree_class_init (SPXMLViewTreeClass * klass);
 static void sp_xmlview_tree_init (SPXMLViewTree * tree);
@@ -34,31 +50,45 @@ static void sp_xmlview_tree_destroy(GtkWidget * object);
 static void sp_xmlview_tree_destroy(GtkObject * object);
 #endif
 
-static NodeData * node_data_new (SPXMLViewTree * tree, GtkTreeIter * node, GtkTreeRowReference  *rowref, Inkscape::XML::Node * repr);
-
-static GtkTreeRowReference * add_node (SPXMLViewTree * tree, GtkTreeIter * parent, GtkTreeIter * before, Inkscape::XML::Node * repr);
+static NodeData * node_data_new (SPXMLViewTree * tree, GtkTreeIter * iter, Inkscape::XML::Node * repr);
+static NodeData * node_data_lookup (SPXMLViewTree * tree, Inkscape::XML::Node * repr);
+static void node_data_free (NodeData * data);
+static void node_data_free_children (NodeData * data);
+static void node_data_free_all (SPXMLViewTree * tree);
+
+static void add_node (SPXMLViewTree * tree, GtkTreeIter * parent, GtkTreeIter * before, Inkscape::XML::Node * repr);
+static void add_placeholder (SPXMLViewTree * tree, GtkTreeIter * parent);
+static void remove_child_rows (SPXMLViewTree * tree, GtkTreeIter * parent, gint count);
+static void populate (NodeData * data);
+static void depopulate (NodeData * data);
+static void sync_children (NodeData * data);
+static void rebuild_row (NodeData * data);
+static void set_label (NodeData * data);
+static gchar * node_label (Inkscape::XML::Node * repr);
+
+static void queue_change (SPXMLViewTree * tree, SPXMLViewTreePrivate::ReprSet & set, Inkscape::XML::Node * repr);
+static gboolean on_idle (gpointer data);
+static void flush_changes (SPXMLViewTree * tree);
 
 static void element_child_added (Inkscape::XML::Node * repr, Inkscape::XML::Node * child, Inkscape::XML::Node * ref, gpointer data);
 static void element_attr_changed (Inkscape::XML::Node * repr, const gchar * key, const gchar * old_value, const gchar * new_value, bool is_interactive, gpointer data);
 static void element_child_removed (Inkscape::XML::Node * repr, Inkscape::XML::Node * child, Inkscape::XML::Node * ref, gpointer data);
 static void element_order_changed (Inkscape::XML::Node * repr, Inkscape::XML::Node * child, Inkscape::XML::Node * oldref, Inkscape::XML::Node * newref, gpointer data);
 
-static void text_content_changed (Inkscape::XML::Node * repr, const gchar * old_content, const gchar * new_content, gpointer data);
-static void comment_content_changed (Inkscape::XML::Node * repr, const gchar * old_content, const gchar * new_content, gpointer data);
-static void pi_content_changed (Inkscape::XML::Node * repr, const gchar * old_content, const gchar * new_content, gpointer data);
+static void content_changed (Inkscape::XML::Node * repr, const gchar * old_content, const gchar * new_content, gpointer data);
 
-static gboolean ref_to_sibling (NodeData *node, Inkscape::XML::Node * ref, GtkTreeIter *);
-static gboolean repr_to_child (NodeData *node, Inkscape::XML::Node * repr, GtkTreeIter *);
+static gboolean same_row (GtkTreeIter * iter1, GtkTreeIter * iter2);
 static gboolean tree_model_iter_compare(GtkTreeModel* store, GtkTreeIter * iter1, GtkTreeIter * iter2);
 GtkTreeRowReference  *tree_iter_to_ref (SPXMLViewTree * tree, GtkTreeIter* iter);
 static gboolean tree_ref_to_iter (SPXMLViewTree * tree, GtkTreeIter* iter, GtkTreeRowReference  *ref);
 
 gboolean search_equal_func (GtkTreeModel *model, gint column, const gchar *key, GtkTreeIter *iter, gpointer search_data);
-gboolean foreach_func (GtkTreeModel *model, GtkTreePath  *path, GtkTreeIter  *iter, gpointer user_data);
 
 void on_row_changed(GtkTreeModel *tree_model, GtkTreePath *path, GtkTreeIter *iter, gpointer user_data);
 void on_drag_data_received(GtkWidget *wgt, GdkDragContext *context, int x, int y, GtkSelectionData *seldata, guint info, guint time, gpointer userdata);
 gboolean do_drag_motion(GtkWidget *widget, GdkDragContext *context, gint x, gint y, guint time, gpointer user_data);
+gboolean on_test_expand_row(GtkTreeView *view, GtkTreeIter *iter, GtkTreePath *path, gpointer user_data);
+void on_row_collapsed(GtkTreeView *view, GtkTreeIter *iter, GtkTreePath *path, gpointer user_data);
 
 static const Inkscape::XML::NodeEventVector element_repr_events = {
         element_child_added,
@@ -68,27 +98,11 @@ static const Inkscape::XML::NodeEventVector element_repr_events = {
         element_order_changed
 };
 
-static const Inkscape::XML::NodeEventVector text_repr_events = {
+static const Inkscape::XML::NodeEventVector content_repr_events = {
         NULL, /* child_added */
         NULL, /* child_removed */
         NULL, /* attr_changed */
-        text_content_changed,
-        NULL  /* order_changed */
-};
-
-static const Inkscape::XML::NodeEventVector comment_repr_events = {
-        NULL, /* child_added */
-        NULL, /* child_removed */
-        NULL, /* attr_changed */
-        comment_content_changed,
-        NULL  /* order_changed */
-};
-
-static const Inkscape::XML::NodeEventVector pi_repr_events = {
-        NULL, /* child_added */
-        NULL, /* child_removed */
-        NULL, /* attr_changed */
-        pi_content_changed,
+        content_changed,
         NULL  /* order_changed */
 };
 
@@ -98,7 +112,7 @@ GtkWidget *sp_xmlview_tree_new(Inkscape::XML::Node * repr, void * /*factory*/, v
 {
     SPXMLViewTree *tree = SP_XMLVIEW_TREE(g_object_new (SP_TYPE_XMLVIEW_TREE, NULL));
 
-    tree->store = gtk_tree_store_new (STORE_N_COLS, G_TYPE_STRING, G_TYPE_POINTER, G_TYPE_POINTER);
+    tree->store = gtk_tree_store_new (STORE_N_COLS, G_TYPE_STRING, G_TYPE_POINTER);
 
     // Detach the model from the view until all the data is loaded
     g_object_ref(tree->store);
@@ -115,6 +129,9 @@ GtkWidget *sp_xmlview_tree_new(Inkscape::XML::Node * repr, void * /*factory*/, v
     gtk_cell_renderer_set_padding (renderer, 2, 0);
     gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
 
+    g_signal_connect(GTK_TREE_VIEW(tree), "test-expand-row", G_CALLBACK(on_test_expand_row), tree);
+    g_signal_connect(GTK_TREE_VIEW(tree), "row-collapsed", G_CALLBACK(on_row_collapsed), tree);
+
     sp_xmlview_tree_set_repr (tree, repr);
 
     g_signal_connect(G_OBJECT(tree->store), "row-changed", G_CALLBACK(on_row_changed), tree);
@@ -176,6 +193,7 @@ sp_xmlview_tree_init (SPXMLViewTree * tree)
 	tree->repr = NULL;
 	tree->blocked = 0;
 	tree->dndactive = FALSE;
+	tree->priv = new SPXMLViewTreePrivate();
 }
 
 
@@ -187,7 +205,12 @@ void sp_xmlview_tree_destroy(GtkObject * object)
 {
 	SPXMLViewTree * tree = SP_XMLVIEW_TREE (object);
 
-	sp_xmlview_tree_set_repr (tree, NULL);
+	if (tree->priv) {
+		sp_xmlview_tree_set_repr (tree, NULL);
+		node_data_free_all (tree);
+		delete tree->priv;
+		tree->priv = NULL;
+	}
 
 #if GTK_CHECK_VERSION(3,0,0)
 	GTK_WIDGET_CLASS(parent_class)->destroy (object);
@@ -197,184 +220,406 @@ void sp_xmlview_tree_destroy(GtkObject * object)
 }
 
 /*
- * Add a new row to the tree
+ * Add a new row to the tree, with a placeholder child if the repr has children
  */
-GtkTreeRowReference *
+void
 add_node (SPXMLViewTree * tree, GtkTreeIter *parent, GtkTreeIter *before, Inkscape::XML::Node * repr)
 {
-	NodeData * data = NULL;
 	const Inkscape::XML::NodeEventVector * vec;
-	static const gchar *default_text[] = { "???" };
 
 	g_assert (tree != NULL);
 	g_assert (repr != NULL);
 
-    if (before && !gtk_tree_store_iter_is_valid(tree->store, before)) {
-        before = NULL;
-    }
+	/* a row left behind by drag and drop, see on_row_changed() */
+	NodeData *data = node_data_lookup (tree, repr);
+	if (data) {
+		node_data_free (data);
+	}
 
 	GtkTreeIter iter;
-    gtk_tree_store_insert_before (tree->store, &iter, parent, before);
+	gtk_tree_store_insert_before (tree->store, &iter, parent, before);
 
-    if (!gtk_tree_store_iter_is_valid(tree->store, &iter)) {
-        return NULL;
-    }
-
-    GtkTreeRowReference  *rowref = tree_iter_to_ref (tree, &iter);
-    data = node_data_new (tree, &iter, rowref, repr);
-    g_assert (data != NULL);
+	data = node_data_new (tree, &iter, repr);
+	g_assert (data != NULL);
 
-	gtk_tree_store_set (tree->store, &iter, STORE_TEXT_COL, default_text, STORE_DATA_COL, data, STORE_REPR_COL, repr, -1);
+	gchar *label = node_label (repr);
+	gtk_tree_store_set (tree->store, &iter, STORE_TEXT_COL, label, STORE_REPR_COL, repr, -1);
+	g_free (label);
 
-	if ( repr->type() == Inkscape::XML::TEXT_NODE ) {
-		vec = &text_repr_events;
-	} else if ( repr->type() == Inkscape::XML::COMMENT_NODE ) {
-		vec = &comment_repr_events;
-	} else if ( repr->type() == Inkscape::XML::PI_NODE ) {
-		vec = &pi_repr_events;
-	} else if ( repr->type() == Inkscape::XML::ELEMENT_NODE ) {
+	if ( repr->type() == Inkscape::XML::ELEMENT_NODE ) {
 		vec = &element_repr_events;
+	} else if ( repr->type() == Inkscape::XML::TEXT_NODE ||
+	            repr->type() == Inkscape::XML::COMMENT_NODE ||
+	            repr->type() == Inkscape::XML::PI_NODE ) {
+		vec = &content_repr_events;
 	} else {
 		vec = NULL;
 	}
 
 	if (vec) {
-		/* cheat a little to get the id updated properly */
-		if (repr->type() == Inkscape::XML::ELEMENT_NODE) {
-			element_attr_changed (repr, "id", NULL, NULL, false, data);
-		}
 		sp_repr_add_listener (repr, vec, data);
-		sp_repr_synthesize_events (repr, vec, data);
 	}
 
-	return rowref;
+	if (repr->firstChild()) {
+		add_placeholder (tree, &iter);
+	}
 }
 
-NodeData *node_data_new(SPXMLViewTree * tree, GtkTreeIter * /*node*/, GtkTreeRowReference  *rowref, Inkscape::XML::Node *repr)
+/*
+ * The child row which makes a row expandable before its children have rows
+ */
+void add_placeholder (SPXMLViewTree * tree, GtkTreeIter *parent)
+{
+    GtkTreeIter iter;
+    gtk_tree_store_append (tree->store, &iter, parent);
+    gtk_tree_store_set (tree->store, &iter, STORE_TEXT_COL, "", STORE_REPR_COL, NULL, -1);
+}
+
+/*
+ * Remove the first count child rows of parent, or all of them if count is negative.
+ * The caller frees their node data.
+ */
+void remove_child_rows (SPXMLViewTree * tree, GtkTreeIter *parent, gint count)
+{
+    GtkTreeIter child;
+    while (count-- != 0 && gtk_tree_model_iter_children (GTK_TREE_MODEL(tree->store), &child, parent)) {
+        gtk_tree_store_remove (tree->store, &child);
+    }
+}
+
+NodeData *node_data_new(SPXMLViewTree * tree, GtkTreeIter *iter, Inkscape::XML::Node *repr)
 {
     NodeData *data = g_new(NodeData, 1);
     data->tree = tree;
-    data->rowref = rowref;
+    data->iter = *iter;
     data->repr = repr;
+    data->populated = false;
     Inkscape::GC::anchor(repr);
+    tree->priv->nodes[repr] = data;
     return data;
 }
 
-void element_child_added (Inkscape::XML::Node * /*repr*/, Inkscape::XML::Node * child, Inkscape::XML::Node * ref, gpointer ptr)
+NodeData *node_data_lookup(SPXMLViewTree * tree, Inkscape::XML::Node *repr)
 {
-    NodeData *data = static_cast<NodeData *>(ptr);
-    GtkTreeIter before;
+    SPXMLViewTreePrivate::NodeMap::iterator found = tree->priv->nodes.find(repr);
+    return found != tree->priv->nodes.end() ? found->second : NULL;
+}
 
-    if (data->tree->blocked) return;
+/*
+ * Stop observing the repr of data and of the rows under it, without touching the rows
+ */
+void node_data_free(NodeData *data)
+{
+    node_data_free_children (data);
 
-    if (!ref_to_sibling (data, ref, &before)) {
+    sp_repr_remove_listener_by_data (data->repr, data);
+    data->tree->priv->nodes.erase (data->repr);
+    Inkscape::GC::release (data->repr);
+    g_free (data);
+}
+
+void node_data_free_children(NodeData *data)
+{
+    if (!data->populated) {
         return;
     }
+    for (Inkscape::XML::Node *child = data->repr->firstChild(); child; child = child->next()) {
+        NodeData *child_data = node_data_lookup (data->tree, child);
+        if (child_data) {
+            node_data_free (child_data);
+        }
+    }
+}
 
-    GtkTreeIter data_iter;
-    tree_ref_to_iter(data->tree, &data_iter,  data->rowref);
-    add_node (data->tree, &data_iter, &before, child);
+void node_data_free_all(SPXMLViewTree * tree)
+{
+    SPXMLViewTreePrivate *priv = tree->priv;
+    for (SPXMLViewTreePrivate::NodeMap::iterator i = priv->nodes.begin(); i != priv->nodes.end(); ++i) {
+        sp_repr_remove_listener_by_data (i->first, i->second);
+        Inkscape::GC::release (i->first);
+        g_free (i->second);
+    }
+    priv->nodes.clear();
+
+    priv->relabel.clear();
+    priv->resync.clear();
+    priv->rebuild.clear();
+    if (priv->idle_id) {
+        g_source_remove (priv->idle_id);
+        priv->idle_id = 0;
+    }
 }
 
-void element_attr_changed(Inkscape::XML::Node * repr, const gchar * key, const gchar * /*old_value*/, const gchar * new_value, bool /*is_interactive*/, gpointer ptr)
+/*
+ * Give the children of data rows of their own in place of the placeholder
+ */
+void populate(NodeData *data)
 {
-    NodeData *data = static_cast<NodeData *>(ptr);
-    gchar *label;
+    if (data->populated) {
+        return;
+    }
+    SPXMLViewTree *tree = data->tree;
 
-    if (data->tree->blocked) return;
+    // Rows are added before the old ones go, so that the row never looks childless
+    gint old_rows = gtk_tree_model_iter_n_children (GTK_TREE_MODEL(tree->store), &data->iter);
+    data->populated = true;
+    for (Inkscape::XML::Node *child = data->repr->firstChild(); child; child = child->next()) {
+        add_node (tree, &data->iter, NULL, child);
+    }
+    remove_child_rows (tree, &data->iter, old_rows);
+}
 
-    if (0 != strcmp (key, "id") && 0 != strcmp (key, "inkscape:label"))
+/*
+ * Drop the rows under data, leaving a placeholder if its repr has children
+ */
+void depopulate(NodeData *data)
+{
+    node_data_free_children (data);
+    remove_child_rows (data->tree, &data->iter, -1);
+    data->populated = false;
+
+    if (data->repr->firstChild()) {
+        add_placeholder (data->tree, &data->iter);
+    }
+}
+
+/*
+ * Bring the child rows of data in line with the children of its repr
+ */
+void sync_children(NodeData *data)
+{
+    SPXMLViewTree *tree = data->tree;
+    GtkTreeModel *model = GTK_TREE_MODEL(tree->store);
+
+    if (!data->populated) {
+        gboolean has_rows = gtk_tree_model_iter_has_child (model, &data->iter);
+        if (data->repr->firstChild() && !has_rows) {
+            add_placeholder (tree, &data->iter);
+        } else if (!data->repr->firstChild() && has_rows) {
+            remove_child_rows (tree, &data->iter, -1);
+        }
         return;
+    }
 
-    new_value = repr->attribute("id");
-    const gchar *layer = repr->attribute("inkscape:label");
+    GtkTreeIter row;
+    gboolean valid = gtk_tree_model_iter_children (model, &row, &data->iter);
+    for (Inkscape::XML::Node *child = data->repr->firstChild(); child; child = child->next()) {
+        NodeData *child_data = node_data_lookup (tree, child);
+        if (child_data && valid && same_row (&child_data->iter, &row)) {
+            valid = gtk_tree_model_iter_next (model, &row);
+            continue;
+        }
 
-    if (new_value && layer) {
-        label = g_strdup_printf ("<%s id=\"%s\" inkscape:label=\"%s\">", repr->name(), new_value, layer);
-    } else if (new_value) {
-        label = g_strdup_printf ("<%s id=\"%s\">", repr->name(), new_value);
-    } else {
-        label = g_strdup_printf ("<%s>", repr->name());
+        GtkTreeIter parent;
+        if (child_data && gtk_tree_model_iter_parent (model, &parent, &child_data->iter) &&
+            same_row (&parent, &data->iter)) {
+            // Its row is further down: reordered
+            gtk_tree_store_move_before (tree->store, &child_data->iter, valid ? &row : NULL);
+        } else {
+            add_node (tree, &data->iter, valid ? &row : NULL, child);
+        }
     }
 
-    GtkTreeIter iter;
-    if (tree_ref_to_iter(data->tree, &iter,  data->rowref)) {
-        gtk_tree_store_set (GTK_TREE_STORE(data->tree->store), &iter, STORE_TEXT_COL, label, -1);
+    // What is left belongs to children which are gone
+    while (valid) {
+        NodeData *child_data = node_data_lookup (tree, sp_xmlview_tree_node_get_repr (model, &row));
+        if (child_data && same_row (&child_data->iter, &row)) {
+            node_data_free (child_data);
+        }
+        valid = gtk_tree_store_remove (tree->store, &row);
+    }
+}
+
+/*
+ * Build the rows under a row copied by drag and drop again, see on_row_changed()
+ */
+void rebuild_row(NodeData *data)
+{
+    GtkTreeView *view = GTK_TREE_VIEW(data->tree);
+    GtkTreePath *path = gtk_tree_model_get_path (GTK_TREE_MODEL(data->tree->store), &data->iter);
+    gboolean expanded = gtk_tree_view_row_expanded (view, path);
+
+    depopulate (data);
+    if (expanded) {
+        gtk_tree_view_expand_row (view, path, FALSE);
     }
+    gtk_tree_path_free (path);
+}
+
+void set_label(NodeData *data)
+{
+    gchar *label = node_label (data->repr);
+    gtk_tree_store_set (data->tree->store, &data->iter, STORE_TEXT_COL, label, -1);
     g_free (label);
 }
 
-void element_child_removed(Inkscape::XML::Node * /*repr*/, Inkscape::XML::Node * child, Inkscape::XML::Node * /*ref*/, gpointer ptr)
+gchar *node_label(Inkscape::XML::Node *repr)
+{
+    switch (repr->type()) {
+        case Inkscape::XML::ELEMENT_NODE: {
+            const gchar *id = repr->attribute("id");
+            const gchar *layer = repr->attribute("inkscape:label");
+
+            if (id && layer) {
+                return g_strdup_printf ("<%s id=\"%s\" inkscape:label=\"%s\">", repr->name(), id, layer);
+            } else if (id) {
+                return g_strdup_printf ("<%s id=\"%s\">", repr->name(), id);
+            }
+            return g_strdup_printf ("<%s>", repr->name());
+        }
+        case Inkscape::XML::TEXT_NODE:
+            return g_strdup_printf ("\"%s\"", repr->content());
+        case Inkscape::XML::COMMENT_NODE:
+            return g_strdup_printf ("<!--%s-->", repr->content());
+        case Inkscape::XML::PI_NODE:
+            return g_strdup_printf ("<?%s %s?>", repr->name(), repr->content());
+        default:
+            return g_strdup ("???");
+    }
+}
+
+/*
+ * Note a change to apply at the next idle, so that a burst of changes updates each row once
+ */
+void queue_change(SPXMLViewTree * tree, SPXMLViewTreePrivate::ReprSet &set, Inkscape::XML::Node *repr)
+{
+    set.insert (repr);
+    if (!tree->priv->idle_id) {
+        tree->priv->idle_id = g_idle_add (on_idle, tree);
+    }
+}
+
+gboolean on_idle(gpointer data)
+{
+    SPXMLViewTree *tree = SP_XMLVIEW_TREE(data);
+    tree->priv->idle_id = 0;
+    flush_changes (tree);
+    return FALSE;
+}
+
+void flush_changes(SPXMLViewTree * tree)
+{
+    SPXMLViewTreePrivate *priv = tree->priv;
+    if (priv->idle_id) {
+        g_source_remove (priv->idle_id);
+        priv->idle_id = 0;
+    }
+
+    // Rows may come and go while applying the changes, hence the lookups
+    SPXMLViewTreePrivate::ReprSet rebuild, resync, relabel;
+    rebuild.swap (priv->rebuild);
+    resync.swap (priv->resync);
+    relabel.swap (priv->relabel);
+
+    for (SPXMLViewTreePrivate::ReprSet::iterator i = rebuild.begin(); i != rebuild.end(); ++i) {
+        NodeData *data = node_data_lookup (tree, *i);
+        if (data) {
+            rebuild_row (data);
+        }
+    }
+    for (SPXMLViewTreePrivate::ReprSet::iterator i = resync.begin(); i != resync.end(); ++i) {
+        NodeData *data = node_data_lookup (tree, *i);
+        if (data) {
+            sync_children (data);
+        }
+    }
+    for (SPXMLViewTreePrivate::ReprSet::iterator i = relabel.begin(); i != relabel.end(); ++i) {
+        NodeData *data = node_data_lookup (tree, *i);
+        if (data) {
+            set_label (data);
+        }
+    }
+}
+
+void element_child_added (Inkscape::XML::Node * repr, Inkscape::XML::Node * /*child*/, Inkscape::XML::Node * /*ref*/, gpointer ptr)
 {
     NodeData *data = static_cast<NodeData *>(ptr);
 
     if (data->tree->blocked) return;
 
-    GtkTreeIter iter;
-    if (repr_to_child (data, child, &iter)) {
-        gtk_tree_store_remove (GTK_TREE_STORE(data->tree->store), &iter);
-    }
+    queue_change (data->tree, data->tree->priv->resync, repr);
 }
 
-void element_order_changed(Inkscape::XML::Node * /*repr*/, Inkscape::XML::Node * child, Inkscape::XML::Node * /*oldref*/, Inkscape::XML::Node * newref, gpointer ptr)
+void element_attr_changed(Inkscape::XML::Node * repr, const gchar * key, const gchar * /*old_value*/, const gchar * /*new_value*/, bool /*is_interactive*/, gpointer ptr)
 {
     NodeData *data = static_cast<NodeData *>(ptr);
-    GtkTreeIter before, node;
 
     if (data->tree->blocked) return;
 
-    ref_to_sibling (data, newref, &before);
-    repr_to_child (data, child, &node);
+    if (0 != strcmp (key, "id") && 0 != strcmp (key, "inkscape:label"))
+        return;
 
-    if (gtk_tree_store_iter_is_valid(data->tree->store, &before)) {
-        gtk_tree_store_move_before (data->tree->store, &node, &before);
-    } else {
-        repr_to_child (data, newref, &before);
-        gtk_tree_store_move_after (data->tree->store, &node, &before);
-    }
+    queue_change (data->tree, data->tree->priv->relabel, repr);
 }
 
-void text_content_changed(Inkscape::XML::Node * /*repr*/, const gchar * /*old_content*/, const gchar * new_content, gpointer ptr)
+void element_child_removed(Inkscape::XML::Node * repr, Inkscape::XML::Node * child, Inkscape::XML::Node * /*ref*/, gpointer ptr)
 {
     NodeData *data = static_cast<NodeData *>(ptr);
 
     if (data->tree->blocked) return;
 
-    gchar *label = g_strdup_printf ("\"%s\"", new_content);
-    GtkTreeIter iter;
-    if (tree_ref_to_iter(data->tree, &iter,  data->rowref)) {
-        gtk_tree_store_set (GTK_TREE_STORE(data->tree->store), &iter, STORE_TEXT_COL, label, -1);
+    // Removed at once rather than at the next idle, so that no row outlives its repr's place in the document
+    NodeData *child_data = node_data_lookup (data->tree, child);
+    if (child_data) {
+        GtkTreeIter iter = child_data->iter;
+        node_data_free (child_data);
+        gtk_tree_store_remove (data->tree->store, &iter);
     }
 
-    g_free (label);
+    if (!data->populated) {
+        queue_change (data->tree, data->tree->priv->resync, repr);
+    }
 }
 
-void comment_content_changed(Inkscape::XML::Node * /*repr*/, const gchar * /*old_content*/, const gchar *new_content, gpointer ptr)
+void element_order_changed(Inkscape::XML::Node * repr, Inkscape::XML::Node * /*child*/, Inkscape::XML::Node * /*oldref*/, Inkscape::XML::Node * /*newref*/, gpointer ptr)
 {
-    NodeData *data = static_cast<NodeData*>(ptr);
+    NodeData *data = static_cast<NodeData *>(ptr);
 
     if (data->tree->blocked) return;
 
-    gchar *label = g_strdup_printf ("<!--%s-->", new_content);
-    GtkTreeIter iter;
-    if (tree_ref_to_iter(data->tree, &iter,  data->rowref)) {
-        gtk_tree_store_set (GTK_TREE_STORE(data->tree->store), &iter, STORE_TEXT_COL, label, -1);
-    }
-    g_free (label);
+    queue_change (data->tree, data->tree->priv->resync, repr);
 }
 
-void pi_content_changed(Inkscape::XML::Node *repr, const gchar * /*old_content*/, const gchar *new_content, gpointer ptr)
+void content_changed(Inkscape::XML::Node * repr, const gchar * /*old_content*/, const gchar * /*new_content*/, gpointer ptr)
 {
     NodeData *data = static_cast<NodeData *>(ptr);
 
     if (data->tree->blocked) return;
 
-    gchar *label = g_strdup_printf ("<?%s %s?>", repr->name(), new_content);
-    GtkTreeIter iter;
-    if (tree_ref_to_iter(data->tree, &iter,  data->rowref)) {
-        gtk_tree_store_set (GTK_TREE_STORE(data->tree->store), &iter, STORE_TEXT_COL, label, -1);
+    queue_change (data->tree, data->tree->priv->relabel, repr);
+}
+
+/*
+ * Create the child rows of a row as it is expanded
+ */
+gboolean on_test_expand_row(GtkTreeView * /*view*/, GtkTreeIter *iter, GtkTreePath * /*path*/, gpointer user_data)
+{
+    SPXMLViewTree *tree = SP_XMLVIEW_TREE(user_data);
+    NodeData *data = node_data_lookup (tree, sp_xmlview_tree_node_get_repr (GTK_TREE_MODEL(tree->store), iter));
+    if (!data) {
+        return TRUE;
+    }
+
+    if (!data->repr->firstChild()) {
+        // The children went away since the placeholder was added
+        sync_children (data);
+        return TRUE;
+    }
+
+    populate (data);
+    return FALSE;
+}
+
+/*
+ * Drop the child rows of a row, and stop observing their reprs, as it is collapsed
+ */
+void on_row_collapsed(GtkTreeView * /*view*/, GtkTreeIter *iter, GtkTreePath * /*path*/, gpointer user_data)
+{
+    SPXMLViewTree *tree = SP_XMLVIEW_TREE(user_data);
+    NodeData *data = node_data_lookup (tree, sp_xmlview_tree_node_get_repr (GTK_TREE_MODEL(tree->store), iter));
+    if (data && data->populated) {
+        depopulate (data);
     }
-    g_free (label);
 }
 
 /*
@@ -424,6 +669,20 @@ void on_row_changed(GtkTreeModel *tree_model, GtkTreePath *path, GtkTreeIter *it
     tree->dndactive = FALSE;
 
     Inkscape::XML::Node *repr = sp_xmlview_tree_node_get_repr(tree_model, iter);
+
+    /*
+     * The drop copied the row and removes the original after this, along with the rows
+     * below it: the repr keeps the copy, whose children are built again once the
+     * drop is over.
+     */
+    NodeData *data = node_data_lookup (tree, repr);
+    if (data) {
+        node_data_free_children (data);
+        data->iter = *iter;
+        data->populated = false;
+        queue_change (tree, tree->priv->rebuild, repr);
+    }
+
     GtkTreeIter new_parent;
     if (!gtk_tree_model_iter_parent(tree_model, &new_parent, iter)) {
         //No parent of drop location
@@ -474,70 +733,27 @@ void on_row_changed(GtkTreeModel *tree_model, GtkTreePath *path, GtkTreeIter *it
     }
     SP_XMLVIEW_TREE (tree)->blocked--;
 
-    // Reselect the dragged row
+    // Reselect the dragged row; expanding a new parent which had no child rows yet
+    // creates the row of repr anew
     GtkTreeSelection *selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(tree));
-    gtk_tree_view_expand_to_path (GTK_TREE_VIEW(tree), path);
-    //gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW(tree), path, NULL, true, 0.66, 0.0);
-    gtk_tree_selection_select_iter(selection, iter);
+    GtkTreePath *parent_path = gtk_tree_path_copy (path);
+    gtk_tree_path_up (parent_path);
+    gtk_tree_view_expand_to_path (GTK_TREE_VIEW(tree), parent_path);
+    gtk_tree_path_free (parent_path);
+
+    data = node_data_lookup (tree, repr);
+    if (data) {
+        GtkTreePath *row_path = gtk_tree_model_get_path (tree_model, &data->iter);
+        gtk_tree_view_expand_row (GTK_TREE_VIEW(tree), row_path, FALSE);
+        //gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW(tree), row_path, NULL, true, 0.66, 0.0);
+        gtk_tree_path_free (row_path);
+        gtk_tree_selection_select_iter(selection, &data->iter);
+    }
 
     // Signal that a drag and drop has completed successfully
     g_signal_emit_by_name(G_OBJECT (tree), "tree_move", GUINT_TO_POINTER(1) );
 }
 
-/*
- * Set iter to ref or node data's child with the same repr or first child
- */
-gboolean ref_to_sibling (NodeData *data, Inkscape::XML::Node *repr, GtkTreeIter *iter)
-{
-	if (repr) {
-		if (!repr_to_child (data, repr, iter)) {
-            return false;
-        }
-        gtk_tree_model_iter_next (GTK_TREE_MODEL(data->tree->store), iter);
-	} else {
-	    GtkTreeIter data_iter;
-	    if (!tree_ref_to_iter(data->tree, &data_iter,  data->rowref)) {
-	        return false;
-	    }
-	    gtk_tree_model_iter_children(GTK_TREE_MODEL(data->tree->store), iter, &data_iter);
-	}
-	return true;
-}
-
-/*
- * Set iter to the node data's child with the same repr
- */
-gboolean repr_to_child (NodeData *data, Inkscape::XML::Node * repr, GtkTreeIter *iter)
-{
-    GtkTreeIter data_iter;
-    tree_ref_to_iter(data->tree, &data_iter,  data->rowref);
-    GtkTreeModel *model = GTK_TREE_MODEL(data->tree->store);
-    gboolean valid = false;
-
-    if (!gtk_tree_store_iter_is_valid(data->tree->store, &data_iter)) {
-        return false;
-    }
-
-    /*
-     * The node we are looking for is likely to be the last one, so check it first.
-     */
-    gint n_children = gtk_tree_model_iter_n_children (model, &data_iter);
-    if (n_children > 1) {
-        valid = gtk_tree_model_iter_nth_child (model, iter, &data_iter, n_children-1);
-        if (valid && sp_xmlview_tree_node_get_repr (model, iter) == repr) {
-            //g_message("repr_to_child hit %d", n_children);
-            return valid;
-        }
-    }
-
-    valid = gtk_tree_model_iter_children(model, iter, &data_iter);
-    while (valid && sp_xmlview_tree_node_get_repr (model, iter) != repr) {
-        valid = gtk_tree_model_iter_next(model, iter);
-	}
-
-    return valid;
-}
-
 /*
  * Get a matching GtkTreeRowReference for a GtkTreeIter
  */
@@ -564,6 +780,14 @@ gboolean tree_ref_to_iter (SPXMLViewTree * tree, GtkTreeIter* iter, GtkTreeRowRe
     return gtk_tree_store_iter_is_valid(GTK_TREE_STORE(tree->store), iter);
 }
 
+/*
+ * Whether 2 GtkTreeIter of the store point to the same row
+ */
+gboolean same_row(GtkTreeIter * iter1, GtkTreeIter * iter2)
+{
+    return iter1->user_data == iter2->user_data;
+}
+
 /*
  * Compare 2 GtkTreeIter and return 0 if they are equal
  */
@@ -599,7 +823,8 @@ gboolean do_drag_motion(GtkWidget *widget, GdkDragContext *context, gint x, gint
         SPXMLViewTree *tree = SP_XMLVIEW_TREE(user_data);
         GtkTreeIter iter;
         gtk_tree_model_get_iter(GTK_TREE_MODEL(tree->store), &iter, path);
-        if (sp_xmlview_tree_node_get_repr (GTK_TREE_MODEL(tree->store), &iter)->type() != Inkscape::XML::ELEMENT_NODE) {
+        Inkscape::XML::Node *repr = sp_xmlview_tree_node_get_repr (GTK_TREE_MODEL(tree->store), &iter);
+        if (!repr || repr->type() != Inkscape::XML::ELEMENT_NODE) {
             action = 0;
         }
 
@@ -636,22 +861,23 @@ sp_xmlview_tree_set_repr (SPXMLViewTree * tree, Inkscape::XML::Node * repr)
         //gtk_tree_store_clear(tree->store);
         gtk_tree_view_set_model(GTK_TREE_VIEW(tree), NULL);
         g_object_unref(tree->store);
-        tree->store = gtk_tree_store_new (STORE_N_COLS, G_TYPE_STRING, G_TYPE_POINTER, G_TYPE_POINTER);
+        tree->store = gtk_tree_store_new (STORE_N_COLS, G_TYPE_STRING, G_TYPE_POINTER);
         gtk_tree_view_set_model (GTK_TREE_VIEW(tree), GTK_TREE_MODEL(tree->store));
 
+        node_data_free_all (tree);
         Inkscape::GC::release(tree->repr);
     }
     tree->repr = repr;
     if (repr) {
-        GtkTreeRowReference * rowref;
         Inkscape::GC::anchor(repr);
-        rowref = add_node (tree, NULL, NULL, repr);
+        add_node (tree, NULL, NULL, repr);
 
         // Set the tree model here, after all data is inserted
         gtk_tree_view_set_model (GTK_TREE_VIEW(tree), GTK_TREE_MODEL(tree->store));
         g_object_unref(tree->store);
 
-        GtkTreePath *path = gtk_tree_row_reference_get_path(rowref);
+        // Expanding creates the rows of the children
+        GtkTreePath *path = gtk_tree_model_get_path(GTK_TREE_MODEL(tree->store), &node_data_lookup (tree, repr)->iter);
         gtk_tree_view_expand_to_path (GTK_TREE_VIEW(tree), path);
         gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW(tree), path, NULL, true, 0.5, 0.0);
         gtk_tree_path_free(path);
@@ -672,41 +898,34 @@ sp_xmlview_tree_node_get_repr (GtkTreeModel *model, GtkTreeIter * iter)
 
 
 /*
- * Find a GtkTreeIter position in the tree by repr
+ * Find a GtkTreeIter position in the tree by repr, creating the rows of its ancestors'
+ * children on the way down if they were never expanded
  */
 gboolean
 sp_xmlview_tree_get_repr_node (SPXMLViewTree * tree, Inkscape::XML::Node * repr, GtkTreeIter *iter)
 {
-    /*
-     * Use a NodeData here to pass in the repr to the foreach function and store a rowref if found,
-     * if found we can return the iter
-     */
-    NodeData anode;
-    anode.tree = tree;
-    anode.repr = repr;
-    anode.rowref = NULL;
-
-    gtk_tree_model_foreach(GTK_TREE_MODEL(tree->store), foreach_func, &anode);
-    if (anode.rowref != NULL) {
-        tree_ref_to_iter(tree, iter, anode.rowref);
-        return TRUE;
+    flush_changes (tree);
+
+    std::vector<Inkscape::XML::Node *> missing;
+    Inkscape::XML::Node *node = repr;
+    NodeData *data = node_data_lookup (tree, node);
+    while (!data && node) {
+        missing.push_back (node);
+        node = node->parent();
+        data = node ? node_data_lookup (tree, node) : NULL;
     }
 
-    return FALSE;
-}
-
-gboolean foreach_func(GtkTreeModel *model, GtkTreePath * /*path*/, GtkTreeIter *iter, gpointer user_data)
-{
-    NodeData *anode = static_cast<NodeData *>(user_data);
-    Inkscape::XML::Node *iter_repr;
-    gtk_tree_model_get (model, iter, STORE_REPR_COL, &iter_repr, -1);
-    if (anode->repr == iter_repr) {
-        GtkTreeRowReference  *rowref = tree_iter_to_ref (anode->tree, iter);
-        anode->rowref = rowref;
-        return TRUE;
+    while (data && !missing.empty()) {
+        populate (data);
+        data = node_data_lookup (tree, missing.back());
+        missing.pop_back();
     }
 
-    return FALSE;
+    if (!data) {
+        return FALSE;
+    }
+    *iter = data->iter;
+    return TRUE;
 }
 
 /*
@@ -718,7 +937,7 @@ gboolean search_equal_func(GtkTreeModel *model, gint /*column*/, const gchar *ke
     gchar *text = 0;
     gtk_tree_model_get(model, iter, STORE_TEXT_COL, &text, -1);
 
-    gboolean match = (strstr(text, key) != NULL);
+    gboolean match = (text && strstr(text, key) != NULL);
 
     g_free(text);
 
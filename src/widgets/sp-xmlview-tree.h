@@ -26,7 +26,14 @@
 
 struct SPXMLViewTree;
 struct SPXMLViewTreeClass;
+struct SPXMLViewTreePrivate;
 
+/*
+ * Rows are only created for the children of expanded rows; a row whose repr has
+ * children but which was never expanded holds a single placeholder child, for which
+ * sp_xmlview_tree_node_get_repr returns NULL.  Only reprs with a row are observed,
+ * and the changes they report are applied to the store once per idle cycle.
+ */
 struct SPXMLViewTree
 {
 	GtkTreeView tree;
@@ -34,6 +41,7 @@ struct SPXMLViewTree
 	Inkscape::XML::Node * repr;
 	gint blocked;
     gboolean dndactive;
+    SPXMLViewTreePrivate *priv;
 };
 
 struct SPXMLViewTreeClass
@@ -49,6 +57,7 @@ GtkWidget * sp_xmlview_tree_new (Inkscape::XML::Node * repr, void * factory, voi
 void sp_xmlview_tree_set_repr (SPXMLViewTree * tree, Inkscape::XML::Node * repr);
 
 Inkscape::XML::Node * sp_xmlview_tree_node_get_repr (GtkTreeModel *model, GtkTreeIter * node);
+/* Creates the rows down to repr if needed, without expanding them */
 gboolean sp_xmlview_tree_get_repr_node (SPXMLViewTree * tree, Inkscape::XML::Node * repr, GtkTreeIter *node);
 
 
@@ -38,7 +38,7 @@ struct CommentNode : public SimpleNode {
     Inkscape::XML::NodeType type() const { return Inkscape::XML::COMMENT_NODE; }
 
 protected:
-    SimpleNode *_duplicate(Document* doc) const { return new CommentNode(*this, doc); }
+    SimpleNode *_duplicate(Document* doc) const { return new (_pool(doc)) CommentNode(*this, doc); }
 };
 
 }
@@ -34,7 +34,7 @@ public:
     Inkscape::XML::NodeType type() const { return Inkscape::XML::ELEMENT_NODE; }
 
 protected:
-    SimpleNode *_duplicate(Document* doc) const { return new ElementNode(*this, doc); }
+    SimpleNode *_duplicate(Document* doc) const { return new (_pool(doc)) ElementNode(*this, doc); }
 };
 
 }
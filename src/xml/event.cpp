@@ -14,7 +14,10 @@
  */
 
 #include <glib.h> // g_assert()
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <zlib.h>
 
 #include "event.h"
 #include "event-fns.h"
@@ -164,13 +167,13 @@ void Inkscape::XML::EventDel::_undoOne(
 void Inkscape::XML::EventChgAttr::_undoOne(
     Inkscape::XML::NodeObserver &observer
 ) const {
-    observer.notifyAttributeChanged(*this->repr, this->key, this->newval, this->oldval);
+    observer.notifyAttributeChanged(*this->repr, this->key, this->newval.get(), this->oldval.get());
 }
 
 void Inkscape::XML::EventChgContent::_undoOne(
     Inkscape::XML::NodeObserver &observer
 ) const {
-    observer.notifyContentChanged(*this->repr, this->newval, this->oldval);
+    observer.notifyContentChanged(*this->repr, this->newval.get(), this->oldval.get());
 }
 
 void Inkscape::XML::EventChgOrder::_undoOne(
@@ -223,13 +226,13 @@ void Inkscape::XML::EventDel::_replayOne(
 void Inkscape::XML::EventChgAttr::_replayOne(
     Inkscape::XML::NodeObserver &observer
 ) const {
-    observer.notifyAttributeChanged(*this->repr, this->key, this->oldval, this->newval);
+    observer.notifyAttributeChanged(*this->repr, this->key, this->oldval.get(), this->newval.get());
 }
 
 void Inkscape::XML::EventChgContent::_replayOne(
     Inkscape::XML::NodeObserver &observer
 ) const {
-    observer.notifyContentChanged(*this->repr, this->oldval, this->newval);
+    observer.notifyContentChanged(*this->repr, this->oldval.get(), this->newval.get());
 }
 
 void Inkscape::XML::EventChgOrder::_replayOne(
@@ -275,6 +278,118 @@ sp_repr_free_log (Inkscape::XML::Event *log)
     }
 }
 
+void
+sp_repr_pack_log (Inkscape::XML::Event *log, std::size_t threshold)
+{
+    for ( Inkscape::XML::Event *action = log ; action ; action = action->next ) {
+        action->packOne(threshold);
+    }
+}
+
+std::size_t
+sp_repr_log_memory_use (Inkscape::XML::Event const *log)
+{
+    std::size_t size = 0;
+    for ( Inkscape::XML::Event const *action = log ; action ; action = action->next ) {
+        size += action->memoryUseOne();
+    }
+    return size;
+}
+
+Inkscape::Util::ptr_shared<char> Inkscape::XML::LoggedValue::get() const
+{
+    if (!_packed) {
+        return _value;
+    }
+
+    char *value = new (Inkscape::GC::ATOMIC) char[_length + 1];
+    uLongf length = _length;
+    int const status = uncompress(reinterpret_cast<Bytef *>(value), &length, _packed, _packed_size);
+    g_assert(status == Z_OK && length == _length);
+    value[_length] = 0;
+    return Inkscape::Util::share_unsafe(value);
+}
+
+void Inkscape::XML::LoggedValue::pack(std::size_t threshold)
+{
+    if (_packed || !_value) {
+        return;
+    }
+    std::size_t const length = std::strlen(_value.pointer());
+    if (length < threshold) {
+        return;
+    }
+
+    uLongf size = compressBound(length);
+    unsigned char *packed = static_cast<unsigned char *>(g_malloc(size));
+    if (compress2(packed, &size, reinterpret_cast<Bytef const *>(_value.pointer()), length, Z_BEST_SPEED) != Z_OK ||
+        size > length - length / 4)
+    {
+        g_free(packed);
+        return;
+    }
+
+    _packed = static_cast<unsigned char *>(g_realloc(packed, size));
+    _packed_size = size;
+    _length = length;
+    _value = Inkscape::Util::share_unsafe<char>(NULL);
+}
+
+std::size_t Inkscape::XML::LoggedValue::memoryUse() const
+{
+    if (_packed) {
+        return _packed_size;
+    }
+    // Values that are not packed may be shared with the document or other events,
+    // so this overestimates.
+    return _value ? std::strlen(_value.pointer()) + 1 : 0;
+}
+
+void Inkscape::XML::LoggedValue::swap(LoggedValue &other)
+{
+    std::swap(_value, other._value);
+    std::swap(_packed, other._packed);
+    std::swap(_packed_size, other._packed_size);
+    std::swap(_length, other._length);
+}
+
+void Inkscape::XML::EventChgAttr::_packOne(std::size_t threshold)
+{
+    this->oldval.pack(threshold);
+    this->newval.pack(threshold);
+}
+
+void Inkscape::XML::EventChgContent::_packOne(std::size_t threshold)
+{
+    this->oldval.pack(threshold);
+    this->newval.pack(threshold);
+}
+
+std::size_t Inkscape::XML::EventAdd::_memoryUseOne() const
+{
+    return sizeof(*this);
+}
+
+std::size_t Inkscape::XML::EventDel::_memoryUseOne() const
+{
+    return sizeof(*this);
+}
+
+std::size_t Inkscape::XML::EventChgAttr::_memoryUseOne() const
+{
+    return sizeof(*this) + this->oldval.memoryUse() + this->newval.memoryUse();
+}
+
+std::size_t Inkscape::XML::EventChgContent::_memoryUseOne() const
+{
+    return sizeof(*this) + this->oldval.memoryUse() + this->newval.memoryUse();
+}
+
+std::size_t Inkscape::XML::EventChgOrder::_memoryUseOne() const
+{
+    return sizeof(*this);
+}
+
 namespace {
 
 template <typename T> struct ActionRelations;
@@ -332,7 +447,7 @@ Inkscape::XML::Event *Inkscape::XML::EventChgAttr::_optimizeOne() {
              chg_attr->key == this->key )
         {
             /* replace our oldval with the prior action's */
-            this->oldval = chg_attr->oldval;
+            this->oldval.swap(chg_attr->oldval);
 
             /* discard the prior action */
             this->next = chg_attr->next;
@@ -350,7 +465,7 @@ Inkscape::XML::Event *Inkscape::XML::EventChgContent::_optimizeOne() {
     if (chg_content) {
         if (chg_content->repr == this->repr ) {
             /* replace our oldval with the prior action's */
-            this->oldval = chg_content->oldval;
+            this->oldval.swap(chg_content->oldval);
 
             /* get rid of the prior action*/
             this->next = chg_content->next;
@@ -21,6 +21,7 @@
 #include <glib.h>
 #include <glibmm/ustring.h>
 
+#include <cstddef>
 #include <iterator>
 #include "util/share.h"
 #include "util/forward-pointer-iterator.h"
@@ -41,6 +42,44 @@ enum EventType {
     EVENT_CHG_ORDER ///< Order of children changed
 };
 
+/**
+ * @brief Attribute value or node content kept by an event
+ *
+ * Long values, which are mostly path data, can be packed with zlib while they sit
+ * in the undo history; they are unpacked again only when the event is undone or replayed.
+ */
+class LoggedValue {
+public:
+    LoggedValue(Inkscape::Util::ptr_shared<char> value)
+    : _value(value), _packed(NULL), _packed_size(0), _length(0) {}
+    ~LoggedValue() { g_free(_packed); }
+
+    /**
+     * @brief Get the value
+     *
+     * A packed value is unpacked into a new string on each call.
+     */
+    Inkscape::Util::ptr_shared<char> get() const;
+    /**
+     * @brief Pack the value if it is at least @a threshold bytes long
+     *
+     * The value is left as it is if packing would not save a quarter of its size.
+     */
+    void pack(std::size_t threshold);
+    /// Number of bytes the value takes up as it is kept
+    std::size_t memoryUse() const;
+    void swap(LoggedValue &other);
+
+private:
+    LoggedValue(LoggedValue const &); // no copy
+    void operator=(LoggedValue const &); // no assign
+
+    Inkscape::Util::ptr_shared<char> _value; ///< NULL while packed
+    unsigned char *_packed;
+    std::size_t _packed_size;
+    std::size_t _length; ///< unpacked length of a packed value
+};
+
 /**
  * @brief Generic XML modification event
  *
@@ -93,6 +132,14 @@ public:
      * @return Pointer to the optimized event chain, which may have changed
      */
     Event *optimizeOne() { return _optimizeOne(); }
+    /**
+     * @brief Pack the long values this event keeps, see LoggedValue::pack()
+     */
+    void packOne(std::size_t threshold) { _packOne(threshold); }
+    /**
+     * @brief Number of bytes taken up by this event and the values it keeps
+     */
+    std::size_t memoryUseOne() const { return _memoryUseOne(); }
     /**
      * @brief Undo this event to an observer
      *
@@ -118,6 +165,8 @@ protected:
     virtual Event *_optimizeOne()=0;
     virtual void _undoOne(NodeObserver &) const=0;
     virtual void _replayOne(NodeObserver &) const=0;
+    virtual void _packOne(std::size_t /*threshold*/) {}
+    virtual std::size_t _memoryUseOne() const=0;
 
 private:
     static int _next_serial;
@@ -140,6 +189,7 @@ private:
     Event *_optimizeOne();
     void _undoOne(NodeObserver &observer) const;
     void _replayOne(NodeObserver &observer) const;
+    std::size_t _memoryUseOne() const;
 };
 
 /**
@@ -159,6 +209,7 @@ private:
     Event *_optimizeOne();
     void _undoOne(NodeObserver &observer) const;
     void _replayOne(NodeObserver &observer) const;
+    std::size_t _memoryUseOne() const;
 };
 
 /**
@@ -176,14 +227,16 @@ public:
     /// GQuark corresponding to the changed attribute's name
     GQuark key;
     /// Value of the attribute before the change
-    Inkscape::Util::ptr_shared<char> oldval;
+    LoggedValue oldval;
     /// Value of the attribute after the change
-    Inkscape::Util::ptr_shared<char> newval;
+    LoggedValue newval;
 
 private:
     Event *_optimizeOne();
     void _undoOne(NodeObserver &observer) const;
     void _replayOne(NodeObserver &observer) const;
+    void _packOne(std::size_t threshold);
+    std::size_t _memoryUseOne() const;
 };
 
 /**
@@ -198,14 +251,16 @@ public:
     : Event(repr, next), oldval(ov), newval(nv) {}
 
     /// Content of the node before the change
-    Inkscape::Util::ptr_shared<char> oldval;
+    LoggedValue oldval;
     /// Content of the node after the change
-    Inkscape::Util::ptr_shared<char> newval;
+    LoggedValue newval;
 
 private:
     Event *_optimizeOne();
     void _undoOne(NodeObserver &observer) const;
     void _replayOne(NodeObserver &observer) const;
+    void _packOne(std::size_t threshold);
+    std::size_t _memoryUseOne() const;
 };
 
 /**
@@ -228,6 +283,7 @@ private:
     Event *_optimizeOne();
     void _undoOne(NodeObserver &observer) const;
     void _replayOne(NodeObserver &observer) const;
+    std::size_t _memoryUseOne() const;
 };
 
 }
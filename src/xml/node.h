@@ -144,6 +144,16 @@ public:
      * @param key The name of the node's attribute
      */
     virtual gchar const *attribute(gchar const *key) const=0;
+
+    /**
+     * @brief Get the string representation of a node's attribute, by its GQuark
+     *
+     * Same as attribute(), but skips interning the name. Use it when the quark of the
+     * attribute name is already at hand, or can be cached.
+     *
+     * @param key The GQuark of the attribute's name
+     */
+    virtual gchar const *attributeByKey(GQuark key) const=0;
     
     /**
      * @brief Get a list of the node's attributes
@@ -204,6 +214,17 @@ public:
      * @param is_interactive Ignored
      */
     virtual void setAttribute(gchar const *key, gchar const *value, bool is_interactive=false)=0;
+
+    /**
+     * @brief Change an attribute of this node, given the GQuark of its name
+     *
+     * Same as setAttribute(), but skips interning the name.
+     *
+     * @param key The GQuark of the attribute's name
+     * @param value The new value of the attribute
+     * @param is_interactive Ignored
+     */
+    virtual void setAttributeByKey(GQuark key, gchar const *value, bool is_interactive=false)=0;
     
     /**
      * @brief Directly set the integer GQuark code for the name of the node
@@ -36,7 +36,7 @@ struct PINode : public SimpleNode {
     Inkscape::XML::NodeType type() const { return Inkscape::XML::PI_NODE; }
 
 protected:
-    SimpleNode *_duplicate(Document* doc) const { return new PINode(*this, doc); }
+    SimpleNode *_duplicate(Document* doc) const { return new (_pool(doc)) PINode(*this, doc); }
 };
 
 }
@@ -1,6 +1,7 @@
 #include <cxxtest/TestSuite.h>
 
 #include <cstdlib>
+#include <string>
 #include <glib.h>
 
 #include "repr.h"
@@ -87,6 +88,33 @@ public:
         sp_repr_unparent(c);
     }
 
+    void testUndoOfPackedAttributeChange()
+    {
+        std::string before("M 0,0");
+        std::string after("M 0,0");
+        for (int i = 0; i < 2000; i++) {
+            before += " L 1.5,2.5";
+            after += " L 3.5,4.5";
+        }
+        a->setAttribute("d", before.c_str());
+
+        sp_repr_begin_transaction(document);
+        a->setAttribute("d", after.c_str());
+        Inkscape::XML::Event *log = sp_repr_commit_undoable(document);
+
+        std::size_t const unpacked = sp_repr_log_memory_use(log);
+        sp_repr_pack_log(log, 1024);
+        TS_ASSERT_LESS_THAN(sp_repr_log_memory_use(log), unpacked);
+
+        sp_repr_undo_log(log);
+        TS_ASSERT_EQUALS(std::string(a->attribute("d")), before);
+        sp_repr_replay_log(log);
+        TS_ASSERT_EQUALS(std::string(a->attribute("d")), after);
+
+        sp_repr_free_log(log);
+        a->setAttribute("d", NULL);
+    }
+
     /* lots more tests needed ... */
 };
 
@@ -0,0 +1,212 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cstring>
+#include <string>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "repr.h"
+
+class XmlReprIoTest : public CxxTest::TestSuite
+{
+    std::string filename;
+    std::string entities_filename;
+
+public:
+
+    XmlReprIoTest()
+    {
+        Inkscape::GC::init();
+
+        std::string svg("<svg xmlns='http://www.w3.org/2000/svg'>");
+        for (int i = 0; i < 20000; i++) {
+            svg += "<rect width='10' height='10'/>";
+        }
+        svg += "</svg>";
+
+        gchar *name = g_build_filename(g_get_tmp_dir(), "repr-io-test.svg", NULL);
+        if (g_file_set_contents(name, svg.c_str(), svg.size(), NULL)) {
+            filename = name;
+        }
+        g_free(name);
+
+        static gchar const entities_svg[] =
+            "<?xml version='1.0'?>\n"
+            "<!DOCTYPE svg [<!ENTITY foo 'F&amp;O'>]>\n"
+            "<svg xmlns='http://www.w3.org/2000/svg'>"
+            "<text a='x&amp;y&lt;z' b='&foo;'>t&amp;&lt;&foo;</text>"
+            "</svg>";
+        name = g_build_filename(g_get_tmp_dir(), "repr-io-test-entities.svg", NULL);
+        if (g_file_set_contents(name, entities_svg, -1, NULL)) {
+            entities_filename = name;
+        }
+        g_free(name);
+    }
+    virtual ~XmlReprIoTest()
+    {
+        if (!filename.empty()) {
+            g_unlink(filename.c_str());
+        }
+        if (!entities_filename.empty()) {
+            g_unlink(entities_filename.c_str());
+        }
+    }
+
+// createSuite and destroySuite get us per-suite setup and teardown
+// without us having to worry about static initialization order, etc.
+    static XmlReprIoTest *createSuite() { return new XmlReprIoTest(); }
+    static void destroySuite( XmlReprIoTest *suite ) { delete suite; }
+
+    void testReadFileSubstitutesEntities()
+    {
+        TS_ASSERT(!entities_filename.empty());
+
+        Inkscape::XML::Document *rdoc = sp_repr_read_file(entities_filename.c_str(), SP_SVG_NS_URI);
+        assertEntitiesSubstituted(rdoc);
+        if (rdoc) {
+            Inkscape::GC::release(rdoc);
+        }
+    }
+
+    void testFileReaderMatchesReadFile()
+    {
+        TS_ASSERT(!filename.empty());
+
+        Inkscape::XML::ReprFileReader reader(filename.c_str(), SP_SVG_NS_URI);
+        double last = 0;
+        while (reader.step()) {
+            double const progress = reader.progress();
+            TS_ASSERT(progress >= 0 && progress <= 1);
+            last = progress;
+        }
+        TS_ASSERT(last <= 1);
+        Inkscape::XML::Document *rdoc = reader.document();
+        Inkscape::XML::Document *expected = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI);
+
+        TS_ASSERT(rdoc && expected);
+        if ( rdoc && expected ) {
+            TS_ASSERT_EQUALS(std::string(rdoc->root()->name()), "svg:svg");
+            TS_ASSERT_EQUALS(rdoc->root()->childCount(), expected->root()->childCount());
+            TS_ASSERT_EQUALS(rdoc->root()->childCount(), 20000u);
+        }
+        if (rdoc) {
+            Inkscape::GC::release(rdoc);
+        }
+        if (expected) {
+            Inkscape::GC::release(expected);
+        }
+    }
+
+    void testFileReaderSubstitutesEntities()
+    {
+        TS_ASSERT(!entities_filename.empty());
+
+        Inkscape::XML::ReprFileReader reader(entities_filename.c_str(), SP_SVG_NS_URI);
+        Inkscape::XML::Document *rdoc = reader.document();
+        assertEntitiesSubstituted(rdoc);
+        if (rdoc) {
+            Inkscape::GC::release(rdoc);
+        }
+    }
+
+    void testFileReaderCancel()
+    {
+        Inkscape::XML::ReprFileReader reader(filename.c_str(), SP_SVG_NS_URI);
+        reader.step();
+        reader.cancel();
+        TS_ASSERT(!reader.step());
+        TS_ASSERT(reader.document() == NULL);
+    }
+
+    void testFileReaderMissingFile()
+    {
+        Inkscape::XML::ReprFileReader reader("no-such-file.svg", SP_SVG_NS_URI);
+        TS_ASSERT(reader.document() == NULL);
+    }
+
+    void testSnapshotMatchesSaveFile()
+    {
+        Inkscape::XML::Document *doc = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI);
+        TS_ASSERT(doc);
+        if (!doc) {
+            return;
+        }
+
+        gchar *saved = g_build_filename(g_get_tmp_dir(), "repr-io-test-saved.svg", NULL);
+        gchar *written = g_build_filename(g_get_tmp_dir(), "repr-io-test-snapshot.svg", NULL);
+        gchar *compressed = g_build_filename(g_get_tmp_dir(), "repr-io-test-snapshot.svgz", NULL);
+
+        TS_ASSERT(sp_repr_save_file(doc, saved, SP_SVG_NS_URI));
+        Inkscape::XML::ReprSnapshot *snapshot = new Inkscape::XML::ReprSnapshot(doc, SP_SVG_NS_URI);
+
+        // later changes do not reach the snapshot
+        doc->root()->setAttribute("width", "100");
+        doc->root()->removeChild(doc->root()->firstChild());
+
+        TS_ASSERT(snapshot->write(written, false));
+        TS_ASSERT(snapshot->write(compressed, true));
+        delete snapshot;
+
+        gchar *expected_text = NULL;
+        gchar *written_text = NULL;
+        TS_ASSERT(g_file_get_contents(saved, &expected_text, NULL, NULL));
+        TS_ASSERT(g_file_get_contents(written, &written_text, NULL, NULL));
+        if ( expected_text && written_text ) {
+            TS_ASSERT_EQUALS(std::string(written_text), std::string(expected_text));
+        }
+        g_free(expected_text);
+        g_free(written_text);
+
+        Inkscape::XML::Document *reread = sp_repr_read_file(compressed, SP_SVG_NS_URI);
+        TS_ASSERT(reread);
+        if (reread) {
+            TS_ASSERT_EQUALS(reread->root()->childCount(), 20000u);
+            Inkscape::GC::release(reread);
+        }
+
+        g_unlink(saved);
+        g_unlink(written);
+        g_unlink(compressed);
+        g_free(saved);
+        g_free(written);
+        g_free(compressed);
+        Inkscape::GC::release(doc);
+    }
+
+private:
+    /** Checks the document read from entities_filename. */
+    void assertEntitiesSubstituted(Inkscape::XML::Document *rdoc)
+    {
+        TS_ASSERT(rdoc);
+        if (!rdoc) {
+            return;
+        }
+        Inkscape::XML::Node *text = rdoc->root()->firstChild();
+        TS_ASSERT(text);
+        if (!text) {
+            return;
+        }
+        TS_ASSERT_EQUALS(str(text->attribute("a")), "x&y<z");
+        TS_ASSERT_EQUALS(str(text->attribute("b")), "F&O");
+        TS_ASSERT(text->firstChild());
+        if (text->firstChild()) {
+            TS_ASSERT_EQUALS(str(text->firstChild()->content()), "t&<F&O");
+        }
+    }
+
+    static std::string str(gchar const *s)
+    {
+        return s ? s : "(null)";
+    }
+};
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -14,11 +14,17 @@
 # include <config.h>
 #endif
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <stdexcept>
+#include <map>
+#include <vector>
+#include <sys/stat.h>
 
 #include <libxml/parser.h>
+#include <libxml/parserInternals.h>
+#include <libxml/SAX2.h>
 
 #include "xml/repr.h"
 #include "xml/attribute-record.h"
@@ -38,6 +44,11 @@
 #include "preferences.h"
 
 #include <glibmm/miscutils.h>
+#if WITH_GLIBMM_2_32 && HAVE_GLIBMM_THREADS_H
+# include <glibmm/threads.h>
+#else
+# include <glibmm/thread.h>
+#endif
 
 using Inkscape::IO::Writer;
 using Inkscape::Util::List;
@@ -50,6 +61,7 @@ using Inkscape::XML::calc_abs_doc_base;
 using Inkscape::XML::rebase_href_attrs;
 
 Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns);
+static void sp_repr_finish_read (Node *root, const gchar *default_ns);
 static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gchar *default_ns, GHashTable *prefix_map);
 static gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar *default_ns, GHashTable *prefix_map);
 static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
@@ -104,6 +116,7 @@ public:
     int setFile( char const * filename, bool load_entities );
 
     xmlDocPtr readXml();
+    Document *readRepr(const gchar *default_ns);
 
     static int readCb( void * context, char * buffer, int len );
     static int closeCb( void * context );
@@ -111,7 +124,13 @@ public:
     char const* getEncoding() const { return encoding; }
     int read( char * buffer, int len );
     int close();
+
+    /** Fraction of the file read so far, or -1 if unknown. */
+    double readFraction() const;
+
+    int parseOptions() const;
 private:
+
     const char* filename;
     char* encoding;
     FILE* fp;
@@ -219,7 +238,7 @@ int XmlSource::setFile(char const *filename, bool load_entities=false)
     return retVal;
 }
 
-xmlDocPtr XmlSource::readXml()
+int XmlSource::parseOptions() const
 {
     int parse_options = XML_PARSE_HUGE | XML_PARSE_RECOVER;
 
@@ -230,8 +249,13 @@ xmlDocPtr XmlSource::readXml()
     // Allow NOENT only if we're filtering out SYSTEM and PUBLIC entities
     if (LoadEntities)     parse_options |= XML_PARSE_NOENT;
 
+    return parse_options;
+}
+
+xmlDocPtr XmlSource::readXml()
+{
     return xmlReadIO( readCb, closeCb, this,
-                      filename, getEncoding(), parse_options);
+                      filename, getEncoding(), parseOptions());
 }
 
 int XmlSource::readCb( void * context, char * buffer, int len )
@@ -301,6 +325,19 @@ int XmlSource::read( char *buffer, int len )
     return retVal;
 }
 
+double XmlSource::readFraction() const
+{
+    struct stat st;
+    if ( !fp || fstat(fileno(fp), &st) != 0 || st.st_size <= 0 ) {
+        return -1;
+    }
+    long pos = ftell(fp);
+    if ( pos < 0 ) {
+        return -1;
+    }
+    return CLAMP(static_cast<double>(pos) / st.st_size, 0.0, 1.0);
+}
+
 int XmlSource::close()
 {
     if ( gzin ) {
@@ -321,6 +358,334 @@ int XmlSource::close()
     return 0;
 }
 
+namespace {
+
+/**
+ * Builds a repr tree directly from libxml2 SAX2 events, so that the document never exists
+ * as a libxml2 tree as well. The result is the same as sp_repr_do_read on the parsed tree.
+ */
+class SaxReprBuilder
+{
+public:
+    SaxReprBuilder(const gchar *default_ns)
+        : _default_ns(default_ns),
+          _doc(NULL),
+          _root(NULL),
+          _old_sax(NULL),
+          _text_cdata(false)
+    {}
+
+    Document *parse(xmlParserCtxtPtr ctxt);
+
+    /**
+     * Takes over the events of \a ctxt, for a push parser fed by the caller; end()
+     * then returns the document as parse() does.
+     */
+    void begin(xmlParserCtxtPtr ctxt);
+    Document *end(xmlParserCtxtPtr ctxt);
+
+private:
+    struct NameKey {
+        NameKey(const xmlChar *l, const xmlChar *p, const xmlChar *u) : localname(l), prefix(p), uri(u) {}
+        bool operator<(NameKey const &other) const {
+            if (localname != other.localname) return localname < other.localname;
+            if (prefix != other.prefix) return prefix < other.prefix;
+            return uri < other.uri;
+        }
+        const xmlChar *localname;
+        const xmlChar *prefix;
+        const xmlChar *uri;
+    };
+    typedef std::map<NameKey, GQuark> NameMap;
+
+    static SaxReprBuilder *get(void *ctx) {
+        return static_cast<SaxReprBuilder *>(static_cast<xmlParserCtxtPtr>(ctx)->_private);
+    }
+
+    static void startElementCb(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+                               const xmlChar *URI, int nb_namespaces, const xmlChar **namespaces,
+                               int nb_attributes, int nb_defaulted, const xmlChar **attributes);
+    static void endElementCb(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+                             const xmlChar *URI);
+    static void charactersCb(void *ctx, const xmlChar *ch, int len);
+    static void cdataBlockCb(void *ctx, const xmlChar *value, int len);
+    static void commentCb(void *ctx, const xmlChar *value);
+    static void processingInstructionCb(void *ctx, const xmlChar *target, const xmlChar *data);
+    static xmlEntityPtr getEntityCb(void *ctx, const xmlChar *name);
+
+    GQuark qualifiedName(xmlParserCtxtPtr ctxt, const xmlChar *localname,
+                         const xmlChar *prefix, const xmlChar *URI);
+    void append(Node *repr);
+    void appendText(gchar const *content, bool is_cdata);
+    void flushText();
+
+    const gchar *_default_ns;
+    Document *_doc;
+    Node *_root;
+    xmlSAXHandler _handler;
+    xmlSAXHandlerPtr _old_sax;
+    std::vector<Node *> _parents;
+    std::string _text; ///< character data not yet turned into a text node
+    bool _text_cdata;
+    std::string _value;
+    NameMap _names;
+};
+
+Document *SaxReprBuilder::parse(xmlParserCtxtPtr ctxt)
+{
+    begin(ctxt);
+    xmlParseDocument(ctxt);
+    return end(ctxt);
+}
+
+void SaxReprBuilder::begin(xmlParserCtxtPtr ctxt)
+{
+    xmlSAXVersion(&_handler, 2);
+    _handler.startElement = NULL;
+    _handler.endElement = NULL;
+    _handler.startElementNs = startElementCb;
+    _handler.endElementNs = endElementCb;
+    _handler.characters = charactersCb;
+    _handler.ignorableWhitespace = charactersCb;
+    _handler.cdataBlock = cdataBlockCb;
+    _handler.comment = commentCb;
+    _handler.processingInstruction = processingInstructionCb;
+    _handler.getEntity = getEntityCb;
+    // entities are substituted, there is no tree to hang references on
+    _handler.reference = NULL;
+
+    // xmlCtxtUseOptions clears this without XML_PARSE_NOENT; the events would then carry
+    // attribute values with character references for '&' and user entities left as they are
+    ctxt->replaceEntities = 1;
+
+    // created anchored, which keeps the tree alive between pushed chunks
+    _doc = new Inkscape::XML::SimpleDocument();
+
+    // The default SAX2 handlers still keep the DTD in ctxt->myDoc, for entity lookup
+    _old_sax = ctxt->sax;
+    ctxt->sax = &_handler;
+    ctxt->_private = this;
+}
+
+Document *SaxReprBuilder::end(xmlParserCtxtPtr ctxt)
+{
+    ctxt->sax = _old_sax;
+    ctxt->_private = NULL;
+    _old_sax = NULL;
+
+    if (ctxt->myDoc) {
+        xmlFreeDoc(ctxt->myDoc);
+        ctxt->myDoc = NULL;
+    }
+
+    Document *rdoc = _doc;
+    _doc = NULL;
+    if ( !_root || !( ctxt->wellFormed || ctxt->recovery ) ) {
+        Inkscape::GC::release(rdoc);
+        return NULL;
+    }
+
+    sp_repr_finish_read(_root, _default_ns);
+    return rdoc;
+}
+
+GQuark SaxReprBuilder::qualifiedName(xmlParserCtxtPtr ctxt, const xmlChar *localname,
+                                     const xmlChar *prefix, const xmlChar *URI)
+{
+    // Names come from the parser dictionary, so the pointers alone identify them
+    bool const cacheable = ctxt->dict
+        && xmlDictOwns(ctxt->dict, localname) == 1
+        && ( !prefix || xmlDictOwns(ctxt->dict, prefix) == 1 )
+        && ( !URI || xmlDictOwns(ctxt->dict, URI) == 1 );
+    NameKey const key(localname, prefix, URI);
+    if (cacheable) {
+        NameMap::iterator found = _names.find(key);
+        if ( found != _names.end() ) {
+            return found->second;
+        }
+    }
+
+    gchar const *ns_prefix = NULL;
+    if (URI) {
+        ns_prefix = sp_xml_ns_uri_prefix(reinterpret_cast<const gchar *>(URI),
+                                         reinterpret_cast<const gchar *>(prefix));
+    }
+    GQuark code;
+    if (ns_prefix) {
+        gchar *name = g_strconcat(ns_prefix, ":", reinterpret_cast<const gchar *>(localname), NULL);
+        code = g_quark_from_string(name);
+        g_free(name);
+    } else {
+        code = g_quark_from_string(reinterpret_cast<const gchar *>(localname));
+    }
+
+    if (cacheable) {
+        _names.insert(NameMap::value_type(key, code));
+    }
+    return code;
+}
+
+void SaxReprBuilder::append(Node *repr)
+{
+    if (_parents.empty()) {
+        _doc->appendChild(repr);
+    } else {
+        _parents.back()->appendChild(repr);
+    }
+    Inkscape::GC::release(repr);
+}
+
+void SaxReprBuilder::appendText(gchar const *content, bool is_cdata)
+{
+    if ( _parents.empty() || !*content ) {
+        return; // no text outside the root element, and no empty text nodes
+    }
+    // sp_repr_svg_read_node asks xmlNodeGetSpacePreserve about the text node itself, which
+    // never answers "preserve", so all-whitespace text is always dropped.
+    gchar const *p = content;
+    while ( *p && g_ascii_isspace(*p) ) {
+        ++p;
+    }
+    if (!*p) {
+        return;
+    }
+    // We keep track of original node type so that CDATA sections are preserved on output.
+    append(_doc->createTextNode(content, is_cdata));
+}
+
+void SaxReprBuilder::flushText()
+{
+    if (!_text.empty()) {
+        appendText(_text.c_str(), _text_cdata);
+        _text.clear();
+    }
+}
+
+void SaxReprBuilder::startElementCb(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+                                    const xmlChar *URI, int /*nb_namespaces*/, const xmlChar ** /*namespaces*/,
+                                    int nb_attributes, int /*nb_defaulted*/, const xmlChar **attributes)
+{
+    xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+    SaxReprBuilder *self = get(ctx);
+    self->flushText();
+
+    if ( self->_parents.empty() && self->_root ) {
+        // a second root element; sp_repr_do_read would not take it either
+        xmlStopParser(ctxt);
+        return;
+    }
+
+    Node *repr = self->_doc->createElement(g_quark_to_string(self->qualifiedName(ctxt, localname, prefix, URI)));
+
+    // attributes come as (localname, prefix, URI, value, end) tuples
+    for ( int i = 0 ; i < nb_attributes ; i++ ) {
+        const xmlChar **attr = attributes + 5 * i;
+        self->_value.assign(reinterpret_cast<const char *>(attr[3]), attr[4] - attr[3]);
+        repr->setAttributeByKey(self->qualifiedName(ctxt, attr[0], attr[1], attr[2]), self->_value.c_str());
+    }
+
+    if (self->_parents.empty()) {
+        self->_root = repr;
+    }
+    self->append(repr);
+    self->_parents.push_back(repr);
+}
+
+void SaxReprBuilder::endElementCb(void *ctx, const xmlChar * /*localname*/, const xmlChar * /*prefix*/,
+                                  const xmlChar * /*URI*/)
+{
+    SaxReprBuilder *self = get(ctx);
+    self->flushText();
+    if (!self->_parents.empty()) {
+        self->_parents.pop_back();
+    }
+}
+
+void SaxReprBuilder::charactersCb(void *ctx, const xmlChar *ch, int len)
+{
+    SaxReprBuilder *self = get(ctx);
+    if (self->_text_cdata) {
+        self->flushText();
+        self->_text_cdata = false;
+    }
+    // libxml2 delivers text in pieces; they make up a single node
+    self->_text.append(reinterpret_cast<const char *>(ch), len);
+}
+
+void SaxReprBuilder::cdataBlockCb(void *ctx, const xmlChar *value, int len)
+{
+    SaxReprBuilder *self = get(ctx);
+    if (!self->_text_cdata) {
+        self->flushText();
+        self->_text_cdata = true;
+    }
+    // adjacent CDATA sections end up in one node as well
+    self->_text.append(reinterpret_cast<const char *>(value), len);
+}
+
+void SaxReprBuilder::commentCb(void *ctx, const xmlChar *value)
+{
+    xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+    SaxReprBuilder *self = get(ctx);
+    if (ctxt->inSubset) {
+        return;
+    }
+    self->flushText();
+    self->append(self->_doc->createComment(reinterpret_cast<const gchar *>(value)));
+}
+
+xmlEntityPtr SaxReprBuilder::getEntityCb(void *ctx, const xmlChar *name)
+{
+    xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+    xmlEntityPtr entity = xmlSAX2GetEntity(ctx, name);
+    // External entities are only loaded when asked for (XmlSource::setFile has
+    // filtered out the SYSTEM and PUBLIC ones then); otherwise they are dropped
+    // like undeclared ones, as references in the old tree were.
+    if ( entity && !( ctxt->options & XML_PARSE_NOENT )
+         && ( entity->etype == XML_EXTERNAL_GENERAL_PARSED_ENTITY
+              || entity->etype == XML_EXTERNAL_GENERAL_UNPARSED_ENTITY ) ) {
+        return NULL;
+    }
+    return entity;
+}
+
+void SaxReprBuilder::processingInstructionCb(void *ctx, const xmlChar *target, const xmlChar *data)
+{
+    xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+    SaxReprBuilder *self = get(ctx);
+    if (ctxt->inSubset) {
+        return;
+    }
+    self->flushText();
+    self->append(self->_doc->createPI(reinterpret_cast<const gchar *>(target),
+                                      reinterpret_cast<const gchar *>(data)));
+}
+
+}
+
+Document *XmlSource::readRepr(const gchar *default_ns)
+{
+    xmlParserCtxtPtr ctxt = xmlCreateIOParserCtxt(NULL, NULL, readCb, closeCb, this, XML_CHAR_ENCODING_NONE);
+    if (!ctxt) {
+        return NULL;
+    }
+    if (getEncoding()) {
+        xmlCharEncodingHandlerPtr handler = xmlFindCharEncodingHandler(getEncoding());
+        if (handler) {
+            xmlSwitchToEncoding(ctxt, handler);
+        }
+    }
+    if ( filename && ctxt->input && !ctxt->input->filename ) {
+        ctxt->input->filename = reinterpret_cast<char *>(xmlStrdup(reinterpret_cast<const xmlChar *>(filename)));
+    }
+    xmlCtxtUseOptions(ctxt, parseOptions());
+
+    SaxReprBuilder builder(default_ns);
+    Document *rdoc = builder.parse(ctxt);
+    xmlFreeParserCtxt(ctxt);
+    return rdoc;
+}
+
 /**
  * Reads XML from a file, including WMF files, and returns the Document.
  * The default namespace can also be specified, if desired.
@@ -363,15 +728,13 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
         XmlSource src;
 
         if ( (src.setFile(filename) == 0) ) {
-            doc = src.readXml();
-            rdoc = sp_repr_do_read( doc, default_ns );
+            rdoc = src.readRepr( default_ns );
             // For some reason, failed ns loading results in this
             // We try a system check version of load with NOENT for adobe
             if(rdoc && strcmp(rdoc->root()->name(), "ns:svg") == 0) {
-                xmlFreeDoc( doc );
+                Inkscape::GC::release( rdoc );
                 src.setFile(filename, true);
-                doc = src.readXml();
-                rdoc = sp_repr_do_read( doc, default_ns );
+                rdoc = src.readRepr( default_ns );
             }
         }
     }
@@ -388,24 +751,308 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
     return rdoc;
 }
 
+namespace Inkscape {
+namespace XML {
+
+namespace {
+
+#if GLIB_CHECK_VERSION(2,32,0)
+typedef Glib::Threads::Mutex ReaderMutex;
+typedef Glib::Threads::Cond ReaderCond;
+typedef Glib::Threads::Thread ReaderThread;
+#else
+typedef Glib::Mutex ReaderMutex;
+typedef Glib::Cond ReaderCond;
+typedef Glib::Thread ReaderThread;
+#endif
+
+/// Bytes read by the worker per call and handed to the parser per step.
+int const READER_CHUNK_SIZE = 64 * 1024;
+/// The worker waits while this much read data has not been taken by the parser.
+std::string::size_type const READER_MAX_PENDING = 1024 * 1024;
+
+}
+
+/**
+ * State shared between the reader, on the main thread, and the worker thread.
+ * The worker owns the XmlSource; everything under "shared" is guarded by mutex.
+ */
+class ReprFileReader::Impl
+{
+public:
+    Impl(gchar const *filename, gchar const *default_ns)
+        : filename(filename),
+          default_ns(default_ns ? default_ns : ""),
+          builder(default_ns ? this->default_ns.c_str() : NULL),
+          ctxt(NULL),
+          doc(NULL),
+          options(0),
+          thread(NULL),
+          input_pos(0),
+          parsed(0),
+          finished(false),
+          encoding(NULL),
+          opened(false),
+          done(false),
+          cancelled(false),
+          read_fraction(0)
+    {}
+
+    void run();
+    void startParser();
+    void stopParser();
+
+    std::string filename;
+    std::string default_ns;
+    SaxReprBuilder builder;
+    xmlParserCtxtPtr ctxt;
+    Document *doc;
+    int options;
+    ReaderThread *thread;
+
+    // main thread only
+    std::string input; ///< read data being handed to the parser
+    std::string::size_type input_pos;
+    std::string::size_type parsed;
+    bool finished;
+
+    // shared
+    ReaderMutex mutex;
+    ReaderCond cond;
+    std::string pending;
+    gchar *encoding;
+    bool opened;
+    bool done;
+    bool cancelled;
+    double read_fraction;
+};
+
+void ReprFileReader::Impl::run()
+{
+    XmlSource src;
+    bool const ok = ( src.setFile(filename.c_str(), false) == 0 );
+    {
+        ReaderMutex::Lock lock(mutex);
+        opened = ok;
+        if ( ok && src.getEncoding() ) {
+            encoding = g_strdup(src.getEncoding());
+        }
+        done = !ok;
+    }
+    if (!ok) {
+        return;
+    }
+
+    std::vector<char> buffer(READER_CHUNK_SIZE);
+    while (true) {
+        int len = src.read(&buffer[0], buffer.size());
+        double const fraction = src.readFraction();
+
+        ReaderMutex::Lock lock(mutex);
+        if ( len > 0 ) {
+            pending.append(&buffer[0], len);
+        }
+        if ( fraction >= 0 ) {
+            read_fraction = fraction;
+        }
+        if ( len <= 0 || cancelled ) {
+            done = true;
+            break;
+        }
+        while ( pending.size() > READER_MAX_PENDING && !cancelled ) {
+            cond.wait(mutex);
+        }
+    }
+    src.close();
+}
+
+void ReprFileReader::Impl::startParser()
+{
+    ctxt = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, filename.c_str());
+    if (!ctxt) {
+        return;
+    }
+    if (encoding) {
+        xmlCharEncodingHandlerPtr handler = xmlFindCharEncodingHandler(encoding);
+        if (handler) {
+            xmlSwitchToEncoding(ctxt, handler);
+        }
+    }
+    xmlCtxtUseOptions(ctxt, options);
+    builder.begin(ctxt);
+}
+
+void ReprFileReader::Impl::stopParser()
+{
+    if (ctxt) {
+        Document *rdoc = builder.end(ctxt);
+        if ( rdoc && cancelled ) {
+            Inkscape::GC::release(rdoc);
+            rdoc = NULL;
+        }
+        doc = rdoc;
+        xmlFreeParserCtxt(ctxt);
+        ctxt = NULL;
+    }
+    finished = true;
+}
+
+ReprFileReader::ReprFileReader(gchar const *filename, gchar const *default_ns)
+    : _impl(new Impl(filename, default_ns))
+{
+    xmlSubstituteEntitiesDefault(1);
+
+    // preferences are only safe to read here, on the main thread
+    XmlSource src;
+    _impl->options = src.parseOptions();
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+    if(!Glib::thread_supported())
+        Glib::thread_init();
+#endif
+
+#if GLIB_CHECK_VERSION(2,32,0)
+    _impl->thread = Glib::Threads::Thread::create(sigc::mem_fun(*_impl, &Impl::run));
+#else
+    _impl->thread = Glib::Thread::create(sigc::mem_fun(*_impl, &Impl::run), true);
+#endif
+    if (!_impl->thread) {
+        _impl->finished = true;
+    }
+}
+
+ReprFileReader::~ReprFileReader()
+{
+    cancel();
+    if (_impl->thread) {
+        _impl->thread->join();
+    }
+    _impl->stopParser();
+    if (_impl->doc) {
+        Inkscape::GC::release(_impl->doc);
+    }
+    g_free(_impl->encoding);
+    delete _impl;
+}
+
+bool ReprFileReader::step()
+{
+    Impl &d = *_impl;
+    if (d.finished) {
+        return false;
+    }
+
+    bool opened, done, cancelled;
+    {
+        ReaderMutex::Lock lock(d.mutex);
+        if ( d.input_pos >= d.input.size() ) {
+            d.input.clear();
+            d.input_pos = 0;
+            d.input.swap(d.pending);
+            d.cond.signal();
+        }
+        opened = d.opened;
+        done = d.done && d.pending.empty();
+        cancelled = d.cancelled;
+    }
+
+    if (cancelled) {
+        d.stopParser();
+        return false;
+    }
+    if (!opened) {
+        if (done) {
+            d.finished = true;
+            return false;
+        }
+        g_usleep(10000);
+        return true;
+    }
+    if (!d.ctxt) {
+        d.startParser();
+        if (!d.ctxt) {
+            d.finished = true;
+            return false;
+        }
+    }
+
+    if ( d.input_pos < d.input.size() ) {
+        int const len = std::min<std::string::size_type>(READER_CHUNK_SIZE, d.input.size() - d.input_pos);
+        xmlParseChunk(d.ctxt, d.input.data() + d.input_pos, len, 0);
+        d.input_pos += len;
+        d.parsed += len;
+        return true;
+    }
+    if (!done) {
+        g_usleep(10000);
+        return true;
+    }
+
+    xmlParseChunk(d.ctxt, NULL, 0, 1);
+    d.stopParser();
+    return false;
+}
+
+double ReprFileReader::progress() const
+{
+    Impl &d = *_impl;
+    if (d.finished) {
+        return 1.0;
+    }
+    ReaderMutex::Lock lock(d.mutex);
+    double const unparsed = ( d.input.size() - d.input_pos ) + d.pending.size();
+    if ( d.parsed + unparsed <= 0 ) {
+        return 0.0;
+    }
+    return d.read_fraction * d.parsed / ( d.parsed + unparsed );
+}
+
+void ReprFileReader::cancel()
+{
+    ReaderMutex::Lock lock(_impl->mutex);
+    _impl->cancelled = true;
+    _impl->cond.signal();
+}
+
+Document *ReprFileReader::document()
+{
+    while (step()) {
+    }
+
+    Document *rdoc = _impl->doc;
+    _impl->doc = NULL;
+    // As in sp_repr_read_file: failed ns loading gives this, try again with entities
+    if ( rdoc && strcmp(rdoc->root()->name(), "ns:svg") == 0 ) {
+        Inkscape::GC::release(rdoc);
+        rdoc = NULL;
+        XmlSource src;
+        if ( src.setFile(_impl->filename.c_str(), true) == 0 ) {
+            rdoc = src.readRepr(_impl->default_ns.empty() ? NULL : _impl->default_ns.c_str());
+        }
+    }
+    return rdoc;
+}
+
+} // namespace XML
+} // namespace Inkscape
+
 /**
  * Reads and parses XML from a buffer, returning it as an Document
  */
 Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *default_ns)
 {
-    xmlDocPtr doc;
-    Document * rdoc;
-
     xmlSubstituteEntitiesDefault(1);
 
     g_return_val_if_fail (buffer != NULL, NULL);
 
-    doc = xmlParseMemory (const_cast<gchar *>(buffer), length);
-
-    rdoc = sp_repr_do_read (doc, default_ns);
-    if (doc) {
-        xmlFreeDoc (doc);
+    xmlParserCtxtPtr ctxt = xmlCreateMemoryParserCtxt(buffer, length);
+    if (!ctxt) {
+        return NULL;
     }
+
+    SaxReprBuilder builder(default_ns);
+    Document *rdoc = builder.parse(ctxt);
+    xmlFreeParserCtxt(ctxt);
     return rdoc;
 }
 
@@ -432,8 +1079,18 @@ namespace {
 
 typedef std::map<Glib::QueryQuark, Glib::QueryQuark, Inkscape::compare_quark_ids> PrefixMap;
 
+// ReprSnapshot::write() looks up prefixes from other threads
+#if GLIB_CHECK_VERSION(2,32,0)
+typedef Glib::Threads::Mutex PrefixMutex;
+PrefixMutex prefix_map_mutex;
+#else
+typedef Glib::Mutex PrefixMutex;
+Glib::StaticMutex prefix_map_mutex = GLIBMM_STATIC_MUTEX_INIT;
+#endif
+PrefixMap prefix_map;
+
 Glib::QueryQuark qname_prefix(Glib::QueryQuark qname) {
-    static PrefixMap prefix_map;
+    PrefixMutex::Lock lock(prefix_map_mutex);
     PrefixMap::iterator iter = prefix_map.find(qname);
     if ( iter != prefix_map.end() ) {
         return (*iter).second;
@@ -509,28 +1166,7 @@ Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
     }
 
     if (root != NULL) {
-        /* promote elements of some XML documents that don't use namespaces
-         * into their default namespace */
-        if ( default_ns && !strchr(root->name(), ':') ) {
-            if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
-                promote_to_namespace(root, "svg");
-            }
-            if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
-                promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
-            }
-        }
-
-
-        // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
-        // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
-        // icons.svg). How can one tell if a file is internal?
-        if ( !strcmp(root->name(), "svg:svg" ) ) {
-            Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-            bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
-            if( clean ) {
-                sp_attribute_clean_tree( root );
-            }
-        }
+        sp_repr_finish_read(root, default_ns);
     }
 
     g_hash_table_destroy (prefix_map);
@@ -538,6 +1174,34 @@ Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
     return rdoc;
 }
 
+/**
+ * Namespace promotion and attribute cleaning, done once the whole tree is read.
+ */
+static void sp_repr_finish_read (Node *root, const gchar *default_ns)
+{
+    /* promote elements of some XML documents that don't use namespaces
+     * into their default namespace */
+    if ( default_ns && !strchr(root->name(), ':') ) {
+        if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
+            promote_to_namespace(root, "svg");
+        }
+        if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
+            promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
+        }
+    }
+
+    // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
+    // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
+    // icons.svg). How can one tell if a file is internal?
+    if ( !strcmp(root->name(), "svg:svg" ) ) {
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
+        if( clean ) {
+            sp_attribute_clean_tree( root );
+        }
+    }
+}
+
 gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar */*default_ns*/, GHashTable *prefix_map)
 {
     const xmlChar *prefix;
@@ -668,12 +1332,12 @@ static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
 }
 
 
-Glib::ustring sp_repr_save_buf(Document *doc)
+Glib::ustring sp_repr_save_buf(Document *doc, gchar const *default_ns)
 {   
     Inkscape::IO::StringOutputStream souts;
     Inkscape::IO::OutputStreamWriter outs(souts);
 
-    sp_repr_save_writer(doc, &outs, SP_INKSCAPE_NS_URI, 0, 0);
+    sp_repr_save_writer(doc, &outs, default_ns, 0, 0);
 
     outs.close();
     Glib::ustring buf = souts.getString();
@@ -808,22 +1472,16 @@ static void repr_write_comment( Writer &out, const gchar * val, bool addWhitespa
 
 namespace {
 
-typedef std::map<Glib::QueryQuark, gchar const *, Inkscape::compare_quark_ids> LocalNameMap;
 typedef std::map<Glib::QueryQuark, Inkscape::Util::ptr_shared<char>, Inkscape::compare_quark_ids> NSMap;
 
+// computed each time, as ReprSnapshot::write() calls it from other threads
 gchar const *qname_local_name(Glib::QueryQuark qname) {
-    static LocalNameMap local_name_map;
-    LocalNameMap::iterator iter = local_name_map.find(qname);
-    if ( iter != local_name_map.end() ) {
-        return (*iter).second;
+    gchar const *name_string=g_quark_to_string(qname);
+    gchar const *prefix_end=strchr(name_string, ':');
+    if (prefix_end) {
+        return prefix_end + 1;
     } else {
-        gchar const *name_string=g_quark_to_string(qname);
-        gchar const *prefix_end=strchr(name_string, ':');
-        if (prefix_end) {
-            return prefix_end + 1;
-        } else {
-            return name_string;
-        }
+        return name_string;
     }
 }
 
@@ -1086,6 +1744,152 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
 }
 
 
+namespace Inkscape {
+namespace XML {
+
+namespace {
+
+/**
+ * Puts on \a root the namespace declarations that
+ * sp_repr_write_stream_root_element() adds while writing, in the same order,
+ * and returns the prefix to leave out of names.
+ */
+GQuark declare_namespaces(Node *root, gchar const *default_ns)
+{
+    Glib::QueryQuark xml_prefix=g_quark_from_static_string("xml");
+
+    NSMap ns_map;
+    populate_ns_map(ns_map, *root);
+
+    Glib::QueryQuark elide_prefix=GQuark(0);
+    if ( default_ns && ns_map.find(GQuark(0)) == ns_map.end() ) {
+        elide_prefix = g_quark_from_string(sp_xml_ns_uri_prefix(default_ns, NULL));
+    }
+
+    std::vector<std::pair<std::string, std::string> > attributes;
+    for ( NSMap::iterator iter=ns_map.begin() ; iter != ns_map.end() ; ++iter ) {
+        Glib::QueryQuark prefix=(*iter).first;
+        char const *ns_uri=(*iter).second;
+
+        if (prefix.id()) {
+            if ( prefix != xml_prefix ) {
+                if ( elide_prefix == prefix ) {
+                    attributes.insert(attributes.begin(), std::make_pair(std::string("xmlns"), std::string(ns_uri)));
+                }
+
+                std::string attr_name="xmlns:";
+                attr_name.append(g_quark_to_string(prefix));
+                attributes.insert(attributes.begin(), std::make_pair(attr_name, std::string(ns_uri)));
+            }
+        } else {
+            elide_prefix = GQuark(0);
+        }
+    }
+
+    // the declarations go before the attributes already there
+    for ( List<AttributeRecord const> iter=root->attributeList() ; iter ; ++iter ) {
+        attributes.push_back(std::make_pair(std::string(g_quark_to_string(iter->key)), std::string(iter->value)));
+    }
+    for ( std::vector<std::pair<std::string, std::string> >::iterator iter=attributes.begin() ;
+          iter != attributes.end() ; ++iter )
+    {
+        root->setAttribute(iter->first.c_str(), NULL);
+    }
+    for ( std::vector<std::pair<std::string, std::string> >::iterator iter=attributes.begin() ;
+          iter != attributes.end() ; ++iter )
+    {
+        root->setAttribute(iter->first.c_str(), iter->second.c_str());
+    }
+
+    return elide_prefix;
+}
+
+/** Builds the attribute list of \a repr and its descendants, which the writer walks. */
+void cache_attribute_lists(Node *repr)
+{
+    repr->attributeList();
+    for ( Node *child = repr->firstChild() ; child ; child = child->next() ) {
+        cache_attribute_lists(child);
+    }
+}
+
+}
+
+ReprSnapshot::ReprSnapshot(Document *doc, gchar const *default_ns)
+    : _doc(new SimpleDocument()),
+      _elide_prefix(0)
+{
+    // preferences are only safe to read here, on the main thread
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    _inlineattrs = prefs->getBool("/options/svgoutput/inlineattrs");
+    _indent = prefs->getInt("/options/svgoutput/indent", 2);
+    bool clean = prefs->getBool("/options/svgoutput/check_on_writing");
+
+    _doc->setAttribute("doctype", static_cast<Node *>(doc)->attribute("doctype"));
+    for ( Node *child = sp_repr_document_first_child(doc) ; child ; child = child->next() ) {
+        Node *copy = child->duplicate(_doc);
+        _doc->appendChild(copy);
+        Inkscape::GC::release(copy);
+
+        if ( copy->type() == Inkscape::XML::ELEMENT_NODE ) {
+            if (clean) sp_attribute_clean_tree( copy );
+            _elide_prefix = declare_namespaces(copy, default_ns);
+        }
+    }
+
+    // so that write() finds every list made and allocates nothing
+    cache_attribute_lists(_doc);
+}
+
+ReprSnapshot::~ReprSnapshot()
+{
+    Inkscape::GC::release(_doc);
+}
+
+bool ReprSnapshot::write(gchar const *filename, bool compress) const
+{
+    FILE *file = Inkscape::IO::fopen_utf8name(filename, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    {
+        Inkscape::URI dummy("x");
+        Inkscape::IO::UriOutputStream bout(file, dummy);
+        Inkscape::IO::GzipOutputStream *gout = compress ? new Inkscape::IO::GzipOutputStream(bout) : NULL;
+        Inkscape::IO::OutputStreamWriter *out  = compress ? new Inkscape::IO::OutputStreamWriter( *gout ) : new Inkscape::IO::OutputStreamWriter( bout );
+
+        out->writeString( "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n" );
+
+        const gchar *str = static_cast<Node *>(_doc)->attribute("doctype");
+        if (str) {
+            out->writeString( str );
+        }
+
+        for (Node *repr = sp_repr_document_first_child(_doc);
+             repr; repr = repr->next())
+        {
+            sp_repr_write_stream(repr, *out, 0, TRUE, _elide_prefix, _inlineattrs, _indent, NULL, NULL);
+            if ( repr->type() == Inkscape::XML::COMMENT_NODE ) {
+                out->writeChar('\n');
+            }
+        }
+
+        delete out;
+        delete gout;
+    }
+
+    bool ok = !ferror(file);
+    if ( fclose(file) != 0 ) {
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace XML
+} // namespace Inkscape
+
+
 /*
   Local Variables:
   mode:c++
@@ -0,0 +1,102 @@
+#include <cxxtest/TestSuite.h>
+
+#include <glib.h>
+
+#include "repr.h"
+#include "repr-sorting.h"
+
+class XmlReprSortingTest : public CxxTest::TestSuite
+{
+    Inkscape::XML::Document *document;
+    Inkscape::XML::Node *root, *g, *a, *b, *c, *d;
+
+public:
+
+    XmlReprSortingTest()
+    {
+        Inkscape::GC::init();
+
+        document = sp_repr_document_new("test");
+        root = document->root();
+
+        // root: a, g(c, d), b
+        a = document->createElement("a");
+        g = document->createElement("g");
+        b = document->createElement("b");
+        c = document->createElement("c");
+        d = document->createElement("d");
+        root->appendChild(a);
+        root->appendChild(g);
+        root->appendChild(b);
+        g->appendChild(c);
+        g->appendChild(d);
+    }
+    virtual ~XmlReprSortingTest() {}
+
+// createSuite and destroySuite get us per-suite setup and teardown
+// without us having to worry about static initialization order, etc.
+    static XmlReprSortingTest *createSuite() { return new XmlReprSortingTest(); }
+    static void destroySuite( XmlReprSortingTest *suite ) { delete suite; }
+
+    void testSortMatchesComparePosition()
+    {
+        GSList *list = NULL;
+        list = g_slist_prepend(list, a);
+        list = g_slist_prepend(list, g);
+        list = g_slist_prepend(list, d);
+        list = g_slist_prepend(list, b);
+        list = g_slist_prepend(list, c);
+
+        GSList *expected = g_slist_sort(g_slist_copy(list), (GCompareFunc) sp_repr_compare_position);
+        list = sp_repr_sort_by_position(list);
+
+        TS_ASSERT_EQUALS(g_slist_length(list), 5u);
+        for (GSList *i = list, *j = expected; i && j; i = i->next, j = j->next) {
+            TS_ASSERT_EQUALS(i->data, j->data);
+        }
+        // descendants before their ancestors, as sp_repr_compare_position() has it
+        TS_ASSERT_EQUALS(g_slist_nth_data(list, 0), a);
+        TS_ASSERT_EQUALS(g_slist_nth_data(list, 1), c);
+        TS_ASSERT_EQUALS(g_slist_nth_data(list, 2), d);
+        TS_ASSERT_EQUALS(g_slist_nth_data(list, 3), g);
+        TS_ASSERT_EQUALS(g_slist_nth_data(list, 4), b);
+
+        g_slist_free(expected);
+        g_slist_free(list);
+    }
+
+    void testReorderKeepsSiblingsLinked()
+    {
+        a->setPosition(-1);
+        TS_ASSERT_EQUALS(root->lastChild(), a);
+        TS_ASSERT_EQUALS(root->firstChild(), g);
+
+        root->removeChild(g);
+        TS_ASSERT_EQUALS(root->firstChild(), b);
+        TS_ASSERT_EQUALS(b->next(), a);
+        TS_ASSERT_EQUALS(a->position(), 1u);
+
+        root->changeOrder(a, NULL);
+        TS_ASSERT_EQUALS(root->firstChild(), a);
+        TS_ASSERT_EQUALS(root->lastChild(), b);
+
+        root->addChild(g, a);
+        TS_ASSERT_EQUALS(a->next(), g);
+        TS_ASSERT_EQUALS(g->next(), b);
+        root->removeChild(b);
+        TS_ASSERT_EQUALS(root->lastChild(), g);
+        root->appendChild(b);
+        a->setPosition(0);
+    }
+};
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
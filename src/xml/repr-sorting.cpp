@@ -1,4 +1,7 @@
 
+#include <algorithm>
+#include <vector>
+
 #include "util/longest-common-suffix.h"
 #include "xml/repr.h"
 #include "xml/node-iterators.h"
@@ -53,6 +56,59 @@ Inkscape::XML::Node *AncetreFils(Inkscape::XML::Node *descendent, Inkscape::XML:
     return const_cast<Inkscape::XML::Node *>(tmp);
 }
 
+namespace {
+
+/** A node's position, then its parent's, and so on up to the root. */
+struct PositionKey {
+    std::vector<unsigned> path;
+    gpointer data;
+};
+
+/** Descendants come before their ancestors, as with sp_repr_compare_position(). */
+bool key_less(PositionKey const *a, PositionKey const *b)
+{
+    std::vector<unsigned>::const_reverse_iterator i = a->path.rbegin();
+    std::vector<unsigned>::const_reverse_iterator j = b->path.rbegin();
+    for ( ; i != a->path.rend() && j != b->path.rend() ; ++i, ++j ) {
+        if (*i != *j) {
+            return *i < *j;
+        }
+    }
+    return i != a->path.rend() && j == b->path.rend();
+}
+
+}
+
+GSList *sp_repr_sort_by_position(GSList *list, Inkscape::XML::Node const *(*repr_of)(gconstpointer))
+{
+    if ( !list || !list->next ) {
+        return list;
+    }
+
+    std::vector<PositionKey> keys(g_slist_length(list));
+    std::vector<PositionKey *> order;
+    order.reserve(keys.size());
+    std::vector<PositionKey>::iterator key = keys.begin();
+    for (GSList *l = list; l; l = l->next, ++key) {
+        key->data = l->data;
+        Inkscape::XML::Node const *repr = repr_of ? repr_of(l->data)
+                                                  : static_cast<Inkscape::XML::Node const *>(l->data);
+        for ( ; repr && repr->parent() ; repr = repr->parent() ) {
+            key->path.push_back(repr->position());
+        }
+        order.push_back(&*key);
+    }
+
+    std::stable_sort(order.begin(), order.end(), key_less);
+
+    // reuse the list cells
+    GSList *l = list;
+    for (std::vector<PositionKey *>::const_iterator i = order.begin(); i != order.end(); ++i, l = l->next) {
+        l->data = (*i)->data;
+    }
+    return list;
+}
+
 /*
   Local Variables:
   mode:c++
@@ -7,6 +7,8 @@
 #ifndef SEEN_XML_REPR_SORTING_H
 #define SEEN_XML_REPR_SORTING_H
 
+#include <glib.h>
+
 namespace Inkscape {
 namespace XML {
 
@@ -29,6 +31,16 @@ Inkscape::XML::Node const *AncetreFils(Inkscape::XML::Node const *descendent, In
 
 Inkscape::XML::Node *AncetreFils(Inkscape::XML::Node *descendent, Inkscape::XML::Node *ancestor);
 
+/**
+ * Sorts \a list into the order of sp_repr_compare_position(), as g_slist_sort() would with it.
+ *
+ * The position of each node and of its ancestors is looked up once, so a large list costs
+ * no more than one walk up from each node. The list holds nodes, or anything \a repr_of maps
+ * to a node.
+ */
+GSList *sp_repr_sort_by_position(GSList *list,
+                                 Inkscape::XML::Node const *(*repr_of)(gconstpointer) = NULL);
+
 #endif // SEEN_XML_REPR_SOTRING_H
 /*
   Local Variables:
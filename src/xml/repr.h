@@ -58,7 +58,7 @@ void sp_repr_write_stream(Inkscape::XML::Node *repr, Inkscape::IO::Writer &out,
                           gchar const *old_href_base = NULL,
                           gchar const *new_href_base = NULL);
 Inkscape::XML::Document *sp_repr_read_buf (const Glib::ustring &buf, const gchar *default_ns);
-Glib::ustring sp_repr_save_buf(Inkscape::XML::Document *doc);
+Glib::ustring sp_repr_save_buf(Inkscape::XML::Document *doc, gchar const *default_ns = SP_INKSCAPE_NS_URI);
 
 // TODO convert to std::string
 void sp_repr_save_stream(Inkscape::XML::Document *doc, FILE *to_file,
@@ -71,6 +71,74 @@ bool sp_repr_save_rebased_file(Inkscape::XML::Document *doc, gchar const *filena
                                gchar const *default_ns,
                                gchar const *old_base, gchar const *new_base_filename);
 
+namespace Inkscape {
+namespace XML {
+
+/**
+ * Reads a file as sp_repr_read_file() does, a piece at a time, so that the caller
+ * can keep its user interface running and show progress meanwhile.
+ *
+ * The file is read and decompressed on a worker thread. The XML is still parsed and
+ * the nodes built on the calling thread, since they live in the collected heap, from
+ * the data the worker has read so far, at each call of step(). When no data is ready,
+ * step() sleeps for 10 ms before it returns.
+ */
+class ReprFileReader {
+public:
+    ReprFileReader(gchar const *filename, gchar const *default_ns);
+    ~ReprFileReader();
+
+    /** Parses what has been read since the last call; returns false once there is no more to do. */
+    bool step();
+    /**
+     * Rough fraction of the file read and parsed, from 0 to 1. Building the objects of
+     * the document afterwards is not covered.
+     */
+    double progress() const;
+    /** Stops reading; document() then returns NULL. May be called from any thread. */
+    void cancel();
+    /** Finishes reading if needed and returns the document, which the caller owns, or NULL. */
+    Document *document();
+
+private:
+    ReprFileReader(ReprFileReader const &); // no copy
+    void operator=(ReprFileReader const &); // no assign
+
+    class Impl;
+    Impl *_impl;
+};
+
+/**
+ * A copy of a document which can be written out from another thread, so that
+ * saving it does not hold up editing.
+ *
+ * The constructor copies the nodes, which share their attribute values with
+ * the document, and reads the preferences that affect writing. It and the
+ * destructor must run on the main thread, as the copy lives in the collected
+ * heap. write() allocates nothing there and may run on any thread, once at a
+ * time.
+ */
+class ReprSnapshot {
+public:
+    ReprSnapshot(Document *doc, gchar const *default_ns);
+    ~ReprSnapshot();
+
+    /** Writes the copy to \a filename, gzipped if \a compress; returns false if that failed. */
+    bool write(gchar const *filename, bool compress) const;
+
+private:
+    ReprSnapshot(ReprSnapshot const &); // no copy
+    void operator=(ReprSnapshot const &); // no assign
+
+    Document *_doc;
+    GQuark _elide_prefix;
+    bool _inlineattrs;
+    int _indent;
+};
+
+} // namespace XML
+} // namespace Inkscape
+
 
 /* CSS stuff */
 
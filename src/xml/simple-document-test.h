@@ -0,0 +1,108 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <glib.h>
+
+#include "repr.h"
+#include "xml/simple-document.h"
+
+class XmlSimpleDocumentTest : public CxxTest::TestSuite
+{
+public:
+
+    XmlSimpleDocumentTest()
+    {
+        Inkscape::GC::init();
+    }
+    virtual ~XmlSimpleDocumentTest() {}
+
+// createSuite and destroySuite get us per-suite setup and teardown
+// without us having to worry about static initialization order, etc.
+    static XmlSimpleDocumentTest *createSuite() { return new XmlSimpleDocumentTest(); }
+    static void destroySuite( XmlSimpleDocumentTest *suite ) { delete suite; }
+
+    void testAttributes()
+    {
+        Inkscape::XML::Document *doc = sp_repr_document_new("svg:svg");
+        Inkscape::XML::Node *node = doc->createElement("svg:rect");
+        GQuark const width = g_quark_from_static_string("width");
+
+        for ( unsigned i = 0 ; i < 10 ; i++ ) {
+            gchar *name = g_strdup_printf("a%u", i);
+            node->setAttribute(name, "x");
+            g_free(name);
+        }
+        node->setAttributeByKey(width, "10");
+        TS_ASSERT_EQUALS(std::string(node->attribute("width")), "10");
+        TS_ASSERT_EQUALS(std::string(node->attributeByKey(width)), "10");
+        TS_ASSERT(!node->attribute("never-seen-before-attribute"));
+
+        Inkscape::Util::List<Inkscape::XML::AttributeRecord const> before = node->attributeList();
+        node->setAttribute("a3", NULL);
+        node->setAttribute("a0", "y");
+        TS_ASSERT(!node->attribute("a3"));
+
+        // document order is kept, and lists handed out earlier don't change
+        std::string names;
+        for ( Inkscape::Util::List<Inkscape::XML::AttributeRecord const> iter = node->attributeList() ; iter ; ++iter ) {
+            names += g_quark_to_string(iter->key);
+            names += ' ';
+        }
+        TS_ASSERT_EQUALS(names, "a0 a1 a2 a4 a5 a6 a7 a8 a9 width ");
+        TS_ASSERT_EQUALS(std::string(before->value), "x");
+
+        Inkscape::XML::Node *copy = node->duplicate(doc);
+        TS_ASSERT_EQUALS(std::string(copy->attribute("a0")), "y");
+        TS_ASSERT_EQUALS(std::string(copy->attribute("width")), "10");
+
+        Inkscape::GC::release(copy);
+        Inkscape::GC::release(node);
+        Inkscape::GC::release(doc);
+    }
+
+    void testNodesComeFromBatches()
+    {
+        unsigned const count = 20000;
+        std::string svg("<svg xmlns=\"http://www.w3.org/2000/svg\">");
+        for ( unsigned i = 0 ; i < count ; i++ ) {
+            gchar *elem = g_strdup_printf("<rect id=\"r%u\" x=\"%u\" y=\"1\" width=\"2\" height=\"3\"/>", i, i);
+            svg += elem;
+            g_free(elem);
+        }
+        svg += "</svg>";
+
+        GTimer *timer = g_timer_new();
+        Inkscape::XML::Document *doc = sp_repr_read_mem(svg.data(), svg.size(), SP_SVG_NS_URI);
+        double const loaded = g_timer_elapsed(timer, NULL);
+        TS_ASSERT(doc);
+        TS_ASSERT_EQUALS(doc->root()->childCount(), count);
+
+        Inkscape::GC::BatchPool &pool = static_cast<Inkscape::XML::SimpleDocument *>(doc)->nodePool();
+        unsigned long const allocations = pool.allocations();
+        unsigned long const batches = pool.batches();
+        // one node and five attributes per rect
+        TS_ASSERT_LESS_THAN_EQUALS(6 * count, allocations);
+        TS_ASSERT_LESS_THAN(batches * 10, allocations);
+
+        Inkscape::GC::release(doc);
+        Inkscape::GC::Core::gcollect();
+        double const closed = g_timer_elapsed(timer, NULL);
+        g_timer_destroy(timer);
+
+        gchar *report = g_strdup_printf("load %.1fms, close %.1fms, %lu objects from %lu allocations",
+                                        loaded * 1000, (closed - loaded) * 1000, allocations, batches);
+        TS_TRACE(report);
+        g_free(report);
+    }
+};
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
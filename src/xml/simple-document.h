@@ -63,6 +63,9 @@ public:
                                 Util::ptr_shared<char> old_value,
                                 Util::ptr_shared<char> new_value);
 
+    /// Nodes and attribute list cells of this document are allocated from here.
+    GC::BatchPool &nodePool() { return _node_pool; }
+
 protected:
     SimpleDocument(SimpleDocument const &doc)
     : Node(), SimpleNode(doc), Document(), NodeObserver(),
@@ -79,6 +82,7 @@ private:
     bool _in_transaction;
     LogBuilder _log_builder;
     bool _is_CData;
+    GC::BatchPool _node_pool;
 };
 
 }
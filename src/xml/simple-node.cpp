@@ -15,6 +15,7 @@
  */
 
 #include <cstring>
+#include <new>
 #include <string>
 
 #include <glib.h>
@@ -23,6 +24,7 @@
 
 #include "xml/node.h"
 #include "xml/simple-node.h"
+#include "xml/simple-document.h"
 #include "xml/node-event-vector.h"
 #include "xml/node-fns.h"
 #include "xml/repr.h"
@@ -160,19 +162,16 @@ using Util::share_string;
 using Util::share_unsafe;
 using Util::share_static_string;
 using Util::List;
-using Util::MutableList;
-using Util::cons;
-using Util::rest;
-using Util::set_rest;
 
 SimpleNode::SimpleNode(int code, Document *document)
-: Node(), _name(code), _attributes(), _child_count(0),
+: Node(), _name(code), _attributes(NULL), _attribute_count(0), _attribute_capacity(0),
+  _attribute_list(), _attribute_list_valid(false), _child_count(0),
   _cached_positions_valid(false)
 {
     g_assert(document != NULL);
 
     this->_document = document;
-    this->_parent = this->_next = NULL;
+    this->_parent = this->_next = this->_prev = NULL;
     this->_first_child = this->_last_child = NULL;
 
     _observers.add(_subtree_observers);
@@ -181,14 +180,15 @@ SimpleNode::SimpleNode(int code, Document *document)
 SimpleNode::SimpleNode(SimpleNode const &node, Document *document)
 : Node(),
   _cached_position(node._cached_position),
-  _name(node._name), _attributes(), _content(node._content),
+  _name(node._name), _attributes(NULL), _attribute_count(0), _attribute_capacity(0),
+  _attribute_list(), _attribute_list_valid(false), _content(node._content),
   _child_count(node._child_count),
   _cached_positions_valid(node._cached_positions_valid)
 {
     g_assert(document != NULL);
 
     _document = document;
-    _parent = _next = NULL;
+    _parent = _next = _prev = NULL;
     _first_child = _last_child = NULL;
 
     for ( SimpleNode *child = node._first_child ;
@@ -197,6 +197,7 @@ SimpleNode::SimpleNode(SimpleNode const &node, Document *document)
         SimpleNode *child_copy=dynamic_cast<SimpleNode *>(child->duplicate(document));
 
         child_copy->_setParent(this);
+        child_copy->_prev = _last_child;
         if (_last_child) {
             _last_child->_next = child_copy;
         } else {
@@ -207,15 +208,26 @@ SimpleNode::SimpleNode(SimpleNode const &node, Document *document)
         child_copy->release(); // release to avoid a leak
     }
 
-    for ( List<AttributeRecord const> iter = node._attributes ;
-          iter ; ++iter )
-    {
-        _attributes = cons(*iter, _attributes);
+    if (node._attribute_count) {
+        _attributes = _allocateAttributes(node._attribute_count);
+        for ( unsigned i = 0 ; i < node._attribute_count ; i++ ) {
+            ::new (&_attributes[i]) AttributeRecord(node._attributes[i]);
+        }
+        _attribute_count = _attribute_capacity = node._attribute_count;
     }
 
     _observers.add(_subtree_observers);
 }
 
+GC::BatchPool &SimpleNode::_pool(Document *doc) {
+    // SimpleDocument is the only implementation of Document
+    return static_cast<SimpleDocument *>(doc)->nodePool();
+}
+
+AttributeRecord *SimpleNode::_allocateAttributes(unsigned capacity) {
+    return static_cast<AttributeRecord *>(_pool(_document).allocate(capacity * sizeof(AttributeRecord)));
+}
+
 gchar const *SimpleNode::name() const {
     return g_quark_to_string(_name);
 }
@@ -227,19 +239,33 @@ gchar const *SimpleNode::content() const {
 gchar const *SimpleNode::attribute(gchar const *name) const {
     g_return_val_if_fail(name != NULL, NULL);
 
-    GQuark const key = g_quark_from_string(name);
+    // a name that was never interned can't be set on any node
+    GQuark const key = g_quark_try_string(name);
+    return key ? attributeByKey(key) : NULL;
+}
 
-    for ( List<AttributeRecord const> iter = _attributes ;
-          iter ; ++iter )
-    {
-        if ( iter->key == key ) {
-            return iter->value;
+gchar const *SimpleNode::attributeByKey(GQuark key) const {
+    for ( unsigned i = 0 ; i < _attribute_count ; i++ ) {
+        if ( _attributes[i].key == key ) {
+            return _attributes[i].value;
         }
     }
 
     return NULL;
 }
 
+List<AttributeRecord const> SimpleNode::attributeList() const {
+    if (!_attribute_list_valid) {
+        List<AttributeRecord const> list;
+        for ( unsigned i = _attribute_count ; i > 0 ; i-- ) {
+            list = List<AttributeRecord const>(_attributes[i - 1], list, _pool(_document));
+        }
+        _attribute_list = list;
+        _attribute_list_valid = true;
+    }
+    return _attribute_list;
+}
+
 unsigned SimpleNode::position() const {
     g_return_val_if_fail(_parent != NULL, 0);
     return _parent->_childPosition(*this);
@@ -270,10 +296,8 @@ Node *SimpleNode::nthChild(unsigned index) {
 bool SimpleNode::matchAttributeName(gchar const *partial_name) const {
     g_return_val_if_fail(partial_name != NULL, false);
 
-    for ( List<AttributeRecord const> iter = _attributes ;
-          iter ; ++iter )
-    {
-        gchar const *name = g_quark_to_string(iter->key);
+    for ( unsigned i = 0 ; i < _attribute_count ; i++ ) {
+        gchar const *name = g_quark_to_string(_attributes[i].key);
         if (std::strstr(name, partial_name)) {
             return true;
         }
@@ -312,21 +336,30 @@ void SimpleNode::setContent(gchar const *content) {
 }
 
 void
-SimpleNode::setAttribute(gchar const *name, gchar const *value, bool const /*is_interactive*/)
+SimpleNode::setAttribute(gchar const *name, gchar const *value, bool const is_interactive)
 {
     g_return_if_fail(name && *name);
 
+    setAttributeByKey(g_quark_from_string(name), value, is_interactive);
+}
+
+void
+SimpleNode::setAttributeByKey(GQuark const key, gchar const *value, bool const /*is_interactive*/)
+{
+    g_return_if_fail(key != 0);
+
     // Check usefulness of attributes on elements in the svg namespace, optionally don't add them to tree.
-    Glib::ustring element = g_quark_to_string(_name);
-    // g_message("setAttribute:  %s: %s: %s", element.c_str(), name, value);
-    gchar* cleaned_value = g_strdup( value );
+    gchar const *element = g_quark_to_string(_name);
+    // g_message("setAttribute:  %s: %s: %s", element, g_quark_to_string(key), value);
+    Glib::ustring cleaned_style;
 
     // Only check elements in SVG name space and don't block setting attribute to NULL.
-    if( element.substr(0,4) == "svg:" && value != NULL) {
+    if( !strncmp(element, "svg:", 4) && value != NULL) {
 
         Inkscape::Preferences *prefs = Inkscape::Preferences::get();
         if( prefs->getBool("/options/svgoutput/check_on_editing") ) {
 
+            gchar const *name = g_quark_to_string(key);
             gchar const *id_char = attribute("id");
             Glib::ustring id = (id_char == NULL ? "" : id_char );
             unsigned int flags = sp_attribute_clean_get_prefs();
@@ -337,7 +370,6 @@ SimpleNode::setAttribute(gchar const *name, gchar const *value, bool const /*is_
             if( (attr_warn || attr_remove) && value != NULL ) {
                 bool is_useful = sp_attribute_check_attribute( element, id, name, attr_warn );
                 if( !is_useful && attr_remove ) {
-                    g_free( cleaned_value );
                     return; // Don't add to tree.
                 }
             }
@@ -345,8 +377,8 @@ SimpleNode::setAttribute(gchar const *name, gchar const *value, bool const /*is_
             // Check style properties -- Note: if element is not yet inserted into
             // tree (and thus has no parent), default values will not be tested.
             if( !strcmp( name, "style" ) && (flags >= SP_ATTR_CLEAN_STYLE_WARN) ) {
-                g_free( cleaned_value );
-                cleaned_value = g_strdup( sp_attribute_clean_style( this, value, flags ).c_str() );
+                cleaned_style = sp_attribute_clean_style( this, value, flags );
+                value = cleaned_style.c_str();
                 // if( g_strcmp0( value, cleaned_value ) ) {
                 //     g_warning( "SimpleNode::setAttribute: %s", id.c_str() );
                 //     g_warning( "     original: %s", value);
@@ -356,51 +388,51 @@ SimpleNode::setAttribute(gchar const *name, gchar const *value, bool const /*is_
         }
     }
 
-    GQuark const key = g_quark_from_string(name);
-
-    MutableList<AttributeRecord> ref;
-    MutableList<AttributeRecord> existing;
-    for ( existing = _attributes ; existing ; ++existing ) {
-        if ( existing->key == key ) {
-            break;
-        }
-        ref = existing;
+    unsigned existing = 0;
+    while ( existing < _attribute_count && _attributes[existing].key != key ) {
+        existing++;
     }
+    bool const found = existing < _attribute_count;
     Debug::EventTracker<> tracker;
 
-    ptr_shared<char> old_value=( existing ? existing->value : ptr_shared<char>() );
+    ptr_shared<char> old_value=( found ? _attributes[existing].value : ptr_shared<char>() );
 
     ptr_shared<char> new_value=ptr_shared<char>();
-    if (cleaned_value) {
-        new_value = share_string(cleaned_value);
+    if (value) {
+        new_value = share_string(value);
         tracker.set<DebugSetAttribute>(*this, key, new_value);
-        if (!existing) {
-            if (ref) {
-                set_rest(ref, MutableList<AttributeRecord>(AttributeRecord(key, new_value)));
-            } else {
-                _attributes = MutableList<AttributeRecord>(AttributeRecord(key, new_value));
+        if (!found) {
+            if ( _attribute_count == _attribute_capacity ) {
+                unsigned const capacity = _attribute_capacity ? 2 * _attribute_capacity : 4;
+                AttributeRecord *grown = _allocateAttributes(capacity);
+                for ( unsigned i = 0 ; i < _attribute_count ; i++ ) {
+                    ::new (&grown[i]) AttributeRecord(_attributes[i]);
+                }
+                _attributes = grown; // the old array is left to the collector
+                _attribute_capacity = capacity;
             }
+            ::new (&_attributes[_attribute_count]) AttributeRecord(key, new_value);
+            _attribute_count++;
         } else {
-            existing->value = new_value;
+            _attributes[existing].value = new_value;
         }
     } else {
         tracker.set<DebugClearAttribute>(*this, key);
-        if (existing) {
-            if (ref) {
-                set_rest(ref, rest(existing));
-            } else {
-                _attributes = rest(existing);
+        if (found) {
+            _attribute_count--;
+            for ( unsigned i = existing ; i < _attribute_count ; i++ ) {
+                _attributes[i] = _attributes[i + 1];
             }
-            set_rest(existing, MutableList<AttributeRecord>());
+            _attributes[_attribute_count].value = ptr_shared<char>();
         }
     }
+    _attribute_list_valid = false;
 
     if ( new_value != old_value && (!old_value || !new_value || strcmp(old_value, new_value))) {
         _document->logger()->notifyAttributeChanged(*this, key, old_value, new_value);
         _observers.notifyAttributeChanged(*this, key, old_value, new_value);
-        //g_warning( "setAttribute notified: %s: %s: %s: %s", name, element.c_str(), old_value, new_value ); 
+        //g_warning( "setAttribute notified: %s: %s: %s: %s", g_quark_to_string(key), element, old_value, new_value ); 
     }
-    g_free( cleaned_value );
 }
 
 void SimpleNode::addChild(Node *generic_child, Node *generic_ref) {
@@ -441,6 +473,10 @@ void SimpleNode::addChild(Node *generic_child, Node *generic_ref) {
 
     child->_setParent(this);
     child->_next = next;
+    child->_prev = ref;
+    if (next) {
+        next->_prev = child;
+    }
     _child_count++;
 
     _document->logger()->notifyChildAdded(*this, *child, ref);
@@ -452,7 +488,7 @@ void SimpleNode::removeChild(Node *generic_child) {
     g_assert(generic_child->document() == _document);
 
     SimpleNode *child=dynamic_cast<SimpleNode *>(generic_child);
-    SimpleNode *ref=dynamic_cast<SimpleNode *>(previous_node(child));
+    SimpleNode *ref=child->_prev;
 
     g_assert(child->_parent == this);
 
@@ -467,11 +503,13 @@ void SimpleNode::removeChild(Node *generic_child) {
     if (!next) { // removing the last child?
         _last_child = ref;
     } else {
+        next->_prev = ref;
         // removing any other child invalidates the cached positions
         _cached_positions_valid = false;
     }
 
     child->_next = NULL;
+    child->_prev = NULL;
     child->_setParent(NULL);
     _child_count--;
 
@@ -491,7 +529,7 @@ void SimpleNode::changeOrder(Node *generic_child, Node *generic_ref) {
     g_return_if_fail(child != ref);
     g_return_if_fail(!ref || ref->parent() == this);
 
-    SimpleNode *const prev=dynamic_cast<SimpleNode *>(previous_node(child));
+    SimpleNode *const prev=child->_prev;
 
     Debug::EventTracker<DebugSetChildPosition> tracker(*this, *child, prev, ref);
 
@@ -508,6 +546,8 @@ void SimpleNode::changeOrder(Node *generic_child, Node *generic_ref) {
     }
     if (!next) {
         _last_child = prev;
+    } else {
+        next->_prev = prev;
     }
 
     /* Insert at new position. */
@@ -519,8 +559,11 @@ void SimpleNode::changeOrder(Node *generic_child, Node *generic_ref) {
         _first_child = child;
     }
     child->_next = next;
+    child->_prev = ref;
     if (!next) {
         _last_child = child;
+    } else {
+        next->_prev = child;
     }
 
     _cached_positions_valid = false;
@@ -536,6 +579,13 @@ void SimpleNode::setPosition(int pos) {
     // a negative position is the same as an infinitely large position
 
     SimpleNode *ref=NULL;
+    if ( pos < 0 ) {
+        ref = _parent->_last_child;
+        if ( ref == this ) {
+            ref = _prev;
+        }
+        pos = 0;
+    }
     for ( SimpleNode *sibling = _parent->_first_child ;
           sibling && pos ; sibling = sibling->_next )
     {
@@ -582,10 +632,8 @@ const NodeEventVector OBSERVER_EVENT_VECTOR = {
 
 void SimpleNode::synthesizeEvents(NodeEventVector const *vector, void *data) {
     if (vector->attr_changed) {
-        for ( List<AttributeRecord const> iter = _attributes ;
-              iter ; ++iter )
-        {
-            vector->attr_changed(this, g_quark_to_string(iter->key), NULL, iter->value, false, data);
+        for ( unsigned i = 0 ; i < _attribute_count ; i++ ) {
+            vector->attr_changed(this, g_quark_to_string(_attributes[i].key), NULL, _attributes[i].value, false, data);
         }
     }
     if (vector->child_added) {
@@ -657,7 +705,7 @@ void SimpleNode::mergeFrom(Node const *src, gchar const *key) {
     for ( List<AttributeRecord const> iter = src->attributeList() ;
           iter ; ++iter )
     {
-        setAttribute(g_quark_to_string(iter->key), iter->value);
+        setAttributeByKey(iter->key, iter->value);
     }
 }
 
@@ -84,7 +84,9 @@ public:
     void setPosition(int pos);
 
     gchar const *attribute(gchar const *key) const;
+    gchar const *attributeByKey(GQuark key) const;
     void setAttribute(gchar const *key, gchar const *value, bool is_interactive=false);
+    void setAttributeByKey(GQuark key, gchar const *value, bool is_interactive=false);
     bool matchAttributeName(gchar const *partial_name) const;
 
     gchar const *content() const;
@@ -92,9 +94,7 @@ public:
 
     void mergeFrom(Node const *src, gchar const *key);
 
-    Inkscape::Util::List<AttributeRecord const> attributeList() const {
-        return _attributes;
-    }
+    Inkscape::Util::List<AttributeRecord const> attributeList() const;
 
     void synthesizeEvents(NodeEventVector const *vector, void *data);
     void synthesizeEvents(NodeObserver &observer);
@@ -126,20 +126,32 @@ protected:
 
     virtual SimpleNode *_duplicate(Document *doc) const=0;
 
+    /// The allocation pool of a SimpleDocument.
+    static GC::BatchPool &_pool(Document *doc);
+
 private:
     void operator=(Node const &); // no assign
 
     void _setParent(SimpleNode *parent);
     unsigned _childPosition(SimpleNode const &child) const;
+    AttributeRecord *_allocateAttributes(unsigned capacity);
 
     SimpleNode *_parent;
     SimpleNode *_next;
+    SimpleNode *_prev; ///< kept so that unlinking a child needs no walk of its siblings
     Document *_document;
     mutable unsigned _cached_position;
 
     int _name;
 
-    Inkscape::Util::MutableList<AttributeRecord> _attributes;
+    /// Attributes in document order. The array is collectable memory, so that
+    /// the collector sees the values.
+    AttributeRecord *_attributes;
+    unsigned _attribute_count;
+    unsigned _attribute_capacity;
+    /// attributeList() as handed out last, until the attributes change
+    mutable Inkscape::Util::List<AttributeRecord const> _attribute_list;
+    mutable bool _attribute_list_valid;
 
     Inkscape::Util::ptr_shared<char> _content;
 
@@ -47,7 +47,7 @@ struct TextNode : public SimpleNode {
     bool is_CData() const { return _is_CData; }
 
 protected:
-    SimpleNode *_duplicate(Document* doc) const { return new TextNode(*this, doc); }
+    SimpleNode *_duplicate(Document* doc) const { return new (_pool(doc)) TextNode(*this, doc); }
     bool _is_CData;
 };
 